@@ -6,6 +6,8 @@
 #include "core\events\event.h"
 #include "core\platform\platform.h"
 #include "core\threading\jobsystem.h"
+#include "core\memory\frameAllocator.h"
+#include "core\memory\memTracker.h"
 #include "renderer\renderer.h"
 
 namespace VulkanTest
@@ -26,9 +28,11 @@ App::App()
     freopen("CONOUT$", "w", stderr);
 
     Logger::RegisterSink(mStdoutLoggerSink);
+    Logger::StartAsync();
     Logger::Info("App initialized.");
      
-    Jobsystem::Initialize(Platform::GetCPUsCount());
+    const U32 workerCount = CommandLine::options.workerCount > 0 ? CommandLine::options.workerCount : Platform::GetCPUsCount();
+    Jobsystem::Initialize(workerCount);
 
     Platform::Initialize();
     Platform::LogPlatformInfo();
@@ -38,6 +42,7 @@ App::App()
 
 App::~App()
 {
+    Logger::StopAsync();
     Platform::Uninitialize();
     Jobsystem::Uninitialize();
 }
@@ -225,10 +230,14 @@ void App::OnEvent(const Platform::WindowEvent& ent)
 
 void App::OnIdle()
 {
+    FrameAllocator::BeginFrame();
     GetWSI().BeginFrame();
 
     Profiler::BeginFrame();
     ProfilerGPU::BeginFrame();
+#ifdef VULKAN_MEMORY_TRACKER
+    MemoryTracker::Get().Update();
+#endif
 
     // Calculate delta time
     deltaTime = timer.Tick();
@@ -26,7 +26,7 @@ namespace VulkanTest
 
 			// Load resource init data from storage
 			ResourceInitData initData;
-			if (!storage->LoadResourceHeader(initData))
+			if (!storage->LoadResourceHeader(res->GetGUID(), initData))
 			{
 				Logger::Warning("Failed to Load resource header");
 				return false;
@@ -74,20 +74,23 @@ namespace VulkanTest
 			if (!storage->IsLoaded())
 				return false;
 
+			DataChunk* toLoad[MAX_RESOURCE_DATA_CHUNKS];
+			U32 count = 0;
 			for (int i = 0; i < MAX_RESOURCE_DATA_CHUNKS; i++)
 			{
 				if ((1 << i) & chunkFlag)
 				{
 					const auto chunk = res->GetChunk(i);
-					if (chunk == nullptr)
-						continue;
-
-					if (!storage->LoadChunk(chunk))
-						return false;
+					if (chunk != nullptr)
+						toLoad[count++] = chunk;
 				}
 			}
 
-			return true;
+			if (count == 0)
+				return true;
+
+			// Chunks are loaded together so that their reads are in flight at the same time
+			return storage->LoadChunks(Span<DataChunk* const>(toLoad, count));
 		}
 
 		void OnEnd()override
@@ -175,7 +178,7 @@ namespace VulkanTest
 
 		// Reinitialize storage
 		ResourceInitData initData;
-		if (!storage->LoadResourceHeader(initData))
+		if (!storage->LoadResourceHeader(GetGUID(), initData))
 		{
 			Logger::Warning("Failed to Load resource header");
 			return;
@@ -263,6 +266,8 @@ namespace VulkanTest
 		if (flags == 0)
 			return false;
 
+		DataChunk* toLoad[MAX_RESOURCE_DATA_CHUNKS];
+		U32 count = 0;
 		for (I32 i = 0; i < MAX_RESOURCE_DATA_CHUNKS; i++)
 		{
 			auto chunk = header.chunks[i];
@@ -271,11 +276,13 @@ namespace VulkanTest
 				&& chunk->IsMissing()
 				&& chunk->ExistsInFile())
 			{
-				if (!storage->LoadChunk(chunk))
-					return false;
+				toLoad[count++] = chunk;
 			}
 		}
-		return true;
+		if (count == 0)
+			return true;
+
+		return storage->LoadChunks(Span<DataChunk* const>(toLoad, count));
 	}
 
 	void BinaryResource::ReleaseChunk(I32 index)
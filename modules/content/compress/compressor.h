@@ -5,10 +5,44 @@
 
 namespace VulkanTest
 {
+	struct CompressionOptions
+	{
+		// LZ4 acceleration, higher is faster to compress with a lower ratio
+		I32 acceleration = 1;
+		// LZ4HC level, higher is slower to compress with a better ratio, 0 to use the fast compressor.
+		// Both are decoded by the same LZ4 decompressor at the same speed
+		I32 hcLevel = 0;
+		// Train a dictionary over small chunks of the storage and compress them with it
+		bool useDictionary = false;
+		U32 maxDictionarySize = 16 * 1024;
+		// Chunks larger than two blocks are compressed as independent blocks, 0 to disable
+		U32 blockSize = 128 * 1024;
+	};
+
+	// Header of block compressed data, followed by the compressed size of each block and the blocks
+	struct CompressedBlocksHeader
+	{
+		U32 blockSize;
+		U32 blockCount;
+	};
+
 	class VULKAN_TEST_API Compressor
 	{
 	public:
-		static bool Compress(OutputMemoryStream& compressedData, U64& compressedSize, Span<const U8> data);
-		static I32  Decompress(const char* source, char* dest, int compressedSize, int maxDecompressedSize);
+		// Only the last window of the dictionary is used by LZ4
+		static constexpr U32 MAX_DICTIONARY_SIZE = 64 * 1024;
+		static constexpr I32 HC_LEVEL_MIN = 1;
+		static constexpr I32 HC_LEVEL_MAX = 12;
+		static constexpr I32 HC_LEVEL_DEFAULT = 9;
+
+		static bool Compress(OutputMemoryStream& compressedData, U64& compressedSize, Span<const U8> data, I32 acceleration = 1, I32 hcLevel = 0, Span<const U8> dictionary = Span<const U8>());
+		static I32  Decompress(const char* source, char* dest, int compressedSize, int maxDecompressedSize, Span<const U8> dictionary = Span<const U8>());
+
+		// Blocks are compressed and decompressed in parallel on the job system, the decompression writes to dest directly
+		static bool CompressBlocks(OutputMemoryStream& compressedData, U64& compressedSize, Span<const U8> data, U32 blockSize, I32 acceleration = 1, I32 hcLevel = 0);
+		static bool DecompressBlocks(Span<const U8> source, U8* dest, U64 decompressedSize);
+
+		// Build a dictionary from the content shared by samples, it's used to compress small chunks which have little redundancy on their own
+		static void TrainDictionary(OutputMemoryStream& dictionary, Span<const Span<const U8>> samples, U32 maxSize);
 	};
 }
\ No newline at end of file
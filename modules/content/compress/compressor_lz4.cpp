@@ -1,15 +1,231 @@
 #include "compressor.h"
 #include "lz4\lz4.h"
+#include "core\collections\hashMap.h"
+#include "core\platform\atomic.h"
 #include "core\profiler\profiler.h"
+#include "core\threading\jobsystem.h"
+#include "math\hash.h"
+
+#include <algorithm>
 
 namespace VulkanTest
 {
-	bool Compressor::Compress(OutputMemoryStream& compressedData, U64& compressedSize, Span<const U8> data)
+    //////////////////////////////////////////////////////////////////////////
+    // LZ4HC, hash chain match finder with lazy matching.
+    // The output is a standard LZ4 block, decoded by LZ4_decompress_safe at the same speed as the fast compressor.
+
+    static constexpr I32 HC_MIN_MATCH = 4;
+    static constexpr I32 HC_MAX_DISTANCE = 65535;
+    // The last match must start 12 bytes before the end and the last 5 bytes are literals
+    static constexpr I32 HC_MF_LIMIT = 12;
+    static constexpr I32 HC_LAST_LITERALS = 5;
+    static constexpr U32 HC_HASH_LOG = 15;
+    static constexpr U32 HC_CHAIN_SIZE = 64 * 1024;
+
+    static U32 ReadU32(const U8* ptr)
+    {
+        U32 value;
+        memcpy(&value, ptr, sizeof(U32));
+        return value;
+    }
+
+    static U32 HashHC(U32 sequence)
+    {
+        return (sequence * 2654435761u) >> (32 - HC_HASH_LOG);
+    }
+
+    struct HCMatchFinder
+    {
+        // Dictionary followed by the data
+        const U8* src = nullptr;
+        I32 maxAttempts = 0;
+        I32 nextToInsert = 0;
+        Array<I32> hashTable;
+        Array<U16> chainTable;  // Distance to the previous position with the same hash, 0 ends the chain
+
+        HCMatchFinder(const U8* src_, I32 level) :
+            src(src_),
+            maxAttempts(1 << (std::min(std::max(level, Compressor::HC_LEVEL_MIN), Compressor::HC_LEVEL_MAX) - 1))
+        {
+            hashTable.resize(1 << HC_HASH_LOG);
+            chainTable.resize(HC_CHAIN_SIZE);
+            for (auto& pos : hashTable)
+                pos = -1;
+        }
+
+        void Insert(I32 target)
+        {
+            while (nextToInsert < target)
+            {
+                const I32 pos = nextToInsert++;
+                I32& head = hashTable[HashHC(ReadU32(src + pos))];
+                const I32 distance = head >= 0 ? pos - head : 0;
+                chainTable[pos & (HC_CHAIN_SIZE - 1)] = (U16)(distance <= HC_MAX_DISTANCE ? distance : 0);
+                head = pos;
+            }
+        }
+
+        // Returns the length of the longest match at pos ending before matchLimit, 0 if there is no match
+        I32 FindMatch(I32 pos, I32 matchLimit, I32& matchPos)
+        {
+            Insert(pos);
+            const U32 sequence = ReadU32(src + pos);
+            I32 candidate = hashTable[HashHC(sequence)];
+            I32 bestLength = 0;
+            for (I32 attempts = maxAttempts; candidate >= 0 && pos - candidate <= HC_MAX_DISTANCE && attempts > 0; attempts--)
+            {
+                // Only candidates longer than the best match are compared
+                if (src[candidate + bestLength] == src[pos + bestLength] && ReadU32(src + candidate) == sequence)
+                {
+                    I32 length = HC_MIN_MATCH;
+                    while (pos + length < matchLimit && src[candidate + length] == src[pos + length])
+                        length++;
+
+                    if (length > bestLength)
+                    {
+                        bestLength = length;
+                        matchPos = candidate;
+                        if (pos + length >= matchLimit)
+                            break;
+                    }
+                }
+
+                const U16 distance = chainTable[candidate & (HC_CHAIN_SIZE - 1)];
+                if (distance == 0)
+                    break;
+                candidate -= distance;
+            }
+            return bestLength >= HC_MIN_MATCH ? bestLength : 0;
+        }
+    };
+
+    static void WriteLength(U8*& op, I32 length)
+    {
+        for (; length >= 255; length -= 255)
+            *op++ = 255;
+        *op++ = (U8)length;
+    }
+
+    // Write a sequence of literals followed by a match, the last sequence has only literals (matchLength is 0)
+    static bool WriteSequence(U8*& op, const U8* oend, const U8* literals, I32 literalLength, I32 offset, I32 matchLength)
+    {
+        const I64 maxSize = 1 + (literalLength / 255 + 1) + literalLength + 2 + (matchLength / 255 + 1);
+        if (oend - op < maxSize)
+            return false;
+
+        U8* token = op++;
+        if (literalLength >= 15)
+        {
+            *token = 15 << 4;
+            WriteLength(op, literalLength - 15);
+        }
+        else
+        {
+            *token = (U8)(literalLength << 4);
+        }
+        memcpy(op, literals, literalLength);
+        op += literalLength;
+        if (matchLength == 0)
+            return true;
+
+        *op++ = (U8)offset;
+        *op++ = (U8)(offset >> 8);
+        const I32 length = matchLength - HC_MIN_MATCH;
+        if (length >= 15)
+        {
+            *token |= 15;
+            WriteLength(op, length - 15);
+        }
+        else
+        {
+            *token |= (U8)length;
+        }
+        return true;
+    }
+
+    // Compress src[dataStart, srcSize), src[0, dataStart) is the dictionary, returns the compressed size or 0 if failed
+    static I32 CompressHC(const U8* src, I32 dataStart, I32 srcSize, U8* dest, I32 destCapacity, I32 level)
+    {
+        U8* op = dest;
+        const U8* oend = dest + destCapacity;
+        I32 anchor = dataStart;
+        if (srcSize - dataStart > HC_MF_LIMIT)
+        {
+            HCMatchFinder finder(src, level);
+            finder.nextToInsert = std::max(0, dataStart - HC_MAX_DISTANCE);
+            const I32 mfLimit = srcSize - HC_MF_LIMIT;
+            const I32 matchLimit = srcSize - HC_LAST_LITERALS;
+            I32 ip = dataStart;
+            while (ip <= mfLimit)
+            {
+                I32 matchPos;
+                I32 matchLength = finder.FindMatch(ip, matchLimit, matchPos);
+                if (matchLength == 0)
+                {
+                    ip++;
+                    continue;
+                }
+
+                // Lazy matching, a longer match at the next position is preferred
+                while (ip + 1 <= mfLimit)
+                {
+                    I32 nextMatchPos;
+                    const I32 nextLength = finder.FindMatch(ip + 1, matchLimit, nextMatchPos);
+                    if (nextLength <= matchLength)
+                        break;
+
+                    ip++;
+                    matchLength = nextLength;
+                    matchPos = nextMatchPos;
+                }
+
+                if (!WriteSequence(op, oend, src + anchor, ip - anchor, ip - matchPos, matchLength))
+                    return 0;
+
+                ip += matchLength;
+                anchor = ip;
+            }
+        }
+
+        if (!WriteSequence(op, oend, src + anchor, srcSize - anchor, 0, 0))
+            return 0;
+        return (I32)(op - dest);
+    }
+
+	bool Compressor::Compress(OutputMemoryStream& compressedData, U64& compressedSize, Span<const U8> data, I32 acceleration, I32 hcLevel, Span<const U8> dictionary)
 	{
         PROFILE_FUNCTION();
         const I32 cap = LZ4_compressBound((I32)data.length());
         compressedData.Resize(cap);
-        compressedSize = LZ4_compress_default((const char*)data.begin(), (char*)compressedData.Data(), (I32)data.length(), cap);
+        if (hcLevel > 0)
+        {
+            if (dictionary.length() > 0)
+            {
+                // The match finder works on the dictionary window followed by the data
+                const U64 dictionarySize = std::min((U64)dictionary.length(), (U64)MAX_DICTIONARY_SIZE);
+                Array<U8> window;
+                window.resize(dictionarySize + data.length());
+                memcpy(window.data(), dictionary.end() - dictionarySize, dictionarySize);
+                memcpy(window.data() + dictionarySize, data.begin(), data.length());
+                compressedSize = CompressHC(window.data(), (I32)dictionarySize, (I32)window.size(), compressedData.Data(), cap, hcLevel);
+            }
+            else
+            {
+                compressedSize = CompressHC(data.begin(), 0, (I32)data.length(), compressedData.Data(), cap, hcLevel);
+            }
+        }
+        else if (dictionary.length() > 0)
+        {
+            LZ4_stream_t stream;
+            LZ4_initStream(&stream, sizeof(stream));
+            LZ4_loadDict(&stream, (const char*)dictionary.begin(), (I32)dictionary.length());
+            compressedSize = LZ4_compress_fast_continue(&stream, (const char*)data.begin(), (char*)compressedData.Data(), (I32)data.length(), cap, acceleration);
+        }
+        else
+        {
+            compressedSize = LZ4_compress_fast((const char*)data.begin(), (char*)compressedData.Data(), (I32)data.length(), cap, acceleration);
+        }
+
         if (compressedSize == 0)
             return false;
 
@@ -17,9 +233,193 @@ namespace VulkanTest
         return true;
 	}
 
-    I32 Compressor::Decompress(const char* source, char* dest, int compressedSize, int maxDecompressedSize)
+    I32 Compressor::Decompress(const char* source, char* dest, int compressedSize, int maxDecompressedSize, Span<const U8> dictionary)
     {
         PROFILE_FUNCTION();
+        if (dictionary.length() > 0)
+            return LZ4_decompress_safe_usingDict(source, dest, compressedSize, maxDecompressedSize, (const char*)dictionary.begin(), (I32)dictionary.length());
+
         return LZ4_decompress_safe(source, dest, compressedSize, maxDecompressedSize);
     }
+
+    bool Compressor::CompressBlocks(OutputMemoryStream& compressedData, U64& compressedSize, Span<const U8> data, U32 blockSize, I32 acceleration, I32 hcLevel)
+    {
+        PROFILE_FUNCTION();
+        ASSERT(blockSize > 0);
+        const U32 blockCount = (U32)((data.length() + blockSize - 1) / blockSize);
+        Array<OutputMemoryStream> blocks;
+        blocks.resize(blockCount);
+
+        volatile I32 failedCount = 0;
+        Jobsystem::ForEach(blockCount, 1, [&](U32 begin, U32 end) {
+            for (U32 i = begin; i < end; i++)
+            {
+                const U64 offset = (U64)i * blockSize;
+                const U64 size = std::min((U64)blockSize, data.length() - offset);
+                U64 blockCompressedSize;
+                if (!Compress(blocks[i], blockCompressedSize, Span<const U8>(data.begin() + offset, size), acceleration, hcLevel))
+                    AtomicIncrement(&failedCount);
+            }
+        });
+        if (failedCount > 0)
+            return false;
+
+        CompressedBlocksHeader header;
+        header.blockSize = blockSize;
+        header.blockCount = blockCount;
+        compressedData.Clear();
+        compressedData.Write(header);
+        for (const auto& block : blocks)
+            compressedData.Write((U32)block.Size());
+        for (const auto& block : blocks)
+            compressedData.Write(block.Data(), block.Size());
+
+        compressedSize = compressedData.Size();
+        return true;
+    }
+
+    bool Compressor::DecompressBlocks(Span<const U8> source, U8* dest, U64 decompressedSize)
+    {
+        PROFILE_FUNCTION();
+        CompressedBlocksHeader header;
+        if (source.length() < sizeof(header))
+            return false;
+
+        memcpy(&header, source.begin(), sizeof(header));
+        const U64 tableSize = sizeof(U32) * (U64)header.blockCount;
+        if (header.blockSize == 0 ||
+            header.blockCount == 0 ||
+            (U64)header.blockSize * header.blockCount < decompressedSize ||
+            (U64)header.blockSize * (header.blockCount - 1) >= decompressedSize ||
+            sizeof(header) + tableSize > source.length())
+            return false;
+
+        // Offsets of blocks in the source
+        Array<U64> offsets;
+        offsets.resize(header.blockCount + 1);
+        const U8* table = source.begin() + sizeof(header);
+        U64 offset = sizeof(header) + tableSize;
+        for (U32 i = 0; i < header.blockCount; i++)
+        {
+            U32 size;
+            memcpy(&size, table + sizeof(U32) * i, sizeof(U32));
+            offsets[i] = offset;
+            offset += size;
+        }
+        offsets[header.blockCount] = offset;
+        if (offset > source.length())
+            return false;
+
+        volatile I32 failedCount = 0;
+        Jobsystem::ForEach(header.blockCount, 1, [&](U32 begin, U32 end) {
+            for (U32 i = begin; i < end; i++)
+            {
+                const U64 destOffset = (U64)i * header.blockSize;
+                const I32 destSize = (I32)std::min((U64)header.blockSize, decompressedSize - destOffset);
+                const I32 ret = LZ4_decompress_safe(
+                    (const char*)source.begin() + offsets[i],
+                    (char*)dest + destOffset,
+                    (I32)(offsets[i + 1] - offsets[i]),
+                    destSize);
+                if (ret != destSize)
+                    AtomicIncrement(&failedCount);
+            }
+        });
+        return failedCount == 0;
+    }
+
+    // Simplified cover algorithm, samples are split into segments which are scored
+    // by the k-mers shared with other samples, the best segments form the dictionary
+    void Compressor::TrainDictionary(OutputMemoryStream& dictionary, Span<const Span<const U8>> samples, U32 maxSize)
+    {
+        PROFILE_FUNCTION();
+        constexpr U32 KMER_SIZE = sizeof(U64);
+        constexpr U32 SEGMENT_SIZE = 64;
+
+        dictionary.Clear();
+        maxSize = std::min(maxSize, MAX_DICTIONARY_SIZE);
+        if (samples.empty() || maxSize == 0)
+            return;
+
+        // Count the samples containing each k-mer
+        struct KmerStat
+        {
+            U32 sampleCount = 0;
+            U32 lastSample = 0xffffffff;
+        };
+        HashMap<U64, KmerStat> kmerStats;
+        for (U32 i = 0; i < (U32)samples.length(); i++)
+        {
+            const auto& sample = samples[i];
+            for (U64 pos = 0; pos + KMER_SIZE <= sample.length(); pos++)
+            {
+                U64 kmer;
+                memcpy(&kmer, sample.begin() + pos, KMER_SIZE);
+                auto it = kmerStats.find(kmer);
+                if (!it.isValid())
+                    it = kmerStats.insert(kmer, KmerStat());
+
+                KmerStat& stat = it.value();
+                if (stat.lastSample != i)
+                {
+                    stat.sampleCount++;
+                    stat.lastSample = i;
+                }
+            }
+        }
+
+        struct Segment
+        {
+            const U8* data;
+            U32 size;
+            U64 score;
+        };
+        Array<Segment> segments;
+        for (const auto& sample : samples)
+        {
+            for (U64 begin = 0; begin + KMER_SIZE <= sample.length(); begin += SEGMENT_SIZE)
+            {
+                const U32 size = (U32)std::min((U64)SEGMENT_SIZE, sample.length() - begin);
+                U64 score = 0;
+                for (U64 pos = begin; pos + KMER_SIZE <= begin + size; pos++)
+                {
+                    U64 kmer;
+                    memcpy(&kmer, sample.begin() + pos, KMER_SIZE);
+                    score += kmerStats.find(kmer).value().sampleCount - 1;
+                }
+
+                if (score > 0)
+                    segments.push_back({ sample.begin() + begin, size, score });
+            }
+        }
+
+        std::sort(segments.begin(), segments.end(), [](const Segment& a, const Segment& b) {
+            return a.score > b.score;
+        });
+
+        // Identical segments are added once
+        HashMap<U64, bool> addedSegments;
+        Array<const Segment*> selected;
+        U32 totalSize = 0;
+        for (const auto& segment : segments)
+        {
+            if (totalSize + segment.size > maxSize)
+                continue;
+
+            const U64 hash = XXHash64(segment.data, segment.size);
+            if (addedSegments.find(hash).isValid())
+                continue;
+
+            addedSegments.insert(hash, true);
+            selected.push_back(&segment);
+            totalSize += segment.size;
+            if (totalSize == maxSize)
+                break;
+        }
+
+        // Closer matches are cheaper, the best segments are placed at the end
+        dictionary.Reserve(totalSize);
+        for (I32 i = (I32)selected.size() - 1; i >= 0; i--)
+            dictionary.Write(selected[i]->data, selected[i]->size);
+    }
 }
\ No newline at end of file
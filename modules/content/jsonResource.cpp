@@ -43,7 +43,7 @@ namespace VulkanTest
 			return false;
 
 		ResourceInitData initData;
-		if (!storage->LoadResourceHeader(initData))
+		if (!storage->LoadResourceHeader(GetGUID(), initData))
 			return false;
 
 		auto dataChunk = initData.header.chunks[0];
@@ -1,6 +1,7 @@
 #include "resourceManager.h"
 #include "loading\resourceLoading.h"
 #include "core\filesystem\filesystem.h"
+#include "core\filesystem\asyncIO.h"
 #include "core\profiler\profiler.h"
 #include "core\engine.h"
 
@@ -485,14 +486,20 @@ namespace VulkanTest
 		if (!guid.IsValid())
 			return false;
 
-#ifdef CJING3D_EDITOR
 		if (cache.Find(guid, info))
 			return true;
 
+		// Find in mounted packages
+		StorageManager::PackageEntry entry;
+		if (StorageManager::FindPackageEntry(guid, entry))
+		{
+			info.guid = guid;
+			info.type = entry.type;
+			info.path = entry.path;
+			return true;
+		}
+
 		return false;
-#else
-		return cache.Find(guid, info);
-#endif
 	}
 
 	bool ResourceManager::GetResourceInfo(const Path& path, ResourceInfo& info)
@@ -600,7 +607,13 @@ namespace VulkanTest
 		// Init resource cache
 		cache.Initialize();
 
+#ifndef CJING3D_EDITOR
+		// Mount cooked packages
+		StorageManager::MountPackages(Globals::ProjectContentFolder);
+#endif
+
 		// Init resource loading
+		AsyncIO::Initialize();
 		ContentLoadingManager::Initialize();
 
 		initialized = true;
@@ -671,6 +684,7 @@ namespace VulkanTest
 
 		// Uninit resource loading
 		ContentLoadingManager::Uninitialize();
+		AsyncIO::Uninitialize();
 
 		// Flush pending objects
 		ObjectService::FlushNow();
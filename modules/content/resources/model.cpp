@@ -10,7 +10,7 @@ namespace VulkanTest
 	REGISTER_BINARY_RESOURCE(Model);
 
 	const U32 Model::FILE_MAGIC = 0x5f4c4d4f;
-	const U32 Model::FILE_VERSION = 0x01;
+	const U32 Model::FILE_VERSION = 0x02;
 
 	namespace
 	{
@@ -137,16 +137,34 @@ namespace VulkanTest
 			I32 indicesCount;
 			input.Read(indexSize);
 
-			// Index only U32 now
-			// if (indexSize != 2 && indexSize != 4)
-			if (indexSize != 4)
+			if (indexSize != 2 && indexSize != 4)
 				return false;
 			input.Read(indicesCount);
 			if (indicesCount <= 0)
 				return false;
 
+			// Indices are always U32 in memory
 			mesh.indices.resize(indicesCount);
-			input.Read(mesh.indices.data(), sizeof(U32) * indicesCount);
+			if (indexSize == 2)
+			{
+				// Widen from the chunk data directly, no temporary copy
+				const U64 dataSize = sizeof(U16) * indicesCount;
+				if (input.GetPos() + dataSize > input.Size())
+					return false;
+
+				const U8* indices16 = (const U8*)input.GetBuffer() + input.GetPos();
+				for (I32 i = 0; i < indicesCount; i++)
+				{
+					U16 index;
+					memcpy(&index, indices16 + i * sizeof(U16), sizeof(U16));
+					mesh.indices[i] = index;
+				}
+				input.SetPos(input.GetPos() + dataSize);
+			}
+			else
+			{
+				input.Read(mesh.indices.data(), sizeof(U32) * indicesCount);
+			}
 
 			// Read vertex datas
 			for (U32 i = 0; i < layout.attributeCount; i++)
@@ -308,7 +326,7 @@ namespace VulkanTest
 			Logger::Warning("Unsupported model file %s", GetPath());
 			return false;
 		}
-		if (header.version != FILE_VERSION)
+		if (header.version == 0 || header.version > FILE_VERSION)
 		{
 			Logger::Warning("Unsupported version of model %s", GetPath());
 			return false;
@@ -368,6 +386,12 @@ namespace VulkanTest
 			auto& lod = modelLods[lodIndex];
 			lod.model = this;
 
+			// Screen size is written since version 2, older models halve it for each lod like the importer without lod errors
+			if (header.version >= 0x02)
+				input.Read(lod.screenSize);
+			else
+				lod.screenSize = lodIndex > 0 ? modelLods[lodIndex - 1].screenSize * 0.5f : 1.0f;
+
 			U16 meshCount = 0;
 			input.Read(meshCount);
 			if (meshCount == 0)
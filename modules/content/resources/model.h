@@ -28,6 +28,7 @@ namespace VulkanTest
 			return meshes;
 		}
 
+		// The lod is used while the projected size (bounding radius / distance) is not larger than it
 		F32 screenSize = 1.0f;
 
 	private:
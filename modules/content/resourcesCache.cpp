@@ -170,8 +170,8 @@ namespace VulkanTest
 		ASSERT(storage);
 		PROFILE_FUNCTION();
 
-		auto entry = storage->GetResourceEntry();
-		ASSERT(entry.guid.IsValid());
+		if (!storage->IsLoaded() && !storage->Load())
+			return;
 
 		ScopedMutex lock(mutex);
 		auto storagePath = storage->GetPath();
@@ -181,26 +181,36 @@ namespace VulkanTest
 				resourceRegistry.erase(it);
 		}
 
-		// Find resource guid collison
-		bool hasCollision = false;
-		ResourceInfo resInfo;
-		if (Find(entry.guid, resInfo))
+		// Package registers all of its entries
+		for (I32 i = 0; i < storage->GetEntriesCount(); i++)
 		{
-			Logger::Warning("Founded duplicated resource %d %d %s", entry.guid.GetHash(), entry.type.GetHashValue(), storagePath.c_str());
-			hasCollision = true;
-			ASSERT(false);
+			const auto& entry = storage->GetEntry(i);
+			ASSERT(entry.guid.IsValid());
+
+			// Find resource guid collison
+			bool hasCollision = false;
+			ResourceInfo resInfo;
+			if (Find(entry.guid, resInfo))
+			{
+				Logger::Warning("Founded duplicated resource %d %d %s", entry.guid.GetHash(), entry.type.GetHashValue(), storagePath.c_str());
+				hasCollision = true;
+				ASSERT(false);
 
-			// TODO Change guid of resource to avoid collisio
+				// TODO Change guid of resource to avoid collisio
+			}
+
+			// Register resource entry, packages have many entries so it is only a dev log
+			Logger::Log(LogLevel::LVL_DEV, "Register resource %d %d %s", entry.guid.GetHash(), entry.type.GetHashValue(), storagePath.c_str());
+			Entry e = {};
+			e.info.guid = entry.guid;
+			e.info.type = entry.type;
+			e.info.path = storagePath;
+			resourceRegistry.insert(entry.guid, e);
 		}
 
-		// Register resource entry
-		Logger::Info("Register resource %d %d %s", entry.guid.GetHash(), entry.type.GetHashValue(), storagePath.c_str());
-		Entry e = {};
-		e.info.guid = entry.guid;
-		e.info.type = entry.type;
-		e.info.path = storagePath;
-		resourceRegistry.insert(entry.guid, e);
-		pathHashMapping.insert(path, entry.guid);
+		// Path mapping is only for single resource
+		if (!storage->IsPackage())
+			pathHashMapping.insert(storagePath, storage->GetResourceEntry().guid);
 
 		isDirty = true;
 	}
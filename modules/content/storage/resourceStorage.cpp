@@ -1,16 +1,26 @@
 #include "resourceStorage.h"
 #include "resourceManager.h"
 #include "core\serialization\fileWriteStream.h"
+#include "core\filesystem\asyncIO.h"
+#include "core\threading\jobsystem.h"
+#include "core\profiler\profiler.h"
 #include "compress\compressor.h"
 
+#include <algorithm>
+
 namespace VulkanTest
 {
 	constexpr U32 COMPRESSION_SIZE_LIMIT = 4096;
+	// Smaller chunks are not worth compressing even with the dictionary
+	constexpr U32 DICTIONARY_CHUNK_SIZE_MIN = 64;
+	constexpr U32 DICTIONARY_SAMPLES_MIN = 8;
 
 	struct VULKAN_TEST_API ResourceStorageHeader
 	{
 		static constexpr U32 MAGIC = 'FACK';
-		static constexpr U32 VERSION = 0x01;
+		// 0x02: Chunk codecs and the dictionary of small chunks
+		// 0x03: Block compressed chunks
+		static constexpr U32 VERSION = 0x03;
 
 		U32 magic = MAGIC;
 		U32 version = 0;
@@ -19,6 +29,9 @@ namespace VulkanTest
 	};
 
 	ResourceStorage::StorageLock ResourceStorage::StorageLock::Invalid(nullptr);
+	ResourceStorage::ReadMode ResourceStorage::CurrentReadMode = ResourceStorage::ReadMode::Auto;
+	U64 ResourceStorage::AsyncReadBatchSize = 4 * 1024 * 1024;
+	ResourceStorage::IOStats ResourceStorage::Stats;
 
 	ResourceStorage::ResourceStorage(const Path& path_) :
 		path(path_),
@@ -51,8 +64,9 @@ namespace VulkanTest
 		// Resource format
 		// -----------------------------------
 		// ResourceStorageHeader
-		// Entries
+		// Entries (sorted by guid)
 		// Chunk locations
+		// Dictionary (version >= 0x02)
 		// resource header (count == entries count)
 		// Chunk datas
 
@@ -65,21 +79,28 @@ namespace VulkanTest
 			return false;
 		}
 
-		if (resHeader.version != ResourceStorageHeader::VERSION)
+		if (resHeader.version == 0 || resHeader.version > ResourceStorageHeader::VERSION)
 		{
 			Logger::Warning("Invalid compiled resource %s", GetPath().c_str());
 			return false;
 		}
 
 		// Entries
-		ASSERT_MSG(resHeader.assetsCount == 1, "Unsupport multiple resources now");
-		for (U32 i = 0; i < resHeader.assetsCount; i++)
+		if (resHeader.assetsCount == 0)
 		{
-			ResourceEntry entry;
-			inputMem->Read(entry);
-			this->entry = entry;
+			Logger::Warning("Empty compiled resource %s", GetPath().c_str());
+			return false;
 		}
 
+		entries.resize(resHeader.assetsCount);
+		inputMem->Read(entries.data(), sizeof(ResourceEntry) * resHeader.assetsCount);
+
+		auto CompareEntry = [](const ResourceEntry& a, const ResourceEntry& b) {
+			return a.guid < b.guid;
+		};
+		if (!std::is_sorted(entries.begin(), entries.end(), CompareEntry))
+			std::sort(entries.begin(), entries.end(), CompareEntry);
+
 		// Chunk locations
 		for (U32 i = 0; i < resHeader.chunksCount; i++)
 		{
@@ -91,12 +112,32 @@ namespace VulkanTest
 				return false;
 			}
 
+			U8 codec;
+			inputMem->Read(codec);
+			if (codec >= (U8)ChunkCodec::Count)
+			{
+				Logger::Warning("Invalid chunk codec %s", GetPath().c_str());
+				return false;
+			}
+
 			auto chunk = CJING_NEW(DataChunk);
 			chunk->location = location;
-			inputMem->Read(chunk->compressed);
+			chunk->codec = (ChunkCodec)codec;
 			chunks.push_back(chunk);
 		}
 
+		// Dictionary of small chunks
+		if (resHeader.version >= 0x02)
+		{
+			U32 dictionarySize;
+			inputMem->Read(dictionarySize);
+			if (dictionarySize > 0)
+			{
+				dictionary.Resize(dictionarySize);
+				inputMem->Read(dictionary.Data(), dictionarySize);
+			}
+		}
+
 		isLoaded = true;
 		return true;
 	}
@@ -111,6 +152,8 @@ namespace VulkanTest
 		for (auto chunk : chunks)
 			CJING_SAFE_DELETE(chunk);
 		chunks.clear();
+		entries.clear();
+		dictionary.Free();
 
 		isLoaded = false;
 	}
@@ -143,7 +186,37 @@ namespace VulkanTest
 	bool ResourceStorage::LoadResourceHeader(ResourceInitData& initData)
 	{
 		ASSERT(isLoaded);
+		if (entries.empty())
+			return false;
+
+		return LoadResourceHeader(entries[0], initData);
+	}
+
+	bool ResourceStorage::LoadResourceHeader(const Guid& guid, ResourceInitData& initData)
+	{
+		ASSERT(isLoaded);
+		const I32 index = FindEntry(guid);
+		if (index < 0)
+		{
+			Logger::Warning("Missing resource %s in %s", guid.ToString(Guid::FormatType::N).c_str(), GetPath().c_str());
+			return false;
+		}
+
+		return LoadResourceHeader(entries[index], initData);
+	}
+
+	I32 ResourceStorage::FindEntry(const Guid& guid) const
+	{
+		auto it = std::lower_bound(entries.begin(), entries.end(), guid, [](const ResourceEntry& entry, const Guid& guid) {
+			return entry.guid < guid;
+		});
+		if (it == entries.end() || it->guid != guid)
+			return -1;
+		return I32(it - entries.begin());
+	}
 
+	bool ResourceStorage::LoadResourceHeader(const ResourceEntry& entry, ResourceInitData& initData)
+	{
 		FileReadStream* input = LoadContent();
 		if (input == nullptr)
 			return false;
@@ -159,6 +232,11 @@ namespace VulkanTest
 
 		// Guid
 		input->Read(initData.header.guid);
+		if (initData.header.guid != entry.guid)
+		{
+			Logger::Warning("Invalid resource header %s", GetPath().c_str());
+			return false;
+		}
 
 		// Type
 		U64 hash = input->Read<U64>();
@@ -194,6 +272,39 @@ namespace VulkanTest
 		return true;
 	}
 
+	static bool DecompressChunk(DataChunk* chunk, const U8* src, I32 size, I32 originalSize, Span<const U8> dictionary)
+	{
+		chunk->mem.Free();
+		if (chunk->codec == ChunkCodec::LZ4Blocks)
+		{
+			// Blocks are decompressed in parallel into the chunk memory
+			chunk->mem.Resize((U64)originalSize);
+			if (!Compressor::DecompressBlocks(Span<const U8>(src, size), chunk->mem.Data(), (U64)originalSize))
+			{
+				chunk->mem.Free();
+				return false;
+			}
+			return true;
+		}
+
+		chunk->mem.Allocate((U64)originalSize);
+		I32 decompressedSize = Compressor::Decompress(
+			(const char*)src,
+			(char*)chunk->mem.Data(),
+			size,
+			originalSize,
+			chunk->codec == ChunkCodec::LZ4Dict ? dictionary : Span<const U8>());
+
+		if (decompressedSize != originalSize)
+		{
+			chunk->mem.Free();
+			return false;
+		}
+
+		chunk->mem.Resize(decompressedSize);
+		return true;
+	}
+
 	bool ResourceStorage::LoadChunk(DataChunk* chunk)
 	{
 		ASSERT(isLoaded);
@@ -208,15 +319,43 @@ namespace VulkanTest
 			return false;
 		}
 
+		StorageLock lock(this);
+		auto size = chunk->location.Size;
+
+		// Read chunks from the mapped file directly, uncompressed chunks are not copied
+		const U8* mappedData = CurrentReadMode != ReadMode::Blocking ? MapContent() : nullptr;
+		if (mappedData != nullptr)
+		{
+			if ((U64)chunk->location.Address + size > mappedFile->Size())
+			{
+				Logger::Warning("Invalid chunk location in %s", path.c_str());
+				return false;
+			}
+
+			const U8* src = mappedData + chunk->location.Address;
+			if (chunk->IsCompressed())
+			{
+				I32 originalSize;
+				memcpy(&originalSize, src, sizeof(I32));
+				if (!DecompressChunk(chunk, src + sizeof(I32), I32(size - sizeof(I32)), originalSize, dictionary))
+					return false;
+			}
+			else
+			{
+				chunk->LinkMapped(src, size);
+			}
+
+			chunk->RegisterUsage();
+			return true;
+		}
+
 		FileReadStream* input = LoadContent();
 		if (input == nullptr)
 			return false;
 
-		StorageLock lock(this);
 		input->SetPos(chunk->location.Address);
-
-		auto size = chunk->location.Size;
-		if (chunk->compressed)
+		AtomicAdd(&Stats.copiedBytes, 2 * (I64)size);
+		if (chunk->IsCompressed())
 		{
 			size -= sizeof(I32);
 			I32 originalSize;
@@ -226,17 +365,8 @@ namespace VulkanTest
 			tmp.Resize(size);
 			input->Read(tmp.Data(), size);
 
-			chunk->mem.Allocate((U64)originalSize);
-			I32 decompressedSize = Compressor::Decompress(
-				(char*)tmp.Data(),
-				(char*)chunk->mem.Data() + chunk->mem.Size(),
-				I32(size),
-				I32(originalSize));
-
-			if (decompressedSize != originalSize)
+			if (!DecompressChunk(chunk, tmp.Data(), I32(size), originalSize, dictionary))
 				return false;
-
-			chunk->mem.Resize(decompressedSize);
 		}
 		else
 		{
@@ -248,6 +378,197 @@ namespace VulkanTest
 		return true;
 	}
 
+	struct ChunkLoadBatch;
+
+	struct ChunkRead
+	{
+		ChunkLoadBatch* batch = nullptr;
+		DataChunk* chunk = nullptr;
+		// Compressed data with the original size at the beginning, read into compressedData or in the mapped file
+		Span<const U8> source;
+		OutputMemoryStream compressedData;
+	};
+
+	struct ChunkLoadBatch
+	{
+		Array<ChunkRead> reads;
+		Span<const U8> dictionary;
+		volatile I32 pendingReads = 0;
+		volatile I32 failedCount = 0;
+		Semaphore readsDone{ 0, 1 };
+		Jobsystem::JobHandle jobHandle;
+	};
+
+	static void DecompressChunkJob(void* data)
+	{
+		ChunkRead* read = static_cast<ChunkRead*>(data);
+		const U8* src = read->source.data();
+		I32 originalSize;
+		memcpy(&originalSize, src, sizeof(I32));
+		I32 size = I32(read->source.length() - sizeof(I32));
+		if (!DecompressChunk(read->chunk, src + sizeof(I32), size, originalSize, read->batch->dictionary))
+			AtomicIncrement(&read->batch->failedCount);
+		read->compressedData.Free();
+	}
+
+	static void RunDecompressChunkJob(ChunkRead& read)
+	{
+		// Blocks are short jobs split from the decompression job, they inherit its priority,
+		// so they are spread on all workers instead of the few long running workers
+		const auto priority = read.chunk->codec == ChunkCodec::LZ4Blocks ? Jobsystem::JobPriority::Normal : Jobsystem::JobPriority::LongRunning;
+		Jobsystem::Run(&read, DecompressChunkJob, &read.batch->jobHandle, Jobsystem::ANY_WORKER, priority);
+	}
+
+	// Called on the io thread, decompression is kicked as a job so that the io thread is never blocked
+	static void OnChunkRead(void* data, bool success)
+	{
+		ChunkRead* read = static_cast<ChunkRead*>(data);
+		ChunkLoadBatch* batch = read->batch;
+		if (!success)
+		{
+			AtomicIncrement(&batch->failedCount);
+		}
+		else if (read->chunk->IsCompressed())
+		{
+			RunDecompressChunkJob(*read);
+		}
+
+		if (AtomicDecrement(&batch->pendingReads) == 0)
+			batch->readsDone.Signal();
+	}
+
+	bool ResourceStorage::LoadChunks(Span<DataChunk* const> toLoad)
+	{
+		PROFILE_FUNCTION();
+		ASSERT(isLoaded);
+
+		StorageLock lock(this);
+		const U8* mappedData = CurrentReadMode != ReadMode::Blocking ? MapContent() : nullptr;
+
+		Array<DataChunk*> toRead;
+		U64 readSize = 0;
+		for (DataChunk* chunk : toLoad)
+		{
+			if (chunk == nullptr || chunk->IsLoaded())
+				continue;
+
+			ASSERT(chunks.indexOf(chunk) != -1);
+			if (!chunk->ExistsInFile())
+			{
+				Logger::Warning("Invalid chunk");
+				return false;
+			}
+
+			// Uncompressed chunks are just views into the mapping
+			if (mappedData != nullptr && !chunk->IsCompressed())
+			{
+				if (!LoadChunk(chunk))
+					return false;
+				continue;
+			}
+			toRead.push_back(chunk);
+			readSize += chunk->location.Size;
+		}
+
+		// Single chunks have nothing to overlap, they are read from the mapping or by the file stream
+		const bool isBatch = toRead.size() > 1 && CurrentReadMode != ReadMode::Blocking;
+		const bool useAsyncIO = isBatch && (mappedData == nullptr ||
+			CurrentReadMode == ReadMode::Async ||
+			(CurrentReadMode == ReadMode::Auto && readSize >= AsyncReadBatchSize));
+		AsyncFile* file = useAsyncIO && AsyncIO::IsInitialized() ? OpenAsyncContent() : nullptr;
+		if (file == nullptr && (!isBatch || mappedData == nullptr))
+		{
+			for (auto chunk : toRead)
+			{
+				if (!LoadChunk(chunk))
+					return false;
+			}
+			return true;
+		}
+
+		auto FinishBatch = [&](ChunkLoadBatch& batch) {
+			if (batch.failedCount > 0)
+			{
+				Logger::Warning("Failed to load chunks of %s", path.c_str());
+				for (auto chunk : toRead)
+					chunk->Unload();
+				return false;
+			}
+
+			for (auto chunk : toRead)
+				chunk->RegisterUsage();
+			return true;
+		};
+
+		// Compressed chunks of the mapped file are decompressed from the mapping in parallel without any read
+		if (file == nullptr)
+		{
+			for (auto chunk : toRead)
+			{
+				if ((U64)chunk->location.Address + chunk->location.Size > mappedFile->Size())
+				{
+					Logger::Warning("Invalid chunk location in %s", path.c_str());
+					return false;
+				}
+			}
+
+			ChunkLoadBatch batch;
+			batch.dictionary = dictionary;
+			batch.reads.resize(toRead.size());
+			for (U32 i = 0; i < toRead.size(); i++)
+			{
+				DataChunk* chunk = toRead[i];
+				ChunkRead& read = batch.reads[i];
+				read.batch = &batch;
+				read.chunk = chunk;
+				read.source = Span<const U8>(mappedData + chunk->location.Address, chunk->location.Size);
+				RunDecompressChunkJob(read);
+			}
+			Jobsystem::Wait(&batch.jobHandle);
+			return FinishBatch(batch);
+		}
+
+		// All reads are queued at once, io sorts them by file offset
+		ChunkLoadBatch batch;
+		batch.dictionary = dictionary;
+		batch.reads.resize(toRead.size());
+		batch.pendingReads = (I32)toRead.size();
+
+		Array<AsyncReadRequest> requests;
+		requests.resize(toRead.size());
+		for (U32 i = 0; i < toRead.size(); i++)
+		{
+			DataChunk* chunk = toRead[i];
+			ChunkRead& read = batch.reads[i];
+			read.batch = &batch;
+			read.chunk = chunk;
+
+			AsyncReadRequest& request = requests[i];
+			request.file = file;
+			request.offset = chunk->location.Address;
+			request.size = chunk->location.Size;
+			request.callback = OnChunkRead;
+			request.userData = &read;
+			AtomicAdd(&Stats.copiedBytes, (I64)chunk->location.Size);
+			if (chunk->IsCompressed())
+			{
+				read.compressedData.Resize(chunk->location.Size);
+				read.source = Span<const U8>(read.compressedData.Data(), read.compressedData.Size());
+				request.buffer = read.compressedData.Data();
+			}
+			else
+			{
+				chunk->mem.Resize(chunk->location.Size);
+				request.buffer = chunk->mem.Data();
+			}
+		}
+
+		AsyncIO::Read(Span<const AsyncReadRequest>(requests.data(), requests.size()));
+		batch.readsDone.Wait();
+		Jobsystem::Wait(&batch.jobHandle);
+		return FinishBatch(batch);
+	}
+
 	DataChunk* ResourceStorage::AllocateChunk()
 	{
 		auto chunk = CJING_NEW(DataChunk);
@@ -308,46 +629,104 @@ namespace VulkanTest
 		return ret;
 	}
 
+	bool ResourceStorage::CreatePackage(const Path& path, Span<const ResourceInitData* const> datas, const CompressionOptions& options)
+	{
+		auto storage = StorageManager::EnsureAccess(path);
+		auto stream = FileWriteStream::Open(path);
+		if (stream == nullptr)
+			return false;
+
+		bool ret = Save(*stream, datas, options);
+
+		CJING_DELETE(stream);
+
+		// Reload storage if is loaded
+		if (storage)
+			storage->Reload();
+
+		return ret;
+	}
+
 	bool ResourceStorage::Save(IOutputStream& output, const ResourceInitData& data)
 	{
+		const ResourceInitData* datas[] = { &data };
+		return Save(output, Span<const ResourceInitData* const>(datas, 1));
+	}
+
+	bool ResourceStorage::Save(IOutputStream& output, Span<const ResourceInitData* const> datas, const CompressionOptions& options)
+	{
+		if (datas.empty())
+			return false;
+
+		// Entries are sorted by guid, so that the entry could be found by binary search
+		Array<const ResourceInitData*> sortedDatas;
+		for (auto data : datas)
+			sortedDatas.push_back(data);
+		std::sort(sortedDatas.begin(), sortedDatas.end(), [](const ResourceInitData* a, const ResourceInitData* b) {
+			return a->header.guid < b->header.guid;
+		});
+
+		// Chunks of all resources are stored together
 		Array<DataChunk*> chunks;
-		for (I32 i = 0; i < MAX_RESOURCE_DATA_CHUNKS; i++)
+		for (auto data : sortedDatas)
 		{
-			if (data.header.chunks[i] != nullptr && data.header.chunks[i]->IsLoaded())
-				chunks.push_back(data.header.chunks[i]);
+			for (I32 i = 0; i < MAX_RESOURCE_DATA_CHUNKS; i++)
+			{
+				if (data->header.chunks[i] != nullptr && data->header.chunks[i]->IsLoaded())
+					chunks.push_back(data->header.chunks[i]);
+			}
+		}
+
+		// Small chunks have little redundancy on their own, they share a dictionary trained over them
+		OutputMemoryStream dictionary;
+		if (options.useDictionary)
+		{
+			Array<Span<const U8>> samples;
+			for (auto chunk : chunks)
+			{
+				if (chunk->Size() >= DICTIONARY_CHUNK_SIZE_MIN && chunk->Size() <= COMPRESSION_SIZE_LIMIT)
+					samples.push_back(Span<const U8>(chunk->Data(), chunk->Size()));
+			}
+
+			if (samples.size() >= DICTIONARY_SAMPLES_MIN)
+				Compressor::TrainDictionary(dictionary, Span<const Span<const U8>>(samples.data(), samples.size()), options.maxDictionarySize);
 		}
 
 		// Resource format
 		// -----------------------------------
 		// ResourceStorageHeader
-		// Entries
+		// Entries (sorted by guid)
 		// Chunk locations
-		// Chunk mapping (count == entries count)
+		// Dictionary
+		// Resource headers (count == entries count)
 		// Chunk datas
 
 		// Write header
 		ResourceStorageHeader header;
 		header.magic = ResourceStorageHeader::MAGIC;
 		header.version = ResourceStorageHeader::VERSION;
-		header.assetsCount = 1;
+		header.assetsCount = sortedDatas.size();
 		header.chunksCount = chunks.size();
 		output.Write(header);
 
-		// Write entry
-		U32 currentAddress = sizeof(header) + sizeof(entry) + (sizeof(DataChunk::location) + sizeof(U8)) * header.chunksCount;
-
-		ResourceStorage::ResourceEntry entry;
-		entry.guid = data.header.guid;
-		entry.type = data.header.type;
-		entry.address = currentAddress;
-		output.Write(entry);
-
-		// Entry address -> ReasourceHeader(Guid, ResourceType, chunkMapping)
-		currentAddress += 
-			sizeof(Guid) +								// GUID
-			sizeof(U64) +								// TypeName
-			sizeof(ChunkMapping) +						// ChunkMapping
-			sizeof(I32) + (U32)data.customData.Size();  // Custom data size + data
+		// Write entries
+		U32 currentAddress = sizeof(header) + sizeof(ResourceEntry) * header.assetsCount + (sizeof(DataChunk::location) + sizeof(U8)) * header.chunksCount;
+		currentAddress += sizeof(U32) + (U32)dictionary.Size();
+		for (auto data : sortedDatas)
+		{
+			// Entry address -> ReasourceHeader(Guid, ResourceType, chunkMapping)
+			ResourceStorage::ResourceEntry entry;
+			entry.guid = data->header.guid;
+			entry.type = data->header.type;
+			entry.address = currentAddress;
+			output.Write(entry);
+
+			currentAddress +=
+				sizeof(Guid) +									// GUID
+				sizeof(U64) +									// TypeName
+				sizeof(ChunkMapping) +							// ChunkMapping
+				sizeof(I32) + (U32)data->customData.Size();		// Custom data size + data
+		}
 
 		// Compress chunk
 		Array<OutputMemoryStream> compressedChunks;
@@ -355,28 +734,49 @@ namespace VulkanTest
 		for (U32 i = 0; i < header.chunksCount; i++)
 		{
 			auto chunk = chunks[i];
-			bool compressed = chunk->compressed;
-			if (!compressed && chunk->Size() > COMPRESSION_SIZE_LIMIT)
-				compressed = true;
+			ChunkCodec codec = chunk->codec;
+			if (codec == ChunkCodec::None)
+			{
+				if (chunk->Size() > COMPRESSION_SIZE_LIMIT)
+					codec = ChunkCodec::LZ4;
+				else if (chunk->Size() >= DICTIONARY_CHUNK_SIZE_MIN && dictionary.Size() > 0)
+					codec = ChunkCodec::LZ4Dict;
+			}
+			if (codec == ChunkCodec::LZ4Dict && dictionary.Size() == 0)
+				codec = ChunkCodec::LZ4;
+
+			// Large chunks are split into blocks decompressed in parallel
+			if (codec == ChunkCodec::LZ4 || codec == ChunkCodec::LZ4Blocks)
+				codec = options.blockSize > 0 && chunk->Size() > (U64)options.blockSize * 2 ? ChunkCodec::LZ4Blocks : ChunkCodec::LZ4;
 
-			if (compressed)
+			if (codec != ChunkCodec::None)
 			{
 				U64 compressedSize;
-				if (!Compressor::Compress(compressedChunks[i], compressedSize, chunk->mem))
+				bool ret;
+				if (codec == ChunkCodec::LZ4Blocks)
+				{
+					ret = Compressor::CompressBlocks(compressedChunks[i], compressedSize, chunk->mem, options.blockSize, options.acceleration, options.hcLevel);
+				}
+				else
+				{
+					Span<const U8> chunkDictionary = codec == ChunkCodec::LZ4Dict ? Span<const U8>(dictionary.Data(), dictionary.Size()) : Span<const U8>();
+					ret = Compressor::Compress(compressedChunks[i], compressedSize, chunk->mem, options.acceleration, options.hcLevel, chunkDictionary);
+				}
+
+				if (!ret)
 				{
 					Logger::Error("Could not compress chunk");
 					return false;
 				}
 
-				// TODO
-				//if (compressedSize <= 0 || compressedSize > I32(chunk->Size() / 4 * 3))
-				//{
-				//	compressedChunks.clear();
-				//	compressed = false;
-				//}
-	
-				chunk->compressed = compressed;
+				// Small chunks are kept raw if the dictionary doesn't help
+				if (codec == ChunkCodec::LZ4Dict && compressedSize + sizeof(I32) >= chunk->Size())
+				{
+					compressedChunks[i].Free();
+					codec = ChunkCodec::None;
+				}
 			}
+			chunk->codec = codec;
 		}
 
 		// Write chunk locations
@@ -391,27 +791,34 @@ namespace VulkanTest
 			currentAddress += (U32)size;
 
 			output.Write(chunks[i]->location);
-			output.Write(chunks[i]->compressed);
+			output.Write((U8)chunks[i]->codec);
 		}
 
-		// Write resource header
+		// Write dictionary
+		output.Write((U32)dictionary.Size());
+		if (dictionary.Size() > 0)
+			output.Write(dictionary.Data(), dictionary.Size());
+
+		// Write resource headers
 		// ---------------------------------------
 		// Guid
 		// Type
 		// Chunk mapping
 		// Custom data
+		for (auto data : sortedDatas)
+		{
+			output.Write(data->header.guid);
+			output.Write(data->header.type.GetHashValue());
 
-		output.Write(data.header.guid);
-		output.Write(data.header.type.GetHashValue());
+			ChunkMapping chunkMapping;
+			for (U32 i = 0; i < MAX_RESOURCE_DATA_CHUNKS; i++)
+				chunkMapping.chunkIndex[i] = data->header.chunks[i] != nullptr ? chunks.indexOf(data->header.chunks[i]) : INVALID_CHUNK_INDEX;
+			output.Write(chunkMapping);
 
-		ChunkMapping chunkMapping;
-		for (U32 i = 0; i < MAX_RESOURCE_DATA_CHUNKS; i++)
-			chunkMapping.chunkIndex[i] = chunks.indexOf(data.header.chunks[i]);
-		output.Write(chunkMapping);
-
-		output.Write((I32)data.customData.Size());
-		if (data.customData.Size() > 0)
-			output.Write(data.customData.Data(), data.customData.Size());
+			output.Write((I32)data->customData.Size());
+			if (data->customData.Size() > 0)
+				output.Write(data->customData.Data(), data->customData.Size());
+		}
 
 		// Write chunk data
 		for (U32 i = 0; i < header.chunksCount; i++)
@@ -447,10 +854,38 @@ namespace VulkanTest
 			}
 
 			stream = CJING_NEW(FileReadStream)(std::move(file_));
+			AtomicIncrement(&Stats.fileOpens);
 		}
 		return stream;
 	}
 
+	const U8* ResourceStorage::MapContent()
+	{
+		ScopedMutex lock(mutex);
+		if (!mappedFile)
+		{
+			auto file_ = FileSystem::OpenFile(path.c_str(), (FileFlags)((int)FileFlags::READ | (int)FileFlags::MMAP));
+			if (!file_ || !file_->IsValid())
+				return nullptr;
+
+			mappedFile = std::move(file_);
+			AtomicIncrement(&Stats.fileOpens);
+		}
+		return (const U8*)mappedFile->GetMappedData();
+	}
+
+	AsyncFile* ResourceStorage::OpenAsyncContent()
+	{
+		ScopedMutex lock(mutex);
+		if (asyncFile == nullptr)
+		{
+			asyncFile = AsyncIO::OpenFile(path.c_str());
+			if (asyncFile != nullptr)
+				AtomicIncrement(&Stats.fileOpens);
+		}
+		return asyncFile;
+	}
+
 	void ResourceStorage::CloseContent()
 	{
 		I32 waitTime = 10;
@@ -460,13 +895,34 @@ namespace VulkanTest
 		if (AtomicRead(&chunksLock) != 0)
 		{
 			// Storage can be locked by some streaming tasks
-			auto entry = GetResourceEntry();
-			auto res = ResourceManager::GetResource(entry.guid);
-			if (res != nullptr)
-				res->CancelStreaming();
+			for (const auto& entry : entries)
+			{
+				auto res = ResourceManager::GetResource(entry.guid);
+				if (res != nullptr)
+					res->CancelStreaming();
+			}
 		}
 
 		ASSERT(chunksLock == 0);
 		file.DeleteAll();
+
+		// Mapped chunks can not outlive the mapping
+		for (auto chunk : chunks)
+		{
+			if (chunk->IsMapped())
+				chunk->Unload();
+		}
+
+		ScopedMutex lock(mutex);
+		if (mappedFile)
+		{
+			mappedFile->Close();
+			mappedFile.Reset();
+		}
+		if (asyncFile != nullptr)
+		{
+			AsyncIO::CloseFile(asyncFile);
+			asyncFile = nullptr;
+		}
 	}
 }
\ No newline at end of file
@@ -6,10 +6,12 @@
 #include "core\serialization\fileReadStream.h"
 #include "core\utils\threadLocal.h"
 #include "core\serialization\stream.h"
+#include "content\compress\compressor.h"
 
 namespace VulkanTest
 {
 	class ResourceManager;
+	struct AsyncFile;
 
 	class VULKAN_TEST_API ResourceStorage : public Object
 	{
@@ -26,6 +28,34 @@ namespace VulkanTest
 			I32 chunkIndex[MAX_RESOURCE_DATA_CHUNKS];
 		};
 
+		// How chunks are read from the storage files
+		enum class ReadMode
+		{
+			// Small batches are decompressed from the mapping, large batches are read by AsyncIO
+			Auto,
+			// Chunks are decompressed from the mapping
+			Mapped,
+			// Batches are read by AsyncIO, single chunks are decompressed from the mapping
+			Async,
+			// Chunks are read one by one by the file stream of the loading thread
+			Blocking
+		};
+		static ReadMode CurrentReadMode;
+		// Batches of compressed chunks at least this large are read by AsyncIO in the Auto mode,
+		// the reads are kept in flight instead of page faults of the mapping blocking the decompression jobs
+		static U64 AsyncReadBatchSize;
+
+		// Counters of the storage io, the benchmarks report their deltas
+		struct IOStats
+		{
+			// Bytes copied from the storage files to memory, the outputs of the decompression are not counted.
+			// The file stream copies twice (into its buffer and out of it), AsyncIO once, the mapping doesn't copy
+			volatile I64 copiedBytes = 0;
+			// Files opened by the storages, by the file streams, the mappings and AsyncIO
+			volatile I32 fileOpens = 0;
+		};
+		static IOStats Stats;
+
 		ResourceStorage(const Path& path_);
 		virtual ~ResourceStorage();
 
@@ -33,7 +63,10 @@ namespace VulkanTest
 		void Unload();
 		void Tick();
 		bool LoadResourceHeader(ResourceInitData& initData);
+		bool LoadResourceHeader(const Guid& guid, ResourceInitData& initData);
 		bool LoadChunk(DataChunk* chunk);
+		// Load chunks together, reads are kept in flight and compressed chunks are decompressed by jobs
+		bool LoadChunks(Span<DataChunk* const> toLoad);
 		DataChunk* AllocateChunk();
 		bool ShouldDispose()const;
 		bool Reload();
@@ -67,10 +100,26 @@ namespace VulkanTest
 				lastRefLoseTime = (F32)Timer::GetRawTimestamp() / (F32)Timer::GetFrequency();
 		}
 
+		// Get the first entry, a single resource storage has only one entry
 		ResourceEntry GetResourceEntry() {
-			return entry;
+			return entries.empty() ? ResourceEntry() : entries[0];
+		}
+
+		// Entries are sorted by guid
+		I32 GetEntriesCount()const {
+			return entries.size();
+		}
+
+		const ResourceEntry& GetEntry(I32 index)const {
+			return entries[index];
 		}
 
+		bool IsPackage()const {
+			return entries.size() > 1;
+		}
+
+		I32 FindEntry(const Guid& guid)const;
+
 		I32 GetReference() const;
 
 		// Scoed locker
@@ -127,16 +176,28 @@ namespace VulkanTest
 		static bool Create(const Path& path, const ResourceInitData& initData);
 		static bool Save(IOutputStream& output, const ResourceInitData& data);
 
+		// Package holds multiple resources sharing one file and one table of contents
+		static bool CreatePackage(const Path& path, Span<const ResourceInitData* const> datas, const CompressionOptions& options = CompressionOptions());
+		static bool Save(IOutputStream& output, Span<const ResourceInitData* const> datas, const CompressionOptions& options = CompressionOptions());
+
 		DelegateList<void(ResourceStorage*, bool)> OnReloaded; 
 #endif
 
 	private:
 		FileReadStream* LoadContent();
+		const U8* MapContent();
+		AsyncFile* OpenAsyncContent();
+		bool LoadResourceHeader(const ResourceEntry& entry, ResourceInitData& initData);
 
 		Path path;
-		ResourceEntry entry;
+		Array<ResourceEntry> entries;
 		Array<DataChunk*> chunks;
 		ThreadLocalObject<FileReadStream> file;
+		// Shared by all threads, uncompressed chunks are views into the mapping
+		UniquePtr<File> mappedFile;
+		AsyncFile* asyncFile = nullptr;
+		// Shared by small chunks compressed by ChunkCodec::LZ4Dict
+		OutputMemoryStream dictionary;
 		bool isLoaded = false;
 		Mutex mutex;
 		volatile I64 chunksLock;
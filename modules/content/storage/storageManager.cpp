@@ -1,6 +1,7 @@
 #include "storageManager.h"
 #include "resourceManager.h"
 #include "core\engine.h"
+#include "core\filesystem\filesystem.h"
 
 namespace VulkanTest
 {
@@ -11,6 +12,9 @@ namespace VulkanTest
 		Array<std::pair<U64, ResourceStorage*>> toRemoved;
 		Mutex mutex;
 
+		HashMap<Guid, StorageManager::PackageEntry> packageEntries;
+		Mutex packageMutex;
+
 	public:
 		StorageServiceImpl() :
 			EngineService("StorageServiceImpl", -999)
@@ -56,6 +60,11 @@ namespace VulkanTest
 				}
 			}
 			storageMap.clear();
+
+			packageMutex.Lock();
+			packageEntries.clear();
+			packageMutex.Unlock();
+
 			initialized = false;
 		}
 	};
@@ -117,4 +126,57 @@ namespace VulkanTest
 
 		return ResourceStorageRef(ret);
 	}
+
+	bool StorageManager::MountPackage(const Path& path)
+	{
+		auto storage = GetStorage(path, true);
+		if (!storage)
+			return false;
+
+		auto& impl = StorageServiceImplInstance;
+		ScopedMutex lock(impl.packageMutex);
+		for (I32 i = 0; i < storage->GetEntriesCount(); i++)
+		{
+			const auto& entry = storage->GetEntry(i);
+			auto it = impl.packageEntries.find(entry.guid);
+			if (it.isValid())
+			{
+				Logger::Warning("Duplicated resource %s in package %s and %s", entry.guid.ToString(Guid::FormatType::N).c_str(), it.value().path.c_str(), path.c_str());
+				impl.packageEntries.erase(it);
+			}
+
+			PackageEntry packageEntry;
+			packageEntry.path = path;
+			packageEntry.type = entry.type;
+			packageEntry.entryIndex = i;
+			impl.packageEntries.insert(entry.guid, packageEntry);
+		}
+		return true;
+	}
+
+	void StorageManager::UnmountPackage(const Path& path)
+	{
+		auto& impl = StorageServiceImplInstance;
+		ScopedMutex lock(impl.packageMutex);
+		impl.packageEntries.eraseIf([&path](const PackageEntry& entry) {
+			return entry.path == path;
+		});
+	}
+
+	void StorageManager::MountPackages(const Path& dir)
+	{
+		auto fileList = FileSystem::Enumerate(dir.c_str(), (int)EnumrateMode::File);
+		for (const auto& fileInfo : fileList)
+		{
+			if (EndsWith(fileInfo.filename, PACKAGE_FILES_EXTENSION_WITH_DOT))
+				MountPackage(dir / fileInfo.filename);
+		}
+	}
+
+	bool StorageManager::FindPackageEntry(const Guid& guid, PackageEntry& entry)
+	{
+		auto& impl = StorageServiceImplInstance;
+		ScopedMutex lock(impl.packageMutex);
+		return impl.packageEntries.tryGet(guid, entry);
+	}
 }
\ No newline at end of file
@@ -10,8 +10,22 @@ namespace VulkanTest
 	class VULKAN_TEST_API StorageManager
 	{
 	public:
+		// Location of a resource in a package
+		struct PackageEntry
+		{
+			Path path;
+			ResourceType type;
+			I32 entryIndex;
+		};
+
 		static ResourceStorageRef EnsureAccess(const Path& path);
 		static ResourceStorageRef TryGetStorage(const Path& path);
 		static ResourceStorageRef GetStorage(const Path& path, bool doLoad = false);
+
+		// Packages map the guids of their entries to (package, entry)
+		static bool MountPackage(const Path& path);
+		static void UnmountPackage(const Path& path);
+		static void MountPackages(const Path& dir);
+		static bool FindPackageEntry(const Guid& guid, PackageEntry& entry);
 	};
 }
\ No newline at end of file
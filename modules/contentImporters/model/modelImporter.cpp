@@ -12,8 +12,220 @@ namespace VulkanTest
 {
 namespace Editor
 {
+	bool AreIndices16Bit(const ModelImporter::ImportMesh& mesh)
+	{
+		// Same as the index format of the runtime mesh
+		return mesh.vertexPositions.size() <= 65536;
+	}
+
+	U64 GetMeshDataSize(const ModelImporter::ImportMesh& mesh)
+	{
+		return
+			mesh.indices.size() * (AreIndices16Bit(mesh) ? sizeof(U16) : sizeof(U32)) +
+			mesh.vertexPositions.size() * sizeof(F32x3) +
+			mesh.vertexNormals.size() * sizeof(F32x3) +
+			mesh.vertexTangents.size() * sizeof(F32x4) +
+			mesh.vertexUvset_0.size() * sizeof(F32x2);
+	}
+
+	template<typename T>
+	void RemapVertexStream(Array<T>& stream, const Array<U32>& remap, U32 vertexCount)
+	{
+		if (stream.empty())
+			return;
+
+		Array<T> result;
+		result.resize(vertexCount);
+		for (U32 i = 0; i < stream.size(); i++)
+		{
+			if (remap[i] != ModelTool::INVALID_INDEX)
+				result[remap[i]] = stream[i];
+		}
+		stream.swap(result);
+	}
+
+	void RemapVertices(ModelImporter::ImportMesh& mesh, const Array<U32>& remap, U32 vertexCount)
+	{
+		for (U32& index : mesh.indices)
+			index = remap[index];
+
+		RemapVertexStream(mesh.vertexPositions, remap, vertexCount);
+		RemapVertexStream(mesh.vertexNormals, remap, vertexCount);
+		RemapVertexStream(mesh.vertexTangents, remap, vertexCount);
+		RemapVertexStream(mesh.vertexUvset_0, remap, vertexCount);
+	}
+
+	void OptimizeMesh(ModelImporter::ImportMesh& mesh)
+	{
+		if (mesh.indices.empty() || mesh.vertexPositions.empty())
+			return;
+
+		const U32 oldVertexCount = mesh.vertexPositions.size();
+		const U64 oldSize = GetMeshDataSize(mesh);
+		const F32 oldACMR = ModelTool::AnalyzeVertexCache(mesh.indices.data(), mesh.indices.size(), oldVertexCount);
+
+		// Weld vertices with identical attributes, unused vertices are removed
+		Array<ModelTool::VertexStream> streams;
+		streams.push_back({ mesh.vertexPositions.data(), sizeof(F32x3) });
+		if (!mesh.vertexNormals.empty())
+			streams.push_back({ mesh.vertexNormals.data(), sizeof(F32x3) });
+		if (!mesh.vertexTangents.empty())
+			streams.push_back({ mesh.vertexTangents.data(), sizeof(F32x4) });
+		if (!mesh.vertexUvset_0.empty())
+			streams.push_back({ mesh.vertexUvset_0.data(), sizeof(F32x2) });
+
+		Array<U32> remap;
+		remap.resize(oldVertexCount);
+		U32 vertexCount = ModelTool::GenerateVertexRemap(remap.data(), mesh.indices.data(), mesh.indices.size(), oldVertexCount, streams);
+		RemapVertices(mesh, remap, vertexCount);
+
+		// Reorder triangles of each subset for the vertex cache, then reorder clusters of triangles for overdraw
+		Array<U32> optimized;
+		optimized.resize(mesh.indices.size());
+		for (const auto& subset : mesh.subsets)
+		{
+			U32* indices = mesh.indices.data() + subset.uniqueIndexOffset;
+			ModelTool::OptimizeVertexCache(optimized.data(), indices, subset.uniqueIndexCount, vertexCount);
+			ModelTool::OptimizeOverdraw(indices, optimized.data(), subset.uniqueIndexCount, mesh.vertexPositions.data(), vertexCount, 1.05f);
+		}
+
+		// Reorder vertices in the order of first use for the vertex fetch
+		vertexCount = ModelTool::OptimizeVertexFetchRemap(remap.data(), mesh.indices.data(), mesh.indices.size(), vertexCount);
+		RemapVertices(mesh, remap, vertexCount);
+
+		const U64 newSize = GetMeshDataSize(mesh);
+		const F32 newACMR = ModelTool::AnalyzeVertexCache(mesh.indices.data(), mesh.indices.size(), vertexCount);
+		Logger::Info("Optimized mesh %s: vertices %d -> %d, ACMR %.3f -> %.3f, %s indices, %llu bytes saved",
+			mesh.name.c_str(), oldVertexCount, vertexCount, oldACMR, newACMR, 
+			AreIndices16Bit(mesh) ? "16 bit" : "32 bit",
+			oldSize > newSize ? oldSize - newSize : 0);
+	}
+
+	void GenerateLOD(const ModelImporter::ImportMesh& srcMesh, ModelImporter::ImportMesh& lodMesh, F32 ratio)
+	{
+		// Simplify subsets separately, the edges between subsets are borders and stay in place
+		const U32 vertexCount = srcMesh.vertexPositions.size();
+		Array<U32> indices;
+		Array<U32> optimized;
+		indices.resize(srcMesh.indices.size());
+		optimized.resize(srcMesh.indices.size());
+
+		lodMesh.subsets.resize(srcMesh.subsets.size());
+		U32 indexOffset = 0;
+		F32 maxError = 0.0f;
+		for (U32 i = 0; i < srcMesh.subsets.size(); i++)
+		{
+			const auto& srcSubset = srcMesh.subsets[i];
+			const U32* srcIndices = srcMesh.indices.data() + srcSubset.uniqueIndexOffset;
+			const U32 targetIndexCount = (U32)(srcSubset.uniqueIndexCount * ratio) / 3 * 3;
+
+			F32 error = 0.0f;
+			U32 indexCount = ModelTool::SimplifyMesh(
+				optimized.data(), 
+				srcIndices, 
+				srcSubset.uniqueIndexCount, 
+				srcMesh.vertexPositions.data(),
+				vertexCount,
+				targetIndexCount,
+				1.0f,
+				&error);
+
+			// Keep the source triangles if the subset is collapsed entirely
+			if (indexCount == 0)
+			{
+				indexCount = srcSubset.uniqueIndexCount;
+				memcpy(optimized.data(), srcIndices, sizeof(U32) * indexCount);
+				error = 0.0f;
+			}
+			ModelTool::OptimizeVertexCache(indices.data() + indexOffset, optimized.data(), indexCount, vertexCount);
+
+			auto& subset = lodMesh.subsets[i];
+			subset = srcSubset;
+			subset.uniqueIndexOffset = indexOffset;
+			subset.uniqueIndexCount = indexCount;
+			indexOffset += indexCount;
+			maxError = std::max(maxError, error);
+		}
+		indices.resize(indexOffset);
+		lodMesh.indices.swap(indices);
+
+		// Copy the vertices used by the lod
+		lodMesh.vertexPositions = srcMesh.vertexPositions.copy();
+		lodMesh.vertexNormals = srcMesh.vertexNormals.copy();
+		lodMesh.vertexTangents = srcMesh.vertexTangents.copy();
+		lodMesh.vertexUvset_0 = srcMesh.vertexUvset_0.copy();
+
+		Array<U32> remap;
+		remap.resize(vertexCount);
+		const U32 lodVertexCount = ModelTool::OptimizeVertexFetchRemap(remap.data(), lodMesh.indices.data(), lodMesh.indices.size(), vertexCount);
+		RemapVertices(lodMesh, remap, lodVertexCount);
+
+		// Error is relative to the largest extent of the mesh
+		const F32x3 extents = srcMesh.aabb.max - srcMesh.aabb.min;
+		const F32 error = maxError * std::max(extents.x, std::max(extents.y, extents.z));
+		lodMesh.lodError = std::max(srcMesh.lodError, error);
+		lodMesh.aabb = srcMesh.aabb;
+		lodMesh.import = srcMesh.import;
+		lodMesh.hasUV = srcMesh.hasUV;
+	}
+
+	void GenerateLODs(ModelImporter::ImportModel& modelData, const ModelImporter::ImportConfig& cfg)
+	{
+		// Lods from the source file are kept
+		if (modelData.lods.size() != 1)
+			return;
+
+		const U32 lodCount = std::min(cfg.autoLodCount + 1, (U32)Model::MAX_MODEL_LODS);
+		const F32 ratio = std::min(std::max(cfg.autoLodRatio, 0.01f), 1.0f);
+		if (lodCount <= 1)
+			return;
+
+		// Meshes are never reallocated in the generation, pointers of lods are rebuilt after
+		auto& meshes = modelData.meshes;
+		const U32 baseMeshCount = meshes.size();
+		meshes.reserve(baseMeshCount * lodCount);
+		for (U32 meshIndex = 0; meshIndex < baseMeshCount; meshIndex++)
+		{
+			if (meshes[meshIndex].indices.empty())
+				continue;
+
+			U32 srcMeshIndex = meshIndex;
+			for (U32 lodIndex = 1; lodIndex < lodCount; lodIndex++)
+			{
+				auto& lodMesh = meshes.emplace();
+				const auto& srcMesh = meshes[srcMeshIndex];
+				lodMesh.name = StaticString<MAX_PATH_LENGTH>().Sprintf("%s_LOD%d", meshes[meshIndex].name.c_str(), lodIndex).c_str();
+				lodMesh.lod = lodIndex;
+				GenerateLOD(srcMesh, lodMesh, ratio);
+
+				Logger::Info("Generated lod %d of mesh %s: triangles %d -> %d, error %.5f",
+					lodIndex, meshes[meshIndex].name.c_str(), 
+					meshes[meshIndex].indices.size() / 3, lodMesh.indices.size() / 3,
+					lodMesh.lodError);
+
+				srcMeshIndex = meshes.size() - 1;
+				meshes[meshIndex].lodMeshes.push_back((I32)srcMeshIndex);
+			}
+		}
+
+		modelData.lods.clear();
+		for (auto& mesh : meshes)
+		{
+			if (modelData.lods.size() <= mesh.lod)
+				modelData.lods.resize(mesh.lod + 1);
+			modelData.lods[mesh.lod].lodIndex = mesh.lod;
+			modelData.lods[mesh.lod].meshes.push_back(&mesh);
+		}
+	}
+
 	void PostprocessModelData(ModelImporter::ImportModel& modelData, const ModelImporter::ImportConfig& cfg)
 	{
+		if (cfg.optimizeMeshes)
+		{
+			for (auto& importMesh : modelData.meshes)
+				OptimizeMesh(importMesh);
+		}
+
 		// Calculate vertex tangents
 		for (auto& importMesh : modelData.meshes)
 		{
@@ -30,8 +242,9 @@ namespace Editor
 			}
 		}
 
-		// TODO
 		// Generate lod data
+		if (cfg.autoLODs)
+			GenerateLODs(modelData, cfg);
 	}
 
 
@@ -186,6 +399,33 @@ namespace Editor
 		CopyString(out, mesh.name.c_str());
 	}
 
+	F32 GetLODScreenSize(const ModelImporter::ImportModel& modelData, I32 lodIndex, F32 prevScreenSize)
+	{
+		if (lodIndex == 0)
+			return 1.0f;
+
+		// The lod is used while the simplification error is projected under LOD_SCREEN_ERROR,
+		// screen size is the radius of the bounding sphere divided by the distance.
+		const F32 LOD_SCREEN_ERROR = 0.002f;
+		AABB aabb;
+		for (const auto& mesh : modelData.lods[0].meshes)
+			aabb.Merge(mesh->aabb);
+
+		F32 error = 0.0f;
+		for (const auto& mesh : modelData.lods[lodIndex].meshes)
+		{
+			// Halve the screen size for each lod without known error
+			if (mesh->lodError < 0.0f)
+				return (lodIndex == 1 ? 1.0f : prevScreenSize) * 0.5f;
+			error = std::max(error, mesh->lodError);
+		}
+
+		F32 screenSize = error > 0.0f ? aabb.GetRadius() * LOD_SCREEN_ERROR / error : FLT_MAX;
+		if (lodIndex > 1)
+			screenSize = std::min(screenSize, prevScreenSize);
+		return screenSize;
+	}
+
 	CreateResult ModelImporter::WriteModel(CreateResourceContext& ctx, ImportModel& modelData)
 	{
 		IMPORT_SETUP(Model);
@@ -216,9 +456,13 @@ namespace Editor
 		// Write lods
 		I32 lodsCount = modelData.lods.size();
 		outMem->Write((U8)lodsCount);
+		F32 screenSize = 1.0f;
 		for (int i = 0; i < lodsCount; i++)
 		{
 			auto& lod = modelData.lods[i];
+			screenSize = GetLODScreenSize(modelData, i, screenSize);
+			outMem->Write(screenSize);
+
 			I32 meshCount = lod.meshes.size();
 			outMem->Write((U16)meshCount);
 
@@ -286,13 +530,18 @@ namespace Editor
 				ObjectComponent* obj = entity.GetMut<ObjectComponent>();
 				obj->mesh = entity;		
 
-				// Write mesh as model resource
+				// Write mesh and its generated lods as model resource
 				ImportModel modelData;
 				auto& lod = modelData.lods.emplace();
 				lod.meshes.push_back(&mesh);
+				for (I32 lodMeshIndex : mesh.lodMeshes)
+				{
+					auto& meshLod = modelData.lods.emplace();
+					meshLod.lodIndex = modelData.lods.size() - 1;
+					meshLod.meshes.push_back(&ctx.modelData.meshes[lodMeshIndex]);
+				}
 
-				// TEMP
-				const I32 meshLods = 1;
+				const I32 meshLods = modelData.lods.size();
 				MeshComponent* meshComp = entity.GetMut<MeshComponent>();
 				meshComp->meshCount = 1;
 				meshComp->lodsCount = meshLods;
@@ -301,18 +550,27 @@ namespace Editor
 					auto& meshInfo = meshComp->meshes[lodIndex].emplace();
 					meshInfo.aabb = mesh.aabb;
 					meshInfo.meshIndex = 0;
-					
-					// Write scene materials
-					meshInfo.material = entity;		
-					MaterialComponent* comp = entity.GetMut<MaterialComponent>();
-					comp->materials.resize(mesh.subsets.size());
-					for (I32 i = 0; i < mesh.subsets.size(); i++)
-					{
-						auto& material = ctx.modelData.materials[mesh.subsets[i].materialIndex];
-						mesh.subsets[i].materialIndex = i;
-						comp->materials[i].SetVirtualID(material.guid);
+					meshInfo.material = entity;
+				}
+
+				// Write scene materials
+				MaterialComponent* comp = entity.GetMut<MaterialComponent>();
+				comp->materials.resize(mesh.subsets.size());
+				for (I32 i = 0; i < mesh.subsets.size(); i++)
+				{
+					auto& material = ctx.modelData.materials[mesh.subsets[i].materialIndex];
+					comp->materials[i].SetVirtualID(material.guid);
+
+					modelData.materials.push_back(material);
+				}
 
-						modelData.materials.push_back(material);
+				// Subsets of all lods refer to the material slots of the model
+				for (auto& modelLod : modelData.lods)
+				{
+					for (auto lodMesh : modelLod.meshes)
+					{
+						for (I32 i = 0; i < lodMesh->subsets.size(); i++)
+							lodMesh->subsets[i].materialIndex = i;
 					}
 				}
 	
@@ -400,13 +658,6 @@ namespace Editor
 		return attributeCount; // Pos & Normals & Tagents & UV
 	}
 
-	bool AreIndices16Bit(const ModelImporter::ImportMesh& mesh)
-	{
-		// TODO: mesh only support U32 now..
-		// return mesh.indices.size() < (1 << 16);
-		return false;
-	}
-
 	bool ModelImporter::WriteMesh(OutputMemoryStream& outMem, const ImportMesh& mesh)
 	{
 		// Mesh format:
@@ -455,7 +706,7 @@ namespace Editor
 			outMem.Write((I32)mesh.indices.size());
 			for (U32 i : mesh.indices)
 			{
-				ASSERT(i <= (1 << 16));
+				ASSERT(i < (1 << 16));
 				U16 index = (U16)i;
 				outMem.Write(index);
 			}
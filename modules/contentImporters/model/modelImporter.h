@@ -25,7 +25,9 @@ namespace Editor
 			ModelType type = ModelType::Model;
 			F32 scale = 1.0f;
 			bool autoLODs = false;
-			U32 autoLodCount = 1;
+			U32 autoLodCount = 3;
+			F32 autoLodRatio = 0.5f;
+			bool optimizeMeshes = true;
 		};
 
 		struct ImportMesh
@@ -51,6 +53,11 @@ namespace Editor
 			Array<F32x2> vertexUvset_0;
 			Array<U32> indices;
 			bool hasUV = false;
+
+			// Simplification error of the generated lod, negative if the lod is not generated
+			F32 lodError = -1.0f;
+			// Generated lods in ImportModel::meshes
+			Array<I32> lodMeshes;
 		};
 
 		struct ImportTexture
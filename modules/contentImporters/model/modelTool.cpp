@@ -75,5 +75,979 @@ namespace Editor
 		FromCString(Span(lodStr, StringLength(lodStr)), lodIndex);
 		return lodIndex;
 	}
+
+	static U32 HashVertex(U32 vertex, Span<const ModelTool::VertexStream> streams)
+	{
+		// FNV-1a of the vertex data of all streams
+		U32 hash = 2166136261u;
+		for (const auto& stream : streams)
+		{
+			const U8* data = (const U8*)stream.data + (size_t)vertex * stream.stride;
+			for (U32 i = 0; i < stream.stride; i++)
+				hash = (hash ^ data[i]) * 16777619u;
+		}
+		return hash;
+	}
+
+	static bool CompareVertex(U32 a, U32 b, Span<const ModelTool::VertexStream> streams)
+	{
+		for (const auto& stream : streams)
+		{
+			const U8* data = (const U8*)stream.data;
+			if (memcmp(data + (size_t)a * stream.stride, data + (size_t)b * stream.stride, stream.stride) != 0)
+				return false;
+		}
+		return true;
+	}
+
+	U32 ModelTool::GenerateVertexRemap(U32* remap, const U32* indices, U32 indexCount, U32 vertexCount, Span<const VertexStream> streams)
+	{
+		for (U32 i = 0; i < vertexCount; i++)
+			remap[i] = INVALID_INDEX;
+
+		// Open addressing table of the unique vertices
+		U32 tableSize = 2;
+		while (tableSize < vertexCount * 2)
+			tableSize <<= 1;
+		const U32 tableMask = tableSize - 1;
+
+		Array<U32> table;
+		table.resize(tableSize);
+		for (U32& entry : table)
+			entry = INVALID_INDEX;
+
+		U32 uniqueCount = 0;
+		for (U32 i = 0; i < indexCount; i++)
+		{
+			const U32 vertex = indices[i];
+			ASSERT(vertex < vertexCount);
+			if (remap[vertex] != INVALID_INDEX)
+				continue;
+
+			U32 slot = HashVertex(vertex, streams) & tableMask;
+			while (true)
+			{
+				const U32 entry = table[slot];
+				if (entry == INVALID_INDEX)
+				{
+					table[slot] = vertex;
+					remap[vertex] = uniqueCount++;
+					break;
+				}
+
+				if (CompareVertex(entry, vertex, streams))
+				{
+					remap[vertex] = remap[entry];
+					break;
+				}
+				slot = (slot + 1) & tableMask;
+			}
+		}
+		return uniqueCount;
+	}
+
+	// Vertex scores of "Linear-Speed Vertex Cache Optimisation", Tom Forsyth
+	static const U32 VERTEX_CACHE_SIZE = 32;
+
+	static F32 GetVertexScore(I32 cachePosition, U32 liveTriangles)
+	{
+		if (liveTriangles == 0)
+			return -1.0f;
+
+		F32 score = 0.0f;
+		if (cachePosition >= 0)
+		{
+			// The vertices of the last triangle are scored equally, so the triangle strips are not preferred
+			if (cachePosition < 3)
+				score = 0.75f;
+			else
+				score = powf(1.0f - (F32)(cachePosition - 3) / (VERTEX_CACHE_SIZE - 3), 1.5f);
+		}
+
+		// Vertices with few remaining triangles are preferred, so isolated triangles are not left behind
+		return score + 2.0f / sqrtf((F32)liveTriangles);
+	}
+
+	void ModelTool::OptimizeVertexCache(U32* dst, const U32* indices, U32 indexCount, U32 vertexCount)
+	{
+		const U32 triangleCount = indexCount / 3;
+		if (triangleCount == 0)
+			return;
+
+		// Triangles adjacent to each vertex, the live triangles are kept in the front
+		Array<U32> liveTriangles;
+		liveTriangles.resize(vertexCount);
+		memset(liveTriangles.data(), 0, vertexCount * sizeof(U32));
+		for (U32 i = 0; i < triangleCount * 3; i++)
+			liveTriangles[indices[i]]++;
+
+		Array<U32> adjacencyOffsets;
+		adjacencyOffsets.resize(vertexCount + 1);
+		adjacencyOffsets[0] = 0;
+		for (U32 i = 0; i < vertexCount; i++)
+			adjacencyOffsets[i + 1] = adjacencyOffsets[i] + liveTriangles[i];
+
+		Array<U32> adjacency;
+		adjacency.resize(triangleCount * 3);
+		Array<U32> fillOffsets;
+		fillOffsets.resize(vertexCount);
+		memcpy(fillOffsets.data(), adjacencyOffsets.data(), vertexCount * sizeof(U32));
+		for (U32 i = 0; i < triangleCount * 3; i++)
+			adjacency[fillOffsets[indices[i]]++] = i / 3;
+
+		Array<I32> cachePositions;
+		Array<F32> vertexScores;
+		cachePositions.resize(vertexCount);
+		vertexScores.resize(vertexCount);
+		for (U32 i = 0; i < vertexCount; i++)
+		{
+			cachePositions[i] = -1;
+			vertexScores[i] = GetVertexScore(-1, liveTriangles[i]);
+		}
+
+		Array<F32> triangleScores;
+		Array<U8> emitted;
+		triangleScores.resize(triangleCount);
+		emitted.resize(triangleCount);
+		I32 bestTriangle = -1;
+		F32 bestScore = -FLT_MAX;
+		for (U32 t = 0; t < triangleCount; t++)
+		{
+			triangleScores[t] = vertexScores[indices[t * 3 + 0]] + vertexScores[indices[t * 3 + 1]] + vertexScores[indices[t * 3 + 2]];
+			emitted[t] = 0;
+			if (triangleScores[t] > bestScore)
+			{
+				bestScore = triangleScores[t];
+				bestTriangle = (I32)t;
+			}
+		}
+
+		U32 cache[VERTEX_CACHE_SIZE + 3];
+		U32 cacheCount = 0;
+		U32 inputCursor = 0;
+		for (U32 outTriangle = 0; outTriangle < triangleCount; outTriangle++)
+		{
+			// No candidate in the cache, continue from the next triangle not emitted in the input order
+			if (bestTriangle < 0)
+			{
+				while (emitted[inputCursor])
+					inputCursor++;
+				bestTriangle = (I32)inputCursor;
+			}
+
+			const U32* triangle = indices + bestTriangle * 3;
+			dst[outTriangle * 3 + 0] = triangle[0];
+			dst[outTriangle * 3 + 1] = triangle[1];
+			dst[outTriangle * 3 + 2] = triangle[2];
+			emitted[bestTriangle] = 1;
+
+			// Remove the triangle from the live triangles of its vertices
+			for (U32 k = 0; k < 3; k++)
+			{
+				const U32 vertex = triangle[k];
+				U32* vertexTriangles = adjacency.data() + adjacencyOffsets[vertex];
+				const U32 liveCount = liveTriangles[vertex];
+				for (U32 i = 0; i < liveCount; i++)
+				{
+					if (vertexTriangles[i] == (U32)bestTriangle)
+					{
+						std::swap(vertexTriangles[i], vertexTriangles[liveCount - 1]);
+						liveTriangles[vertex]--;
+						break;
+					}
+				}
+			}
+
+			// Push the vertices of the triangle to the front of the LRU cache
+			U32 newCache[VERTEX_CACHE_SIZE + 3];
+			U32 newCacheCount = 0;
+			for (U32 k = 0; k < 3; k++)
+				newCache[newCacheCount++] = triangle[k];
+			for (U32 i = 0; i < cacheCount; i++)
+			{
+				const U32 vertex = cache[i];
+				if (vertex != triangle[0] && vertex != triangle[1] && vertex != triangle[2])
+					newCache[newCacheCount++] = vertex;
+			}
+
+			// Update the scores of the cached and evicted vertices, the best triangle is selected from the cached vertices
+			bestTriangle = -1;
+			bestScore = -FLT_MAX;
+			for (U32 i = 0; i < newCacheCount; i++)
+			{
+				const U32 vertex = newCache[i];
+				const I32 cachePosition = i < VERTEX_CACHE_SIZE ? (I32)i : -1;
+				cachePositions[vertex] = cachePosition;
+
+				const F32 score = GetVertexScore(cachePosition, liveTriangles[vertex]);
+				const F32 delta = score - vertexScores[vertex];
+				vertexScores[vertex] = score;
+
+				const U32* vertexTriangles = adjacency.data() + adjacencyOffsets[vertex];
+				for (U32 j = 0; j < liveTriangles[vertex]; j++)
+				{
+					const U32 t = vertexTriangles[j];
+					triangleScores[t] += delta;
+					if (cachePosition >= 0 && triangleScores[t] > bestScore)
+					{
+						bestScore = triangleScores[t];
+						bestTriangle = (I32)t;
+					}
+				}
+			}
+
+			cacheCount = std::min(newCacheCount, VERTEX_CACHE_SIZE);
+			memcpy(cache, newCache, cacheCount * sizeof(U32));
+		}
+	}
+
+	// FIFO vertex cache simulated by timestamps, a vertex is cached if it is transformed in the last cacheSize misses
+	struct VertexCacheSimulator
+	{
+		Array<U32> cacheTimes;
+		U32 cacheSize;
+		U32 timestamp;
+
+		VertexCacheSimulator(U32 vertexCount, U32 cacheSize_) :
+			cacheSize(cacheSize_),
+			timestamp(cacheSize_ + 1)
+		{
+			cacheTimes.resize(vertexCount);
+			memset(cacheTimes.data(), 0, vertexCount * sizeof(U32));
+		}
+
+		U32 Simulate(const U32* triangle)
+		{
+			U32 misses = 0;
+			for (U32 k = 0; k < 3; k++)
+			{
+				const U32 vertex = triangle[k];
+				if (timestamp - cacheTimes[vertex] > cacheSize)
+				{
+					cacheTimes[vertex] = timestamp++;
+					misses++;
+				}
+			}
+			return misses;
+		}
+
+		void Reset()
+		{
+			timestamp += cacheSize + 1;
+		}
+	};
+
+	static F32x3 Cross(const F32x3& a, const F32x3& b)
+	{
+		return F32x3(a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z, a.x * b.y - a.y * b.x);
+	}
+
+	void ModelTool::OptimizeOverdraw(U32* dst, const U32* indices, U32 indexCount, const F32x3* positions, U32 vertexCount, F32 threshold)
+	{
+		const U32 triangleCount = indexCount / 3;
+		if (triangleCount == 0)
+			return;
+
+		// Hard boundaries of clusters are the triangles missing all vertices, where the cache is effectively reset
+		VertexCacheSimulator cache(vertexCount, 16);
+		Array<U32> hardClusters;
+		for (U32 t = 0; t < triangleCount; t++)
+		{
+			if (cache.Simulate(indices + t * 3) == 3 || t == 0)
+				hardClusters.push_back(t);
+		}
+
+		// Split hard clusters into smaller ones while their ACMR is still within the threshold of the hard cluster
+		Array<U32> clusters;
+		for (U32 i = 0; i < hardClusters.size(); i++)
+		{
+			const U32 begin = hardClusters[i];
+			const U32 end = i + 1 < hardClusters.size() ? hardClusters[i + 1] : triangleCount;
+
+			cache.Reset();
+			U32 misses = 0;
+			for (U32 t = begin; t < end; t++)
+				misses += cache.Simulate(indices + t * 3);
+			const F32 maxACMR = (F32)misses / (end - begin) * threshold;
+
+			cache.Reset();
+			U32 clusterBegin = begin;
+			U32 clusterMisses = 0;
+			clusters.push_back(begin);
+			for (U32 t = begin; t + 1 < end; t++)
+			{
+				clusterMisses += cache.Simulate(indices + t * 3);
+				if ((F32)clusterMisses / (t + 1 - clusterBegin) <= maxACMR)
+				{
+					clusterBegin = t + 1;
+					clusterMisses = 0;
+					clusters.push_back(clusterBegin);
+					cache.Reset();
+				}
+			}
+		}
+
+		// Area weighted centroid and normal of each cluster
+		struct ClusterInfo
+		{
+			F32x3 centroid;
+			F32x3 normal;
+			F32 area;
+		};
+		Array<ClusterInfo> clusterInfos;
+		clusterInfos.resize(clusters.size());
+		F32x3 meshCentroid = F32x3(0.0f);
+		F32 meshArea = 0.0f;
+		for (U32 i = 0; i < clusters.size(); i++)
+		{
+			const U32 begin = clusters[i];
+			const U32 end = i + 1 < clusters.size() ? clusters[i + 1] : triangleCount;
+
+			ClusterInfo& info = clusterInfos[i];
+			info.centroid = F32x3(0.0f);
+			info.normal = F32x3(0.0f);
+			info.area = 0.0f;
+			for (U32 t = begin; t < end; t++)
+			{
+				const F32x3 p0 = positions[indices[t * 3 + 0]];
+				const F32x3 p1 = positions[indices[t * 3 + 1]];
+				const F32x3 p2 = positions[indices[t * 3 + 2]];
+				const F32x3 normal = Cross(p1 - p0, p2 - p0);
+				const F32 area = length(normal);
+
+				info.centroid += (p0 + p1 + p2) * (area / 3.0f);
+				info.normal += normal;
+				info.area += area;
+			}
+
+			meshCentroid += info.centroid;
+			meshArea += info.area;
+			if (info.area > 0.0f)
+				info.centroid *= 1.0f / info.area;
+		}
+		if (meshArea > 0.0f)
+			meshCentroid *= 1.0f / meshArea;
+
+		// Clusters facing outside are drawn first, so they occlude the inner ones.
+		// The winding of the mesh is unknown, the outside is the side of the most normals
+		F32 orientation = 0.0f;
+		for (const ClusterInfo& info : clusterInfos)
+			orientation += dot(info.normal, info.centroid - meshCentroid);
+
+		Array<F32> sortKeys;
+		Array<U32> order;
+		sortKeys.resize(clusters.size());
+		order.resize(clusters.size());
+		for (U32 i = 0; i < clusters.size(); i++)
+		{
+			const ClusterInfo& info = clusterInfos[i];
+			const F32 normalLength = length(info.normal);
+			const F32x3 normal = normalLength > 0.0f ? info.normal * (1.0f / normalLength) : F32x3(0.0f);
+			sortKeys[i] = dot(info.centroid - meshCentroid, normal) * (orientation < 0.0f ? -1.0f : 1.0f);
+			order[i] = i;
+		}
+		std::stable_sort(order.begin(), order.end(), [&](U32 a, U32 b) {
+			return sortKeys[a] > sortKeys[b];
+		});
+
+		U32 offset = 0;
+		for (U32 cluster : order)
+		{
+			const U32 begin = clusters[cluster];
+			const U32 end = cluster + 1 < clusters.size() ? clusters[cluster + 1] : triangleCount;
+			memcpy(dst + offset, indices + begin * 3, (end - begin) * 3 * sizeof(U32));
+			offset += (end - begin) * 3;
+		}
+	}
+
+	U32 ModelTool::OptimizeVertexFetchRemap(U32* remap, const U32* indices, U32 indexCount, U32 vertexCount)
+	{
+		for (U32 i = 0; i < vertexCount; i++)
+			remap[i] = INVALID_INDEX;
+
+		U32 nextVertex = 0;
+		for (U32 i = 0; i < indexCount; i++)
+		{
+			const U32 vertex = indices[i];
+			if (remap[vertex] == INVALID_INDEX)
+				remap[vertex] = nextVertex++;
+		}
+		return nextVertex;
+	}
+
+	F32 ModelTool::AnalyzeVertexCache(const U32* indices, U32 indexCount, U32 vertexCount, U32 cacheSize)
+	{
+		const U32 triangleCount = indexCount / 3;
+		if (triangleCount == 0)
+			return 0.0f;
+
+		VertexCacheSimulator cache(vertexCount, cacheSize);
+		U32 misses = 0;
+		for (U32 t = 0; t < triangleCount; t++)
+			misses += cache.Simulate(indices + t * 3);
+		return (F32)misses / triangleCount;
+	}
+
+	// Vertex kinds of the simplifier
+	// Manifold: interior vertex, Border: vertex on an open edge loop
+	// Seam: vertex on an attribute seam with exactly two wedges, Locked: any other vertex which is never moved
+	enum SimplifyVertexKind : U8
+	{
+		VERTEX_KIND_MANIFOLD,
+		VERTEX_KIND_BORDER,
+		VERTEX_KIND_SEAM,
+		VERTEX_KIND_LOCKED,
+		VERTEX_KIND_COUNT
+	};
+
+	// Is the collapse from the kind of row to the kind of column allowed
+	static const bool CAN_COLLAPSE[VERTEX_KIND_COUNT][VERTEX_KIND_COUNT] = {
+		{ true, true, true, true },
+		{ false, true, false, false },
+		{ false, false, true, false },
+		{ false, false, false, false },
+	};
+
+	// Does the edge between the kinds occur in both directions
+	static const bool HAS_OPPOSITE_EDGE[VERTEX_KIND_COUNT][VERTEX_KIND_COUNT] = {
+		{ true, true, true, true },
+		{ true, false, true, false },
+		{ true, true, true, true },
+		{ true, false, true, false },
+	};
+
+	static const F32 BOUNDARY_EDGE_WEIGHT = 10.0f;
+
+	struct Quadric
+	{
+		F32 a00, a11, a22;
+		F32 a10, a20, a21;
+		F32 b0, b1, b2;
+		F32 c;
+		F32 w;
+	};
+
+	static void QuadricFromPlane(Quadric& q, F32 a, F32 b, F32 c, F32 d, F32 w)
+	{
+		const F32 aw = a * w;
+		const F32 bw = b * w;
+		const F32 cw = c * w;
+		const F32 dw = d * w;
+		q.a00 = a * aw;
+		q.a11 = b * bw;
+		q.a22 = c * cw;
+		q.a10 = a * bw;
+		q.a20 = a * cw;
+		q.a21 = b * cw;
+		q.b0 = a * dw;
+		q.b1 = b * dw;
+		q.b2 = c * dw;
+		q.c = d * dw;
+		q.w = w;
+	}
+
+	static void QuadricAdd(Quadric& q, const Quadric& r)
+	{
+		q.a00 += r.a00;
+		q.a11 += r.a11;
+		q.a22 += r.a22;
+		q.a10 += r.a10;
+		q.a20 += r.a20;
+		q.a21 += r.a21;
+		q.b0 += r.b0;
+		q.b1 += r.b1;
+		q.b2 += r.b2;
+		q.c += r.c;
+		q.w += r.w;
+	}
+
+	// Weighted squared distance from v to the planes of the quadric
+	static F32 QuadricError(const Quadric& q, const F32x3& v)
+	{
+		F32 rx = q.b0 + q.a10 * v.y;
+		F32 ry = q.b1 + q.a21 * v.z;
+		F32 rz = q.b2 + q.a20 * v.x;
+		rx = rx * 2.0f + q.a00 * v.x;
+		ry = ry * 2.0f + q.a11 * v.y;
+		rz = rz * 2.0f + q.a22 * v.z;
+
+		const F32 r = q.c + rx * v.x + ry * v.y + rz * v.z;
+		return q.w > 0.0f ? std::abs(r) / q.w : 0.0f;
+	}
+
+	struct SimplifyAdjacency
+	{
+		Array<U32> counts;
+		Array<U32> offsets;
+		Array<U32> data;
+
+		void Build(const U32* indices, U32 indexCount, U32 vertexCount, const U32* remap, bool edges)
+		{
+			counts.resize(vertexCount);
+			offsets.resize(vertexCount);
+			data.resize(indexCount);
+			memset(counts.data(), 0, sizeof(U32) * vertexCount);
+
+			auto GetVertex = [&](U32 i) {
+				return remap != nullptr ? remap[indices[i]] : indices[i];
+			};
+
+			for (U32 i = 0; i < indexCount; i++)
+				counts[GetVertex(i)]++;
+
+			U32 offset = 0;
+			for (U32 i = 0; i < vertexCount; i++)
+			{
+				offsets[i] = offset;
+				offset += counts[i];
+				counts[i] = 0;
+			}
+
+			// Edges store the next vertex of the triangle, otherwise the triangle index is stored
+			for (U32 i = 0; i < indexCount; i += 3)
+			{
+				for (U32 e = 0; e < 3; e++)
+				{
+					const U32 v = GetVertex(i + e);
+					data[offsets[v] + counts[v]++] = edges ? GetVertex(i + (e + 1) % 3) : i / 3;
+				}
+			}
+		}
+
+		bool HasEdge(U32 a, U32 b) const
+		{
+			for (U32 i = 0; i < counts[a]; i++)
+			{
+				if (data[offsets[a] + i] == b)
+					return true;
+			}
+			return false;
+		}
+	};
+
+	struct SimplifyCollapse
+	{
+		U32 v0;
+		U32 v1;
+		bool bidirectional;
+		F32 error;
+	};
+
+	static void BuildPositionRemap(Array<U32>& remap, Array<U32>& wedge, const U32* indices, U32 indexCount, const F32x3* positions, U32 vertexCount)
+	{
+		remap.resize(vertexCount);
+		wedge.resize(vertexCount);
+		for (U32 i = 0; i < vertexCount; i++)
+		{
+			remap[i] = i;
+			wedge[i] = i;
+		}
+
+		U32 tableSize = 2;
+		while (tableSize < vertexCount * 2)
+			tableSize <<= 1;
+		const U32 tableMask = tableSize - 1;
+
+		Array<U32> table;
+		table.resize(tableSize);
+		for (U32& entry : table)
+			entry = ModelTool::INVALID_INDEX;
+
+		// Only referenced vertices are welded, unused duplicates would turn seams into locked vertices
+		Array<bool> visited;
+		visited.resize(vertexCount);
+		memset(visited.data(), 0, sizeof(bool) * vertexCount);
+
+		const ModelTool::VertexStream stream = { positions, sizeof(F32x3) };
+		const Span<const ModelTool::VertexStream> streams(&stream, 1);
+		for (U32 i = 0; i < indexCount; i++)
+		{
+			const U32 vertex = indices[i];
+			if (visited[vertex])
+				continue;
+			visited[vertex] = true;
+
+			U32 slot = HashVertex(vertex, streams) & tableMask;
+			while (table[slot] != ModelTool::INVALID_INDEX && !CompareVertex(table[slot], vertex, streams))
+				slot = (slot + 1) & tableMask;
+
+			if (table[slot] == ModelTool::INVALID_INDEX)
+			{
+				table[slot] = vertex;
+				continue;
+			}
+
+			// Insert the vertex into the circular wedge list of the canonical vertex
+			const U32 canonical = table[slot];
+			remap[vertex] = canonical;
+			wedge[vertex] = wedge[canonical];
+			wedge[canonical] = vertex;
+		}
+	}
+
+	static void ClassifyVertices(Array<U8>& kinds, Array<U32>& loop, Array<U32>& loopback, const SimplifyAdjacency& adjacency, const Array<U32>& remap, const Array<U32>& wedge, U32 vertexCount)
+	{
+		const U32 INVALID_INDEX = ModelTool::INVALID_INDEX;
+
+		// Open half edges of each vertex, the vertex itself is stored if there are more than one
+		loop.resize(vertexCount);
+		loopback.resize(vertexCount);
+		for (U32 i = 0; i < vertexCount; i++)
+		{
+			loop[i] = INVALID_INDEX;
+			loopback[i] = INVALID_INDEX;
+		}
+
+		for (U32 vertex = 0; vertex < vertexCount; vertex++)
+		{
+			for (U32 i = 0; i < adjacency.counts[vertex]; i++)
+			{
+				const U32 target = adjacency.data[adjacency.offsets[vertex] + i];
+				if (target == vertex)
+				{
+					loop[vertex] = vertex;
+					loopback[vertex] = vertex;
+				}
+				else if (!adjacency.HasEdge(target, vertex))
+				{
+					loopback[target] = loopback[target] == INVALID_INDEX ? vertex : target;
+					loop[vertex] = loop[vertex] == INVALID_INDEX ? target : vertex;
+				}
+			}
+		}
+
+		kinds.resize(vertexCount);
+		for (U32 i = 0; i < vertexCount; i++)
+		{
+			if (remap[i] != i)
+				continue;
+
+			const U32 openOut = loop[i];
+			const U32 openIn = loopback[i];
+			if (wedge[i] == i)
+			{
+				if (openOut == INVALID_INDEX && openIn == INVALID_INDEX)
+					kinds[i] = VERTEX_KIND_MANIFOLD;
+				else if (openOut != INVALID_INDEX && openOut != i && openIn != INVALID_INDEX && openIn != i)
+					kinds[i] = VERTEX_KIND_BORDER;
+				else
+					kinds[i] = VERTEX_KIND_LOCKED;
+			}
+			else if (wedge[wedge[i]] == i)
+			{
+				// Both wedges have one open half edge, and the edges of the wedges are connected
+				const U32 w = wedge[i];
+				const U32 openOutW = loop[w];
+				const U32 openInW = loopback[w];
+				if (openOut != INVALID_INDEX && openOut != i && openIn != INVALID_INDEX && openIn != i &&
+					openOutW != INVALID_INDEX && openOutW != w && openInW != INVALID_INDEX && openInW != w &&
+					remap[openIn] == remap[openOutW] && remap[openOut] == remap[openInW])
+					kinds[i] = VERTEX_KIND_SEAM;
+				else
+					kinds[i] = VERTEX_KIND_LOCKED;
+			}
+			else
+			{
+				kinds[i] = VERTEX_KIND_LOCKED;
+			}
+		}
+
+		for (U32 i = 0; i < vertexCount; i++)
+			kinds[i] = kinds[remap[i]];
+	}
+
+	static void FillQuadrics(Array<Quadric>& quadrics, const U32* indices, U32 indexCount, const Array<F32x3>& positions, const Array<U32>& remap, const Array<U8>& kinds, const Array<U32>& loop)
+	{
+		for (U32 i = 0; i < indexCount; i += 3)
+		{
+			const U32 i0 = indices[i + 0];
+			const U32 i1 = indices[i + 1];
+			const U32 i2 = indices[i + 2];
+			const F32x3 p0 = positions[i0];
+
+			// Plane of the triangle weighted by the area
+			F32x3 normal = Cross(positions[i1] - p0, positions[i2] - p0);
+			const F32 area = length(normal);
+			if (area > 0.0f)
+				normal = normal / area;
+
+			Quadric q;
+			QuadricFromPlane(q, normal.x, normal.y, normal.z, -dot(normal, p0), area);
+			QuadricAdd(quadrics[remap[i0]], q);
+			QuadricAdd(quadrics[remap[i1]], q);
+			QuadricAdd(quadrics[remap[i2]], q);
+
+			// Planes perpendicular to the open edges keep borders and seams in place
+			for (U32 e = 0; e < 3; e++)
+			{
+				const U32 v0 = indices[i + e];
+				const U32 v1 = indices[i + (e + 1) % 3];
+				const U32 v2 = indices[i + (e + 2) % 3];
+				const U8 kind = kinds[v0];
+				if ((kind != VERTEX_KIND_BORDER && kind != VERTEX_KIND_SEAM) || loop[v0] != v1)
+					continue;
+
+				const F32x3 p10 = positions[v1] - positions[v0];
+				const F32x3 p20 = positions[v2] - positions[v0];
+				const F32 edgeLengthSq = dot(p10, p10);
+				if (edgeLengthSq <= 0.0f)
+					continue;
+
+				F32x3 perp = p20 - p10 * (dot(p10, p20) / edgeLengthSq);
+				const F32 perpLength = length(perp);
+				if (perpLength > 0.0f)
+					perp = perp / perpLength;
+
+				const F32 weight = std::sqrt(edgeLengthSq) * (kind == VERTEX_KIND_BORDER ? BOUNDARY_EDGE_WEIGHT : 1.0f);
+				Quadric edgeQ;
+				QuadricFromPlane(edgeQ, perp.x, perp.y, perp.z, -dot(perp, positions[v0]), weight);
+				QuadricAdd(quadrics[remap[v0]], edgeQ);
+				QuadricAdd(quadrics[remap[v1]], edgeQ);
+			}
+		}
+	}
+
+	static bool HasTriangleFlips(const SimplifyAdjacency& triangles, const U32* indices, const Array<F32x3>& positions, const Array<U32>& remap, U32 r0, U32 r1, const F32x3& target)
+	{
+		for (U32 i = 0; i < triangles.counts[r0]; i++)
+		{
+			const U32* tri = indices + triangles.data[triangles.offsets[r0] + i] * 3;
+			const U32 a = remap[tri[0]];
+			const U32 b = remap[tri[1]];
+			const U32 c = remap[tri[2]];
+
+			// Triangles of the collapsed edge are removed
+			if (a == r1 || b == r1 || c == r1)
+				continue;
+
+			// Rotate so that the moved vertex comes first
+			const U32 o0 = a == r0 ? b : (b == r0 ? c : a);
+			const U32 o1 = a == r0 ? c : (b == r0 ? a : b);
+			const F32x3 p0 = positions[r0];
+			const F32x3 p1 = positions[o0];
+			const F32x3 p2 = positions[o1];
+
+			const F32x3 n0 = Cross(p1 - p0, p2 - p0);
+			const F32x3 n1 = Cross(p1 - target, p2 - target);
+			if (dot(n0, n1) <= 1e-2f * std::sqrt(dot(n0, n0) * dot(n1, n1)))
+				return true;
+		}
+		return false;
+	}
+
+	U32 ModelTool::SimplifyMesh(U32* dst, const U32* indices, U32 indexCount, const F32x3* positions, U32 vertexCount, U32 targetIndexCount, F32 targetError, F32* resultError)
+	{
+		ASSERT(indexCount % 3 == 0);
+		if (dst != indices)
+			memcpy(dst, indices, sizeof(U32) * indexCount);
+		if (resultError != nullptr)
+			*resultError = 0.0f;
+		if (indexCount <= targetIndexCount || vertexCount == 0)
+			return indexCount;
+
+		// Positions are rescaled to the unit cube, so errors are relative to the mesh extents
+		F32x3 minPos = positions[0];
+		F32x3 maxPos = positions[0];
+		for (U32 i = 1; i < vertexCount; i++)
+		{
+			minPos = F32x3(std::min(minPos.x, positions[i].x), std::min(minPos.y, positions[i].y), std::min(minPos.z, positions[i].z));
+			maxPos = F32x3(std::max(maxPos.x, positions[i].x), std::max(maxPos.y, positions[i].y), std::max(maxPos.z, positions[i].z));
+		}
+		const F32 extent = std::max(maxPos.x - minPos.x, std::max(maxPos.y - minPos.y, maxPos.z - minPos.z));
+		const F32 scale = extent > 0.0f ? 1.0f / extent : 0.0f;
+
+		Array<F32x3> scaledPositions;
+		scaledPositions.resize(vertexCount);
+		for (U32 i = 0; i < vertexCount; i++)
+			scaledPositions[i] = (positions[i] - minPos) * scale;
+
+		// Vertices at the same position are wedges of one vertex, they differ in attributes
+		Array<U32> remap;
+		Array<U32> wedge;
+		BuildPositionRemap(remap, wedge, dst, indexCount, positions, vertexCount);
+
+		Array<U8> kinds;
+		Array<U32> loop;
+		Array<U32> loopback;
+		{
+			SimplifyAdjacency adjacency;
+			adjacency.Build(dst, indexCount, vertexCount, nullptr, true);
+			ClassifyVertices(kinds, loop, loopback, adjacency, remap, wedge, vertexCount);
+		}
+
+		Array<Quadric> quadrics;
+		quadrics.resize(vertexCount);
+		memset(quadrics.data(), 0, sizeof(Quadric) * vertexCount);
+		FillQuadrics(quadrics, dst, indexCount, scaledPositions, remap, kinds, loop);
+
+		Array<SimplifyCollapse> collapses;
+		Array<U32> collapseOrder;
+		Array<U32> collapseRemap;
+		Array<bool> collapseLocked;
+		collapseRemap.resize(vertexCount);
+		collapseLocked.resize(vertexCount);
+
+		SimplifyAdjacency triangles;
+		const F32 errorLimit = targetError * targetError;
+		F32 maxError = 0.0f;
+		U32 resultCount = indexCount;
+		while (resultCount > targetIndexCount)
+		{
+			// Pick the edges which could be collapsed
+			collapses.clear();
+			for (U32 i = 0; i < resultCount; i += 3)
+			{
+				for (U32 e = 0; e < 3; e++)
+				{
+					const U32 i0 = dst[i + e];
+					const U32 i1 = dst[i + (e + 1) % 3];
+					if (remap[i0] == remap[i1])
+						continue;
+
+					const U8 k0 = kinds[i0];
+					const U8 k1 = kinds[i1];
+					if (!CAN_COLLAPSE[k0][k1] && !CAN_COLLAPSE[k1][k0])
+						continue;
+
+					// Edges shared by two triangles are only picked once
+					if (HAS_OPPOSITE_EDGE[k0][k1] && remap[i1] > remap[i0])
+						continue;
+
+					// Border and seam vertices have to be on the same edge loop
+					if (k0 == k1 && (k0 == VERTEX_KIND_BORDER || k0 == VERTEX_KIND_SEAM) && loop[i0] != i1)
+						continue;
+
+					if (CAN_COLLAPSE[k0][k1] && CAN_COLLAPSE[k1][k0])
+						collapses.push_back({ i0, i1, true, 0.0f });
+					else if (CAN_COLLAPSE[k0][k1])
+						collapses.push_back({ i0, i1, false, 0.0f });
+					else
+						collapses.push_back({ i1, i0, false, 0.0f });
+				}
+			}
+			if (collapses.empty())
+				break;
+
+			// Rank the collapses by the error of the moved vertex, bidirectional edges pick the cheaper direction
+			for (auto& collapse : collapses)
+			{
+				collapse.error = QuadricError(quadrics[remap[collapse.v0]], scaledPositions[collapse.v1]);
+				if (collapse.bidirectional)
+				{
+					const F32 reverseError = QuadricError(quadrics[remap[collapse.v1]], scaledPositions[collapse.v0]);
+					if (reverseError < collapse.error)
+					{
+						std::swap(collapse.v0, collapse.v1);
+						collapse.error = reverseError;
+					}
+				}
+			}
+
+			collapseOrder.resize(collapses.size());
+			for (U32 i = 0; i < collapses.size(); i++)
+				collapseOrder[i] = i;
+			std::sort(collapseOrder.begin(), collapseOrder.end(), [&](U32 a, U32 b) {
+				return collapses[a].error < collapses[b].error;
+			});
+
+			// Perform the cheapest collapses, each vertex is collapsed once per pass
+			triangles.Build(dst, resultCount, vertexCount, remap.data(), false);
+			for (U32 i = 0; i < vertexCount; i++)
+			{
+				collapseRemap[i] = i;
+				collapseLocked[i] = false;
+			}
+
+			const U32 triangleCollapseGoal = (resultCount - targetIndexCount) / 3;
+			U32 triangleCollapses = 0;
+			U32 edgeCollapses = 0;
+			for (U32 index : collapseOrder)
+			{
+				const SimplifyCollapse& collapse = collapses[index];
+				if (collapse.error > errorLimit || triangleCollapses >= triangleCollapseGoal)
+					break;
+
+				const U32 i0 = collapse.v0;
+				const U32 i1 = collapse.v1;
+				const U32 r0 = remap[i0];
+				const U32 r1 = remap[i1];
+				if (collapseLocked[r0] || collapseLocked[r1])
+					continue;
+
+				if (HasTriangleFlips(triangles, dst, scaledPositions, remap, r0, r1, scaledPositions[i1]))
+					continue;
+
+				const U8 kind = kinds[i0];
+				if (kind == VERTEX_KIND_SEAM)
+				{
+					// The other wedge is collapsed along the opposite side of the seam
+					const U32 s0 = wedge[i0];
+					const U32 s1 = loop[i0] == i1 ? loopback[s0] : loop[s0];
+					if (s1 == INVALID_INDEX || s1 == s0 || remap[s1] != r1)
+						continue;
+
+					collapseRemap[i0] = i1;
+					collapseRemap[s0] = s1;
+				}
+				else
+				{
+					collapseRemap[i0] = i1;
+				}
+
+				collapseLocked[r0] = true;
+				collapseLocked[r1] = true;
+				triangleCollapses += kind == VERTEX_KIND_BORDER ? 1 : 2;
+				edgeCollapses++;
+				maxError = std::max(maxError, collapse.error);
+			}
+			if (edgeCollapses == 0)
+				break;
+
+			// The quadrics of collapsed vertices are merged into the targets
+			for (U32 i = 0; i < vertexCount; i++)
+			{
+				if (collapseRemap[i] != i && remap[i] == i)
+					QuadricAdd(quadrics[remap[collapseRemap[i]]], quadrics[i]);
+			}
+
+			// Edge loops skip the collapsed vertices
+			for (U32 i = 0; i < vertexCount; i++)
+			{
+				if (loop[i] != INVALID_INDEX)
+				{
+					const U32 l = loop[i];
+					const U32 r = collapseRemap[l];
+					loop[i] = i == r ? loop[l] : r;
+				}
+				if (loopback[i] != INVALID_INDEX)
+				{
+					const U32 l = loopback[i];
+					const U32 r = collapseRemap[l];
+					loopback[i] = i == r ? loopback[l] : r;
+				}
+			}
+
+			// Remap the triangles and remove the degenerate ones
+			U32 writeOffset = 0;
+			for (U32 i = 0; i < resultCount; i += 3)
+			{
+				const U32 v0 = collapseRemap[dst[i + 0]];
+				const U32 v1 = collapseRemap[dst[i + 1]];
+				const U32 v2 = collapseRemap[dst[i + 2]];
+				if (remap[v0] == remap[v1] || remap[v0] == remap[v2] || remap[v1] == remap[v2])
+					continue;
+
+				dst[writeOffset + 0] = v0;
+				dst[writeOffset + 1] = v1;
+				dst[writeOffset + 2] = v2;
+				writeOffset += 3;
+			}
+			resultCount = writeOffset;
+		}
+
+		if (resultError != nullptr)
+			*resultError = std::sqrt(maxError);
+		return resultCount;
+	}
 }
 }
\ No newline at end of file
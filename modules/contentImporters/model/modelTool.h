@@ -12,6 +12,32 @@ namespace Editor
 	public:
 		static void ComputeVertexTangents(Array<F32x4>& out, I32 indexCount, const U32* indices, const F32x3* vertices, const F32x3* normals, const F32x2* uvs);
 		static I32 DetectLodIndex(const char* name);
+
+		// Mesh optimization
+		struct VertexStream
+		{
+			const void* data;
+			U32 stride;
+		};
+
+		// Generate the remap of unique vertices in the order of first use, unused vertices are mapped to INVALID_INDEX.
+		// Returns the count of unique vertices.
+		static U32 GenerateVertexRemap(U32* remap, const U32* indices, U32 indexCount, U32 vertexCount, Span<const VertexStream> streams);
+		// Reorder triangles to improve the post-transform vertex cache hit rate
+		static void OptimizeVertexCache(U32* dst, const U32* indices, U32 indexCount, U32 vertexCount);
+		// Reorder clusters of the cache optimized triangles to reduce overdraw, the ACMR is increased by threshold at most
+		static void OptimizeOverdraw(U32* dst, const U32* indices, U32 indexCount, const F32x3* positions, U32 vertexCount, F32 threshold);
+		// Generate the remap of vertices in the order of first use to improve the vertex fetch locality
+		static U32 OptimizeVertexFetchRemap(U32* remap, const U32* indices, U32 indexCount, U32 vertexCount);
+		// Average transformed vertices per triangle of a FIFO vertex cache
+		static F32 AnalyzeVertexCache(const U32* indices, U32 indexCount, U32 vertexCount, U32 cacheSize = 16);
+
+		// Simplify the triangles by quadric error edge collapses until the target index count or the target error is reached.
+		// Attribute seams and borders are preserved, errors are relative to the mesh extents.
+		// Returns the index count of the simplified triangles, dst could be the same as indices.
+		static U32 SimplifyMesh(U32* dst, const U32* indices, U32 indexCount, const F32x3* positions, U32 vertexCount, U32 targetIndexCount, F32 targetError, F32* resultError = nullptr);
+
+		static const U32 INVALID_INDEX = 0xFFFFFFFF;
 	};
 }
 }
@@ -0,0 +1,809 @@
+#include "blockCompression.h"
+#include "math\simd.h"
+
+namespace VulkanTest
+{
+namespace Editor
+{
+namespace BlockCompression
+{
+    // Pixels of a block in SoA layout, so 4 pixels are processed at once
+    struct Block
+    {
+        alignas(16) F32 channels[4][16];
+    };
+
+    struct BitWriter
+    {
+        U8* data;
+        U32 pos = 0;
+
+        void Write(U32 value, U32 bits)
+        {
+            for (U32 i = 0; i < bits; i++, pos++)
+                data[pos >> 3] |= (U8)(((value >> i) & 1) << (pos & 7));
+        }
+    };
+
+    struct BitReader
+    {
+        const U8* data;
+        U32 pos = 0;
+
+        U32 Read(U32 bits)
+        {
+            U32 value = 0;
+            for (U32 i = 0; i < bits; i++, pos++)
+                value |= (U32)((data[pos >> 3] >> (pos & 7)) & 1) << i;
+            return value;
+        }
+    };
+
+    static void LoadBlock(const U8* pixels, Block& block)
+    {
+        for (U32 i = 0; i < 16; i++)
+        {
+            for (U32 c = 0; c < 4; c++)
+                block.channels[c][i] = (F32)pixels[i * 4 + c];
+        }
+    }
+
+    static F32 Clamp255(F32 value)
+    {
+        return std::min(std::max(value, 0.0f), 255.0f);
+    }
+
+    // Project the pixels onto the segment e0 -> e1 and select the nearest of the evenly spaced levels, level 0 is e0
+    static void ProjectLevels(const Block& block, U32 firstChannel, U32 channelCount, const F32* e0, const F32* e1, U32 levelCount, U8* levels)
+    {
+        const U32 lastChannel = firstChannel + channelCount;
+        F32 dir[4] = {};
+        F32 len2 = 0.0f;
+        for (U32 c = firstChannel; c < lastChannel; c++)
+        {
+            dir[c] = e1[c] - e0[c];
+            len2 += dir[c] * dir[c];
+        }
+
+        if (len2 < 1e-6f)
+        {
+            memset(levels, 0, 16);
+            return;
+        }
+
+        const F32 scale = (F32)(levelCount - 1) / len2;
+        for (U32 c = firstChannel; c < lastChannel; c++)
+            dir[c] *= scale;
+
+#ifdef __SSE__
+        const __m128 zero = _mm_setzero_ps();
+        const __m128 maxLevel = _mm_set1_ps((F32)(levelCount - 1));
+        const __m128 half = _mm_set1_ps(0.5f);
+        for (U32 i = 0; i < 16; i += 4)
+        {
+            __m128 t = zero;
+            for (U32 c = firstChannel; c < lastChannel; c++)
+            {
+                const __m128 offset = _mm_sub_ps(_mm_load_ps(block.channels[c] + i), _mm_set1_ps(e0[c]));
+                t = _mm_add_ps(t, _mm_mul_ps(offset, _mm_set1_ps(dir[c])));
+            }
+            t = _mm_min_ps(_mm_max_ps(t, zero), maxLevel);
+
+            alignas(16) F32 values[4];
+            _mm_store_ps(values, _mm_add_ps(t, half));
+            for (U32 k = 0; k < 4; k++)
+                levels[i + k] = (U8)values[k];
+        }
+#else
+        for (U32 i = 0; i < 16; i++)
+        {
+            F32 t = 0.0f;
+            for (U32 c = firstChannel; c < lastChannel; c++)
+                t += (block.channels[c][i] - e0[c]) * dir[c];
+            t = std::min(std::max(t, 0.0f), (F32)(levelCount - 1));
+            levels[i] = (U8)(t + 0.5f);
+        }
+#endif
+    }
+
+    // Squared error of the pixels reconstructed from the evenly spaced levels
+    static F32 EvaluateError(const Block& block, U32 firstChannel, U32 channelCount, const F32* e0, const F32* e1, U32 levelCount, const U8* levels)
+    {
+        const U32 lastChannel = firstChannel + channelCount;
+        F32 step[4] = {};
+        for (U32 c = firstChannel; c < lastChannel; c++)
+            step[c] = (e1[c] - e0[c]) / (F32)(levelCount - 1);
+
+#ifdef __SSE__
+        __m128 error = _mm_setzero_ps();
+        for (U32 i = 0; i < 16; i += 4)
+        {
+            const __m128 l = _mm_setr_ps(levels[i], levels[i + 1], levels[i + 2], levels[i + 3]);
+            for (U32 c = firstChannel; c < lastChannel; c++)
+            {
+                const __m128 color = _mm_add_ps(_mm_set1_ps(e0[c]), _mm_mul_ps(l, _mm_set1_ps(step[c])));
+                const __m128 diff = _mm_sub_ps(_mm_load_ps(block.channels[c] + i), color);
+                error = _mm_add_ps(error, _mm_mul_ps(diff, diff));
+            }
+        }
+
+        alignas(16) F32 sums[4];
+        _mm_store_ps(sums, error);
+        return sums[0] + sums[1] + sums[2] + sums[3];
+#else
+        F32 error = 0.0f;
+        for (U32 i = 0; i < 16; i++)
+        {
+            for (U32 c = firstChannel; c < lastChannel; c++)
+            {
+                const F32 diff = block.channels[c][i] - (e0[c] + levels[i] * step[c]);
+                error += diff * diff;
+            }
+        }
+        return error;
+#endif
+    }
+
+    // Find the segment fitting the pixels
+    static void FitEndpoints(const Block& block, U32 firstChannel, U32 channelCount, Quality quality, F32* e0, F32* e1)
+    {
+        const U32 lastChannel = firstChannel + channelCount;
+        F32 mean[4] = {};
+        F32 minValue[4] = {};
+        F32 maxValue[4] = {};
+        U32 widest = firstChannel;
+        for (U32 c = firstChannel; c < lastChannel; c++)
+        {
+            minValue[c] = maxValue[c] = block.channels[c][0];
+            for (U32 i = 0; i < 16; i++)
+            {
+                const F32 value = block.channels[c][i];
+                mean[c] += value;
+                minValue[c] = std::min(minValue[c], value);
+                maxValue[c] = std::max(maxValue[c], value);
+            }
+            mean[c] /= 16.0f;
+
+            if (maxValue[c] - minValue[c] > maxValue[widest] - minValue[widest])
+                widest = c;
+        }
+
+        // Covariance matrix
+        F32 cov[4][4] = {};
+        for (U32 i = 0; i < 16; i++)
+        {
+            for (U32 c0 = firstChannel; c0 < lastChannel; c0++)
+            {
+                const F32 d0 = block.channels[c0][i] - mean[c0];
+                for (U32 c1 = c0; c1 < lastChannel; c1++)
+                    cov[c0][c1] += d0 * (block.channels[c1][i] - mean[c1]);
+            }
+        }
+        for (U32 c0 = firstChannel; c0 < lastChannel; c0++)
+        {
+            for (U32 c1 = firstChannel; c1 < c0; c1++)
+                cov[c0][c1] = cov[c1][c0];
+        }
+
+        // Use the diagonal of the bounding box, flipped according to the covariance with the widest channel
+        if (quality == Quality::Fast)
+        {
+            for (U32 c = firstChannel; c < lastChannel; c++)
+            {
+                const bool flip = cov[widest][c] < 0.0f;
+                e0[c] = flip ? maxValue[c] : minValue[c];
+                e1[c] = flip ? minValue[c] : maxValue[c];
+            }
+            return;
+        }
+
+        // Principal axis by power iteration, starting from the covariance of the widest channel
+        F32 axis[4] = {};
+        for (U32 c = firstChannel; c < lastChannel; c++)
+            axis[c] = cov[widest][c];
+
+        for (U32 iter = 0; iter < 8; iter++)
+        {
+            F32 next[4] = {};
+            F32 maxAbs = 0.0f;
+            for (U32 c0 = firstChannel; c0 < lastChannel; c0++)
+            {
+                for (U32 c1 = firstChannel; c1 < lastChannel; c1++)
+                    next[c0] += cov[c0][c1] * axis[c1];
+                maxAbs = std::max(maxAbs, fabsf(next[c0]));
+            }
+
+            if (maxAbs < 1e-6f)
+                break;
+
+            for (U32 c = firstChannel; c < lastChannel; c++)
+                axis[c] = next[c] / maxAbs;
+        }
+
+        F32 len2 = 0.0f;
+        for (U32 c = firstChannel; c < lastChannel; c++)
+            len2 += axis[c] * axis[c];
+
+        // Flat block
+        if (len2 < 1e-6f)
+        {
+            for (U32 c = firstChannel; c < lastChannel; c++)
+                e0[c] = e1[c] = mean[c];
+            return;
+        }
+
+        const F32 invLen = 1.0f / sqrtf(len2);
+        for (U32 c = firstChannel; c < lastChannel; c++)
+            axis[c] *= invLen;
+
+        F32 minT = FLT_MAX;
+        F32 maxT = -FLT_MAX;
+        for (U32 i = 0; i < 16; i++)
+        {
+            F32 t = 0.0f;
+            for (U32 c = firstChannel; c < lastChannel; c++)
+                t += (block.channels[c][i] - mean[c]) * axis[c];
+            minT = std::min(minT, t);
+            maxT = std::max(maxT, t);
+        }
+
+        for (U32 c = firstChannel; c < lastChannel; c++)
+        {
+            e0[c] = Clamp255(mean[c] + axis[c] * minT);
+            e1[c] = Clamp255(mean[c] + axis[c] * maxT);
+        }
+    }
+
+    // Least squares endpoints for the assigned levels
+    static bool RefineEndpoints(const Block& block, U32 firstChannel, U32 channelCount, U32 levelCount, const U8* levels, F32* e0, F32* e1)
+    {
+        const U32 lastChannel = firstChannel + channelCount;
+        F32 alpha2 = 0.0f;
+        F32 beta2 = 0.0f;
+        F32 alphaBeta = 0.0f;
+        F32 alphaX[4] = {};
+        F32 betaX[4] = {};
+        for (U32 i = 0; i < 16; i++)
+        {
+            const F32 beta = (F32)levels[i] / (F32)(levelCount - 1);
+            const F32 alpha = 1.0f - beta;
+            alpha2 += alpha * alpha;
+            beta2 += beta * beta;
+            alphaBeta += alpha * beta;
+            for (U32 c = firstChannel; c < lastChannel; c++)
+            {
+                alphaX[c] += alpha * block.channels[c][i];
+                betaX[c] += beta * block.channels[c][i];
+            }
+        }
+
+        const F32 det = alpha2 * beta2 - alphaBeta * alphaBeta;
+        if (fabsf(det) < 1e-6f)
+            return false;
+
+        const F32 invDet = 1.0f / det;
+        for (U32 c = firstChannel; c < lastChannel; c++)
+        {
+            e0[c] = Clamp255((alphaX[c] * beta2 - betaX[c] * alphaBeta) * invDet);
+            e1[c] = Clamp255((betaX[c] * alpha2 - alphaX[c] * alphaBeta) * invDet);
+        }
+        return true;
+    }
+
+    //////////////////////////////////////////////////////////////////////////
+    // BC1
+
+    static U16 PackRGB565(const F32* color)
+    {
+        const U32 r = (U32)(Clamp255(color[0]) * 31.0f / 255.0f + 0.5f);
+        const U32 g = (U32)(Clamp255(color[1]) * 63.0f / 255.0f + 0.5f);
+        const U32 b = (U32)(Clamp255(color[2]) * 31.0f / 255.0f + 0.5f);
+        return (U16)((r << 11) | (g << 5) | b);
+    }
+
+    static void UnpackRGB565(U16 value, F32* color)
+    {
+        const U32 r = (value >> 11) & 31;
+        const U32 g = (value >> 5) & 63;
+        const U32 b = value & 31;
+        color[0] = (F32)((r << 3) | (r >> 2));
+        color[1] = (F32)((g << 2) | (g >> 4));
+        color[2] = (F32)((b << 3) | (b >> 2));
+    }
+
+    // Encode the color block, returns the error. Levels are relative to the quantized endpoints q0 -> q1
+    static F32 EncodeBC1Color(const Block& block, const F32* e0, const F32* e1, U8* output, U8* levels, F32* q0, F32* q1)
+    {
+        static const U8 BC1_INDICES[4] = { 0, 2, 3, 1 };
+
+        // Color0 > color1 selects the 4 colors mode
+        U16 color0 = PackRGB565(e0);
+        U16 color1 = PackRGB565(e1);
+        if (color0 < color1)
+            std::swap(color0, color1);
+
+        UnpackRGB565(color0, q0);
+        UnpackRGB565(color1, q1);
+        if (color0 == color1)
+            memset(levels, 0, 16);
+        else
+            ProjectLevels(block, 0, 3, q0, q1, 4, levels);
+
+        U32 indices = 0;
+        for (U32 i = 0; i < 16; i++)
+            indices |= (U32)BC1_INDICES[levels[i]] << (i * 2);
+
+        memcpy(output, &color0, sizeof(U16));
+        memcpy(output + 2, &color1, sizeof(U16));
+        memcpy(output + 4, &indices, sizeof(U32));
+        return EvaluateError(block, 0, 3, q0, q1, 4, levels);
+    }
+
+    static void CompressBC1(const Block& block, Quality quality, U8* output)
+    {
+        F32 e0[4], e1[4];
+        FitEndpoints(block, 0, 3, quality, e0, e1);
+
+        U8 levels[16];
+        F32 q0[4], q1[4];
+        F32 error = EncodeBC1Color(block, e0, e1, output, levels, q0, q1);
+        if (quality != Quality::High)
+            return;
+
+        for (U32 iter = 0; iter < 2 && error > 0.0f; iter++)
+        {
+            if (!RefineEndpoints(block, 0, 3, 4, levels, e0, e1))
+                break;
+
+            U8 candidate[8];
+            U8 candidateLevels[16];
+            const F32 candidateError = EncodeBC1Color(block, e0, e1, candidate, candidateLevels, q0, q1);
+            if (candidateError >= error)
+                break;
+
+            error = candidateError;
+            memcpy(output, candidate, sizeof(candidate));
+            memcpy(levels, candidateLevels, sizeof(candidateLevels));
+        }
+    }
+
+    //////////////////////////////////////////////////////////////////////////
+    // BC4
+
+    static void WriteBC4(U8 a0, U8 a1, const U8* indices, U8* output)
+    {
+        U64 bits = 0;
+        for (U32 i = 0; i < 16; i++)
+            bits |= (U64)indices[i] << (i * 3);
+
+        output[0] = a0;
+        output[1] = a1;
+        for (U32 i = 0; i < 6; i++)
+            output[2 + i] = (U8)(bits >> (i * 8));
+    }
+
+    // Encode the channel with 8 interpolated values, returns the error
+    static F32 EncodeBC4Interpolated(const Block& block, U32 channel, F32 e0, F32 e1, U8* output, U8* levels)
+    {
+        static const U8 BC4_INDICES[8] = { 0, 2, 3, 4, 5, 6, 7, 1 };
+
+        // a0 > a1 selects the 8 values mode
+        U8 a0 = (U8)(Clamp255(e0) + 0.5f);
+        U8 a1 = (U8)(Clamp255(e1) + 0.5f);
+        if (a0 < a1)
+            std::swap(a0, a1);
+
+        F32 q0[4] = {}, q1[4] = {};
+        q0[channel] = a0;
+        q1[channel] = a1;
+        if (a0 == a1)
+            memset(levels, 0, 16);
+        else
+            ProjectLevels(block, channel, 1, q0, q1, 8, levels);
+
+        U8 indices[16];
+        for (U32 i = 0; i < 16; i++)
+            indices[i] = BC4_INDICES[levels[i]];
+
+        WriteBC4(a0, a1, indices, output);
+        return EvaluateError(block, channel, 1, q0, q1, 8, levels);
+    }
+
+    // Encode the channel with 6 interpolated values and explicit 0 and 255, returns the error
+    static F32 EncodeBC4Explicit(const Block& block, U32 channel, U8* output)
+    {
+        U8 a0 = 255;
+        U8 a1 = 0;
+        for (U32 i = 0; i < 16; i++)
+        {
+            const U8 value = (U8)block.channels[channel][i];
+            if (value == 0 || value == 255)
+                continue;
+            a0 = std::min(a0, value);
+            a1 = std::max(a1, value);
+        }
+        if (a0 > a1)
+            a0 = a1 = 0;
+
+        F32 palette[8];
+        palette[0] = a0;
+        palette[1] = a1;
+        for (U32 i = 1; i < 5; i++)
+            palette[1 + i] = (F32)(((5 - i) * a0 + i * a1) / 5);
+        palette[6] = 0.0f;
+        palette[7] = 255.0f;
+
+        U8 indices[16];
+        F32 error = 0.0f;
+        for (U32 i = 0; i < 16; i++)
+        {
+            const F32 value = block.channels[channel][i];
+            F32 bestError = FLT_MAX;
+            for (U32 k = 0; k < 8; k++)
+            {
+                const F32 diff = value - palette[k];
+                if (diff * diff < bestError)
+                {
+                    bestError = diff * diff;
+                    indices[i] = (U8)k;
+                }
+            }
+            error += bestError;
+        }
+
+        WriteBC4(a0, a1, indices, output);
+        return error;
+    }
+
+    static void CompressBC4(const Block& block, U32 channel, Quality quality, U8* output)
+    {
+        F32 minValue = block.channels[channel][0];
+        F32 maxValue = block.channels[channel][0];
+        for (U32 i = 1; i < 16; i++)
+        {
+            minValue = std::min(minValue, block.channels[channel][i]);
+            maxValue = std::max(maxValue, block.channels[channel][i]);
+        }
+
+        U8 levels[16];
+        F32 error = EncodeBC4Interpolated(block, channel, maxValue, minValue, output, levels);
+        if (quality != Quality::High || error <= 0.0f)
+            return;
+
+        U8 candidate[8];
+        F32 e0[4] = {}, e1[4] = {};
+        if (RefineEndpoints(block, channel, 1, 8, levels, e0, e1))
+        {
+            U8 candidateLevels[16];
+            const F32 candidateError = EncodeBC4Interpolated(block, channel, e0[channel], e1[channel], candidate, candidateLevels);
+            if (candidateError < error)
+            {
+                error = candidateError;
+                memcpy(output, candidate, sizeof(candidate));
+            }
+        }
+
+        if (minValue == 0.0f || maxValue == 255.0f)
+        {
+            const F32 candidateError = EncodeBC4Explicit(block, channel, candidate);
+            if (candidateError < error)
+                memcpy(output, candidate, sizeof(candidate));
+        }
+    }
+
+    //////////////////////////////////////////////////////////////////////////
+    // BC7, mode 6: a single subset with RGBA 7.7.7.7 endpoints, a p-bit per endpoint and 4 bits indices
+
+    static F32 QuantizeMode6(const F32* endpoint, U32 pbit, U8* quantized, F32* color)
+    {
+        F32 error = 0.0f;
+        for (U32 c = 0; c < 4; c++)
+        {
+            const F32 value = Clamp255(endpoint[c]);
+            const I32 q = std::min(std::max((I32)((value - pbit) * 0.5f + 0.5f), 0), 127);
+            quantized[c] = (U8)q;
+            color[c] = (F32)((q << 1) | pbit);
+            error += (color[c] - value) * (color[c] - value);
+        }
+        return error;
+    }
+
+    // Encode the block with mode 6, returns the error. Levels are relative to the quantized endpoints q0 -> q1
+    static F32 EncodeBC7Mode6(const Block& block, const F32* e0, const F32* e1, bool searchPBits, U8* output, U8* levels, F32* q0, F32* q1)
+    {
+        U8 quantized[2][4];
+        U32 pbits[2] = {};
+        F32 error = FLT_MAX;
+        for (U32 combination = 0; combination < 4; combination++)
+        {
+            U8 candidate[2][4];
+            F32 c0[4], c1[4];
+            const U32 p0 = combination & 1;
+            const U32 p1 = combination >> 1;
+
+            // Select the p-bits by the endpoint error unless all combinations are searched
+            if (!searchPBits)
+            {
+                F32 tmp[4];
+                U8 tmpQuantized[4];
+                if (combination > 0)
+                    break;
+
+                const U32 bestP0 = QuantizeMode6(e0, 1, tmpQuantized, tmp) < QuantizeMode6(e0, 0, tmpQuantized, tmp) ? 1 : 0;
+                const U32 bestP1 = QuantizeMode6(e1, 1, tmpQuantized, tmp) < QuantizeMode6(e1, 0, tmpQuantized, tmp) ? 1 : 0;
+                QuantizeMode6(e0, bestP0, candidate[0], c0);
+                QuantizeMode6(e1, bestP1, candidate[1], c1);
+                pbits[0] = bestP0;
+                pbits[1] = bestP1;
+            }
+            else
+            {
+                QuantizeMode6(e0, p0, candidate[0], c0);
+                QuantizeMode6(e1, p1, candidate[1], c1);
+            }
+
+            U8 candidateLevels[16];
+            ProjectLevels(block, 0, 4, c0, c1, 16, candidateLevels);
+            const F32 candidateError = EvaluateError(block, 0, 4, c0, c1, 16, candidateLevels);
+            if (candidateError < error)
+            {
+                error = candidateError;
+                memcpy(quantized, candidate, sizeof(quantized));
+                memcpy(levels, candidateLevels, 16);
+                memcpy(q0, c0, sizeof(c0));
+                memcpy(q1, c1, sizeof(c1));
+                if (searchPBits)
+                {
+                    pbits[0] = p0;
+                    pbits[1] = p1;
+                }
+            }
+        }
+
+        // The highest bit of the anchor index is implicitly zero
+        if (levels[0] >= 8)
+        {
+            std::swap(quantized[0], quantized[1]);
+            std::swap(pbits[0], pbits[1]);
+            for (U32 c = 0; c < 4; c++)
+                std::swap(q0[c], q1[c]);
+            for (U32 i = 0; i < 16; i++)
+                levels[i] = 15 - levels[i];
+        }
+
+        memset(output, 0, 16);
+        BitWriter writer = { output };
+        writer.Write(1 << 6, 7);
+        for (U32 c = 0; c < 4; c++)
+        {
+            writer.Write(quantized[0][c], 7);
+            writer.Write(quantized[1][c], 7);
+        }
+        writer.Write(pbits[0], 1);
+        writer.Write(pbits[1], 1);
+        writer.Write(levels[0], 3);
+        for (U32 i = 1; i < 16; i++)
+            writer.Write(levels[i], 4);
+
+        return error;
+    }
+
+    static void CompressBC7(const Block& block, Quality quality, U8* output)
+    {
+        F32 e0[4], e1[4];
+        FitEndpoints(block, 0, 4, quality, e0, e1);
+
+        const bool searchPBits = quality == Quality::High;
+        U8 levels[16];
+        F32 q0[4], q1[4];
+        F32 error = EncodeBC7Mode6(block, e0, e1, searchPBits, output, levels, q0, q1);
+        if (quality != Quality::High)
+            return;
+
+        for (U32 iter = 0; iter < 2 && error > 0.0f; iter++)
+        {
+            if (!RefineEndpoints(block, 0, 4, 16, levels, e0, e1))
+                break;
+
+            U8 candidate[16];
+            U8 candidateLevels[16];
+            const F32 candidateError = EncodeBC7Mode6(block, e0, e1, searchPBits, candidate, candidateLevels, q0, q1);
+            if (candidateError >= error)
+                break;
+
+            error = candidateError;
+            memcpy(output, candidate, sizeof(candidate));
+            memcpy(levels, candidateLevels, sizeof(candidateLevels));
+        }
+    }
+
+    U32 GetBlockSize(Format format)
+    {
+        switch (format)
+        {
+        case Format::BC1:
+        case Format::BC4:
+            return 8;
+        default:
+            return 16;
+        }
+    }
+
+    void CompressBlock(Format format, Quality quality, const U8* pixels, U8* output)
+    {
+        Block block;
+        LoadBlock(pixels, block);
+
+        switch (format)
+        {
+        case Format::BC1:
+            CompressBC1(block, quality, output);
+            break;
+        case Format::BC3:
+            CompressBC4(block, 3, quality, output);
+            CompressBC1(block, quality, output + 8);
+            break;
+        case Format::BC4:
+            CompressBC4(block, 0, quality, output);
+            break;
+        case Format::BC5:
+            CompressBC4(block, 0, quality, output);
+            CompressBC4(block, 1, quality, output + 8);
+            break;
+        case Format::BC7:
+            CompressBC7(block, quality, output);
+            break;
+        default:
+            ASSERT(false);
+            break;
+        }
+    }
+
+    //////////////////////////////////////////////////////////////////////////
+    // Decoders
+
+    static void DecompressBC1(const U8* input, bool alwaysFourColors, U8* pixels)
+    {
+        U16 color0, color1;
+        U32 indices;
+        memcpy(&color0, input, sizeof(U16));
+        memcpy(&color1, input + 2, sizeof(U16));
+        memcpy(&indices, input + 4, sizeof(U32));
+
+        F32 c0[4], c1[4];
+        UnpackRGB565(color0, c0);
+        UnpackRGB565(color1, c1);
+
+        // Color0 <= color1 selects 3 colors and transparent black, BC3 always uses 4 colors
+        U8 palette[4][4];
+        const bool fourColors = alwaysFourColors || color0 > color1;
+        for (U32 c = 0; c < 3; c++)
+        {
+            const U32 v0 = (U32)c0[c];
+            const U32 v1 = (U32)c1[c];
+            palette[0][c] = (U8)v0;
+            palette[1][c] = (U8)v1;
+            palette[2][c] = (U8)(fourColors ? (2 * v0 + v1) / 3 : (v0 + v1) / 2);
+            palette[3][c] = (U8)(fourColors ? (v0 + 2 * v1) / 3 : 0);
+        }
+        palette[0][3] = palette[1][3] = palette[2][3] = 255;
+        palette[3][3] = fourColors ? 255 : 0;
+
+        for (U32 i = 0; i < 16; i++)
+            memcpy(pixels + i * 4, palette[(indices >> (i * 2)) & 3], 4);
+    }
+
+    static void DecompressBC4(const U8* input, U32 channel, U8* pixels)
+    {
+        const U32 a0 = input[0];
+        const U32 a1 = input[1];
+        U32 palette[8];
+        palette[0] = a0;
+        palette[1] = a1;
+        if (a0 > a1)
+        {
+            for (U32 i = 1; i < 7; i++)
+                palette[1 + i] = ((7 - i) * a0 + i * a1) / 7;
+        }
+        else
+        {
+            for (U32 i = 1; i < 5; i++)
+                palette[1 + i] = ((5 - i) * a0 + i * a1) / 5;
+            palette[6] = 0;
+            palette[7] = 255;
+        }
+
+        U64 bits = 0;
+        for (U32 i = 0; i < 6; i++)
+            bits |= (U64)input[2 + i] << (i * 8);
+        for (U32 i = 0; i < 16; i++)
+            pixels[i * 4 + channel] = (U8)palette[(bits >> (i * 3)) & 7];
+    }
+
+    static void DecompressBC7(const U8* input, U8* pixels)
+    {
+        static const U32 WEIGHTS[16] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+
+        BitReader reader = { input };
+        if (reader.Read(7) != (1 << 6))
+        {
+            memset(pixels, 0, 16 * 4);
+            return;
+        }
+
+        U32 endpoints[2][4];
+        for (U32 c = 0; c < 4; c++)
+        {
+            endpoints[0][c] = reader.Read(7);
+            endpoints[1][c] = reader.Read(7);
+        }
+        const U32 p0 = reader.Read(1);
+        const U32 p1 = reader.Read(1);
+        for (U32 c = 0; c < 4; c++)
+        {
+            endpoints[0][c] = (endpoints[0][c] << 1) | p0;
+            endpoints[1][c] = (endpoints[1][c] << 1) | p1;
+        }
+
+        for (U32 i = 0; i < 16; i++)
+        {
+            const U32 weight = WEIGHTS[reader.Read(i == 0 ? 3 : 4)];
+            for (U32 c = 0; c < 4; c++)
+                pixels[i * 4 + c] = (U8)(((64 - weight) * endpoints[0][c] + weight * endpoints[1][c] + 32) >> 6);
+        }
+    }
+
+    void DecompressBlock(Format format, const U8* input, U8* pixels)
+    {
+        static const U8 OPAQUE_BLACK[4] = { 0, 0, 0, 255 };
+        switch (format)
+        {
+        case Format::BC1:
+            DecompressBC1(input, false, pixels);
+            break;
+        case Format::BC3:
+            DecompressBC1(input + 8, true, pixels);
+            DecompressBC4(input, 3, pixels);
+            break;
+        case Format::BC4:
+            for (U32 i = 0; i < 16; i++)
+                memcpy(pixels + i * 4, OPAQUE_BLACK, 4);
+            DecompressBC4(input, 0, pixels);
+            break;
+        case Format::BC5:
+            for (U32 i = 0; i < 16; i++)
+                memcpy(pixels + i * 4, OPAQUE_BLACK, 4);
+            DecompressBC4(input, 0, pixels);
+            DecompressBC4(input + 8, 1, pixels);
+            break;
+        case Format::BC7:
+            DecompressBC7(input, pixels);
+            break;
+        default:
+            ASSERT(false);
+            break;
+        }
+    }
+
+    void CompressBlockRow(Format format, Quality quality, const U8* image, U32 width, U32 height, U32 blockRow, U8* output)
+    {
+        const U32 blocksX = (width + 3) / 4;
+        const U32 blockSize = GetBlockSize(format);
+        U8 pixels[16 * 4];
+        for (U32 blockX = 0; blockX < blocksX; blockX++)
+        {
+            for (U32 y = 0; y < 4; y++)
+            {
+                const U32 srcY = std::min(blockRow * 4 + y, height - 1);
+                for (U32 x = 0; x < 4; x++)
+                {
+                    const U32 srcX = std::min(blockX * 4 + x, width - 1);
+                    memcpy(pixels + (y * 4 + x) * 4, image + ((size_t)srcY * width + srcX) * 4, 4);
+                }
+            }
+            CompressBlock(format, quality, pixels, output + blockX * blockSize);
+        }
+    }
+}
+}
+}
\ No newline at end of file
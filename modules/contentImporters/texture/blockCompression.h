@@ -0,0 +1,43 @@
+#pragma once
+
+#include "core\common.h"
+
+namespace VulkanTest
+{
+namespace Editor
+{
+    // Block compression encoders of RGBA8 images.
+    // Each 4x4 block is encoded independently, so rows of blocks could be compressed in parallel.
+    namespace BlockCompression
+    {
+        enum class Format
+        {
+            BC1,    // RGB, 4bpp
+            BC3,    // RGBA, 8bpp
+            BC4,    // R, 4bpp
+            BC5,    // RG, 8bpp, normal maps
+            BC7,    // RGBA, 8bpp, mode 6 only
+        };
+
+        enum class Quality
+        {
+            Fast,       // Bounding box endpoints
+            Normal,     // Principal axis endpoints
+            High,       // Principal axis endpoints with least squares refinement
+        };
+
+        // Bytes of a 4x4 block
+        U32 GetBlockSize(Format format);
+
+        // Compress a 4x4 block, pixels are RGBA8 in row order
+        void CompressBlock(Format format, Quality quality, const U8* pixels, U8* output);
+
+        // Compress a row of blocks of an image, pixels out of the image are clamped to the edge
+        void CompressBlockRow(Format format, Quality quality, const U8* image, U32 width, U32 height, U32 blockRow, U8* output);
+
+        // Decompress a 4x4 block into RGBA8 pixels in row order, used to measure the error of the encoders.
+        // Only mode 6 of BC7 is supported, channels missing in the format are 0 and alpha is 255.
+        void DecompressBlock(Format format, const U8* input, U8* pixels);
+    }
+}
+}
\ No newline at end of file
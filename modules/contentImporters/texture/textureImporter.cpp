@@ -1,6 +1,9 @@
 #include "textureImporter.h"
 #include "contentImporters\resourceImportingManager.h"
 #include "core\profiler\profiler.h"
+#include "core\platform\timer.h"
+#include "core\threading\jobsystem.h"
+#include "gpu\vulkan\typeToString.h"
 
 #define STB_IMAGE_IMPLEMENTATION
 #include "stb\stb_image.h"
@@ -67,21 +70,19 @@ namespace Editor
         {
             bool compress = true;
             bool generateMipmaps = false;
+            TextureImporter::CompressionFormat format = TextureImporter::CompressionFormat::Auto;
+            BlockCompression::Quality quality = BlockCompression::Quality::Normal;
         };
 
-        void CompressRGBA(Span<const U8> input, OutputMemoryStream& output, U32 width, U32 height)
+        // Image of a mip level to write
+        struct MipImage
         {
-            PROFILE_FUNCTION();
-            output.Write(input.begin(), input.length());
-        }
-
-        void CompressBC3(Span<const U8> input, OutputMemoryStream& output, U32 width, U32 height)
-        {
-        }
-
-        void CompressBC1(Span<const U8> input, OutputMemoryStream& output, U32 width, U32 height)
-        {
-        }
+            const U8* pixels;
+            U32 width;
+            U32 height;
+            U64 offset;     // Offset of the compressed data
+            U32 firstRow;   // The first row of the image in all rows to compress
+        };
 
         U32 MipLevelsCount(U32 width, U32 height, bool useMipLevels)
         {
@@ -133,61 +134,116 @@ namespace Editor
             }
         }
 
-        bool WriteTexture(void (*compressor)(Span<const U8>, OutputMemoryStream&, U32, U32), const Input& input, const Options& options, OutputMemoryStream& dst)
+        bool WriteTexture(const Input& input, const Options& options, VkFormat format, const BlockCompression::Format* blockFormat, OutputMemoryStream& dst)
         {
+            PROFILE_FUNCTION();
             U32 sourceMipLevels = input.mips;
             bool useMipLevels = (options.generateMipmaps || sourceMipLevels > 1) && (input.w > 1 || input.h > 1);
             U32 mipLevels = MipLevelsCount(input.w, input.h, useMipLevels);
 
             GPU::TextureFormatLayout layout;
             layout.SetTexture2D(input.format, input.w, input.h, mipLevels);
-            dst.Reserve(dst.Size() + layout.GetRequiredSize());
-
-            Array<U8> curMipData;
-            Array<U8> prevMipData;
+            const U32 blockStride = layout.GetBlockStride();
             const U32 faces = input.isCubemap ? 6 : 1;
+
+            // Generated mips of all faces are stored in one buffer
+            Array<U8> mipData;
+            if (options.generateMipmaps)
+            {
+                U64 mipDataSize = 0;
+                for (U32 mip = 1; mip < mipLevels; ++mip)
+                    mipDataSize += (U64)std::max(input.w >> mip, 1u) * std::max(input.h >> mip, 1u) * blockStride;
+                mipData.resize((U32)(mipDataSize * faces * input.slices));
+            }
+
+            // Gather images of all mips, mips are generated serially since each one is computed from the previous one
+            Array<MipImage> images;
+            U64 mipDataOffset = 0;
+            U64 compressedSize = 0;
+            U32 rowCount = 0;
             for (U32 slice = 0; slice < input.slices; slice++)
             {
                 for (U32 face = 0; face < faces; ++face)
                 {
                     for (U32 mip = 0; mip < mipLevels; ++mip)
                     {
-                        U32 mipW = std::max(input.w >> mip, 1u);
-                        U32 mipH = std::max(input.h >> mip, 1u);
-                        if (mip == 0)
+                        MipImage& image = images.emplace();
+                        image.width = std::max(input.w >> mip, 1u);
+                        image.height = std::max(input.h >> mip, 1u);
+                        if (mip > 0 && options.generateMipmaps)
                         {
-                            const Input::Image& src = input.Get(face, slice, mip);
-                            compressor(src.pixels, dst, mipW, mipH);
+                            const MipImage& prev = images[images.size() - 2];
+                            U8* pixels = mipData.data() + mipDataOffset;
+                            const U64 size = (U64)image.width * image.height * blockStride;
+                            ComputeMip(
+                                input.format,
+                                Span(prev.pixels, (U64)prev.width * prev.height * blockStride),
+                                Span(pixels, size),
+                                prev.width, prev.height,
+                                image.width, image.height
+                            );
+                            image.pixels = pixels;
+                            mipDataOffset += size;
                         }
                         else
                         {
-                            if (options.generateMipmaps)
-                            {
-                                curMipData.resize(mipW * mipH * layout.GetBlockStride());
-
-                                U32 prevW = std::max(input.w >> (mip - 1), 1u);
-                                U32 prevH = std::max(input.h >> (mip - 1), 1u);
-                                ComputeMip(
-                                    input.format,
-                                    mip == 1 ? Span<const U8>(input.Get(face, slice, 0).pixels) : prevMipData,
-                                    curMipData,
-                                    prevW, prevH, 
-                                    mipW, mipH
-                                );
-
-                                compressor(curMipData, dst, mipW, mipH);
-                                prevMipData.swap(std::move(curMipData));
-                            }
-                            else
-                            {
-                                const Input::Image& src = input.Get(face, slice, mip);
-                                compressor(src.pixels, dst, mipW, mipH);
-                            }
+                            image.pixels = input.Get(face, slice, mip).pixels.Data();
                         }
+
+                        // Rows of blocks or rows of pixels
+                        const U32 rows = blockFormat ? (image.height + 3) / 4 : image.height;
+                        const U64 rowSize = blockFormat ? 
+                            (U64)((image.width + 3) / 4) * BlockCompression::GetBlockSize(*blockFormat) : 
+                            (U64)image.width * blockStride;
+                        image.offset = compressedSize;
+                        image.firstRow = rowCount;
+                        compressedSize += rowSize * rows;
+                        rowCount += rows;
                     }
                 }
             }
 
+            // Compress rows of all images in parallel
+            Timer timer;
+            const U64 dstOffset = dst.Size();
+            dst.Resize(dstOffset + compressedSize);
+            U8* output = dst.Data() + dstOffset;
+            Jobsystem::ForEach(rowCount, 1, [&](U32 beginRow, U32 endRow) {
+                PROFILE_BLOCK("Compress texture rows");
+                U32 imageIndex = 0;
+                while (imageIndex + 1 < images.size() && images[imageIndex + 1].firstRow <= beginRow)
+                    imageIndex++;
+
+                for (U32 row = beginRow; row < endRow; row++)
+                {
+                    while (imageIndex + 1 < images.size() && images[imageIndex + 1].firstRow <= row)
+                        imageIndex++;
+
+                    const MipImage& image = images[imageIndex];
+                    const U32 imageRow = row - image.firstRow;
+                    if (blockFormat)
+                    {
+                        const U64 rowSize = (U64)((image.width + 3) / 4) * BlockCompression::GetBlockSize(*blockFormat);
+                        BlockCompression::CompressBlockRow(*blockFormat, options.quality, image.pixels, image.width, image.height, imageRow, output + image.offset + imageRow * rowSize);
+                    }
+                    else
+                    {
+                        const U64 rowSize = (U64)image.width * blockStride;
+                        memcpy(output + image.offset + imageRow * rowSize, image.pixels + imageRow * rowSize, rowSize);
+                    }
+                }
+            });
+
+            if (blockFormat)
+            {
+                U64 pixels = 0;
+                for (const MipImage& image : images)
+                    pixels += (U64)image.width * image.height;
+
+                const F32 time = std::max(timer.GetTimeSinceStart(), 1e-6f);
+                Logger::Info("Compressed texture %dx%d to %s in %.2f ms (%.1f MPix/s)", 
+                    input.w, input.h, GPU::FormatToString(format), time * 1000.0f, pixels / time / 1000000.0f);
+            }
             return true;
         }
 
@@ -209,13 +265,42 @@ namespace Editor
                 return false;
             }
 
-            VkFormat format;
-            if (!options.compress)
-                format = VK_FORMAT_R8G8B8A8_UNORM;
-            else if (input.hasAlpha)
-                format = VK_FORMAT_BC3_UNORM_BLOCK;
-            else
-                format = VK_FORMAT_BC1_RGB_UNORM_BLOCK;
+            using CompressionFormat = TextureImporter::CompressionFormat;
+            CompressionFormat compressionFormat = options.format;
+            if (compressionFormat == CompressionFormat::Auto)
+                compressionFormat = input.hasAlpha ? CompressionFormat::BC3 : CompressionFormat::BC1;
+
+            VkFormat format = VK_FORMAT_R8G8B8A8_UNORM;
+            BlockCompression::Format blockFormat = BlockCompression::Format::BC1;
+            if (options.compress)
+            {
+                switch (compressionFormat)
+                {
+                case CompressionFormat::BC1:
+                    format = VK_FORMAT_BC1_RGB_UNORM_BLOCK;
+                    blockFormat = BlockCompression::Format::BC1;
+                    break;
+                case CompressionFormat::BC3:
+                    format = VK_FORMAT_BC3_UNORM_BLOCK;
+                    blockFormat = BlockCompression::Format::BC3;
+                    break;
+                case CompressionFormat::BC4:
+                    format = VK_FORMAT_BC4_UNORM_BLOCK;
+                    blockFormat = BlockCompression::Format::BC4;
+                    break;
+                case CompressionFormat::BC5:
+                    format = VK_FORMAT_BC5_UNORM_BLOCK;
+                    blockFormat = BlockCompression::Format::BC5;
+                    break;
+                case CompressionFormat::BC7:
+                    format = VK_FORMAT_BC7_UNORM_BLOCK;
+                    blockFormat = BlockCompression::Format::BC7;
+                    break;
+                default:
+                    ASSERT(false);
+                    break;
+                }
+            }
 
             // Write texture header
             TextureHeader header = {};
@@ -228,14 +313,7 @@ namespace Editor
 
             // Write texture data
             auto textureChunk = ctx.AllocateChunk(0);
-            if (!options.compress)
-                WriteTexture(CompressRGBA, input, options, textureChunk->mem);
-            else if (input.hasAlpha)
-                WriteTexture(CompressBC3, input, options, textureChunk->mem);
-            else
-                WriteTexture(CompressBC1, input, options, textureChunk->mem);
-
-            return true;
+            return WriteTexture(input, options, format, options.compress ? &blockFormat : nullptr, textureChunk->mem);
         }
     }
 
@@ -340,6 +418,8 @@ namespace Editor
             TextureCompressor::Options options;
             options.generateMipmaps = cfg.generateMipmaps;
             options.compress = cfg.compress;
+            options.format = cfg.format;
+            options.quality = cfg.quality;
             if (!TextureCompressor::WriteTexture(input, options, ctx))
                 return CreateResult::Error;
 
@@ -2,6 +2,7 @@
 
 #include "contentImporters\definition.h"
 #include "content\resources\texture.h"
+#include "blockCompression.h"
 
 namespace VulkanTest
 {
@@ -24,10 +25,22 @@ namespace Editor
         };
         static bool GetImageType(const char* path, ImageType& type);
 
+        enum class CompressionFormat
+        {
+            Auto,   // BC3 for images with alpha, otherwise BC1
+            BC1,
+            BC3,
+            BC4,
+            BC5,
+            BC7,
+        };
+
         struct ImportConfig
         {
             bool generateMipmaps = true;
-            bool compress = false;
+            bool compress = true;
+            CompressionFormat format = CompressionFormat::Auto;
+            BlockCompression::Quality quality = BlockCompression::Quality::Normal;
         };
 
         CreateResult Import(CreateResourceContext& ctx);
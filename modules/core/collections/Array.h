@@ -5,7 +5,23 @@
 
 namespace VulkanTest
 {
-    template<typename T>
+    // Default storage of Array, allocates from the general heap
+    struct ArrayAllocator
+    {
+        static void* Allocate(size_t size, size_t align) {
+            return CJING_MALLOC_ALIGN(size, align);
+        }
+
+        static void* Reallocate(void* ptr, size_t oldSize, size_t newSize, size_t align) {
+            return CJING_REMALLOC_ALIGN(ptr, newSize, align);
+        }
+
+        static void Free(void* ptr) {
+            CJING_FREE_ALIGN(ptr);
+        }
+    };
+
+    template<typename T, typename Allocator = ArrayAllocator>
     class Array
     {
     public:
@@ -15,7 +31,7 @@ namespace VulkanTest
             if (data_ != nullptr)
             {
                 DestructData(data_, data_ + size_);
-                CJING_FREE_ALIGN(data_);
+                Allocator::Free(data_);
             }
         }
 
@@ -31,7 +47,9 @@ namespace VulkanTest
             if (data_ != nullptr)
             {
                 DestructData(data_, data_ + size_);
-                CJING_FREE_ALIGN(data_);
+                Allocator::Free(data_);
+                data_ = nullptr;
+                size_ = capacity_ = 0;
             }
 
             std::swap(size_, rhs.size_);
@@ -39,7 +57,7 @@ namespace VulkanTest
             std::swap(data_, rhs.data_);
         }
 
-        void swap(Array<T>&& rhs)
+        void swap(Array&& rhs)
         {
             std::swap(size_, rhs.size_);
             std::swap(capacity_, rhs.capacity_);
@@ -141,10 +159,10 @@ namespace VulkanTest
                 {
                     U32 newCapacity = capacity_ == 0 ? 4 : capacity_ * 2;
                     T* oldData = data_;
-                    data_ = static_cast<T*>(CJING_MALLOC_ALIGN(newCapacity * sizeof(T), alignof(T)));
+                    data_ = static_cast<T*>(Allocator::Allocate(newCapacity * sizeof(T), alignof(T)));
                     MoveData(data_, oldData, index);
                     MoveData(data_ + index + 1, oldData + index, size_ - index);
-                    CJING_FREE_ALIGN(oldData);
+                    Allocator::Free(oldData);
                     capacity_ = newCapacity;
                 }
                 else
@@ -249,13 +267,13 @@ namespace VulkanTest
             clear();
         }
 
-        Array<T> copy() const 
+        Array copy() const 
         {
-            Array<T> res;
+            Array res;
             if (size_ == 0) 
                 return res;
 
-            res.data_ = static_cast<T*>(CJING_MALLOC_ALIGN(size_ * sizeof(T), alignof(T)));
+            res.data_ = static_cast<T*>(Allocator::Allocate(size_ * sizeof(T), alignof(T)));
             res.capacity_ = size_;
             res.size_ = size_;
             for (U32 i = 0; i < size_; ++i) {
@@ -269,8 +287,9 @@ namespace VulkanTest
             clear();
             if (data_ != nullptr)
             {
-                CJING_FREE_ALIGN(data_);
+                Allocator::Free(data_);
                 data_ = nullptr;
+                capacity_ = 0;
             }
         }
 
@@ -292,14 +311,14 @@ namespace VulkanTest
             
             if constexpr (__is_trivially_copyable(T))
             {
-                size_t newSize = newCapacity * sizeof(T);
-                data_ = static_cast<T*>(CJING_REMALLOC_ALIGN(data_, newCapacity * sizeof(T), alignof(T)));
+                data_ = static_cast<T*>(Allocator::Reallocate(data_, capacity_ * sizeof(T), newCapacity * sizeof(T), alignof(T)));
             }
             else
             {
-                T* newData = static_cast<T*>(CJING_MALLOC_ALIGN(newCapacity * sizeof(T), alignof(T)));
+                T* newData = static_cast<T*>(Allocator::Allocate(newCapacity * sizeof(T), alignof(T)));
                 MoveData(newData, data_, size_);
-                CJING_FREE_ALIGN(data_);
+                if (data_ != nullptr)
+                    Allocator::Free(data_);
                 data_ = newData;
             }
             capacity_ = newCapacity;
@@ -60,6 +60,43 @@ namespace VulkanTest
     }
 
 
+    // Remove [pos, pos + len) from the command line
+    static void RemoveArg(char* pos, I32 len, char*& end)
+    {
+        memmove(pos, pos + len, end - pos - len);
+        end -= len;
+        *end = 0;
+    }
+
+    static bool ParseFlag(char* buffer, char*& end, const char* name)
+    {
+        auto posIndex = FindSubstring(buffer, name, 0);
+        if (posIndex < 0)
+            return false;
+
+        RemoveArg(buffer + posIndex, StringLength(name), end);
+        return true;
+    }
+
+    static bool ParseOption(char* buffer, char*& end, const char* name, std::string& value)
+    {
+        auto posIndex = FindSubstring(buffer, name, 0);
+        if (posIndex < 0)
+            return false;
+
+        char* pos = buffer + posIndex;
+        char* argStart;
+        char* argEnd;
+        if (!ParseArg(pos + StringLength(name), argStart, argEnd))
+        {
+            std::cout << "Failed to parse argument." << std::endl;
+            return false;
+        }
+        value = String((const char*)argStart, 0, static_cast<I32>(argEnd - argStart));
+        RemoveArg(pos, static_cast<I32>((argEnd - pos) + 1), end);
+        return true;
+    }
+
 	bool CommandLine::Parse(const char* cmdLine)
 	{
         auto length = StringLength(cmdLine);
@@ -73,26 +110,16 @@ namespace VulkanTest
         buffer[length++] = 0;
         char* end = buffer.data() + length;
 
-        char* pos;
-        char* argStart;
-        char* argEnd;
+        std::string workerCount;
+        if (ParseOption(buffer.data(), end, "-workers", workerCount))
+            FromCString(Span<const char>(workerCount.c_str(), (U32)workerCount.size()), options.workerCount);
+
 #ifdef CJING3D_EDITOR
-		auto posIndex = FindSubstring(buffer.data(), "-project", 0);
-		if (posIndex >= 0)
-		{
-            pos = buffer.data() + posIndex;
-            int len = ARRAYSIZE("-project") - 1;
-            if (!ParseArg(pos + len, argStart, argEnd))
-            {
-                std::cout << "Failed to parse argument." << std::endl;
-                return true;
-            }
-            options.projectPath = String((const char*)argStart, 0, static_cast<I32>(argEnd - argStart));
-            len = static_cast<I32>((argEnd - pos) + 1);
-            memcpy(pos, pos + len, (end - pos - len) * 2);
-            * (end - len) = 0;
-            end -= len;
-		}
+        // Flags are removed first, so that they are not parsed as a part of other options
+        options.cookForce = ParseFlag(buffer.data(), end, "-cookforce");
+        ParseOption(buffer.data(), end, "-project", options.projectPath);
+        ParseOption(buffer.data(), end, "-cook", options.cookPath);
+        ParseOption(buffer.data(), end, "-bench", options.benchmark);
 #endif
 		return true;
 	}
@@ -12,11 +12,20 @@ namespace VulkanTest
 		{
 			bool fullscreen = false;
 			bool vsync = true;
+			// Count of job workers, 0 means the count of CPUs
+			U32 workerCount = 0;
 
 #ifdef CJING3D_EDITOR
 			bool newProject = false;
 			std::string workingPath;
 			std::string projectPath;
+
+			// Cook the project into the output folder and exit
+			std::string cookPath;
+			bool cookForce = false;
+
+			// Run the benchmark of the name ("all" for every benchmark) and exit
+			std::string benchmark;
 #endif
 		};
 		static Options options;
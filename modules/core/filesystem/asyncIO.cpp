@@ -0,0 +1,301 @@
+#include "asyncIO.h"
+#include "filesystem.h"
+#include "core\collections\array.h"
+#include "core\platform\asyncFile.h"
+#include "core\platform\atomic.h"
+#include "core\platform\sync.h"
+#include "core\profiler\profiler.h"
+
+#include <algorithm>
+
+namespace VulkanTest
+{
+	struct AsyncFile
+	{
+		Path path;
+		// File attached to the io completion port, nullptr if reads are done by io threads
+		void* handle = nullptr;
+		// File of the io threads, it is opened once and its reads are serialized by the mutex
+		UniquePtr<File> blockingFile;
+		Mutex blockingMutex;
+	};
+
+	namespace AsyncIOImpl
+	{
+		// Max count of overlapped reads in flight
+		static const U32 MAX_INFLIGHT_READS = 64;
+		// Count of io threads if the io completion port is not available
+		static const U32 FALLBACK_THREAD_COUNT = 4;
+
+		struct PendingRead
+		{
+			// Must be the first member, completions are returned as AsyncReadOp
+			AsyncReadOp op;
+			AsyncReadRequest request;
+		};
+
+		class AsyncIOThread : public Thread
+		{
+		public:
+			I32 Task() override;
+		};
+
+		Mutex mutex;
+		ConditionVariable cv;
+		// Sorted by file and offset descendingly when dirty, the next read is at the back
+		Array<PendingRead*> pendingReads;
+		bool isPendingDirty = false;
+		volatile I32 isExiting = 0;
+		bool initialized = false;
+		AsyncIOQueue* queue = nullptr;
+		Array<AsyncIOThread*> threads;
+	}
+	using namespace AsyncIOImpl;
+
+	// Must be called under the lock
+	static PendingRead* PopPendingRead()
+	{
+		if (pendingReads.empty())
+			return nullptr;
+
+		if (isPendingDirty)
+		{
+			std::sort(pendingReads.begin(), pendingReads.end(), [](const PendingRead* a, const PendingRead* b) {
+				if (a->request.file != b->request.file)
+					return a->request.file > b->request.file;
+				return a->request.offset > b->request.offset;
+			});
+			isPendingDirty = false;
+		}
+
+		PendingRead* read = pendingReads.back();
+		pendingReads.pop_back();
+		return read;
+	}
+
+	static void FinishRead(PendingRead* read, bool success)
+	{
+		if (!success)
+			Logger::Warning("Failed to read %s at %llu", read->request.file->path.c_str(), read->request.offset);
+
+		if (read->request.callback != nullptr)
+			read->request.callback(read->request.userData, success);
+		CJING_SAFE_DELETE(read);
+	}
+
+	// Issue pending reads in order, return the count of issued reads
+	static U32 IssuePendingReads(U32 maxCount)
+	{
+		U32 issuedCount = 0;
+		while (issuedCount < maxCount)
+		{
+			PendingRead* read = nullptr;
+			{
+				ScopedMutex lock(mutex);
+				read = PopPendingRead();
+			}
+			if (read == nullptr)
+				break;
+
+			if (!queue->Read(read->request.file->handle, read->op))
+			{
+				FinishRead(read, false);
+				continue;
+			}
+			issuedCount++;
+		}
+		return issuedCount;
+	}
+
+	static bool ReadBlocking(PendingRead* read)
+	{
+		AsyncFile* file = read->request.file;
+		ScopedMutex lock(file->blockingMutex);
+		return file->blockingFile->Seek(read->request.offset) &&
+			file->blockingFile->Read(read->request.buffer, read->request.size);
+	}
+
+	I32 AsyncIOThread::Task()
+	{
+		Profiler::SetThreadName("AsyncIO");
+		if (queue != nullptr)
+		{
+			// Only one thread owns the completion port, it issues reads and dispatches completions
+			U32 inFlightCount = 0;
+			while (AtomicRead(&isExiting) == 0 || inFlightCount > 0)
+			{
+				if (AtomicRead(&isExiting) == 0)
+					inFlightCount += IssuePendingReads(MAX_INFLIGHT_READS - inFlightCount);
+
+				if (inFlightCount == 0 && AtomicRead(&isExiting) != 0)
+					break;
+
+				AsyncReadOp* op = queue->WaitCompletion();
+				if (op == nullptr)
+					continue;
+
+				ASSERT(inFlightCount > 0);
+				inFlightCount--;
+				PendingRead* read = reinterpret_cast<PendingRead*>(op);
+				FinishRead(read, op->success);
+			}
+		}
+		else
+		{
+			while (true)
+			{
+				PendingRead* read = nullptr;
+				mutex.Lock();
+				while (pendingReads.empty() && AtomicRead(&isExiting) == 0)
+					cv.Sleep(mutex);
+				if (AtomicRead(&isExiting) == 0)
+					read = PopPendingRead();
+				mutex.Unlock();
+
+				if (read == nullptr)
+					break;
+
+				FinishRead(read, ReadBlocking(read));
+			}
+		}
+		return 0;
+	}
+
+	void AsyncIO::Initialize()
+	{
+		if (initialized)
+			return;
+
+		queue = CJING_NEW(AsyncIOQueue);
+		if (!queue->IsValid())
+		{
+			Logger::Warning("Io completion port is not available, fallback to io threads");
+			CJING_SAFE_DELETE(queue);
+		}
+
+		const U32 threadCount = queue != nullptr ? 1 : FALLBACK_THREAD_COUNT;
+		Logger::Info("Create async io threads %d", threadCount);
+
+		StaticString<32> name;
+		for (U32 i = 0; i < threadCount; i++)
+		{
+			AsyncIOThread* thread = CJING_NEW(AsyncIOThread);
+			if (!thread->Create(name.Sprintf("AsyncIO thread %d", i).c_str()))
+			{
+				CJING_SAFE_DELETE(thread);
+				break;
+			}
+			threads.push_back(thread);
+		}
+
+		if (threads.empty())
+		{
+			Logger::Error("Failed to create async io threads");
+			CJING_SAFE_DELETE(queue);
+			return;
+		}
+		initialized = true;
+	}
+
+	void AsyncIO::Uninitialize()
+	{
+		if (!initialized)
+			return;
+
+		AtomicStore(&isExiting, 1);
+		if (queue != nullptr)
+			queue->Wakeup();
+		else
+			cv.WakupAll();
+
+		for (auto thread : threads)
+			thread->Join();
+
+		for (auto thread : threads)
+		{
+			thread->Destroy();
+			CJING_SAFE_DELETE(thread);
+		}
+		threads.clear();
+
+		// Cancel reads which are not issued
+		for (auto read : pendingReads)
+			FinishRead(read, false);
+		pendingReads.clear();
+
+		CJING_SAFE_DELETE(queue);
+		AtomicStore(&isExiting, 0);
+		initialized = false;
+	}
+
+	bool AsyncIO::IsInitialized()
+	{
+		return initialized;
+	}
+
+	AsyncFile* AsyncIO::OpenFile(const char* path)
+	{
+		ASSERT(initialized);
+		if (!FileSystem::FileExists(path))
+			return nullptr;
+
+		void* handle = nullptr;
+		UniquePtr<File> blockingFile;
+		if (queue != nullptr)
+		{
+			handle = queue->OpenFile(path);
+			if (handle == nullptr)
+				return nullptr;
+		}
+		else
+		{
+			blockingFile = FileSystem::OpenFile(path, FileFlags::READ);
+			if (!blockingFile || !blockingFile->IsValid())
+				return nullptr;
+		}
+
+		AsyncFile* file = CJING_NEW(AsyncFile);
+		file->path = Path(path);
+		file->handle = handle;
+		file->blockingFile = blockingFile.Move();
+		return file;
+	}
+
+	void AsyncIO::CloseFile(AsyncFile* file)
+	{
+		if (file == nullptr)
+			return;
+
+		AsyncIOQueue::CloseFile(file->handle);
+		if (file->blockingFile)
+			file->blockingFile->Close();
+		CJING_SAFE_DELETE(file);
+	}
+
+	void AsyncIO::Read(Span<const AsyncReadRequest> requests)
+	{
+		ASSERT(initialized);
+		if (requests.empty())
+			return;
+
+		{
+			ScopedMutex lock(mutex);
+			for (const auto& request : requests)
+			{
+				ASSERT(request.file != nullptr && request.buffer != nullptr);
+				PendingRead* read = CJING_NEW(PendingRead);
+				read->request = request;
+				read->op.buffer = request.buffer;
+				read->op.offset = request.offset;
+				read->op.size = request.size;
+				pendingReads.push_back(read);
+			}
+			isPendingDirty = true;
+		}
+
+		if (queue != nullptr)
+			queue->Wakeup();
+		else
+			cv.WakupAll();
+	}
+}
\ No newline at end of file
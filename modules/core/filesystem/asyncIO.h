@@ -0,0 +1,37 @@
+#pragma once
+
+#include "core\common.h"
+
+namespace VulkanTest
+{
+	struct AsyncFile;
+
+	// Called on the IO thread when the read is finished, it should be cheap (e.g. kicking a job)
+	using AsyncReadCallback = void(*)(void* userData, bool success);
+
+	struct AsyncReadRequest
+	{
+		AsyncFile* file = nullptr;
+		U64 offset = 0;
+		U32 size = 0;
+		void* buffer = nullptr;
+		AsyncReadCallback callback = nullptr;
+		void* userData = nullptr;
+	};
+
+	// Keeps many file reads in flight, pending reads are issued in the order of file offset.
+	// Reads are overlapped by the io completion port of the platform,
+	// or done by a pool of io threads if the port is not available.
+	namespace AsyncIO
+	{
+		void Initialize();
+		void Uninitialize();
+		bool IsInitialized();
+
+		AsyncFile* OpenFile(const char* path);
+		// All reads of the file must be finished
+		void CloseFile(AsyncFile* file);
+
+		void Read(Span<const AsyncReadRequest> requests);
+	}
+}
\ No newline at end of file
@@ -2,16 +2,23 @@
 #include "memTracker.h"
 #include "memory.h"
 #include "platform\platform.h"
+#include "core\platform\atomic.h"
+#include "core\profiler\profiler.h"
 
 namespace VulkanTest
 {
 	// Small alloc strategy:
-	// MAX_SMALL_SIZE is 64
-	// According to size divided into 4 free lists: 8 16 32 64
+	// MAX_SMALL_SIZE is 512
+	// According to size divided into 7 free lists: 8 16 32 64 128 256 512
+	// Each thread keeps a cache of free items for every size class in front of the shared pages,
+	// so the allocator mutex is only taken once per batch.
 
-	static constexpr U32 SMALL_ALLOC_MAX_SIZE = 64;
+	static constexpr U32 SMALL_ALLOC_MAX_SIZE = 512;
+	static constexpr U32 SMALL_ALLOC_CLASS_COUNT = 7;
 	static constexpr U32 PAGE_SIZE = 4096;
-	static constexpr size_t MAX_PAGE_COUNT = 16384;
+	static constexpr size_t MAX_PAGE_COUNT = 65536;
+	static constexpr U32 THREAD_CACHE_SIZE = 32;
+	static constexpr U32 THREAD_CACHE_BATCH = THREAD_CACHE_SIZE / 2;
 
 	struct DefaultAllocator::MemPage
 	{
@@ -26,20 +33,41 @@ namespace VulkanTest
 		Header header;
 	};
 
+	struct DefaultAllocator::ThreadCache
+	{
+		struct Bin
+		{
+			U32 count = 0;
+			void* items[THREAD_CACHE_SIZE];
+		};
+
+		DefaultAllocator* allocator = nullptr;
+		ThreadCache* next = nullptr;		// Next cache of the current thread
+		ThreadCache* prevShared = nullptr;	// Caches of the same allocator
+		ThreadCache* nextShared = nullptr;
+		Bin bins[SMALL_ALLOC_CLASS_COUNT];
+	};
+
+	static_assert(sizeof(DefaultAllocator::freeList) / sizeof(DefaultAllocator::freeList[0]) == SMALL_ALLOC_CLASS_COUNT, "Invalid small alloc class count");
+
 	static U32 GetFreeListIndex(size_t size)
 	{
-		// According to size divided into 4 free lists: 8 16 32 64
-		// (0, 8]   => 0; 
-		// (8, 16]  => 1; 
-		// (16, 32] => 2; 
-		// (32, 64] => 3; 
+		// According to size divided into 7 free lists: 8 16 32 64 128 256 512
+		// (0, 8]     => 0; 
+		// (8, 16]    => 1; 
+		// (16, 32]   => 2; 
+		// (32, 64]   => 3; 
+		// (64, 128]  => 4; 
+		// (128, 256] => 5; 
+		// (256, 512] => 6; 
 		ASSERT(size > 0);
 		ASSERT(size <= SMALL_ALLOC_MAX_SIZE);
 #ifdef _WIN32
 		unsigned long res;
 		return _BitScanReverse(&res, ((unsigned long)size - 1) >> 2) ? res : 0;
 #else
-		return 31 - __builtin_clz((n - 1) >> 2);
+		const U32 n = ((U32)size - 1) >> 2;
+		return n != 0 ? 31 - __builtin_clz(n) : 0;
 #endif
 	}
 
@@ -63,10 +91,9 @@ namespace VulkanTest
 		return (DefaultAllocator::MemPage*)((UIntPtr)ptr & ~(U64)(PAGE_SIZE - 1));
 	}
 
-	static void* AllocSmall(DefaultAllocator& allocator, size_t size)
+	// Allocator mutex must be locked
+	static void* AllocSmallLocked(DefaultAllocator& allocator, U32 freeListIndex)
 	{
-		U32 freeListIndex = GetFreeListIndex(size);
-		ScopedMutex lock(allocator.mutex);
 		if (allocator.smallAllocation == nullptr)
 			allocator.smallAllocation = (U8*)Platform::MemReserve(MAX_PAGE_COUNT * PAGE_SIZE);
 
@@ -83,7 +110,7 @@ namespace VulkanTest
 		}
 
 		ASSERT(page->header.itemSize > 0);
-		ASSERT(page->header.firstFree + size <= sizeof(page->data));
+		ASSERT(page->header.firstFree + page->header.itemSize <= sizeof(page->data));
 		void* mem = &page->data[page->header.firstFree];
 		page->header.firstFree = *(U32*)mem;
 
@@ -105,11 +132,10 @@ namespace VulkanTest
 		return mem;
 	}
 
-	static void FreeSmall(DefaultAllocator& allocator, void* mem)
+	// Allocator mutex must be locked
+	static void FreeSmallLocked(DefaultAllocator& allocator, void* mem)
 	{
 		DefaultAllocator::MemPage* page = GetMemPage(mem);
-		ScopedMutex lock(allocator.mutex);
-
 		if (page->header.firstFree + page->header.itemSize > sizeof(page->data))
 		{
 			ASSERT(!page->header.next);
@@ -117,6 +143,8 @@ namespace VulkanTest
 
 			U32 freeListIndex = GetFreeListIndex(page->header.itemSize);
 			page->header.next = allocator.freeList[freeListIndex];
+			if (page->header.next != nullptr)
+				page->header.next->header.prev = page;
 			allocator.freeList[freeListIndex] = page;
 		}
 
@@ -124,17 +152,141 @@ namespace VulkanTest
 		page->header.firstFree = U32((U8*)mem - page->data);
 	}
 
+	static void DrainThreadCacheLocked(DefaultAllocator::ThreadCache* cache)
+	{
+		for (auto& bin : cache->bins)
+		{
+			for (U32 i = 0; i < bin.count; i++)
+				FreeSmallLocked(*cache->allocator, bin.items[i]);
+			bin.count = 0;
+		}
+
+		// Unlink from the allocator
+		if (cache->prevShared != nullptr)
+			cache->prevShared->nextShared = cache->nextShared;
+		else
+			cache->allocator->threadCaches = cache->nextShared;
+		if (cache->nextShared != nullptr)
+			cache->nextShared->prevShared = cache->prevShared;
+		cache->allocator = nullptr;
+	}
+
+	struct ThreadCacheList
+	{
+		DefaultAllocator::ThreadCache* head = nullptr;
+		bool isDestroyed = false;
+
+		~ThreadCacheList()
+		{
+			// Return all cached items to the shared pages when the thread exits
+			while (head != nullptr)
+			{
+				DefaultAllocator::ThreadCache* cache = head;
+				head = cache->next;
+				if (cache->allocator != nullptr)
+				{
+					DefaultAllocator& allocator = *cache->allocator;
+					ScopedMutex lock(allocator.mutex);
+					DrainThreadCacheLocked(cache);
+				}
+				free(cache);
+			}
+			isDestroyed = true;
+		}
+	};
+	static thread_local ThreadCacheList gThreadCaches;
+
+	static DefaultAllocator::ThreadCache* GetThreadCache(DefaultAllocator& allocator)
+	{
+		ThreadCacheList& caches = gThreadCaches;
+		if (caches.isDestroyed)
+			return nullptr;
+
+		for (auto cache = caches.head; cache != nullptr; cache = cache->next)
+		{
+			if (cache->allocator == &allocator)
+				return cache;
+		}
+
+		// Use malloc to avoid recursing into the allocator
+		void* mem = malloc(sizeof(DefaultAllocator::ThreadCache));
+		if (mem == nullptr)
+			return nullptr;
+
+		DefaultAllocator::ThreadCache* cache = new (NewPlaceHolder(), mem) DefaultAllocator::ThreadCache();
+		cache->allocator = &allocator;
+		cache->next = caches.head;
+		caches.head = cache;
+
+		ScopedMutex lock(allocator.mutex);
+		cache->nextShared = allocator.threadCaches;
+		if (allocator.threadCaches != nullptr)
+			allocator.threadCaches->prevShared = cache;
+		allocator.threadCaches = cache;
+		return cache;
+	}
+
+	static void* AllocSmall(DefaultAllocator& allocator, size_t size)
+	{
+		U32 freeListIndex = GetFreeListIndex(size);
+		DefaultAllocator::ThreadCache* cache = GetThreadCache(allocator);
+		if (cache == nullptr)
+		{
+			ScopedMutex lock(allocator.mutex);
+			return AllocSmallLocked(allocator, freeListIndex);
+		}
+
+		auto& bin = cache->bins[freeListIndex];
+		if (bin.count == 0)
+		{
+			// Refill a batch from the shared pages
+			ScopedMutex lock(allocator.mutex);
+			for (U32 i = 0; i < THREAD_CACHE_BATCH; i++)
+			{
+				void* mem = AllocSmallLocked(allocator, freeListIndex);
+				if (mem == nullptr)
+					break;
+				bin.items[bin.count++] = mem;
+			}
+
+			if (bin.count == 0)
+				return nullptr;
+		}
+
+		return bin.items[--bin.count];
+	}
+
+	static void FreeSmall(DefaultAllocator& allocator, void* mem)
+	{
+		DefaultAllocator::ThreadCache* cache = GetThreadCache(allocator);
+		if (cache == nullptr)
+		{
+			ScopedMutex lock(allocator.mutex);
+			FreeSmallLocked(allocator, mem);
+			return;
+		}
+
+		auto& bin = cache->bins[GetFreeListIndex(GetMemPage(mem)->header.itemSize)];
+		if (bin.count == THREAD_CACHE_SIZE)
+		{
+			// Drain the oldest batch to the shared pages, keep the recently freed (hot) items
+			ScopedMutex lock(allocator.mutex);
+			for (U32 i = 0; i < THREAD_CACHE_BATCH; i++)
+				FreeSmallLocked(allocator, bin.items[i]);
+
+			bin.count -= THREAD_CACHE_BATCH;
+			memmove(bin.items, bin.items + THREAD_CACHE_BATCH, bin.count * sizeof(void*));
+		}
+
+		bin.items[bin.count++] = mem;
+	}
+
 	static void* ReallocSmall(DefaultAllocator& allocator, void* mem, size_t size)
 	{
 		// Check itemSize
 		DefaultAllocator::MemPage* page = GetMemPage(mem);
-		if (size <= SMALL_ALLOC_MAX_SIZE)
-		{
-			U32 i = GetFreeListIndex(size);
-			DefaultAllocator::MemPage* newPage = allocator.freeList[i];
-			if (newPage != nullptr && newPage->header.itemSize == page->header.itemSize)
-				return mem;
-		}
+		if (size <= SMALL_ALLOC_MAX_SIZE && GetFreeListIndex(size) == GetFreeListIndex(page->header.itemSize))
+			return mem;
 
 		void* newMem = size <= SMALL_ALLOC_MAX_SIZE ? AllocSmall(allocator, size) : malloc(size);
 		memcpy(newMem, mem, std::min((size_t)page->header.itemSize, size));
@@ -146,13 +298,11 @@ namespace VulkanTest
 	{
 		// Check itemSize
 		DefaultAllocator::MemPage* page = GetMemPage(mem);
-		if (size <= SMALL_ALLOC_MAX_SIZE)
-		{
-			U32 i = GetFreeListIndex(size);
-			if (allocator.freeList[i]->header.itemSize == page->header.itemSize)
-				return mem;
-		}
-		void* newMem = size <= SMALL_ALLOC_MAX_SIZE ? AllocSmall(allocator, size) : _aligned_malloc(size, align);
+		const bool isSmall = size <= SMALL_ALLOC_MAX_SIZE && align <= size;
+		if (isSmall && GetFreeListIndex(size) == GetFreeListIndex(page->header.itemSize))
+			return mem;
+
+		void* newMem = isSmall ? AllocSmall(allocator, size) : _aligned_malloc(size, align);
 		memcpy(newMem, mem, std::min((size_t)page->header.itemSize, size));
 		FreeSmall(allocator, mem);
 		return newMem;
@@ -173,6 +323,18 @@ namespace VulkanTest
 
 	DefaultAllocator::~DefaultAllocator()
 	{
+		{
+			// Detach the caches of other threads, cached items are released with the pages
+			ScopedMutex lock(mutex);
+			for (auto cache = threadCaches; cache != nullptr; cache = cache->nextShared)
+			{
+				for (auto& bin : cache->bins)
+					bin.count = 0;
+				cache->allocator = nullptr;
+			}
+			threadCaches = nullptr;
+		}
+
 		if (smallAllocation != nullptr)
 			Platform::MemRelease(smallAllocation, MAX_PAGE_COUNT * PAGE_SIZE);
 	}
@@ -182,11 +344,13 @@ namespace VulkanTest
 	{
 		void* ptr = size <= SMALL_ALLOC_MAX_SIZE ? AllocSmall(*this, size) : malloc(size);
 		MemoryTracker::Get().RecordAlloc(ptr, size, filename, line);
+		Profiler::RecordAlloc(size);
 		return ptr;
 	}
 
 	void* DefaultAllocator::Allocate(size_t size)
 	{
+		Profiler::RecordAlloc(size);
 		return size <= SMALL_ALLOC_MAX_SIZE ? AllocSmall(*this, size) : malloc(size);
 	}
 
@@ -200,6 +364,8 @@ namespace VulkanTest
 	void DefaultAllocator::Free(void* ptr)
 	{
 		MemoryTracker::Get().RecordFree(ptr);
+		if (ptr != nullptr)
+			Profiler::RecordFree();
 
 		if (IsSmallAlloc(*this, ptr))
 			FreeSmall(*this, ptr);
@@ -216,6 +382,7 @@ namespace VulkanTest
 			ptr = _aligned_malloc(size, align);
 
 		MemoryTracker::Get().RecordAlloc(ptr, size, filename, line);
+		Profiler::RecordAlloc(size);
 		return ptr;
 	}
 
@@ -233,6 +400,8 @@ namespace VulkanTest
 	void DefaultAllocator::FreeAligned(void* ptr)
 	{
 		MemoryTracker::Get().RecordFree(ptr);
+		if (ptr != nullptr)
+			Profiler::RecordFree();
 
 		if (IsSmallAlloc(*this, ptr))
 			FreeSmall(*this, ptr);
@@ -243,16 +412,20 @@ namespace VulkanTest
 #else
 	void* DefaultAllocator::Allocate(size_t size)
 	{
+		Profiler::RecordAlloc(size);
 		return size <= SMALL_ALLOC_MAX_SIZE ? AllocSmall(*this, size) : malloc(size);
 	}
 
 	void* DefaultAllocator::Reallocate(void* ptr, size_t newSize)
 	{
-		return IsSmallAlloc(*this, ptr) ? ReallocSmall(*this, ptr, newBytes) : realloc(ptr, newBytes);
+		return IsSmallAlloc(*this, ptr) ? ReallocSmall(*this, ptr, newSize) : realloc(ptr, newSize);
 	}
 
 	void DefaultAllocator::Free(void* ptr)
 	{
+		if (ptr != nullptr)
+			Profiler::RecordFree();
+
 		if (IsSmallAlloc(*this, ptr))
 			FreeSmall(*this, ptr);
 		else
@@ -266,16 +439,21 @@ namespace VulkanTest
 			ptr = AllocSmall(*this, size);
 		else
 			ptr = _aligned_malloc(size, align);
+
+		Profiler::RecordAlloc(size);
 		return ptr;
 	}
 
 	void* DefaultAllocator::ReallocateAligned(void* ptr, size_t newSize, size_t align)
 	{
-		return IsSmallAlloc(*this, ptr) ? ReallocSmallAligned(*this, ptr, newBytes, align) : _aligned_realloc(ptr, newBytes, align);
+		return IsSmallAlloc(*this, ptr) ? ReallocSmallAligned(*this, ptr, newSize, align) : _aligned_realloc(ptr, newSize, align);
 	}
 
 	void DefaultAllocator::FreeAligned(void* ptr)
 	{
+		if (ptr != nullptr)
+			Profiler::RecordFree();
+
 		if (IsSmallAlloc(*this, ptr))
 			FreeSmall(*this, ptr);
 		else
@@ -288,27 +466,121 @@ namespace VulkanTest
 		return std::numeric_limits<size_t>::max();
 	}
 
-	LinearAllocator::LinearAllocator()
+	static constexpr size_t LINEAR_COMMIT_SIZE = 64 * 1024;
+
+	LinearAllocator::LinearAllocator(size_t reserveSize_) :
+		reserveSize(AlignTo((U64)reserveSize_, (U64)LINEAR_COMMIT_SIZE))
 	{
+		base = (U8*)Platform::MemReserve(reserveSize);
+		ASSERT(base != nullptr);
 	}
 
 	LinearAllocator::~LinearAllocator()
 	{
+		if (base != nullptr)
+			Platform::MemRelease(base, reserveSize);
 	}
 
+	void LinearAllocator::Commit(size_t end)
+	{
+		ScopedMutex lock(commitMutex);
+		const size_t from = (size_t)AtomicRead(&committed);
+		if (end <= from)
+			return;
+
+		const size_t to = std::min((size_t)AlignTo((U64)end, (U64)LINEAR_COMMIT_SIZE), reserveSize);
+		Platform::MemCommit(base + from, to - from);
+		AtomicExchange(&committed, (I64)to);
+	}
+
+	void* LinearAllocator::AllocateAligned(size_t size, size_t align)
+	{
+		ASSERT(align > 0 && (align & (align - 1)) == 0);
+		size_t start;
+		size_t end;
+		while (true)
+		{
+			const I64 current = AtomicRead(&offset);
+			start = (size_t)AlignTo((U64)current, (U64)align);
+			end = start + size;
+			if (end > reserveSize)
+			{
+				ASSERT(false);
+				return nullptr;
+			}
+
+			if (AtomicCmpExchange(&offset, (I64)end, current) == current)
+				break;
+		}
+
+		if (end > (size_t)AtomicRead(&committed))
+			Commit(end);
+
+		return base + start;
+	}
+
+	bool LinearAllocator::IsOwned(const void* ptr)const
+	{
+		return ptr >= base && ptr < base + reserveSize;
+	}
+
+	void LinearAllocator::Reset()
+	{
+		AtomicExchange(&offset, 0);
+	}
+
+	size_t LinearAllocator::GetMarker()const
+	{
+		return (size_t)offset;
+	}
+
+	void LinearAllocator::Rollback(size_t marker)
+	{
+		ASSERT(marker <= (size_t)offset);
+		AtomicExchange(&offset, (I64)marker);
+	}
+
+	size_t LinearAllocator::GetUsedSize()const
+	{
+		return (size_t)offset;
+	}
+
+	size_t LinearAllocator::GetCommittedSize()const
+	{
+		return (size_t)committed;
+	}
+
+	size_t LinearAllocator::GetMaxAllocationSize()
+	{
+		return reserveSize;
+	}
+
+	// Sizes of allocations aren't stored, so only a null block can be reallocated.
+	// Use FrameAllocator::Reallocate which is given the old size.
+	static void* ReallocLinear(LinearAllocator& allocator, void* ptr, size_t newBytes, size_t align)
+	{
+		if (ptr != nullptr)
+		{
+			ASSERT(false);
+			return nullptr;
+		}
+		return allocator.AllocateAligned(newBytes, align);
+	}
+
+#ifdef VULKAN_MEMORY_TRACKER
 	void* LinearAllocator::Allocate(size_t size, const char* filename, int line)
 	{
-		return nullptr;
+		return AllocateAligned(size, 8);
 	}
 
 	void* LinearAllocator::Allocate(size_t size)
 	{
-		return nullptr;
+		return AllocateAligned(size, 8);
 	}
 
 	void* LinearAllocator::Reallocate(void* ptr, size_t newBytes, const char* filename, int line)
 	{
-		return nullptr;
+		return ReallocLinear(*this, ptr, newBytes, 8);
 	}
 
 	void LinearAllocator::Free(void* ptr)
@@ -317,15 +589,39 @@ namespace VulkanTest
 
 	void* LinearAllocator::AllocateAligned(size_t size, size_t align, const char* filename, int line)
 	{
-		return nullptr;
+		return AllocateAligned(size, align);
 	}
 
 	void* LinearAllocator::ReallocateAligned(void* ptr, size_t newBytes, size_t align, const char* filename, int line)
 	{
-		return nullptr;
+		return ReallocLinear(*this, ptr, newBytes, align);
+	}
+
+	void LinearAllocator::FreeAligned(void* ptr)
+	{
+	}
+#else
+	void* LinearAllocator::Allocate(size_t size)
+	{
+		return AllocateAligned(size, 8);
+	}
+
+	void* LinearAllocator::Reallocate(void* ptr, size_t newSize)
+	{
+		return ReallocLinear(*this, ptr, newSize, 8);
+	}
+
+	void LinearAllocator::Free(void* ptr)
+	{
+	}
+
+	void* LinearAllocator::ReallocateAligned(void* ptr, size_t newSize, size_t align)
+	{
+		return ReallocLinear(*this, ptr, newSize, align);
 	}
 
 	void LinearAllocator::FreeAligned(void* ptr)
 	{
 	}
+#endif
 }
\ No newline at end of file
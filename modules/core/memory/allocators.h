@@ -34,14 +34,22 @@ namespace VulkanTest
 		Mutex mutex;
 		U8* smallAllocation = nullptr;
 
+		// Size classes: 8 16 32 64 128 256 512
 		struct MemPage;
-		MemPage* freeList[4];
+		MemPage* freeList[7];
+
+		// Per-thread caches of small allocations, refilled and drained in batches
+		struct ThreadCache;
+		ThreadCache* threadCaches = nullptr;
 	};
 
-	class VULKAN_TEST_API LinearAllocator final : IAllocator
+	// Bump allocator backed by reserved virtual memory, pages are committed on demand.
+	// Allocate is thread-safe, Free does nothing and the memory is only reclaimed by Reset or Rollback.
+	// Reallocate doesn't support existing blocks, their sizes aren't stored.
+	class VULKAN_TEST_API LinearAllocator final : public IAllocator
 	{
 	public:
-		LinearAllocator();
+		explicit LinearAllocator(size_t reserveSize_ = 64 * 1024 * 1024);
 		~LinearAllocator();
 
 #ifdef VULKAN_MEMORY_TRACKER
@@ -50,6 +58,7 @@ namespace VulkanTest
 		void* Reallocate(void* ptr, size_t newBytes, const char* filename, int line)override;
 		void  Free(void* ptr)override;
 		void* AllocateAligned(size_t size, size_t align, const char* filename, int line)override;
+		void* AllocateAligned(size_t size, size_t align);
 		void* ReallocateAligned(void* ptr, size_t newBytes, size_t align, const char* filename, int line)override;
 		void  FreeAligned(void* ptr)override;
 #else
@@ -60,7 +69,27 @@ namespace VulkanTest
 		void* ReallocateAligned(void* ptr, size_t newSize, size_t align)override;
 		void  FreeAligned(void* ptr)override;
 #endif
+		size_t GetMaxAllocationSize()override;
+
+		bool IsOwned(const void* ptr)const;
+
+		// Release all allocations, committed pages are kept for reuse
+		void Reset();
+
+		// Rollback to a previous marker, not thread-safe with concurrent allocations
+		size_t GetMarker()const;
+		void Rollback(size_t marker);
+
+		size_t GetUsedSize()const;
+		size_t GetCommittedSize()const;
+
 	private:
+		void Commit(size_t end);
 
+		U8* base = nullptr;
+		size_t reserveSize = 0;
+		volatile I64 offset = 0;
+		volatile I64 committed = 0;
+		Mutex commitMutex;
 	};
 }
\ No newline at end of file
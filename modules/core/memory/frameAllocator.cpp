@@ -0,0 +1,133 @@
+#include "frameAllocator.h"
+#include "allocators.h"
+#include "core\platform\atomic.h"
+
+namespace VulkanTest
+{
+namespace FrameAllocator
+{
+	static constexpr size_t FRAME_ARENA_SIZE = 256 * 1024 * 1024;
+	static constexpr size_t CHUNK_SIZE = 64 * 1024;
+	static constexpr size_t MAX_CHUNK_ALLOCATION_SIZE = CHUNK_SIZE / 4;
+
+	struct ThreadChunk
+	{
+		U8* current = nullptr;
+		U8* end = nullptr;
+		U64 frameIndex = 0;
+	};
+
+	static LinearAllocator gArenas[2] = { LinearAllocator(FRAME_ARENA_SIZE), LinearAllocator(FRAME_ARENA_SIZE) };
+	static volatile I64 gFrameIndex = 0;
+	static thread_local ThreadChunk gThreadChunk;
+
+	static U8* AlignPtr(U8* ptr, size_t align)
+	{
+		return (U8*)(((UIntPtr)ptr + align - 1) & ~(UIntPtr)(align - 1));
+	}
+
+	// Get the chunk of current thread, a chunk of the previous frames is dropped
+	static ThreadChunk& GetThreadChunk(U64 frameIndex)
+	{
+		ThreadChunk& chunk = gThreadChunk;
+		if (chunk.frameIndex != frameIndex)
+		{
+			chunk.current = chunk.end = nullptr;
+			chunk.frameIndex = frameIndex;
+		}
+		return chunk;
+	}
+
+	void BeginFrame()
+	{
+		// Reset the arena used by the frame before last, then publish the new frame
+		const U64 frameIndex = (U64)AtomicRead(&gFrameIndex) + 1;
+		gArenas[frameIndex % 2].Reset();
+		AtomicExchange(&gFrameIndex, (I64)frameIndex);
+	}
+
+	U64 GetFrameIndex()
+	{
+		return (U64)AtomicRead(&gFrameIndex);
+	}
+
+	void* Allocate(size_t size, size_t align)
+	{
+		ASSERT(align > 0 && (align & (align - 1)) == 0);
+		const U64 frameIndex = (U64)AtomicRead(&gFrameIndex);
+		ThreadChunk& chunk = GetThreadChunk(frameIndex);
+
+		U8* ret = AlignPtr(chunk.current, align);
+		if (chunk.current != nullptr && ret + size <= chunk.end)
+		{
+			chunk.current = ret + size;
+			return ret;
+		}
+
+		LinearAllocator& arena = gArenas[frameIndex % 2];
+		if (size > MAX_CHUNK_ALLOCATION_SIZE)
+			return arena.AllocateAligned(size, align);
+
+		// Request a new chunk, the remaining space of the old chunk is dropped
+		U8* mem = (U8*)arena.AllocateAligned(CHUNK_SIZE, 64);
+		if (mem == nullptr)
+			return nullptr;
+
+		chunk.end = mem + CHUNK_SIZE;
+		ret = AlignPtr(mem, align);
+		chunk.current = ret + size;
+		return ret;
+	}
+
+	void* Reallocate(void* ptr, size_t oldSize, size_t newSize, size_t align)
+	{
+		if (ptr == nullptr)
+			return Allocate(newSize, align);
+
+		// Grow in place if it is the last allocation of current thread chunk
+		ThreadChunk& chunk = GetThreadChunk((U64)AtomicRead(&gFrameIndex));
+		U8* mem = (U8*)ptr;
+		if (mem + oldSize == chunk.current && mem + newSize <= chunk.end)
+		{
+			chunk.current = mem + newSize;
+			return ptr;
+		}
+
+		void* ret = Allocate(newSize, align);
+		if (ret != nullptr)
+			memcpy(ret, ptr, std::min(oldSize, newSize));
+		return ret;
+	}
+
+	size_t GetUsedSize()
+	{
+		return gArenas[0].GetUsedSize() + gArenas[1].GetUsedSize();
+	}
+
+	size_t GetCommittedSize()
+	{
+		return gArenas[0].GetCommittedSize() + gArenas[1].GetCommittedSize();
+	}
+
+	ScopedMarker::ScopedMarker()
+	{
+		ThreadChunk& threadChunk = GetThreadChunk((U64)AtomicRead(&gFrameIndex));
+		chunk = &threadChunk;
+		current = threadChunk.current;
+		end = threadChunk.end;
+		frameIndex = threadChunk.frameIndex;
+	}
+
+	ScopedMarker::~ScopedMarker()
+	{
+		// Jobs could be resumed on another thread, only rollback on the same thread and frame
+		ThreadChunk& threadChunk = gThreadChunk;
+		if (chunk != &threadChunk || threadChunk.frameIndex != frameIndex)
+			return;
+
+		// Chunks requested in the scope are dropped until the arena is reset
+		threadChunk.current = current;
+		threadChunk.end = end;
+	}
+}
+}
\ No newline at end of file
@@ -0,0 +1,68 @@
+#pragma once
+
+#include "core\common.h"
+#include "core\collections\array.h"
+
+namespace VulkanTest
+{
+	// Per-frame scratch memory.
+	// Two linear arenas are used alternately, memory allocated in frame N is valid until the end of frame N + 1.
+	// Each thread bump-allocates from its own chunk, so allocations never take a lock or touch the general heap.
+	namespace FrameAllocator
+	{
+		// Called at the beginning of each frame, resets the arena of the frame before last
+		VULKAN_TEST_API void BeginFrame();
+		VULKAN_TEST_API U64 GetFrameIndex();
+
+		VULKAN_TEST_API void* Allocate(size_t size, size_t align = 16);
+		VULKAN_TEST_API void* Reallocate(void* ptr, size_t oldSize, size_t newSize, size_t align = 16);
+
+		VULKAN_TEST_API size_t GetUsedSize();
+		VULKAN_TEST_API size_t GetCommittedSize();
+
+		// Rollback the allocations of the current thread made in the scope
+		class VULKAN_TEST_API ScopedMarker
+		{
+		public:
+			ScopedMarker();
+			~ScopedMarker();
+
+			ScopedMarker(const ScopedMarker&) = delete;
+			ScopedMarker& operator=(const ScopedMarker&) = delete;
+
+		private:
+			void* chunk;
+			U8* current;
+			U8* end;
+			U64 frameIndex;
+		};
+
+		template<typename T>
+		T* New(size_t count = 1)
+		{
+			static_assert(std::is_trivially_destructible_v<T>, "Frame memory is never destructed");
+			T* ret = static_cast<T*>(Allocate(sizeof(T) * count, alignof(T)));
+			for (size_t i = 0; i < count; i++)
+				new (NewPlaceHolder(), ret + i) T();
+			return ret;
+		}
+	}
+
+	// Storage of FrameArray
+	struct FrameArrayAllocator
+	{
+		static void* Allocate(size_t size, size_t align) {
+			return FrameAllocator::Allocate(size, align);
+		}
+
+		static void* Reallocate(void* ptr, size_t oldSize, size_t newSize, size_t align) {
+			return FrameAllocator::Reallocate(ptr, oldSize, newSize, align);
+		}
+
+		static void Free(void* ptr) {}
+	};
+
+	// Array for per-frame temporaries, its data is only valid until the end of the next frame
+	template<typename T>
+	using FrameArray = Array<T, FrameArrayAllocator>;
+}
\ No newline at end of file
@@ -1,79 +1,402 @@
 #include "memTracker.h"
 
 #ifdef VULKAN_MEMORY_TRACKER
+#include "memory.h"
 #include "core\platform\sync.h"
+#include "core\platform\atomic.h"
+#include "core\platform\timer.h"
 
 #include <fstream>
 #include <sstream>
 #include <iostream>
+#include <algorithm>
+#include <cstring>
 
 namespace VulkanTest
 {
-	Mutex mutex;
 	std::ofstream loggerFile;
 
-	MemoryTracker::MemoryTracker()
+	static const U32 SHARD_COUNT = 64;
+	static const U32 SHARD_INIT_CAPACITY = 1024;
+	static const U32 MAX_CALLSITES = 16 * 1024;
+	static const U32 THREAD_BUFFER_SIZE = 64;
+	static void* const TOMBSTONE = (void*)1;
+
+	struct Callsite
+	{
+		volatile I32 state = 0;	// 1 when published
+		const char* filename = nullptr;
+		int line = -1;
+		volatile I64 liveBytes = 0;
+		volatile I64 peakBytes = 0;
+		volatile I64 liveCount = 0;
+		volatile I64 allocCount = 0;
+	};
+
+	struct AllocEntry
+	{
+		void* ptr;
+		size_t size;
+		U32 callsite;
+	};
+
+	// Open-addressing table with linear probing, guarded by its own lock
+	struct alignas(64) Shard
+	{
+		SpinLock lock;
+		AllocEntry* entries = nullptr;
+		U32 capacity = 0;
+		U32 count = 0;
+		U32 tombstones = 0;
+	};
+
+	// Allocations of a thread not flushed into shards yet.
+	// The lock is only contended when another thread flushes all buffers.
+	struct ThreadBuffer
+	{
+		SpinLock lock;
+		AllocEntry entries[THREAD_BUFFER_SIZE];
+		U32 count = 0;
+		ThreadBuffer* prev = nullptr;
+		ThreadBuffer* next = nullptr;
+	};
+
+	struct ThreadBufferGuard
+	{
+		~ThreadBufferGuard();
+	};
+
+	// All the internal states use spin locks and the CRT heap, so they are valid during static initialization
+	static Shard gShards[SHARD_COUNT];
+	static Callsite gCallsites[MAX_CALLSITES];	// Index 0 is used when the callsites are exhausted
+	static SpinLock gCallsiteLock;
+	static SpinLock gThreadBuffersLock;
+	static ThreadBuffer* gThreadBuffers = nullptr;
+	static volatile I64 gMemUsage = 0;
+	static volatile I64 gMaxMemUsage = 0;
+
+	static thread_local ThreadBuffer* gThreadBuffer = nullptr;
+	static thread_local bool gThreadBufferReleased = false;
+	static thread_local ThreadBufferGuard gThreadBufferGuard;
+
+	// Errors are reported after all locks are released, the logger could allocate memory
+	static thread_local bool gHasDuplicateAlloc = false;
+	static thread_local AllocEntry gDuplicateAlloc;
+
+	static U64 HashPointer(const void* ptr)
 	{
+		U64 h = (U64)(UIntPtr)ptr;
+		h ^= h >> 33;
+		h *= 0xff51afd7ed558ccdull;
+		h ^= h >> 33;
+		return h;
 	}
 
-	void MemoryTracker::RecordAlloc(void* ptr, size_t size, const char* filename, int line)
+	static U32 GetCallsite(const char* filename, int line)
 	{
-		ScopedMutex lock(mutex);
-		if (size <= 0) {
+		// Callsites are keyed by the address of filename, they are merged by content in snapshots
+		const U32 MASK = MAX_CALLSITES - 1;
+		const U32 start = (U32)(HashPointer(filename) ^ ((U64)line * 0x9E3779B97F4A7C15ull));
+		for (U32 probe = 0; probe < MAX_CALLSITES; probe++)
+		{
+			const U32 index = (start + probe) & MASK;
+			if (index == 0)
+				continue;
+
+			Callsite& callsite = gCallsites[index];
+			if (AtomicRead(&callsite.state) == 0)
+				break;
+
+			if (callsite.filename == filename && callsite.line == line)
+				return index;
+		}
+
+		gCallsiteLock.Lock();
+		U32 ret = 0;
+		for (U32 probe = 0; probe < MAX_CALLSITES; probe++)
+		{
+			const U32 index = (start + probe) & MASK;
+			if (index == 0)
+				continue;
+
+			Callsite& callsite = gCallsites[index];
+			if (AtomicRead(&callsite.state) == 0)
+			{
+				callsite.filename = filename;
+				callsite.line = line;
+				AtomicStore(&callsite.state, 1);
+				ret = index;
+				break;
+			}
+
+			if (callsite.filename == filename && callsite.line == line)
+			{
+				ret = index;
+				break;
+			}
+		}
+		gCallsiteLock.Unlock();
+		return ret;
+	}
+
+	static AllocEntry* FindEntry(Shard& shard, void* ptr, U64 hash)
+	{
+		if (shard.capacity == 0)
+			return nullptr;
+
+		const U32 mask = shard.capacity - 1;
+		for (U32 index = (U32)(hash >> 6) & mask; shard.entries[index].ptr != nullptr; index = (index + 1) & mask)
+		{
+			if (shard.entries[index].ptr == ptr)
+				return &shard.entries[index];
+		}
+		return nullptr;
+	}
+
+	static void PlaceEntry(AllocEntry* entries, U32 capacity, const AllocEntry& entry, U64 hash)
+	{
+		const U32 mask = capacity - 1;
+		U32 index = (U32)(hash >> 6) & mask;
+		while (entries[index].ptr != nullptr && entries[index].ptr != TOMBSTONE)
+			index = (index + 1) & mask;
+		entries[index] = entry;
+	}
+
+	static void RehashShard(Shard& shard, U32 newCapacity)
+	{
+		AllocEntry* newEntries = (AllocEntry*)calloc(newCapacity, sizeof(AllocEntry));
+		for (U32 i = 0; i < shard.capacity; i++)
+		{
+			const AllocEntry& entry = shard.entries[i];
+			if (entry.ptr != nullptr && entry.ptr != TOMBSTONE)
+				PlaceEntry(newEntries, newCapacity, entry, HashPointer(entry.ptr));
+		}
+
+		free(shard.entries);
+		shard.entries = newEntries;
+		shard.capacity = newCapacity;
+		shard.tombstones = 0;
+	}
+
+	static void InsertAlloc(const AllocEntry& entry)
+	{
+		const U64 hash = HashPointer(entry.ptr);
+		Shard& shard = gShards[hash % SHARD_COUNT];
+		shard.lock.Lock();
+		if (FindEntry(shard, entry.ptr, hash) != nullptr)
+		{
+			shard.lock.Unlock();
+			gHasDuplicateAlloc = true;
+			gDuplicateAlloc = entry;
 			return;
 		}
 
-		if (mAllocNodeMap.find(ptr) != mAllocNodeMap.end())
+		// Keep the load factor under 3/4, tombstones are dropped by rehashing
+		if ((shard.count + shard.tombstones + 1) * 4 > shard.capacity * 3)
 		{
-			auto kvp = mAllocNodeMap.find(ptr);
-			AllocNode& allocNode = kvp->second;
-			std::stringstream os;
-			os << (allocNode.filename ? allocNode.filename : "(unknown)");
-			os << "(" << allocNode.line << ")";
-			os << ": alloc size:" << allocNode.size;
-			os << " address:" << (void*)ptr;
-			os << std::endl;
-			Logger::Info(os.str().c_str());
+			U32 newCapacity = std::max(shard.capacity, SHARD_INIT_CAPACITY);
+			if ((shard.count + 1) * 2 > newCapacity)
+				newCapacity *= 2;
+			RehashShard(shard, newCapacity);
+		}
+
+		PlaceEntry(shard.entries, shard.capacity, entry, hash);
+		shard.count++;
+		shard.lock.Unlock();
+
+		AtomicExchangeIfGreater(&gMaxMemUsage, AtomicAdd(&gMemUsage, (I64)entry.size));
+
+		Callsite& callsite = gCallsites[entry.callsite];
+		AtomicIncrement(&callsite.allocCount);
+		AtomicIncrement(&callsite.liveCount);
+		AtomicExchangeIfGreater(&callsite.peakBytes, AtomicAdd(&callsite.liveBytes, (I64)entry.size));
+	}
 
-			ASSERT_MSG(mAllocNodeMap.find(ptr) == mAllocNodeMap.end(), "The address is already allocated");
+	static bool RemoveAlloc(void* ptr)
+	{
+		const U64 hash = HashPointer(ptr);
+		Shard& shard = gShards[hash % SHARD_COUNT];
+		shard.lock.Lock();
+		AllocEntry* found = FindEntry(shard, ptr, hash);
+		if (found == nullptr)
+		{
+			shard.lock.Unlock();
+			return false;
 		}
 
+		const AllocEntry entry = *found;
+		found->ptr = TOMBSTONE;
+		shard.count--;
+		shard.tombstones++;
+		shard.lock.Unlock();
+
+		AtomicSub(&gMemUsage, (I64)entry.size);
 
-		mAllocNodeMap.insert(std::pair(ptr, AllocNode(size, filename, line)));
-		memUsage += size;
-		maxMemUsage = std::max(maxMemUsage, memUsage);
+		Callsite& callsite = gCallsites[entry.callsite];
+		AtomicDecrement(&callsite.liveCount);
+		AtomicSub(&callsite.liveBytes, (I64)entry.size);
+		return true;
 	}
 
-	void MemoryTracker::RecordRealloc(void* ptr, void* old, size_t size, const char* filename, int line)
+	// Must be called with the lock of buffer
+	static void FlushThreadBuffer(ThreadBuffer& buffer)
+	{
+		for (U32 i = 0; i < buffer.count; i++)
+			InsertAlloc(buffer.entries[i]);
+		buffer.count = 0;
+	}
+
+	static void FlushAllThreads()
+	{
+		gThreadBuffersLock.Lock();
+		for (ThreadBuffer* buffer = gThreadBuffers; buffer != nullptr; buffer = buffer->next)
+		{
+			buffer->lock.Lock();
+			FlushThreadBuffer(*buffer);
+			buffer->lock.Unlock();
+		}
+		gThreadBuffersLock.Unlock();
+	}
+
+	static ThreadBuffer* GetThreadBuffer()
+	{
+		if (gThreadBuffer != nullptr || gThreadBufferReleased)
+			return gThreadBuffer;
+
+		// Touch the guard to flush the buffer at thread exit
+		(void)&gThreadBufferGuard;
+
+		ThreadBuffer* buffer = new (NewPlaceHolder(), calloc(1, sizeof(ThreadBuffer))) ThreadBuffer();
+		gThreadBuffersLock.Lock();
+		buffer->next = gThreadBuffers;
+		if (gThreadBuffers != nullptr)
+			gThreadBuffers->prev = buffer;
+		gThreadBuffers = buffer;
+		gThreadBuffersLock.Unlock();
+
+		gThreadBuffer = buffer;
+		return buffer;
+	}
+
+	ThreadBufferGuard::~ThreadBufferGuard()
+	{
+		ThreadBuffer* buffer = gThreadBuffer;
+		gThreadBuffer = nullptr;
+		gThreadBufferReleased = true;
+		if (buffer == nullptr)
+			return;
+
+		gThreadBuffersLock.Lock();
+		if (buffer->prev != nullptr)
+			buffer->prev->next = buffer->next;
+		else
+			gThreadBuffers = buffer->next;
+		if (buffer->next != nullptr)
+			buffer->next->prev = buffer->prev;
+
+		buffer->lock.Lock();
+		FlushThreadBuffer(*buffer);
+		buffer->lock.Unlock();
+		gThreadBuffersLock.Unlock();
+
+		buffer->~ThreadBuffer();
+		free(buffer);
+	}
+
+	static void ReportErrors()
+	{
+		if (!gHasDuplicateAlloc)
+			return;
+
+		gHasDuplicateAlloc = false;
+		const AllocEntry entry = gDuplicateAlloc;
+		const Callsite& callsite = gCallsites[entry.callsite];
+		std::stringstream os;
+		os << (callsite.filename ? callsite.filename : "(unknown)");
+		os << "(" << callsite.line << ")";
+		os << ": alloc size:" << entry.size;
+		os << " address:" << entry.ptr;
+		os << std::endl;
+		Logger::Info(os.str().c_str());
+
+		ASSERT_MSG(false, "The address is already allocated");
+	}
+
+	static bool FreeAlloc(void* ptr)
 	{
-		ScopedMutex lock(mutex);
-		if (ptr != old)
+		// Short-lived allocations are cancelled in the staging buffer
+		ThreadBuffer* buffer = GetThreadBuffer();
+		if (buffer != nullptr)
 		{
-			auto it = mAllocNodeMap.find(old);
-			if (it != mAllocNodeMap.end())
+			buffer->lock.Lock();
+			for (I32 i = (I32)buffer->count - 1; i >= 0; i--)
 			{
-				memUsage -= it->second.size;
-				mAllocNodeMap.erase(it);
+				if (buffer->entries[i].ptr == ptr)
+				{
+					AtomicIncrement(&gCallsites[buffer->entries[i].callsite].allocCount);
+					buffer->entries[i] = buffer->entries[--buffer->count];
+					buffer->lock.Unlock();
+					return true;
+				}
 			}
+			buffer->lock.Unlock();
+		}
+
+		if (RemoveAlloc(ptr))
+			return true;
+
+		// The allocation could be staged by another thread
+		FlushAllThreads();
+		ReportErrors();
+		return RemoveAlloc(ptr);
+	}
+
+	static int CompareCallsite(const char* lhsFile, int lhsLine, const char* rhsFile, int rhsLine)
+	{
+		const int ret = strcmp(lhsFile ? lhsFile : "", rhsFile ? rhsFile : "");
+		if (ret != 0)
+			return ret;
+		return lhsLine - rhsLine;
+	}
+
+	MemoryTracker::MemoryTracker()
+	{
+	}
+
+	MemoryTracker::~MemoryTracker()
+	{
+		ReportMemoryLeak();
+	}
+
+	void MemoryTracker::RecordAlloc(void* ptr, size_t size, const char* filename, int line)
+	{
+		if (ptr == nullptr || size <= 0) {
+			return;
 		}
 
-		auto it = mAllocNodeMap.find(ptr);
-		if (it == mAllocNodeMap.end())
+		const AllocEntry entry = { ptr, size, GetCallsite(filename, line) };
+		ThreadBuffer* buffer = GetThreadBuffer();
+		if (buffer == nullptr)
 		{
-			mAllocNodeMap.insert(std::pair(ptr, AllocNode(size, filename, line)));
-			memUsage += size;
-			maxMemUsage = std::max(maxMemUsage, memUsage);
+			InsertAlloc(entry);
 		}
 		else
 		{
-			size_t oldSize = it->second.size;
-			it->second.size = size;
-			it->second.filename = filename;
-			it->second.line = line;
-
-			memUsage += size - oldSize;
-			maxMemUsage = std::max(maxMemUsage, memUsage);
+			buffer->lock.Lock();
+			if (buffer->count == THREAD_BUFFER_SIZE)
+				FlushThreadBuffer(*buffer);
+			buffer->entries[buffer->count++] = entry;
+			buffer->lock.Unlock();
 		}
+		ReportErrors();
+	}
+
+	void MemoryTracker::RecordRealloc(void* ptr, void* old, size_t size, const char* filename, int line)
+	{
+		if (old != nullptr)
+			FreeAlloc(old);
+
+		RecordAlloc(ptr, size, filename, line);
 	}
 
 	void MemoryTracker::RecordFree(void* ptr)
@@ -82,44 +405,192 @@ namespace VulkanTest
 			return;
 		}
 
-		ScopedMutex lock(mutex);
-		auto it = mAllocNodeMap.find(ptr);
-		if (it == mAllocNodeMap.end())
-		{
+		if (!FreeAlloc(ptr))
 			Logger::Error("The address is already free");
+	}
+
+	uint64_t MemoryTracker::GetMemUsage()
+	{
+		return (uint64_t)AtomicRead(&gMemUsage);
+	}
+
+	uint64_t MemoryTracker::GetMaxMemUsage()
+	{
+		return (uint64_t)AtomicRead(&gMaxMemUsage);
+	}
+
+	void MemoryTracker::TakeSnapshot(Snapshot& snapshot)
+	{
+		FlushAllThreads();
+		ReportErrors();
+
+		snapshot.timestamp = Timer::GetRawTimestamp();
+		snapshot.memUsage = AtomicRead(&gMemUsage);
+		snapshot.callsites.clear();
+		for (U32 i = 0; i < MAX_CALLSITES; i++)
+		{
+			Callsite& callsite = gCallsites[i];
+			const I64 allocCount = AtomicRead(&callsite.allocCount);
+			if (allocCount == 0)
+				continue;
+
+			CallsiteStats& stats = snapshot.callsites.emplace_back();
+			stats.filename = callsite.filename;
+			stats.line = callsite.line;
+			stats.liveBytes = AtomicRead(&callsite.liveBytes);
+			stats.peakBytes = AtomicRead(&callsite.peakBytes);
+			stats.liveCount = AtomicRead(&callsite.liveCount);
+			stats.allocCount = allocCount;
 		}
-		else
+
+		// Merge the callsites with the same file and line from different translation units
+		auto& callsites = snapshot.callsites;
+		std::sort(callsites.begin(), callsites.end(), [](const CallsiteStats& lhs, const CallsiteStats& rhs) {
+			return CompareCallsite(lhs.filename, lhs.line, rhs.filename, rhs.line) < 0;
+		});
+
+		size_t count = 0;
+		for (size_t i = 0; i < callsites.size(); i++)
 		{
-			memUsage -= it->second.size;
-			mAllocNodeMap.erase(it);
+			if (count > 0 && CompareCallsite(callsites[count - 1].filename, callsites[count - 1].line, callsites[i].filename, callsites[i].line) == 0)
+			{
+				CallsiteStats& stats = callsites[count - 1];
+				stats.liveBytes += callsites[i].liveBytes;
+				stats.peakBytes += callsites[i].peakBytes;
+				stats.liveCount += callsites[i].liveCount;
+				stats.allocCount += callsites[i].allocCount;
+			}
+			else
+			{
+				callsites[count++] = callsites[i];
+			}
+		}
+		callsites.resize(count);
+	}
+
+	void MemoryTracker::DiffSnapshots(const Snapshot& from, const Snapshot& to, std::vector<CallsiteDiff>& diffs)
+	{
+		diffs.clear();
+
+		// Callsites of snapshots are sorted by file and line
+		auto AddDiff = [&diffs](const CallsiteStats* lhs, const CallsiteStats* rhs) {
+			const CallsiteStats& callsite = rhs != nullptr ? *rhs : *lhs;
+			CallsiteDiff diff;
+			diff.filename = callsite.filename;
+			diff.line = callsite.line;
+			diff.liveBytes = (rhs ? rhs->liveBytes : 0) - (lhs ? lhs->liveBytes : 0);
+			diff.liveCount = (rhs ? rhs->liveCount : 0) - (lhs ? lhs->liveCount : 0);
+			diff.allocCount = (rhs ? rhs->allocCount : 0) - (lhs ? lhs->allocCount : 0);
+			if (diff.liveBytes != 0 || diff.liveCount != 0 || diff.allocCount != 0)
+				diffs.push_back(diff);
+		};
+
+		size_t i = 0, j = 0;
+		while (i < from.callsites.size() || j < to.callsites.size())
+		{
+			const CallsiteStats* lhs = i < from.callsites.size() ? &from.callsites[i] : nullptr;
+			const CallsiteStats* rhs = j < to.callsites.size() ? &to.callsites[j] : nullptr;
+			const int cmp = lhs == nullptr ? 1 : rhs == nullptr ? -1 : CompareCallsite(lhs->filename, lhs->line, rhs->filename, rhs->line);
+			if (cmp == 0)
+			{
+				AddDiff(lhs, rhs);
+				i++;
+				j++;
+			}
+			else if (cmp < 0)
+			{
+				AddDiff(lhs, nullptr);
+				i++;
+			}
+			else
+			{
+				AddDiff(nullptr, rhs);
+				j++;
+			}
+		}
+
+		// Largest growth first
+		std::sort(diffs.begin(), diffs.end(), [](const CallsiteDiff& lhs, const CallsiteDiff& rhs) {
+			return lhs.liveBytes > rhs.liveBytes;
+		});
+	}
+
+	bool MemoryTracker::ReportSnapshotDiff(const Snapshot& from, const Snapshot& to, U32 maxCount)
+	{
+		std::vector<CallsiteDiff> diffs;
+		DiffSnapshots(from, to, diffs);
+		if (diffs.empty() || diffs[0].liveBytes <= 0)
+			return false;
+
+		std::stringstream os;
+		os << std::endl;
+		os << "[Memory] Memory usage changed:" << (to.memUsage - from.memUsage);
+		os << " (" << from.memUsage << " -> " << to.memUsage << ")" << std::endl;
+		for (size_t i = 0; i < diffs.size() && i < maxCount; i++)
+		{
+			// Diffs are sorted by growth
+			const CallsiteDiff& diff = diffs[i];
+			if (diff.liveBytes <= 0)
+				break;
+
+			os << (diff.filename ? diff.filename : "(unknown)");
+			os << "(" << diff.line << ")";
+			os << ": live size:" << diff.liveBytes;
+			os << " live count:" << diff.liveCount;
+			os << " alloc count:" << diff.allocCount;
+			os << std::endl;
 		}
+		Logger::Info(os.str().c_str());
+		return true;
+	}
+
+	void MemoryTracker::Update()
+	{
+		if (snapshotInterval <= 0.0f)
+			return;
+
+		const U64 now = Timer::GetRawTimestamp();
+		if (lastSnapshotTime != 0 && (F64)(now - lastSnapshotTime) < snapshotInterval * (F64)Timer::GetFrequency())
+			return;
+
+		lastSnapshotTime = now;
+		if (snapshots.size() >= MAX_SNAPSHOTS)
+			snapshots.erase(snapshots.begin());
+		TakeSnapshot(snapshots.emplace_back());
+
+		// Report the growth since the previous snapshot
+		if (snapshots.size() >= 2)
+			ReportSnapshotDiff(snapshots[snapshots.size() - 2], snapshots.back(), SNAPSHOT_REPORT_COUNT);
 	}
 
 	void MemoryTracker::ReportMemoryLeak()
 	{
-		if (mAllocNodeMap.empty()) {
+		Snapshot snapshot;
+		TakeSnapshot(snapshot);
+		if (snapshot.memUsage == 0) {
 			return;
 		}
 
+		std::sort(snapshot.callsites.begin(), snapshot.callsites.end(), [](const CallsiteStats& lhs, const CallsiteStats& rhs) {
+			return lhs.liveBytes > rhs.liveBytes;
+		});
+
 		std::stringstream os;
 		os << std::endl;
 		os << "[Memory] Detected memory leaks !!! " << std::endl;
-		os << "[Memory] Leaked memory usage:" << memUsage << std::endl;
+		os << "[Memory] Leaked memory usage:" << snapshot.memUsage << std::endl;
 		os << "[Memory] Dumping allocations:" << std::endl;
 
-		for (auto kvp : mAllocNodeMap)
+		for (const auto& callsite : snapshot.callsites)
 		{
-			AllocNode& allocNode = kvp.second;
-			os << (allocNode.filename ? allocNode.filename : "(unknown)");
-			os << "(" << allocNode.line << ")";
-			os << ": alloc size:" << allocNode.size;
-			os << " address:" << (void*)kvp.first;
-			os << std::endl;
+			if (callsite.liveCount <= 0)
+				continue;
 
-			if (allocNode.size == 96)
-			{
-				int a = 0;
-			}
+			os << (callsite.filename ? callsite.filename : "(unknown)");
+			os << "(" << callsite.line << ")";
+			os << ": alloc size:" << callsite.liveBytes;
+			os << " count:" << callsite.liveCount;
+			os << std::endl;
 		}
 
 		std::cout << os.str().c_str() << std::endl;
@@ -130,7 +601,7 @@ namespace VulkanTest
 			if (!loggerFile.is_open()) {
 				loggerFile.open(memoryLeaksFileName);
 			}
-			
+
 			loggerFile << os.str();
 			loggerFile.close();
 		}
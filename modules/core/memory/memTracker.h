@@ -3,46 +3,75 @@
 #include "allocator.h"
 
 #ifdef VULKAN_MEMORY_TRACKER
-#include <unordered_map>
+#include <vector>
 
 namespace VulkanTest
 {
+	// Tracks the live allocations of the instrumented build.
+	// Allocations are staged in a small buffer of the allocating thread, short-lived allocations
+	// are cancelled there without touching shared state. The staged allocations are flushed into
+	// a sharded open-addressing table keyed by address, each shard has its own spin lock.
+	// Statistics are aggregated per callsite (file:line).
 	class MemoryTracker
 	{
 	public:
-		~MemoryTracker() {
-			ReportMemoryLeak();
-		}
+		struct CallsiteStats
+		{
+			const char* filename = nullptr;
+			int line = -1;
+			I64 liveBytes = 0;
+			I64 peakBytes = 0;
+			I64 liveCount = 0;
+			I64 allocCount = 0;
+		};
+
+		struct Snapshot
+		{
+			U64 timestamp = 0;
+			I64 memUsage = 0;
+			std::vector<CallsiteStats> callsites;
+		};
+
+		struct CallsiteDiff
+		{
+			const char* filename = nullptr;
+			int line = -1;
+			I64 liveBytes = 0;
+			I64 liveCount = 0;
+			I64 allocCount = 0;
+		};
+
+		~MemoryTracker();
 
 		void RecordAlloc(void* ptr, size_t size, const char* filename, int line);
 		void RecordRealloc(void* ptr, void* old, size_t size, const char* filename, int line);
 		void RecordFree(void* ptr);
 		void ReportMemoryLeak();
 
-		uint64_t GetMemUsage() { return memUsage; }
-		uint64_t GetMaxMemUsage() { return maxMemUsage; }
+		// Periodic snapshots, Update is called once per frame.
+		// Each snapshot is diffed against the previous one and the top growing callsites are reported.
+		void Update();
+		void SetSnapshotInterval(F32 seconds) { snapshotInterval = seconds; }
+		const std::vector<Snapshot>& GetSnapshots()const { return snapshots; }
+
+		void TakeSnapshot(Snapshot& snapshot);
+		static void DiffSnapshots(const Snapshot& from, const Snapshot& to, std::vector<CallsiteDiff>& diffs);
+		// Report the callsites which grow the most, return false if nothing grows
+		static bool ReportSnapshotDiff(const Snapshot& from, const Snapshot& to, U32 maxCount = 32);
+
+		uint64_t GetMemUsage();
+		uint64_t GetMaxMemUsage();
 
 		static MemoryTracker& Get();
 
 	private:
 		MemoryTracker();
 
-		struct AllocNode
-		{
-			size_t size = 0;
-			const char* filename;
-			int line = -1;
-
-			AllocNode(size_t size_, const char* filename_, int line_) :
-				size(size_),
-				filename(filename_),
-				line(line_)
-			{}
-		};
-		std::unordered_map<void*, AllocNode> mAllocNodeMap;
-
-		volatile uint64_t memUsage = 0;
-		volatile uint64_t maxMemUsage = 0;
+		static const U32 MAX_SNAPSHOTS = 8;
+		static const U32 SNAPSHOT_REPORT_COUNT = 16;
+		std::vector<Snapshot> snapshots;
+		F32 snapshotInterval = 10.0f;
+		U64 lastSnapshotTime = 0;
 		char* memoryLeaksFileName = nullptr;
 	};
 }
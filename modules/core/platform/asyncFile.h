@@ -0,0 +1,45 @@
+#pragma once
+
+#include "core\common.h"
+
+namespace VulkanTest
+{
+	// Overlapped read of a file, it must be kept alive until it is completed
+	struct AsyncReadOp
+	{
+		// Platform data (OVERLAPPED on Win32), must be the first member
+		alignas(8) U8 platformData[32];
+		void* buffer = nullptr;
+		U64 offset = 0;
+		U32 size = 0;
+		U32 readed = 0;
+		bool success = false;
+	};
+
+	// Completion queue of overlapped file reads, many reads can be in flight at the same time
+	class VULKAN_TEST_API AsyncIOQueue
+	{
+	public:
+		AsyncIOQueue();
+		~AsyncIOQueue();
+
+		bool IsValid()const;
+
+		// Open a file for overlapped reading and attach it to the queue, return nullptr if failed
+		void* OpenFile(const char* path);
+		static void CloseFile(void* file);
+
+		// Start the read, the completion is returned by WaitCompletion
+		bool Read(void* file, AsyncReadOp& op);
+
+		// Block until any read is completed, return nullptr if it is woken up by Wakeup
+		AsyncReadOp* WaitCompletion();
+		void Wakeup();
+
+	private:
+		AsyncIOQueue(const AsyncIOQueue&) = delete;
+		AsyncIOQueue& operator=(const AsyncIOQueue&) = delete;
+
+		void* port = nullptr;
+	};
+}
\ No newline at end of file
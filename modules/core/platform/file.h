@@ -13,9 +13,9 @@ namespace VulkanTest
 		READ = 1 << 0,
 		WRITE = 1 << 1,
 		CREATE = 1 << 2,
-		MMAP = 1 << 3,
+		MMAP = 1 << 3,		// Map the whole file as copy-on-write memory, only for reading
 
-		DEFAULT_READ = READ | MMAP,
+		DEFAULT_READ = READ,
 		DEFAULT_WRITE = WRITE | CREATE,
 	};
 
@@ -56,6 +56,9 @@ namespace VulkanTest
 		virtual bool IsValid() const = 0;
 		virtual void  Close() = 0;
 
+		// Memory of the whole file if it is mapped
+		virtual const void* GetMappedData() const { return nullptr; }
+
 		bool WriteString(const char* str)
 		{
 			return Write(str, StringLength(str));
@@ -166,6 +169,10 @@ namespace VulkanTest
 		void Close()override
 		{
 		}
+
+		const void* GetMappedData() const override {
+			return data;
+		}
 	};
 
 	class FilePathResolver;
@@ -186,9 +193,13 @@ namespace VulkanTest
 		FileFlags GetFlags() const override;
 		bool IsValid() const override;
 		void  Close() override;
+		const void* GetMappedData() const override;
 
 	private:
 		void* handle;
+		void* mappingHandle = nullptr;
+		U8* mappedData = nullptr;
+		size_t mappedPos = 0;
 		size_t size = 0;
 		FileFlags flags = FileFlags::NONE;
 		volatile int mappedCount = 0;
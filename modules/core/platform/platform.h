@@ -75,6 +75,8 @@ namespace Platform {
 	{
 		U64 usedPhysicalMemory;
 		U64 usedVirtualMemory;
+		// Peak working set of the process lifetime
+		U64 peakPhysicalMemory;
 	};
 
 	void Initialize();
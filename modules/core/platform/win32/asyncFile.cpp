@@ -0,0 +1,96 @@
+#include "core\platform\asyncFile.h"
+#include "core\platform\platform.h"
+
+namespace VulkanTest
+{
+#ifdef CJING3D_PLATFORM_WIN32
+
+	static_assert(sizeof(AsyncReadOp::platformData) >= sizeof(OVERLAPPED), "Platform data is too small for OVERLAPPED");
+
+	AsyncIOQueue::AsyncIOQueue()
+	{
+		// Only the IO thread waits for completions
+		port = ::CreateIoCompletionPort(INVALID_HANDLE_VALUE, nullptr, 0, 1);
+		if (port == nullptr)
+			Logger::Warning("Failed to create io completion port, error:%x", ::GetLastError());
+	}
+
+	AsyncIOQueue::~AsyncIOQueue()
+	{
+		if (port != nullptr)
+			::CloseHandle((HANDLE)port);
+	}
+
+	bool AsyncIOQueue::IsValid() const
+	{
+		return port != nullptr;
+	}
+
+	void* AsyncIOQueue::OpenFile(const char* path)
+	{
+		ASSERT(port != nullptr);
+		HANDLE handle = ::CreateFileA(
+			path,
+			GENERIC_READ,
+			FILE_SHARE_READ,
+			nullptr,
+			OPEN_EXISTING,
+			FILE_ATTRIBUTE_NORMAL | FILE_FLAG_OVERLAPPED,
+			nullptr);
+		if (handle == INVALID_HANDLE_VALUE)
+		{
+			Logger::Warning("Failed to open file for async reading:\"%s\", error:%x", path, ::GetLastError());
+			return nullptr;
+		}
+
+		if (::CreateIoCompletionPort(handle, (HANDLE)port, 0, 0) == nullptr)
+		{
+			Logger::Warning("Failed to attach file to io completion port:\"%s\", error:%x", path, ::GetLastError());
+			::CloseHandle(handle);
+			return nullptr;
+		}
+		return handle;
+	}
+
+	void AsyncIOQueue::CloseFile(void* file)
+	{
+		if (file != nullptr)
+			::CloseHandle((HANDLE)file);
+	}
+
+	bool AsyncIOQueue::Read(void* file, AsyncReadOp& op)
+	{
+		OVERLAPPED* overlapped = (OVERLAPPED*)op.platformData;
+		memset(overlapped, 0, sizeof(OVERLAPPED));
+		overlapped->Offset = (DWORD)(op.offset & 0xffffffffu);
+		overlapped->OffsetHigh = (DWORD)(op.offset >> 32u);
+
+		// The completion is posted to the port even if the read is finished synchronously
+		if (::ReadFile((HANDLE)file, op.buffer, (DWORD)op.size, nullptr, overlapped))
+			return true;
+
+		return ::GetLastError() == ERROR_IO_PENDING;
+	}
+
+	AsyncReadOp* AsyncIOQueue::WaitCompletion()
+	{
+		DWORD bytes = 0;
+		ULONG_PTR key = 0;
+		OVERLAPPED* overlapped = nullptr;
+		BOOL ret = ::GetQueuedCompletionStatus((HANDLE)port, &bytes, &key, &overlapped, INFINITE);
+		if (overlapped == nullptr)
+			return nullptr;
+
+		AsyncReadOp* op = reinterpret_cast<AsyncReadOp*>(overlapped);
+		op->readed = (U32)bytes;
+		op->success = ret && bytes == op->size;
+		return op;
+	}
+
+	void AsyncIOQueue::Wakeup()
+	{
+		::PostQueuedCompletionStatus((HANDLE)port, 0, 0, nullptr);
+	}
+
+#endif
+}
\ No newline at end of file
@@ -92,6 +92,9 @@ namespace VulkanTest
 	{
 		if (!crashReportingEnabled) return EXCEPTION_CONTINUE_SEARCH;
 
+		// Dispatch the pending log records before the dump, they may explain the crash
+		Logger::Flush();
+
 		HANDLE process = GetCurrentProcess();
 		SymInitialize(process, nullptr, TRUE);
 		struct CrashInfo
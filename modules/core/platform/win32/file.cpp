@@ -5,7 +5,8 @@ namespace VulkanTest
 {
 #ifdef CJING3D_PLATFORM_WIN32
 
-	MappedFile::MappedFile(const char* path, FileFlags flags)
+	MappedFile::MappedFile(const char* path, FileFlags flags_) :
+		flags(flags_)
 	{
 		DWORD desiredAccess = 0;
 		DWORD shareMode = 0;
@@ -40,6 +41,25 @@ namespace VulkanTest
 			//DWORD sizeL = ::GetFileSize(handle, &sizeL);
 			//size = (size_t)(sizeH) << 32ull | sizeL;
 			size = ::GetFileSize((HANDLE)handle, 0);
+
+			// Map the whole file, pages written by users are copied instead of being written back
+			const bool canMap = FLAG_ANY(flags, FileFlags::MMAP) && FLAG_ANY(flags, FileFlags::READ) && !FLAG_ANY(flags, FileFlags::WRITE);
+			if (canMap && size > 0)
+			{
+				mappingHandle = ::CreateFileMappingA((HANDLE)handle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+				if (mappingHandle != nullptr)
+					mappedData = (U8*)::MapViewOfFile((HANDLE)mappingHandle, FILE_MAP_COPY, 0, 0, 0);
+
+				if (mappedData == nullptr)
+				{
+					Logger::Warning("Failed to map file:\"%s\", error:%x", path, ::GetLastError());
+					if (mappingHandle != nullptr)
+					{
+						::CloseHandle((HANDLE)mappingHandle);
+						mappingHandle = nullptr;
+					}
+				}
+			}
 		}
 	}
 
@@ -50,6 +70,15 @@ namespace VulkanTest
 
 	bool MappedFile::Read(void* buffer, size_t bytes)
 	{
+		if (mappedData != nullptr)
+		{
+			if (mappedPos + bytes > size)
+				return false;
+			memcpy(buffer, mappedData + mappedPos, bytes);
+			mappedPos += bytes;
+			return true;
+		}
+
 		U8* readBuffer = static_cast<U8*>(buffer);
 		DWORD readed = 0;
 		BOOL success = ::ReadFile(handle, readBuffer, (DWORD)bytes, (LPDWORD)&readed, nullptr);
@@ -58,6 +87,14 @@ namespace VulkanTest
 
 	bool MappedFile::Read(void* buffer, size_t bytes, size_t& readed)
 	{
+		if (mappedData != nullptr)
+		{
+			readed = std::min(size - mappedPos, bytes);
+			memcpy(buffer, mappedData + mappedPos, readed);
+			mappedPos += readed;
+			return true;
+		}
+
 		U8* readBuffer = static_cast<U8*>(buffer);
 		BOOL success = ::ReadFile(handle, readBuffer, (DWORD)bytes, (LPDWORD)&readed, nullptr);
 		return success;
@@ -80,6 +117,14 @@ namespace VulkanTest
 
 	bool MappedFile::Seek(size_t offset)
 	{
+		if (mappedData != nullptr)
+		{
+			if (offset > size)
+				return false;
+			mappedPos = offset;
+			return true;
+		}
+
 		const LONG offsetHi = offset >> 32u;
 		const LONG offsetLo = offset & 0xffffffffu;
 		LONG offsetHiOut = offsetHi;
@@ -88,6 +133,9 @@ namespace VulkanTest
 
 	size_t MappedFile::Tell() const 
 	{
+		if (mappedData != nullptr)
+			return mappedPos;
+
 		LONG offsetHi = 0;
 		DWORD offsetLo = ::SetFilePointer(handle, 0, &offsetHi, FILE_CURRENT);
 		return (size_t)offsetHi << 32ull | offsetLo;
@@ -105,8 +153,24 @@ namespace VulkanTest
 		return handle != INVALID_HANDLE_VALUE;
 	}
 
+	const void* MappedFile::GetMappedData() const
+	{
+		return mappedData;
+	}
+
 	void MappedFile::Close()
 	{
+		if (mappedData != nullptr)
+		{
+			::UnmapViewOfFile(mappedData);
+			mappedData = nullptr;
+		}
+		if (mappingHandle != nullptr)
+		{
+			::CloseHandle((HANDLE)mappingHandle);
+			mappingHandle = nullptr;
+		}
+
 		if (handle != INVALID_HANDLE_VALUE)
 		{
 			::FlushFileBuffers(handle);
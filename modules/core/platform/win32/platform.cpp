@@ -935,6 +935,7 @@ namespace Platform {
 		ProcessMemoryStats ret;
 		ret.usedPhysicalMemory = countersEx.WorkingSetSize;
 		ret.usedVirtualMemory = countersEx.PrivateUsage;
+		ret.peakPhysicalMemory = countersEx.PeakWorkingSetSize;
 		return ret;
 	}
 
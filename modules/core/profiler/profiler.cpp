@@ -2,6 +2,12 @@
 #include "renderStats.h"
 #include "platform\timer.h"
 #include "core\memory\memory.h"
+#include "core\filesystem\filesystem.h"
+#include "core\utils\log.h"
+#include "core\memory\memTracker.h"
+
+#include <algorithm>
+#include <unordered_map>
 
 namespace VulkanTest
 {
@@ -11,140 +17,274 @@ volatile I32 RenderStats::enabled;
 
 namespace Profiler
 {
-	BlockBuffer::BlockBuffer()
+	EventBuffer::EventBuffer()
 	{
-		capacity = 8192;
-		mask = capacity - 1;
-		data = static_cast<Block*>(malloc(sizeof(Block) * capacity));
+		data = static_cast<Event*>(malloc(sizeof(Event) * CAPACITY));
 		ASSERT(data != nullptr);
-		memset(data, 0, sizeof(sizeof(Block) * capacity));
-		head = 0;
-		count = 0;
 	}
 	
-	BlockBuffer::~BlockBuffer()
+	EventBuffer::~EventBuffer()
 	{
 		free(data);
 	}
 
-	void BlockBuffer::GetBlocks(std::vector<Block>& blocks)
+	U64 EventBuffer::Read(U64 from, std::vector<Event>& events, U64& droppedCount)const
 	{
-		blocks.clear();
-
-		if (count == 0)
-			return;
+		// The writer may be ahead of the published head by less than PUBLISH_INTERVAL events
+		const U64 end = GetHead();
+		if (from >= end)
+			return end;
 
-		// Find first block
-		Iterator firstEvent = Begin();
-		for (auto i = firstEvent; i.IsNotEnd(); ++i)
+		const U64 safeCapacity = CAPACITY - PUBLISH_INTERVAL;
+		if (end - from > safeCapacity)
 		{
-			if (i.Block().depth == 0)
-			{
-				firstEvent = i;
-				break;
-			}
+			droppedCount += end - safeCapacity - from;
+			from = end - safeCapacity;
 		}
 
-		if (firstEvent.IsEnd())
-			return;
+		// [ ----------from ----------]
+		//                 |leftCount|
+		const size_t offset = events.size();
+		const U32 count = U32(end - from);
+		const U32 tail = U32(from & MASK);
+		const U32 spaceLeftCount = std::min(CAPACITY - tail, count);
+		events.resize(offset + count);
+		memcpy(events.data() + offset, &data[tail], spaceLeftCount * sizeof(Event));
+		if (count > spaceLeftCount)
+			memcpy(events.data() + offset + spaceLeftCount, &data[0], (count - spaceLeftCount) * sizeof(Event));
+
+		// Discard the events overwritten by the writer while copying, including the unpublished ones
+		std::atomic_thread_fence(std::memory_order_acquire);
+		const U64 writeEnd = head.load(std::memory_order_relaxed) + PUBLISH_INTERVAL;
+		if (writeEnd > from + CAPACITY)
+		{
+			const size_t overwritten = (size_t)std::min((U64)count, writeEnd - CAPACITY - from);
+			events.erase(events.begin() + offset, events.begin() + offset + overwritten);
+			droppedCount += overwritten;
+		}
+		return end;
+	}
 
-		// Find the last item (last event in ended root event)
-		Iterator lastEndedRoot = End();
-		for (auto i = Last(); i != firstEvent; --i)
+	U32 EventBuffer::GetOpenBlocks(const char** blocks, U32 maxCount)const
+	{
+		// Walk back from the last event, skipping the blocks which are ended
+		U32 count = 0;
+		U32 endedCount = 0;
+		const U64 limit = writeIndex > CAPACITY ? writeIndex - CAPACITY : 0;
+		for (U64 index = writeIndex; index > limit && count < maxCount; index--)
 		{
-			if (i.Block().depth == 0 && i.Block().endTime != 0)
+			const Event& ent = data[(index - 1) & MASK];
+			switch (ent.type)
 			{
-				lastEndedRoot = i;
+			case EventType::END_BLOCK:
+			case EventType::END_FIBER_WAIT:
+				endedCount++;
+				break;
+			case EventType::BEGIN_BLOCK:
+			case EventType::BEGIN_FIBER_WAIT:
+				if (endedCount > 0)
+					endedCount--;
+				else
+					blocks[count++] = ent.name;
+				break;
+			default:
 				break;
 			}
 		}
 
-		if (lastEndedRoot.IsEnd())
-			return;
+		std::reverse(blocks, blocks + count);
+		return count;
+	}
 
-		// Find the last non-root event in last root event
-		Iterator lastEvent = lastEndedRoot;
-		const double lastRootEventEndTime = lastEndedRoot.Block().endTime;
-		for (auto i = --End(); i != lastEndedRoot; --i)
+	struct TicksCalibration
+	{
+		U64 baseTicks;
+		U64 baseTimestamp;
+		F64 baseSeconds;
+		std::atomic<U64> frequency{ 0 };
+
+		TicksCalibration()
 		{
-			if (i.Block().endTime != 0 && i.Block().endTime <= lastRootEventEndTime)
-			{
-				lastEvent = i;
-				break;
-			}
+			baseTicks = GetTicks();
+			baseTimestamp = Timer::GetRawTimestamp();
+			baseSeconds = Timer::GetTimeSeconds();
 		}
+	};
+	static TicksCalibration gCalibration;
 
-		// Remove all the events between [Begin(), lastEvent]
-		count -= (lastEvent.Index() - Begin().Index()) & mask;
-	
-		const I32 head = (lastEvent.Index() + 1) & mask;
-		count = (lastEvent.Index() - firstEvent.Index() + 1) & mask;
-		blocks.resize(count);
+	U64 GetTicksFrequency()
+	{
+#ifdef PROFILER_USE_TSC
+		U64 frequency = gCalibration.frequency.load(std::memory_order_acquire);
+		if (frequency != 0)
+			return frequency;
+
+		// Compare the TSC with the system timer over at least 10 ms
+		const U64 timerFrequency = Timer::GetFrequency();
+		U64 ticks;
+		U64 timestamp;
+		do
+		{
+			ticks = GetTicks();
+			timestamp = Timer::GetRawTimestamp();
+		} 
+		while (timestamp - gCalibration.baseTimestamp < timerFrequency / 100);
+
+		frequency = (U64)((F64)(ticks - gCalibration.baseTicks) * (F64)timerFrequency / (F64)(timestamp - gCalibration.baseTimestamp));
+		U64 expected = 0;
+		if (!gCalibration.frequency.compare_exchange_strong(expected, frequency))
+			frequency = expected;
+		return frequency;
+#else
+		return Timer::GetFrequency();
+#endif
+	}
 
-		I32 tail = (head - count) & mask;
-		I32 spaceLeft = capacity - tail;
-		I32 spaceLeftCount = std::min(spaceLeft, count);
-		I32 overflow = count - spaceLeft;
+	F64 TicksToSeconds(U64 ticks)
+	{
+		// Relative to Timer::GetTimeSeconds
+		return gCalibration.baseSeconds + ((F64)ticks - (F64)gCalibration.baseTicks) / (F64)GetTicksFrequency();
+	}
 
+	void Thread::GetBlocks(std::vector<Block>& blocks)
+	{
+		blocks.clear();
 
-		// [ ----------tail ----------]
-		//                 |leftCount|
-		memcpy(blocks.data(), &data[tail], spaceLeftCount * sizeof(Block));
-		if (overflow > 0)
+		U64 droppedCount = 0;
+		std::vector<Event> frameEvents;
+		events.Read(frameStart.load(std::memory_order_relaxed), frameEvents, droppedCount);
+
+		I32 stack[MAX_DEPTH];
+		I32 stackSize = 0;
+		for (const auto& ent : frameEvents)
 		{
-			// [ ----------tail ----------]
-			//  |Overflow|
-			memcpy(blocks.data() + spaceLeftCount, &data[0], overflow * sizeof(Block));
+			switch (ent.type)
+			{
+			case EventType::BEGIN_BLOCK:
+			case EventType::BEGIN_FIBER_WAIT:
+			{
+				Block& block = blocks.emplace_back();
+				block.name = ent.name;
+				block.id = (I32)blocks.size() - 1;
+				block.type = ent.type == EventType::BEGIN_BLOCK ? BlockType::CPU_BLOCK : BlockType::FIBER;
+				block.startTime = TicksToSeconds(ent.time);
+				block.endTime = 0;
+				block.depth = stackSize;
+				if (stackSize < MAX_DEPTH)
+					stack[stackSize] = block.id;
+				stackSize++;
+			}
+			break;
+			case EventType::END_BLOCK:
+			case EventType::END_FIBER_WAIT:
+				// The block may begin before current frame
+				if (stackSize > 0)
+				{
+					stackSize--;
+					if (stackSize < MAX_DEPTH)
+						blocks[stack[stackSize]].endTime = TicksToSeconds(ent.time);
+				}
+				break;
+			default:
+				break;
+			}
 		}
 	}
 
-	Block* Thread::BeginBlock()
+	void Thread::GetCounters(std::vector<Counter>& counters)
 	{
-		const F64 time = Timer::GetTimeSeconds();
-		const I32 index = entBuffer.Add();
-		Block* block = entBuffer.Get(index);
-		memset(block, 0, sizeof(Block));
-		block->id = index;
-		block->startTime = time;
-		block->endTime = 0;
-		block->depth = depth++;
-		return block;
+		counters.clear();
+
+		U64 droppedCount = 0;
+		std::vector<Event> frameEvents;
+		events.Read(frameStart.load(std::memory_order_relaxed), frameEvents, droppedCount);
+		for (const auto& ent : frameEvents)
+		{
+			if (ent.type != EventType::COUNTER)
+				continue;
+
+			Counter& counter = counters.emplace_back();
+			counter.name = ent.name;
+			counter.type = ent.counterType;
+			counter.time = TicksToSeconds(ent.time);
+			counter.value = ent.value;
+		}
 	}
 
-	void Thread::EndBlock(I32 index)
+	// Binary capture format:
+	// | CaptureHeader | Record | Record | ... |
+	// Record: | CaptureRecordType (U8) | payload |
+	//   THREAD:  U32 threadIndex, U64 threadID, U8 nameLength, char name[nameLength]
+	//   NAME:    U32 nameID, U16 nameLength, char name[nameLength]
+	//   EVENTS:  U32 threadIndex, U32 count, CaptureEvent events[count]
+	//            A COUNTER event is followed by U8 counterType, CounterValue value
+	//   DROPPED: U32 threadIndex, U64 count
+	// Name ID 0 is reserved for events without name.
+	static const U32 CAPTURE_MAGIC = 0x46525043; // 'CPRF'
+	static const U32 CAPTURE_VERSION = 2;
+
+	struct CaptureHeader
 	{
-		const F64 time = Timer::GetTimeSeconds();
-		Block* block = entBuffer.Get(index);
-		block->endTime = time;
-		depth--;
-	}
+		U32 magic;
+		U32 version;
+		U64 ticksFrequency;
+		U64 baseTicks;
+	};
 
-	Block* Thread::BeginFiberWait()
+	enum class CaptureRecordType : U8
 	{
-		const F64 time = Timer::GetTimeSeconds();
-		const I32 index = entBuffer.Add();
-		Block* block = entBuffer.Get(index);
-		memset(block, 0, sizeof(Block));
-		block->id = index;
-		block->startTime = time;
-		block->endTime = 0;
-		block->depth = depth - 1;
-		return block;
-	}
+		THREAD,
+		NAME,
+		EVENTS,
+		DROPPED,
+	};
 
-	void Thread::EndFiberWait(I32 index)
+#pragma pack(push, 1)
+	struct CaptureEvent
 	{
-		const F64 time = Timer::GetTimeSeconds();
-		Block* block = entBuffer.Get(index);
-		block->endTime = time;
-	}
+		U64 time;
+		U32 nameID;
+		EventType type;
+	};
+#pragma pack(pop)
 
-	void Thread::GetBlocks(std::vector<Block>& blocks)
+	struct ProfilerImpl;
+
+	// Background thread to stream events into the capture file
+	class CaptureWriter final : public VulkanTest::Thread
 	{
-		return entBuffer.GetBlocks(blocks);
-	}
+	public:
+		CaptureWriter(ProfilerImpl& impl_, UniquePtr<File>&& file_);
+
+		int Task() override;
+		void Flush();
+
+		volatile I32 isRunning = 1;
+
+	private:
+		struct ThreadState
+		{
+			U64 readIndex = 0;
+			StaticString<64> name;
+		};
+
+		void WriteThread(U32 threadIndex, Profiler::Thread& thread);
+		U32 GetNameID(const char* name);
+
+		template<typename T>
+		void Write(const T& value)
+		{
+			const U8* bytes = (const U8*)&value;
+			buffer.insert(buffer.end(), bytes, bytes + sizeof(T));
+		}
 
-	thread_local Thread* CurrentThread = nullptr;
+		ProfilerImpl& impl;
+		UniquePtr<File> file;
+		std::vector<ThreadState> threadStates;
+		std::unordered_map<const char*, U32> nameIDs;
+		std::vector<Event> events;
+		std::vector<U8> buffer;
+	};
 
 	struct ProfilerImpl
 	{
@@ -153,49 +293,222 @@ namespace Profiler
 		DefaultAllocator allocator;
 		bool enabled = false;
 
+		Mutex captureMutex;
+		CaptureWriter* captureWriter = nullptr;
+
+		// Totals of thread statistics at the beginning of last frame
+		I64 lastAllocations = 0;
+		I64 lastAllocatedBytes = 0;
+		I64 lastFrees = 0;
+		I64 lastFiberSwitches = 0;
+
 		ProfilerImpl()
 		{
 		}
 
 		~ProfilerImpl()
 		{
+			StopCapture();
+
 			for (auto thread : contexts)
 				thread->~Thread();
 			contexts.clear();
 		}
 
-		Thread* GetThreadLocalContext()
+		Thread* CreateThreadContext()
 		{
-			thread_local Thread* ctx = [&]() 
-			{
-				void* mem = allocator.Allocate(sizeof(Thread));
-				Thread* newCtx = new(mem) Thread();
-				newCtx->threadID = Platform::GetCurrentThreadID();
-				ScopedMutex lock(mutex);
-				contexts.push_back(newCtx);
-				return newCtx;
-			}();
-			return ctx;
+			void* mem = allocator.Allocate(sizeof(Thread));
+			Thread* newCtx = new(mem) Thread();
+			newCtx->threadID = Platform::GetCurrentThreadID();
+			ScopedMutex lock(mutex);
+			newCtx->threadIndex = (U32)contexts.size();
+			contexts.push_back(newCtx);
+			return newCtx;
 		}
 	};
 	ProfilerImpl gImpl;
 
+	static thread_local Thread* gCurrentThread = nullptr;
+
+	// Only written by the owner thread, so relaxed load/store is enough
+	static FORCE_INLINE void IncreaseStat(std::atomic<I64>& stat, I64 value)
+	{
+		stat.store(stat.load(std::memory_order_relaxed) + value, std::memory_order_relaxed);
+	}
+
+	static Thread* GetThreadLocalContext()
+	{
+		Thread* thread = gCurrentThread;
+		if (thread == nullptr)
+		{
+			thread = gImpl.CreateThreadContext();
+			gCurrentThread = thread;
+		}
+		return thread;
+	}
+
+	CaptureWriter::CaptureWriter(ProfilerImpl& impl_, UniquePtr<File>&& file_) :
+		impl(impl_),
+		file(std::move(file_))
+	{
+		// Start from the current events of existing threads
+		ScopedMutex lock(impl.mutex);
+		threadStates.resize(impl.contexts.size());
+		for (U32 i = 0; i < (U32)impl.contexts.size(); i++)
+			threadStates[i].readIndex = impl.contexts[i]->events.GetHead();
+	}
+
+	int CaptureWriter::Task()
+	{
+		while (AtomicRead(&isRunning) != 0)
+		{
+			Flush();
+			Platform::Sleep(0.01f);
+		}
+
+		Flush();
+		return 0;
+	}
+
+	U32 CaptureWriter::GetNameID(const char* name)
+	{
+		if (name == nullptr)
+			return 0;
+
+		auto it = nameIDs.find(name);
+		if (it != nameIDs.end())
+			return it->second;
+
+		const U32 nameID = (U32)nameIDs.size() + 1;
+		nameIDs.insert(std::make_pair(name, nameID));
+
+		const U16 length = (U16)std::min(StringLength(name), 0xffff);
+		Write(CaptureRecordType::NAME);
+		Write(nameID);
+		Write(length);
+		buffer.insert(buffer.end(), (const U8*)name, (const U8*)name + length);
+		return nameID;
+	}
+
+	void CaptureWriter::WriteThread(U32 threadIndex, Profiler::Thread& thread)
+	{
+		ThreadState& state = threadStates[threadIndex];
+		if (state.name != thread.name.c_str())
+		{
+			state.name = thread.name.c_str();
+			const U8 length = (U8)StringLength(state.name.c_str());
+			Write(CaptureRecordType::THREAD);
+			Write(threadIndex);
+			Write((U64)thread.threadID);
+			Write(length);
+			buffer.insert(buffer.end(), (const U8*)state.name.c_str(), (const U8*)state.name.c_str() + length);
+		}
+
+		events.clear();
+		U64 droppedCount = 0;
+		state.readIndex = thread.events.Read(state.readIndex, events, droppedCount);
+		if (droppedCount > 0)
+		{
+			Write(CaptureRecordType::DROPPED);
+			Write(threadIndex);
+			Write(droppedCount);
+		}
+
+		if (events.empty())
+			return;
+
+		// Write names before events
+		for (const auto& ent : events)
+			GetNameID(ent.name);
+
+		Write(CaptureRecordType::EVENTS);
+		Write(threadIndex);
+		Write((U32)events.size());
+		for (const auto& ent : events)
+		{
+			CaptureEvent captureEvent;
+			captureEvent.time = ent.time;
+			captureEvent.nameID = GetNameID(ent.name);
+			captureEvent.type = ent.type;
+			Write(captureEvent);
+
+			if (ent.type == EventType::COUNTER)
+			{
+				Write(ent.counterType);
+				Write(ent.value);
+			}
+		}
+	}
+
+	void CaptureWriter::Flush()
+	{
+		std::vector<Thread*> threads;
+		{
+			ScopedMutex lock(impl.mutex);
+			threads = impl.contexts;
+		}
+
+		// Threads created after the capture started are captured from their first event
+		if (threadStates.size() < threads.size())
+			threadStates.resize(threads.size());
+
+		buffer.clear();
+		for (U32 i = 0; i < (U32)threads.size(); i++)
+			WriteThread(i, *threads[i]);
+
+		if (!buffer.empty())
+			file->Write(buffer.data(), buffer.size());
+	}
+
 	void SetThreadName(const char* name)
 	{
-		Thread* ctx = gImpl.GetThreadLocalContext();
+		Thread* ctx = GetThreadLocalContext();
 		ctx->name = name;
 	}
 
 	void BeginFrame()
 	{
-		for (auto thread : gImpl.contexts)
-			thread->entBuffer.Clear();
+		I64 allocations = 0;
+		I64 allocatedBytes = 0;
+		I64 frees = 0;
+		I64 fiberSwitches = 0;
+		{
+			ScopedMutex lock(gImpl.mutex);
+			for (auto thread : gImpl.contexts)
+			{
+				thread->frameStart.store(thread->events.GetHead(), std::memory_order_relaxed);
+				allocations += thread->stats.allocations.load(std::memory_order_relaxed);
+				allocatedBytes += thread->stats.allocatedBytes.load(std::memory_order_relaxed);
+				frees += thread->stats.frees.load(std::memory_order_relaxed);
+				fiberSwitches += thread->stats.fiberSwitches.load(std::memory_order_relaxed);
+			}
+		}
+
+		if (!gImpl.enabled)
+			return;
+
+		Thread* thread = GetThreadLocalContext();
+		thread->events.Push(GetTicks(), nullptr, EventType::FRAME);
+		thread->events.Publish();
+
+		// Statistics of the last frame
+		RecordCounter("Allocations", allocations - gImpl.lastAllocations);
+		RecordCounter("AllocatedMemory", allocatedBytes - gImpl.lastAllocatedBytes, CounterType::BYTES);
+		RecordCounter("Frees", frees - gImpl.lastFrees);
+		RecordCounter("FiberSwitches", fiberSwitches - gImpl.lastFiberSwitches);
+#ifdef VULKAN_MEMORY_TRACKER
+		RecordCounter("TrackedMemory", (I64)MemoryTracker::Get().GetMemUsage(), CounterType::BYTES);
+#endif
+		gImpl.lastAllocations = allocations;
+		gImpl.lastAllocatedBytes = allocatedBytes;
+		gImpl.lastFrees = frees;
+		gImpl.lastFiberSwitches = fiberSwitches;
 	}
 
 	void EndFrame()
 	{
 		for (auto thread : gImpl.contexts)
-			ASSERT(thread->blockStack.size() < 256);
+			ASSERT(thread->depth < (I32)Thread::MAX_DEPTH);
 	}
 
 	void BeginBlock(const char* name)
@@ -203,25 +516,25 @@ namespace Profiler
 		if (!gImpl.enabled)
 			return;
 
-		Thread* thread = gImpl.GetThreadLocalContext();
-		Block* block = thread->BeginBlock();
-		block->name = name;
-		block->type = BlockType::CPU_BLOCK;
-
-		thread->blockStack.push_back(block->id);
-		CurrentThread = thread;
+		Thread* thread = GetThreadLocalContext();
+		thread->events.Push(GetTicks(), name, EventType::BEGIN_BLOCK);
+		thread->depth++;
 	}
 
 	void EndBlock()
 	{
+		Thread* thread = gCurrentThread;
 		if (!gImpl.enabled ||
-			CurrentThread == nullptr || 
-			CurrentThread->blockStack.empty())
+			thread == nullptr || 
+			thread->depth <= 0)
 			return;
 
-		I32 index = CurrentThread->blockStack.back();
-		CurrentThread->blockStack.pop_back();
-		CurrentThread->EndBlock(index);
+		thread->depth--;
+		thread->events.Push(GetTicks(), nullptr, EventType::END_BLOCK);
+
+		// Publish when the outermost block is ended, so that readers get complete blocks without waiting
+		if (thread->depth == 0)
+			thread->events.Publish();
 	}
 
 	FiberSwitchData BeginFiberWait()
@@ -229,64 +542,48 @@ namespace Profiler
 		if (!gImpl.enabled)
 			return FiberSwitchData();
 
-		Thread* thread = gImpl.GetThreadLocalContext();
-		Block* block = thread->BeginFiberWait();
-		block->name = "WaitJob";
-		block->type = BlockType::FIBER;
-
+		Thread* thread = GetThreadLocalContext();
 		FiberSwitchData switchData;
-		switchData.id = block->id;
-		switchData.count = (U32)thread->blockStack.size();
+		switchData.startTime = GetTicks();
 		switchData.thread = thread;
-		ASSERT(switchData.count < (U32)ARRAYSIZE(switchData.blocks));
-		memcpy(switchData.blocks, thread->blockStack.data(), std::min(switchData.count, (U32)ARRAYSIZE(switchData.blocks)) * sizeof(I32));
-		
-		CurrentThread = thread;
+		ASSERT(thread->depth < (I32)ARRAYSIZE(switchData.blocks));
+		const U32 maxCount = (U32)std::clamp(thread->depth, 0, (I32)ARRAYSIZE(switchData.blocks));
+		switchData.count = thread->events.GetOpenBlocks(switchData.blocks, maxCount);
 		return switchData;
 	}
 
-	void ContinueBlock(I32 index, Thread* prevThread)
-	{
-		ASSERT(CurrentThread != nullptr);
-		ASSERT(prevThread != nullptr);
-
-		Block* prevBlock = prevThread->entBuffer.Get(index);
-		ASSERT(prevBlock != nullptr);
-
-		Block* continueBlock = CurrentThread->BeginBlock();
-		continueBlock->type = prevBlock->type;
-		continueBlock->name = prevBlock->name;
-		CurrentThread->blockStack.push_back(continueBlock->id);
-	}
-
 	void EndFiberWait(const FiberSwitchData& switchData)
 	{
 		// Notice:
 		// If the job waiting before dose not set the target worker
-		// there will be a rand worker to continue the job, the thread will be changed
+		// there will be a rand worker to continue the job, the thread will be changed.
+		// The wait block is recorded by the thread which continues the job.
 
-		if (!gImpl.enabled || switchData.thread == nullptr || CurrentThread == nullptr)
+		if (!gImpl.enabled || switchData.thread == nullptr)
 			return;
 
-		switchData.thread->EndFiberWait(switchData.id);
+		Thread* thread = GetThreadLocalContext();
+		thread->events.Push(switchData.startTime, "WaitJob", EventType::BEGIN_FIBER_WAIT);
+		thread->events.Push(GetTicks(), nullptr, EventType::END_FIBER_WAIT);
+		thread->events.Publish();
 
+		// Continue the blocks ended before switching
 		for (U32 i = 0; i < switchData.count; i++)
-		{
-			if (i < ARRAYSIZE(switchData.blocks))
-				ContinueBlock(switchData.blocks[i], switchData.thread);
-			else
-				ContinueBlock(-1, switchData.thread);
-		}
+			BeginBlock(switchData.blocks[i]);
 	}
 
 	void BeforeFiberSwitch()
 	{
-		Thread* thread = gImpl.GetThreadLocalContext();
-		while (!thread->blockStack.empty())
+		Thread* thread = GetThreadLocalContext();
+		if (gImpl.enabled)
+			IncreaseStat(thread->stats.fiberSwitches, 1);
+
+		while (thread->depth > 0)
 		{
-			thread->EndBlock(thread->blockStack.back());
-			thread->blockStack.pop_back();
+			thread->depth--;
+			thread->events.Push(GetTicks(), nullptr, EventType::END_BLOCK);
 		}
+		thread->events.Publish();
 	}
 
 	void Enable(bool enabled)
@@ -303,7 +600,96 @@ namespace Profiler
 	{
 		return gImpl.contexts;
 	}
-}
-}
 
+	void RecordCounter(const char* name, I64 value, CounterType type)
+	{
+		if (!gImpl.enabled)
+			return;
+
+		CounterValue counterValue;
+		counterValue.intValue = value;
+		GetThreadLocalContext()->events.PushCounter(GetTicks(), name, type, counterValue);
+	}
+
+	void RecordFloatCounter(const char* name, F64 value)
+	{
+		if (!gImpl.enabled)
+			return;
+
+		CounterValue counterValue;
+		counterValue.floatValue = value;
+		GetThreadLocalContext()->events.PushCounter(GetTicks(), name, CounterType::FLOAT, counterValue);
+	}
+
+	void RecordAlloc(size_t size)
+	{
+		// Don't create the thread context here, it is allocated by the allocator
+		Thread* thread = gCurrentThread;
+		if (!gImpl.enabled || thread == nullptr)
+			return;
+
+		IncreaseStat(thread->stats.allocations, 1);
+		IncreaseStat(thread->stats.allocatedBytes, (I64)size);
+	}
+
+	void RecordFree()
+	{
+		Thread* thread = gCurrentThread;
+		if (!gImpl.enabled || thread == nullptr)
+			return;
 
+		IncreaseStat(thread->stats.frees, 1);
+	}
+
+	bool StartCapture(const char* path)
+	{
+		ScopedMutex lock(gImpl.captureMutex);
+		if (gImpl.captureWriter != nullptr)
+			return false;
+
+		auto file = FileSystem::OpenFile(path, FileFlags::DEFAULT_WRITE);
+		if (!file || !file->IsValid())
+		{
+			Logger::Error("Failed to create profiler capture %s", path);
+			return false;
+		}
+
+		CaptureHeader header;
+		header.magic = CAPTURE_MAGIC;
+		header.version = CAPTURE_VERSION;
+		header.ticksFrequency = GetTicksFrequency();
+		header.baseTicks = GetTicks();
+		file->Write(header);
+
+		CaptureWriter* writer = CJING_NEW(CaptureWriter)(gImpl, std::move(file));
+		if (!writer->Create("ProfilerCapture"))
+		{
+			CJING_SAFE_DELETE(writer);
+			return false;
+		}
+
+		gImpl.captureWriter = writer;
+		return true;
+	}
+
+	void StopCapture()
+	{
+		ScopedMutex lock(gImpl.captureMutex);
+		CaptureWriter* writer = gImpl.captureWriter;
+		if (writer == nullptr)
+			return;
+
+		AtomicExchange(&writer->isRunning, 0);
+		writer->Join();
+		writer->Destroy();
+		CJING_SAFE_DELETE(writer);
+		gImpl.captureWriter = nullptr;
+	}
+
+	bool IsCapturing()
+	{
+		ScopedMutex lock(gImpl.captureMutex);
+		return gImpl.captureWriter != nullptr;
+	}
+}
+}
\ No newline at end of file
@@ -4,8 +4,20 @@
 #include "core\platform\platform.h"
 #include "core\platform\sync.h"
 #include "core\platform\atomic.h"
+#include "core\platform\timer.h"
 #include "core\utils\string.h"
 
+#include <atomic>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define PROFILER_USE_TSC
+#ifdef _WIN32
+#include <intrin.h>
+#else
+#include <x86intrin.h>
+#endif
+#endif
+
 namespace VulkanTest
 {
 namespace Profiler
@@ -27,160 +39,154 @@ namespace Profiler
 		I32 depth;
 	};
 
-	// Simple events ring-buffer
-	struct BlockBuffer
+	enum class EventType : U8
 	{
-	private:
-		Profiler::Block* data;
-		I32 capacity;
-		I32 mask;
-		I32 head;
-		I32 count;
+		BEGIN_BLOCK,
+		END_BLOCK,
+		BEGIN_FIBER_WAIT,
+		END_FIBER_WAIT,
+		FRAME,
+		COUNTER,
+		COUNT
+	};
 
-	public:
-		BlockBuffer();
-		~BlockBuffer();
+	enum class CounterType : U8
+	{
+		INT,
+		FLOAT,
+		BYTES,
+	};
 
-		Profiler::Block* Get(I32 index)const
-		{
-			ASSERT(index >= 0 && index < capacity);
-			return &data[index];
-		}
+	union CounterValue
+	{
+		I64 intValue;
+		F64 floatValue;
+	};
 
-		void Clear()
-		{
-			head = 0;
-			count = 0;
-		}
+	struct Event
+	{
+		U64 time;			// Raw ticks, see GetTicksFrequency
+		const char* name;
+		CounterValue value;	// Only for COUNTER
+		EventType type;
+		CounterType counterType;
+	};
 
-		I32 Add()
-		{
-			const I32 index = head;
-			head = (head + 1) & mask;
-			count = std::min(count + 1, capacity);
-			return index;
-		}
+	struct Counter
+	{
+		const char* name;
+		CounterType type;
+		F64 time;
+		CounterValue value;
+	};
 
-		I32 Count()const {
-			return count;
-		}
+	// Lock-free single-producer ring-buffer of events.
+	// The owner thread writes events, readers copy them out and discard the overwritten ones.
+	// Events are published in batches, so the writer does not store the shared head for every event.
+	struct EventBuffer
+	{
+	public:
+		static const U32 CAPACITY = 64 * 1024;
+		static const U32 MASK = CAPACITY - 1;
+		// The head is published at least every PUBLISH_INTERVAL events
+		static const U32 PUBLISH_INTERVAL = 64;
 
-		void GetBlocks(std::vector<Block>& blocks);
+		EventBuffer();
+		~EventBuffer();
 
-	public:
-		struct Iterator
+		FORCE_INLINE void Push(U64 time, const char* name, EventType type)
 		{
-			friend BlockBuffer;
-
-		private:
-			BlockBuffer* buffer;
-			I32 index;
-
-			Iterator(BlockBuffer* buffer_, const I32 index_)
-				: buffer(buffer_)
-				, index(index_)
-			{
-			}
-
-			Iterator(const Iterator& i) = default;
-
-		public:
-			FORCE_INLINE I32 Index() const
-			{
-				return index;
-			}
-
-			FORCE_INLINE Block& Block() const
-			{
-				return *buffer->Get(index);
-			}
-
-			bool IsEnd() const
-			{
-				return index == buffer->head;
-			}
-
-			bool IsNotEnd() const
-			{
-				return index != buffer->head;
-			}
-
-			FORCE_INLINE bool operator==(const Iterator& v) const
-			{
-				return buffer == v.buffer && index == v.index;
-			}
-
-			FORCE_INLINE bool operator!=(const Iterator& v) const
-			{
-				return buffer != v.buffer || index != v.index;
-			}
-
-		public:
-			Iterator& operator++()
-			{
-				ASSERT(buffer);
-				index = (index + 1) & buffer->mask;
-				return *this;
-			}
-
-			Iterator operator++(int)
-			{
-				ASSERT(buffer);
-				Iterator temp = *this;
-				index = (index + 1) & buffer->mask;
-				return temp;
-			}
-
-			Iterator& operator--()
-			{
-				ASSERT(buffer);
-				index = (index - 1) & buffer->mask;
-				return *this;
-			}
-
-			Iterator operator--(int)
-			{
-				ASSERT(buffer);
-				Iterator temp = *this;
-				index = (index - 1) & buffer->mask;
-				return temp;
-			}
-		};
+			Event& ent = data[writeIndex & MASK];
+			ent.time = time;
+			ent.name = name;
+			ent.type = type;
+			if ((++writeIndex & (PUBLISH_INTERVAL - 1)) == 0)
+				Publish();
+		}
 
-		FORCE_INLINE Iterator Begin()
+		FORCE_INLINE void PushCounter(U64 time, const char* name, CounterType counterType, CounterValue value)
 		{
-			return Iterator(this, (head - count) & mask);
+			Event& ent = data[writeIndex & MASK];
+			ent.time = time;
+			ent.name = name;
+			ent.value = value;
+			ent.type = EventType::COUNTER;
+			ent.counterType = counterType;
+			writeIndex++;
+			Publish();
 		}
 
-		FORCE_INLINE Iterator Last()
+		// Make the written events visible to readers, only called by the owner thread
+		FORCE_INLINE void Publish()
 		{
-			ASSERT(count > 0);
-			return Iterator(this, (head - 1) & mask);
+			head.store(writeIndex, std::memory_order_release);
 		}
 
-		FORCE_INLINE Iterator End()
-		{
-			return Iterator(this, head);
+		U64 GetHead()const {
+			return head.load(std::memory_order_acquire);
 		}
+
+		// Copy events in [from, GetHead()) which are not overwritten yet.
+		// Return the index after the last copied event, dropped events are added to droppedCount.
+		U64 Read(U64 from, std::vector<Event>& events, U64& droppedCount)const;
+
+		// Get the names of the innermost open blocks from the written events, outermost first.
+		// Only called by the owner thread, return the count of found blocks.
+		U32 GetOpenBlocks(const char** blocks, U32 maxCount)const;
+
+	private:
+		Event* data;
+		// Only accessed by the owner thread
+		U64 writeIndex = 0;
+		std::atomic<U64> head{ 0 };
 	};
 
 	// Thread profiler
 	struct Thread
 	{
+		static const U32 MAX_DEPTH = 64;
+
 		StaticString<64> name;
-		Mutex mutex;
 		Platform::ThreadID threadID = 0;
+		U32 threadIndex = 0;
+		EventBuffer events;
+
+		// Count of open blocks of current thread, their names are found from the events when a fiber waits
 		I32 depth = 0;
-		BlockBuffer entBuffer;
-		std::vector<I32> blockStack;
 
-		Block* BeginBlock();
-		void EndBlock(I32 index);
-		Block* BeginFiberWait();
-		void EndFiberWait(I32 index);
+		// Start of current frame, updated by BeginFrame
+		std::atomic<U64> frameStart{ 0 };
+
+		// Statistics accumulated by this thread, collected into counters by BeginFrame
+		struct Stats
+		{
+			std::atomic<I64> allocations{ 0 };
+			std::atomic<I64> allocatedBytes{ 0 };
+			std::atomic<I64> frees{ 0 };
+			std::atomic<I64> fiberSwitches{ 0 };
+		};
+		Stats stats;
+
+		// Get the blocks in current frame
 		void GetBlocks(std::vector<Block>& blocks);
+		// Get the counter samples in current frame
+		void GetCounters(std::vector<Counter>& counters);
 	};
 
+	// Raw timestamp used by profiler (TSC if available)
+	FORCE_INLINE U64 GetTicks()
+	{
+#ifdef PROFILER_USE_TSC
+		return __rdtsc();
+#else
+		return Timer::GetRawTimestamp();
+#endif
+	}
+
+	// Ticks per second, calibrated once against the system timer
+	U64 GetTicksFrequency();
+	F64 TicksToSeconds(U64 ticks);
+
 	void SetThreadName(const char* name);
 	void BeginFrame();
 	void EndFrame();
@@ -190,11 +196,24 @@ namespace Profiler
 	bool IsEnable();
 	std::vector<Thread*>& GetThreads();
 
+	// Counter tracks, the name must be a static string
+	void RecordCounter(const char* name, I64 value, CounterType type = CounterType::INT);
+	void RecordFloatCounter(const char* name, F64 value);
+
+	// Allocation statistics of current thread
+	void RecordAlloc(size_t size);
+	void RecordFree();
+
+	// Stream events of all threads into a binary capture file in background
+	bool StartCapture(const char* path);
+	void StopCapture();
+	bool IsCapturing();
+
 	struct FiberSwitchData 
 	{
-		I32 id;
-		I32 blocks[16];
-		U32 count;
+		U64 startTime = 0;
+		const char* blocks[16];
+		U32 count = 0;
 		Thread* thread = nullptr;
 	};
 	FiberSwitchData BeginFiberWait();
@@ -218,4 +237,6 @@ namespace Profiler
 #define PROFILER_CONCAT(a, b) PROFILER_CONCAT2(a, b)
 #define PROFILE_BLOCK(name) Profiler::Scope PROFILER_CONCAT(profile_scope, __LINE__)(name);
 #define PROFILE_FUNCTION() Profiler::Scope  profile_scope(__FUNCTION__);
+#define PROFILE_COUNTER(name, value) Profiler::RecordCounter(name, (I64)(value));
+#define PROFILE_FLOAT_COUNTER(name, value) Profiler::RecordFloatCounter(name, (F64)(value));
 }
\ No newline at end of file
@@ -235,7 +235,7 @@ namespace VulkanTest
 
 	void OutputMemoryStream::operator=(OutputMemoryStream&& rhs)
 	{
-		if (data != nullptr)
+		if (allocated && data != nullptr)
 			CJING_SAFE_FREE(data);
 
 		data = rhs.data;
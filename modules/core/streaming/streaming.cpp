@@ -13,6 +13,10 @@ namespace VulkanTest
 	{
 	public:
 		void Execute(Jobsystem::JobHandle* handle) override;
+
+		const char* GetName()const override {
+			return "Streaming";
+		}
 	};
 
 	class StreamingServiceImpl : public EngineService
@@ -1,9 +1,12 @@
 #include "jobsystem.h"
+#include "workStealingQueue.h"
 #include "core\memory\memory.h"
+#include "core\collections\concurrentqueue.hpp"
 #include "core\platform\fiber.h"
 #include "core\platform\platform.h"
 #include "core\platform\sync.h"
 #include "core\platform\atomic.h"
+#include "core\platform\timer.h"
 #include "core\profiler\profiler.h"
 
 #pragma warning( push )
@@ -17,6 +20,11 @@ namespace Jobsystem
     // Definition
     const U32 MAX_FIBER_COUNT = 512;
     const U32 MAX_JOB_HANDLE_COUNT = 4096;
+    const U32 MAX_LOCAL_JOB_COUNT = 4096;
+    const U32 JOB_BLOCK_SIZE = 256;
+    const U32 PRIORITY_COUNT = (U32)JobPriority::Count;
+    const U32 LOCAL_PRIORITY_COUNT = (U32)JobPriority::LongRunning;
+    const U32 MAX_WORKER_COUNT = 64;
     const U32 HANDLE_ID_MASK = 0x0000ffff;
     const U32 HANDLE_GENERATION_MASK = 0xffff0000;
 
@@ -28,6 +36,9 @@ namespace Jobsystem
 
     struct ManagerImpl;
     struct WorkerThread;
+    struct WorkerFiber;
+
+    static WorkerFiber* GetFreeFiber();
 
     struct JobImpl
     {
@@ -35,6 +46,8 @@ namespace Jobsystem
         void* data = nullptr;
         JobHandle* onFinishedHandle;
         U8 workerIndex;
+        JobPriority priority = JobPriority::Normal;
+        U64 submitTime = 0;
     };
 
     struct WorkerFiber
@@ -42,33 +55,47 @@ namespace Jobsystem
         U32 index = 0;
         Fiber::Handle handle = Fiber::INVALID_HANDLE;
         JobImpl currentJob;
-    };
 
-    struct JobWaitor
-    {
-        JobWaitor* next;
-        WorkerFiber* fiber;
+        // Intrusive waiting list of the JobHandle, store (index + 1) of the next fiber
+        JobHandle* waitingHandle = nullptr;
+        U32 nextWaitor = 0;
     };
 
-    struct JobCounter
+    struct LatencyCounter
     {
-        volatile I32 value = 0;
-        JobWaitor* waitor = nullptr;
-        U32 generation = 0;	// use for check
+        volatile I64 jobCount = 0;
+        volatile I64 totalTicks = 0;
+        volatile I64 maxTicks = 0;
     };
 
     static volatile I32 gGeneration = 0;
 
     struct ManagerImpl
     {
+        // Only used for fiber pool bookkeeping
         Mutex sync;
-        Mutex jobQueueLock;
 
-        std::vector<WorkerFiber*> readyFibers;
+        // Jobs are allocated from blocks and recycled through a lock-free free list
+        Mutex jobBlockLock;
+        std::vector<JobImpl*> jobBlocks;
+        ConcurrentQueue<JobImpl*> freeJobs;
+
+        // Jobs and resumed fibers which could be executed by any worker, for each priority
+        // Submissions from worker threads go to the worker's own deque instead
+        ConcurrentQueue<JobImpl*> jobQueue[PRIORITY_COUNT];
+        ConcurrentQueue<WorkerFiber*> readyFibers[PRIORITY_COUNT];
+
         std::vector<WorkerFiber*> freeFibers;
         WorkerFiber fiberPool[MAX_FIBER_COUNT];
+
+        // Frame workers are in the front, followed by the long-running workers
         std::vector<WorkerThread*> workers;
-        std::vector<JobImpl> jobQueue;
+        U32 frameWorkerCount = 0;
+        U64 frameWorkerMask = 0;
+        U64 longRunningWorkerMask = 0;
+
+        // Bit mask of sleeping workers (At most 64 workers)
+        volatile I64 idleWorkers = 0;
     };
 
     static LocalPtr<ManagerImpl> gManager;
@@ -86,16 +113,37 @@ namespace Jobsystem
         U32 workderIndex;
         bool isFinished = false;
         bool isEnabled = false;
+        bool isLongRunning = false;
 
         WorkerFiber* currentFiber = nullptr;
         Fiber::Handle primaryFiber = Fiber::INVALID_HANDLE;
-        std::vector<WorkerFiber*> readyFibers;
-        std::vector<JobImpl> jobQueue;
+        U32 randomSeed;
+
+        // Deferred operations of the fiber switched out,
+        // they are handled by the fiber switched in after the switch is done
+        WorkerFiber* pendingFreeFiber = nullptr;
+        WorkerFiber* pendingWaitFiber = nullptr;
+
+        // Fibers and jobs pinned to this worker
+        ConcurrentQueue<WorkerFiber*> readyFibers;
+        ConcurrentQueue<JobImpl*> jobQueue;
+
+        // Jobs pushed by this worker, the others could steal from it
+        WorkStealingQueue<JobImpl*, MAX_LOCAL_JOB_COUNT> localQueues[LOCAL_PRIORITY_COUNT];
+
+        // Only updated by this worker
+        LatencyCounter latency[PRIORITY_COUNT];
+        U64 lastQueueDepthTicks = 0;
+
+        Mutex sleepLock;
+        bool wakeupPending = false;
 
     public:
-        WorkerThread(ManagerImpl& manager_, U32 workerIndex_) :
+        WorkerThread(ManagerImpl& manager_, U32 workerIndex_, bool isLongRunning_) :
             manager(manager_),
-            workderIndex(workerIndex_)
+            workderIndex(workerIndex_),
+            isLongRunning(isLongRunning_),
+            randomSeed(workerIndex_ * 2654435761u + 1)
         {
         }
 
@@ -104,18 +152,342 @@ namespace Jobsystem
             gWorker = this;
             primaryFiber = Fiber::Create(Fiber::THIS_THREAD);
 
-            gManager->sync.Lock();
-            WorkerFiber* fiber = gManager->freeFibers.back();
-            gManager->freeFibers.pop_back();
-            if (!Fiber::IsValid(fiber->handle))
-                fiber->handle = Fiber::Create(64 * 1024, FiberFunc, fiber);
-
+            WorkerFiber* fiber = GetFreeFiber();
             gWorker->currentFiber = fiber;
             Fiber::SwitchTo(gWorker->primaryFiber, fiber->handle);
             return 0;
         }
     };
 
+    //////////////////////////////////////////////////////////////
+    // Job pool
+
+    static JobImpl* AllocateJob()
+    {
+        JobImpl* job = nullptr;
+        if (gManager->freeJobs.try_dequeue(job))
+            return job;
+
+        ScopedMutex lock(gManager->jobBlockLock);
+        if (gManager->freeJobs.try_dequeue(job))
+            return job;
+
+        JobImpl* block = CJING_NEW_ARR(JobImpl, JOB_BLOCK_SIZE);
+        gManager->jobBlocks.push_back(block);
+        for (U32 i = 1; i < JOB_BLOCK_SIZE; i++)
+            gManager->freeJobs.enqueue(&block[i]);
+
+        return &block[0];
+    }
+
+    static void FreeJob(JobImpl* job)
+    {
+        job->task = nullptr;
+        job->data = nullptr;
+        gManager->freeJobs.enqueue(job);
+    }
+
+    //////////////////////////////////////////////////////////////
+    // Worker scheduling
+
+    static U32 NextRandom(U32& seed)
+    {
+        // Xorshift32
+        seed ^= seed << 13;
+        seed ^= seed >> 17;
+        seed ^= seed << 5;
+        return seed;
+    }
+
+    static void SetWorkerIdle(WorkerThread* worker, bool idle)
+    {
+        const I64 bit = (I64)1 << worker->workderIndex;
+        while (true)
+        {
+            const I64 mask = AtomicRead(&gManager->idleWorkers);
+            const I64 newMask = idle ? (mask | bit) : (mask & ~bit);
+            if (mask == newMask || AtomicCmpExchange(&gManager->idleWorkers, newMask, mask) == mask)
+                return;
+        }
+    }
+
+    static void SignalWorker(WorkerThread* worker)
+    {
+        worker->sleepLock.Lock();
+        worker->wakeupPending = true;
+        worker->sleepLock.Unlock();
+        worker->Wakeup();
+    }
+
+    // Wakeup the target worker whether it is sleeping or not
+    static void WakeupWorker(WorkerThread* worker)
+    {
+        SetWorkerIdle(worker, false);
+        SignalWorker(worker);
+    }
+
+    // Wakeup only one sleeping worker in the candidates if exists
+    static bool WakeupIdleWorker(U64 candidates)
+    {
+        while (true)
+        {
+            const I64 mask = AtomicRead(&gManager->idleWorkers);
+            if (((U64)mask & candidates) == 0)
+                return false;
+
+#ifdef _WIN32
+            unsigned long index;
+            _BitScanForward64(&index, (U64)mask & candidates);
+#else
+            U32 index = __builtin_ctzll((U64)mask & candidates);
+#endif
+            const I64 bit = (I64)1 << index;
+            if (AtomicCmpExchange(&gManager->idleWorkers, mask & ~bit, mask) == mask)
+            {
+                SignalWorker(gManager->workers[index]);
+                return true;
+            }
+        }
+    }
+
+    static void WakeupIdleWorkers(JobPriority priority, U32 count)
+    {
+        const U64 candidates = priority == JobPriority::LongRunning ? 
+            gManager->longRunningWorkerMask : 
+            gManager->frameWorkerMask;
+
+        for (U32 i = 0; i < count; i++)
+        {
+            if (!WakeupIdleWorker(candidates))
+                break;
+        }
+    }
+
+    static bool HasPendingWork(WorkerThread* worker)
+    {
+        if (worker->readyFibers.size_approx() > 0 ||
+            worker->jobQueue.size_approx() > 0)
+            return true;
+
+        for (U32 p = 0; p < LOCAL_PRIORITY_COUNT; p++)
+        {
+            if (!worker->localQueues[p].Empty())
+                return true;
+        }
+
+        if (worker->isLongRunning)
+        {
+            const U32 p = (U32)JobPriority::LongRunning;
+            return gManager->readyFibers[p].size_approx() > 0 || gManager->jobQueue[p].size_approx() > 0;
+        }
+
+        for (U32 p = 0; p < LOCAL_PRIORITY_COUNT; p++)
+        {
+            if (gManager->readyFibers[p].size_approx() > 0 ||
+                gManager->jobQueue[p].size_approx() > 0)
+                return true;
+
+            for (auto other : gManager->workers)
+            {
+                if (!other->localQueues[p].Empty())
+                    return true;
+            }
+        }
+        return false;
+    }
+
+    static bool StealJob(WorkerThread* worker, U32 priority, JobImpl*& job)
+    {
+        const U32 count = (U32)gManager->workers.size();
+        if (count <= 1)
+            return false;
+
+        // Start from a random victim to avoid all thieves hitting the same worker
+        const U32 start = NextRandom(worker->randomSeed) % count;
+        for (U32 i = 0; i < count; i++)
+        {
+            WorkerThread* victim = gManager->workers[(start + i) % count];
+            if (victim != worker && victim->localQueues[priority].Steal(job))
+                return true;
+        }
+        return false;
+    }
+
+    static bool PopWork(WorkerThread* worker, WorkerFiber*& fiber, JobImpl*& job)
+    {
+        // Worker
+        if (worker->readyFibers.try_dequeue(fiber))
+            return true;
+        if (worker->jobQueue.try_dequeue(job))
+            return true;
+
+        // Long-running workers only execute long-running jobs and the jobs spawned by them
+        if (worker->isLongRunning)
+        {
+            const U32 p = (U32)JobPriority::LongRunning;
+            if (gManager->readyFibers[p].try_dequeue(fiber))
+                return true;
+
+            for (U32 i = 0; i < LOCAL_PRIORITY_COUNT; i++)
+            {
+                if (worker->localQueues[i].Pop(job))
+                    return true;
+            }
+            return gManager->jobQueue[p].try_dequeue(job);
+        }
+
+        // From high priority to low priority
+        for (U32 p = 0; p < LOCAL_PRIORITY_COUNT; p++)
+        {
+            if (gManager->readyFibers[p].try_dequeue(fiber))
+                return true;
+            if (worker->localQueues[p].Pop(job))
+                return true;
+            if (gManager->jobQueue[p].try_dequeue(job))
+                return true;
+            if (StealJob(worker, p, job))
+                return true;
+        }
+        return false;
+    }
+
+    static void RecordIdleWorkers()
+    {
+        if (!Profiler::IsEnable())
+            return;
+
+        const U64 mask = (U64)AtomicRead(&gManager->idleWorkers);
+#ifdef _WIN32
+        const I64 count = (I64)__popcnt64(mask);
+#else
+        const I64 count = (I64)__builtin_popcountll(mask);
+#endif
+        Profiler::RecordCounter("IdleWorkers", count);
+    }
+
+    // Sample the count of pending jobs, rate-limited to keep the event rings small
+    static void RecordQueueDepth(WorkerThread* worker)
+    {
+        if (!Profiler::IsEnable())
+            return;
+
+        const U64 ticks = Profiler::GetTicks();
+        if (ticks - worker->lastQueueDepthTicks < Profiler::GetTicksFrequency() / 2000)
+            return;
+        worker->lastQueueDepthTicks = ticks;
+
+        I64 depth = 0;
+        for (U32 p = 0; p < PRIORITY_COUNT; p++)
+            depth += (I64)gManager->jobQueue[p].size_approx();
+
+        for (auto other : gManager->workers)
+        {
+            depth += (I64)other->jobQueue.size_approx();
+            for (U32 p = 0; p < LOCAL_PRIORITY_COUNT; p++)
+                depth += other->localQueues[p].Count();
+        }
+        Profiler::RecordCounter("JobQueueDepth", depth);
+    }
+
+    static void SleepWorker(WorkerThread* worker)
+    {
+        // Publish the idle state first and then check again to avoid missing wakeup
+        SetWorkerIdle(worker, true);
+        if (HasPendingWork(worker))
+        {
+            SetWorkerIdle(worker, false);
+            return;
+        }
+
+        RecordIdleWorkers();
+
+        // PROFILE_BLOCK("Sleeping");
+        worker->sleepLock.Lock();
+        while (!worker->wakeupPending && !worker->isFinished)
+            worker->Sleep(worker->sleepLock);
+        worker->wakeupPending = false;
+        worker->sleepLock.Unlock();
+
+        SetWorkerIdle(worker, false);
+        RecordIdleWorkers();
+    }
+
+    //////////////////////////////////////////////////////////////
+    // Fiber switching
+
+    static void ResumeFiber(WorkerFiber* fiber)
+    {
+        U8 workerIndex = fiber->currentJob.workerIndex;
+        if (workerIndex == ANY_WORKER)
+        {
+            const JobPriority priority = fiber->currentJob.priority;
+            gManager->readyFibers[(U32)priority].enqueue(fiber);
+            WakeupIdleWorkers(priority, 1);
+        }
+        else
+        {
+            WorkerThread* worker = gManager->workers[workerIndex];
+            worker->readyFibers.enqueue(fiber);
+            WakeupWorker(worker);
+        }
+    }
+
+    static WorkerFiber* GetFreeFiber()
+    {
+        WorkerFiber* fiber = nullptr;
+        {
+            ScopedMutex lock(gManager->sync);
+            ASSERT(!gManager->freeFibers.empty());
+            fiber = gManager->freeFibers.back();
+            gManager->freeFibers.pop_back();
+        }
+
+        if (!Fiber::IsValid(fiber->handle))
+            fiber->handle = Fiber::Create(64 * 1024, FiberFunc, fiber);
+        return fiber;
+    }
+
+    static void AddWaitor(WorkerFiber* fiber)
+    {
+        JobHandle* handle = fiber->waitingHandle;
+        while (true)
+        {
+            const U64 state = (U64)AtomicRead(&handle->state);
+            if ((state & JobHandle::COUNTER_MASK) == 0)
+            {
+                // Jobs are already finished, resume the fiber directly
+                fiber->waitingHandle = nullptr;
+                ResumeFiber(fiber);
+                return;
+            }
+
+            fiber->nextWaitor = (U32)((state & JobHandle::WAITOR_MASK) >> 32);
+            const U64 tag = (state + (1ull << 48)) & JobHandle::TAG_MASK;
+            const U64 newState = tag | ((U64)(fiber->index + 1) << 32) | (state & JobHandle::COUNTER_MASK);
+            if (AtomicCmpExchange(&handle->state, (I64)newState, (I64)state) == (I64)state)
+                return;
+        }
+    }
+
+    // Called by the fiber switched in, the previous fiber is completely switched out now
+    // so it is safe to let the others resume it
+    static void FinishFiberSwitch(WorkerThread* worker)
+    {
+        if (worker->pendingFreeFiber != nullptr)
+        {
+            ScopedMutex lock(gManager->sync);
+            gManager->freeFibers.push_back(worker->pendingFreeFiber);
+            worker->pendingFreeFiber = nullptr;
+        }
+
+        if (worker->pendingWaitFiber != nullptr)
+        {
+            WorkerFiber* fiber = worker->pendingWaitFiber;
+            worker->pendingWaitFiber = nullptr;
+            AddWaitor(fiber);
+        }
+    }
+
     //////////////////////////////////////////////////////////////
     // Methods
 
@@ -131,20 +503,53 @@ namespace Jobsystem
             gManager->freeFibers.push_back(fiber);
         }
 
-        numWorkers = std::min(64u, numWorkers);
-        gManager->workers.reserve(numWorkers);
+        // Long-running workers are created in addition to the frame workers, one per four frame workers (1 to 4),
+        // they are not bound to cores so that blocking jobs never take a core from frame jobs
+        const U32 numLongRunningWorkers = std::clamp(numWorkers / 4, 1u, 4u);
+        numWorkers = std::min(MAX_WORKER_COUNT - numLongRunningWorkers, numWorkers);
+        gManager->workers.reserve(numWorkers + numLongRunningWorkers);
+
+        auto CreateWorker = [](const char* name, bool isLongRunning)->WorkerThread* {
+            void* mem = CJING_MALLOC_ALIGN(sizeof(WorkerThread), alignof(WorkerThread));
+            WorkerThread* worker = new (NewPlaceHolder(), mem) WorkerThread(*gManager, (U32)gManager->workers.size(), isLongRunning);
+            gManager->workers.push_back(worker);
+            if (!worker->Create(name))
+            {
+                gManager->workers.pop_back();
+                worker->~WorkerThread();
+                CJING_FREE_ALIGN(mem);
+                return nullptr;
+            }
+
+            const U64 bit = (U64)1u << worker->workderIndex;
+            if (isLongRunning)
+                gManager->longRunningWorkerMask |= bit;
+            else
+                gManager->frameWorkerMask |= bit;
+            return worker;
+        };
+
+        StaticString<32> workerName;
         for (U32 i = 0; i < numWorkers; i++)
         {
-            StaticString<32> worldName;
-            WorkerThread* worker = CJING_NEW(WorkerThread)(*gManager, i);
-            if (worker->Create(worldName.Sprintf("Worker_%d", i).c_str()))
-            {
-                gManager->workers.push_back(worker);
+            WorkerThread* worker = CreateWorker(workerName.Sprintf("Worker_%d", i).c_str(), false);
+            if (worker != nullptr)
                 worker->SetAffinity((U64)1u << i);
-            }
         }
+        gManager->frameWorkerCount = (U32)gManager->workers.size();
+        if (gManager->frameWorkerCount == 0)
+            return false;
 
-        return !gManager->workers.empty();
+        for (U32 i = 0; i < numLongRunningWorkers; i++)
+            CreateWorker(workerName.Sprintf("LongRunningWorker_%d", i).c_str(), true);
+
+        return true;
+    }
+
+    U32 GetWorkersCount()
+    {
+        ASSERT(gManager.Get() != nullptr);
+        return gManager->frameWorkerCount;
     }
 
     void Uninitialize()
@@ -156,10 +561,11 @@ namespace Jobsystem
         for (auto worker : gManager->workers)
         {
             while (!worker->IsFinished())
-                worker->Wakeup();
+                SignalWorker(worker);
 
             worker->Destroy();
-            CJING_SAFE_DELETE(worker);
+            worker->~WorkerThread();
+            CJING_FREE_ALIGN(worker);
         }
         gManager->workers.clear();
 
@@ -170,158 +576,293 @@ namespace Jobsystem
                 Fiber::Destroy(fiber.handle);
         }
 
+        // Clear job pool
+        for (auto block : gManager->jobBlocks)
+        {
+            CJING_DELETE_ARR(block, JOB_BLOCK_SIZE);
+        }
+        gManager->jobBlocks.clear();
+
         gManager.Destroy();
     }
 
-    void RunInternal(JobFunc task, void* data, JobHandle* handle, int workerIndex)
+    static void AddJobCount(JobHandle* handle, U32 count)
     {
-        JobImpl job = {};
-        job.data = data;
-        job.task = task;
-        job.workerIndex = U8(workerIndex != ANY_WORKER ? workerIndex % gManager->workers.size() : ANY_WORKER);
-        job.onFinishedHandle = handle;
+        if (handle == nullptr)
+            return;
 
-        if (handle != nullptr)
-        {
-            ScopedMutex guard(gManager->sync);
-            handle->counter++;
-            if (handle->counter == 1)
-                handle->generation = AtomicIncrement(&gGeneration);
-        }
+        // Counter is in the low bits, it never overflows into the waitor bits
+        const U64 state = (U64)AtomicAdd(&handle->state, (I64)count);
+        if ((state & JobHandle::COUNTER_MASK) == count)
+            handle->generation = AtomicIncrement(&gGeneration);
+    }
+
+    static JobImpl* CreateJob(JobFunc&& task, void* data, JobHandle* handle, U8 workerIndex, JobPriority priority)
+    {
+        JobImpl* job = AllocateJob();
+        job->data = data;
+        job->task = std::move(task);
+        job->workerIndex = workerIndex;
+        job->priority = priority;
+        job->onFinishedHandle = handle;
+        job->submitTime = Timer::GetRawTimestamp();
+        return job;
+    }
+
+    static U8 GetTargetWorkerIndex(int workerIndex)
+    {
+        // Pinned jobs are only executed by frame workers
+        return U8(workerIndex != ANY_WORKER ? workerIndex % gManager->frameWorkerCount : ANY_WORKER);
+    }
+
+    static JobPriority GetCurrentPriority()
+    {
+        WorkerThread* worker = GetWorker();
+        if (worker == nullptr || worker->currentFiber == nullptr || !worker->currentFiber->currentJob.task)
+            return JobPriority::Normal;
+        return worker->currentFiber->currentJob.priority;
+    }
+
+    // Push a job of any worker, return false if the job should be pushed into the global queue
+    static bool PushLocalJob(WorkerThread* worker, JobImpl* job)
+    {
+        if (worker == nullptr || job->priority == JobPriority::LongRunning)
+            return false;
+
+        return worker->localQueues[(U32)job->priority].Push(job);
+    }
+
+    void RunInternal(JobFunc&& task, void* data, JobHandle* handle, int workerIndex, JobPriority priority)
+    {
+        JobImpl* job = CreateJob(std::move(task), data, handle, GetTargetWorkerIndex(workerIndex), priority);
+        AddJobCount(handle, 1);
 
         // Push job for worker
-        if (job.workerIndex != ANY_WORKER)
+        if (job->workerIndex != ANY_WORKER)
         {
-            WorkerThread* worker = gManager->workers[job.workerIndex % gManager->workers.size()];
-            {
-                ScopedMutex lock(gManager->jobQueueLock);
-                worker->jobQueue.push_back(job);
-            }
-            worker->Wakeup();
+            WorkerThread* worker = gManager->workers[job->workerIndex];
+            worker->jobQueue.enqueue(job);
+            WakeupWorker(worker);
         }
         else
         {
-            {
-                ScopedMutex lock(gManager->jobQueueLock);
-                gManager->jobQueue.push_back(job);
-            }
+            // Push into the local deque if we are in a worker thread
+            if (!PushLocalJob(GetWorker(), job))
+                gManager->jobQueue[(U32)priority].enqueue(job);
 
-            for (auto worker : gManager->workers)
-                worker->Wakeup();
+            WakeupIdleWorkers(priority, 1);
         }
     }
 
-    void Run(void*data, JobFunc func, JobHandle* handle, U8 workerIndex)
+    void Run(void*data, JobFunc func, JobHandle* handle, U8 workerIndex, JobPriority priority)
     {
         ASSERT(gManager.Get() != nullptr);
 
         RunInternal(
-            func,
+            std::move(func),
             data,
             handle,
-            workerIndex
+            workerIndex,
+            priority
         );
     }
 
-    void Wait(JobHandle* handle)
+    void RunBatch(Span<JobDecl> jobs, JobHandle* handle, U8 workerIndex, JobPriority priority)
     {
         ASSERT(gManager.Get() != nullptr);
 
-        if (handle == nullptr || handle->counter == 0)
+        const U32 count = (U32)jobs.length();
+        if (count == 0)
             return;
 
-        gManager->sync.Lock();
-        if (handle->counter == 0)
+        // Update the counter once for the whole batch
+        AddJobCount(handle, count);
+
+        const U8 targetIndex = GetTargetWorkerIndex(workerIndex);
+        WorkerThread* worker = GetWorker();
+        auto& queue = targetIndex != ANY_WORKER ? gManager->workers[targetIndex]->jobQueue : gManager->jobQueue[(U32)priority];
+        JobImpl* pendingJobs[64];
+        U32 pendingCount = 0;
+        for (auto& decl : jobs)
         {
-            gManager->sync.Unlock();
-            return;
+            JobImpl* job = CreateJob(std::move(decl.func), decl.data, handle, targetIndex, priority);
+            if (targetIndex == ANY_WORKER && PushLocalJob(worker, job))
+                continue;
+
+            pendingJobs[pendingCount++] = job;
+            if (pendingCount == LengthOf(pendingJobs))
+            {
+                queue.enqueue_bulk(pendingJobs, pendingCount);
+                pendingCount = 0;
+            }
         }
-    
-        // No worker, just sleep
-        if (GetWorker() == nullptr)
+
+        if (pendingCount > 0)
+            queue.enqueue_bulk(pendingJobs, pendingCount);
+
+        if (targetIndex != ANY_WORKER)
+            WakeupWorker(gManager->workers[targetIndex]);
+        else
+            WakeupIdleWorkers(priority, count);
+    }
+
+    struct ForEachContext
+    {
+        void* data = nullptr;
+        RangeFunc func = nullptr;
+        U32 grainSize = 1;
+        JobPriority priority = JobPriority::Normal;
+        JobHandle handle;
+    };
+
+    static void RunRange(ForEachContext* ctx, U32 begin, U32 end)
+    {
+        while (begin < end)
         {
-            while (handle->counter > 0)
+            // Lazy binary splitting: split off the upper half only when the local deque is drained,
+            // so idle workers always have something to steal and busy workers avoid useless splits
+            WorkerThread* worker = GetWorker();
+            const bool drained = worker == nullptr || 
+                ctx->priority == JobPriority::LongRunning ||
+                worker->localQueues[(U32)ctx->priority].Empty();
+            if (end - begin > ctx->grainSize && drained)
             {
-                gManager->sync.Unlock();
-                Platform::Sleep(1);
-                gManager->sync.Lock();
+                const U32 mid = begin + (end - begin) / 2;
+                RunInternal([ctx, mid, end](void*) {
+                    RunRange(ctx, mid, end);
+                }, nullptr, &ctx->handle, ANY_WORKER, ctx->priority);
+                end = mid;
+                continue;
             }
-            gManager->sync.Unlock();
+
+            const U32 chunkEnd = std::min(end, begin + ctx->grainSize);
+            ctx->func(ctx->data, begin, chunkEnd);
+            begin = chunkEnd;
+        }
+    }
+
+    void ForEach(U32 count, U32 grainSize, void* data, RangeFunc func)
+    {
+        ASSERT(gManager.Get() != nullptr);
+
+        if (count == 0)
+            return;
+
+        if (grainSize == 0)
+            grainSize = std::max(1u, count / (gManager->frameWorkerCount * 4));
+
+        if (count <= grainSize)
+        {
+            func(data, 0, count);
             return;
         }
 
-        // Set the current fiber as the next waitor of the pending handle
-        WorkerFiber* thisFiber = GetWorker()->currentFiber;
+        ForEachContext ctx;
+        ctx.data = data;
+        ctx.func = func;
+        ctx.grainSize = grainSize;
+        ctx.priority = GetCurrentPriority();
+        RunRange(&ctx, 0, count);
+        Wait(&ctx.handle);
+    }
 
-        JobWaitor waitor = {};
-        waitor.fiber = thisFiber;
-        waitor.next = handle->waitor;
-        handle->waitor = &waitor;
-        
-        auto switchData = Profiler::BeginFiberWait();
+    void Wait(JobHandle* handle)
+    {
+        ASSERT(gManager.Get() != nullptr);
 
-        // Get free fiber
-        WorkerFiber* newFiber = gManager->freeFibers.back();
-        gManager->freeFibers.pop_back();
-        if (!Fiber::IsValid(newFiber->handle))
-            newFiber->handle = Fiber::Create(64 * 1024, FiberFunc, newFiber);
+        if (handle == nullptr || handle->GetCounter() == 0)
+            return;
 
-        GetWorker()->currentFiber = newFiber;
+        // No worker, just sleep
+        WorkerThread* worker = GetWorker();
+        if (worker == nullptr)
+        {
+            while (handle->GetCounter() > 0)
+                Platform::Sleep(0.001f);
+            return;
+        }
+
+        // The current fiber is added into the waiting list after switching out
+        WorkerFiber* thisFiber = worker->currentFiber;
+        thisFiber->waitingHandle = handle;
+
+        auto switchData = Profiler::BeginFiberWait();
+
+        WorkerFiber* newFiber = GetFreeFiber();
+        worker->currentFiber = newFiber;
+        worker->pendingWaitFiber = thisFiber;
         Fiber::SwitchTo(thisFiber->handle, newFiber->handle);
-        GetWorker()->currentFiber = thisFiber;
-        gManager->sync.Unlock();
+
+        // Resumed, the worker may be changed
+        worker = GetWorker();
+        FinishFiberSwitch(worker);
+        worker->currentFiber = thisFiber;
+        thisFiber->waitingHandle = nullptr;
 
         Profiler::EndFiberWait(switchData);
     }
 
     bool Trigger(JobHandle* jobHandle)
     {
-        JobWaitor* waitor = nullptr;
+        // Decrease counter and take the waiting list by one CAS,
+        // the handle could be released by waitors once the counter reaches zero
+        U64 state;
+        U64 newState;
+        while (true)
         {
-            ScopedMutex lock(gManager->sync);
-            jobHandle->counter--;
-            ASSERT(jobHandle->counter >= 0);
-            if (jobHandle->counter > 0)
-                return false;
-
-            waitor = jobHandle->waitor;
-            jobHandle->waitor = nullptr;
+            state = (U64)AtomicRead(&jobHandle->state);
+            ASSERT((state & JobHandle::COUNTER_MASK) > 0);
+            if ((state & JobHandle::COUNTER_MASK) > 1)
+                newState = state - 1;
+            else
+                newState = (state + (1ull << 48)) & JobHandle::TAG_MASK;
+
+            if (AtomicCmpExchange(&jobHandle->state, (I64)newState, (I64)state) == (I64)state)
+                break;
         }
 
-        if (waitor == nullptr)
+        if ((newState & JobHandle::COUNTER_MASK) > 0)
             return false;
 
-        bool needWakeAll = false;
-        {
-            ScopedMutex lock(gManager->jobQueueLock);
-            while (waitor != nullptr)
-            {
-                JobWaitor* next = waitor->next;
-                U8 workerIndex = waitor->fiber->currentJob.workerIndex; 
-                if (workerIndex == ANY_WORKER)
-                {
-                    gManager->readyFibers.push_back(waitor->fiber);
-                    needWakeAll = true;
+        U32 waitor = (U32)((state & JobHandle::WAITOR_MASK) >> 32);
+        if (waitor == 0)
+            return false;
 
-                }
-                else
-                {
-                    WorkerThread* worker = gManager->workers[workerIndex % gManager->workers.size()];
-                    worker->readyFibers.push_back(waitor->fiber);
-                    if (!needWakeAll)
-                        worker->Wakeup();
-                }
-                waitor = next;
-            }
+        while (waitor != 0)
+        {
+            WorkerFiber* fiber = &gManager->fiberPool[waitor - 1];
+            waitor = fiber->nextWaitor;
+            ResumeFiber(fiber);
         }
 
-        if (needWakeAll)
+        return true;
+    }
+
+    JobLatencyStats PopLatencyStats(JobPriority priority)
+    {
+        ASSERT(gManager.Get() != nullptr);
+        ASSERT(priority < JobPriority::Count);
+
+        I64 jobCount = 0;
+        I64 totalTicks = 0;
+        I64 maxTicks = 0;
+        for (auto worker : gManager->workers)
         {
-            for (auto worker : gManager->workers)
-                worker->Wakeup();
+            LatencyCounter& latency = worker->latency[(U32)priority];
+            jobCount += AtomicExchange(&latency.jobCount, 0);
+            totalTicks += AtomicExchange(&latency.totalTicks, 0);
+            maxTicks = std::max(maxTicks, AtomicExchange(&latency.maxTicks, 0));
         }
 
-        return true;
+        JobLatencyStats stats;
+        if (jobCount > 0)
+        {
+            const F64 frequency = (F64)Timer::GetFrequency();
+            stats.jobCount = (U64)jobCount;
+            stats.averageLatency = (F64)totalTicks / (F64)jobCount / frequency;
+            stats.maxLatency = (F64)maxTicks / frequency;
+        }
+        return stats;
     }
 
 #ifdef _WIN32
@@ -330,48 +871,22 @@ namespace Jobsystem
     static void FiberFunc(void* data);
 #endif
     {
-        gManager->sync.Unlock();
-
         WorkerFiber* currentFiber = (WorkerFiber*)(data);
         WorkerThread* worker = GetWorker();
+        FinishFiberSwitch(worker);
         while (!worker->isFinished)
         {
             WorkerFiber* fiber = nullptr;
-            JobImpl job;
+            JobImpl* job = nullptr;
             while (!worker->isFinished)
             {
-                ScopedMutex lock(gManager->jobQueueLock);
-
-                // Worker
-                if (!worker->readyFibers.empty())
+                if (PopWork(worker, fiber, job))
                 {
-                    fiber = worker->readyFibers.back();
-                    worker->readyFibers.pop_back();
-                    break;
-                }
-                if (!worker->jobQueue.empty())
-                {
-                    job = worker->jobQueue.back();
-                    worker->jobQueue.pop_back();
-                    break;
-                }
-                
-                // Global
-                if (!gManager->readyFibers.empty())
-                {
-                    fiber = gManager->readyFibers.back();
-                    gManager->readyFibers.pop_back();
-                    break;
-                }
-                if (!gManager->jobQueue.empty())
-                {
-                    job = gManager->jobQueue.back();
-                    gManager->jobQueue.pop_back();
+                    RecordQueueDepth(worker);
                     break;
                 }
 
-                // PROFILE_BLOCK("Sleeping");
-                worker->Sleep(gManager->jobQueueLock);
+                SleepWorker(worker);
             }
 
             if (worker->isFinished)
@@ -381,26 +896,34 @@ namespace Jobsystem
             {
                 // Do ready fiber
                 worker->currentFiber = fiber;
-
-                gManager->sync.Lock();
-                gManager->freeFibers.push_back(currentFiber);
+                worker->pendingFreeFiber = currentFiber;
                 Fiber::SwitchTo(currentFiber->handle, fiber->handle);
-                gManager->sync.Unlock();
 
+                // Reused by a waiting job
                 worker = GetWorker();
+                FinishFiberSwitch(worker);
                 worker->currentFiber = currentFiber;
             }
-            else if (job.task != nullptr)
+            else if (job != nullptr)
             {
                 Profiler::BeginBlock("Job");
 
                 // Do target job
-                currentFiber->currentJob = job;
-                job.task(job.data);
-                currentFiber->currentJob.task = nullptr;
+                JobImpl& currentJob = currentFiber->currentJob;
+                currentJob = std::move(*job);
+                FreeJob(job);
+
+                LatencyCounter& latency = worker->latency[(U32)currentJob.priority];
+                const I64 ticks = (I64)(Timer::GetRawTimestamp() - currentJob.submitTime);
+                AtomicIncrement(&latency.jobCount);
+                AtomicAdd(&latency.totalTicks, ticks);
+                AtomicExchangeIfGreater(&latency.maxTicks, ticks);
+
+                currentJob.task(currentJob.data);
+                currentJob.task = nullptr;
 
-                if (job.onFinishedHandle)
-                    Trigger(job.onFinishedHandle);
+                if (currentJob.onFinishedHandle)
+                    Trigger(currentJob.onFinishedHandle);
 
                 worker = GetWorker();
                 Profiler::EndBlock();
@@ -8,29 +8,183 @@ namespace Jobsystem
 {
     constexpr U8 ANY_WORKER = 0xff;
 
-    using JobFunc = std::function<void(void*)>;
+    enum class JobPriority : U8
+    {
+        High,           // Frame critical jobs
+        Normal,
+        Background,     // Executed only when there are no high or normal jobs
+        LongRunning,    // Executed by dedicated workers, so it never starves frame jobs (Streaming, shader compiling...)
+        Count
+    };
+
+    // Latency from submitting a job to starting it
+    struct JobLatencyStats
+    {
+        U64 jobCount = 0;
+        F64 averageLatency = 0.0;   // In seconds
+        F64 maxLatency = 0.0;       // In seconds
+    };
+
+    // Type-erased job function which is stored inline, so submitting jobs never allocates
+    class JobFunc
+    {
+    public:
+        static constexpr size_t INLINE_SIZE = 64;
+
+        JobFunc() = default;
+        JobFunc(std::nullptr_t) {}
+
+        template<typename F, typename = std::enable_if_t<!std::is_same_v<std::decay_t<F>, JobFunc>>>
+        JobFunc(F&& func)
+        {
+            using Func = std::decay_t<F>;
+            static_assert(sizeof(Func) <= INLINE_SIZE, "Job function is too large to be stored inline");
+            static_assert(alignof(Func) <= alignof(std::max_align_t), "Unsupported alignment of job function");
+
+            new (storage) Func(std::forward<F>(func));
+            invoker = [](void* storage, void* data) {
+                (*static_cast<Func*>(storage))(data);
+            };
+
+            if constexpr (!std::is_trivially_copyable_v<Func>)
+            {
+                // Move src into dst and destroy src, or destroy dst if src is null
+                manager = [](void* dst, void* src) {
+                    if (src != nullptr)
+                        new (dst) Func(std::move(*static_cast<Func*>(src)));
+                    static_cast<Func*>(src != nullptr ? src : dst)->~Func();
+                };
+            }
+        }
+
+        JobFunc(JobFunc&& rhs)
+        {
+            MoveFrom(rhs);
+        }
+
+        ~JobFunc()
+        {
+            Reset();
+        }
+
+        JobFunc& operator=(JobFunc&& rhs)
+        {
+            if (this != &rhs)
+            {
+                Reset();
+                MoveFrom(rhs);
+            }
+            return *this;
+        }
+
+        JobFunc& operator=(std::nullptr_t)
+        {
+            Reset();
+            return *this;
+        }
+
+        JobFunc(const JobFunc&) = delete;
+        JobFunc& operator=(const JobFunc&) = delete;
+
+        void operator()(void* data)
+        {
+            ASSERT(invoker != nullptr);
+            invoker(storage, data);
+        }
+
+        explicit operator bool()const {
+            return invoker != nullptr;
+        }
+
+        void Reset()
+        {
+            if (manager != nullptr)
+                manager(storage, nullptr);
+            invoker = nullptr;
+            manager = nullptr;
+        }
+
+    private:
+        void MoveFrom(JobFunc& rhs)
+        {
+            if (rhs.manager != nullptr)
+                rhs.manager(storage, rhs.storage);
+            else if (rhs.invoker != nullptr)
+                memcpy(storage, rhs.storage, INLINE_SIZE);
+
+            invoker = rhs.invoker;
+            manager = rhs.manager;
+            rhs.invoker = nullptr;
+            rhs.manager = nullptr;
+        }
+
+        using InvokeFunc = void(*)(void* storage, void* data);
+        using ManageFunc = void(*)(void* dst, void* src);
+
+        alignas(std::max_align_t) U8 storage[INLINE_SIZE];
+        InvokeFunc invoker = nullptr;
+        ManageFunc manager = nullptr;
+    };
+
+    struct JobDecl
+    {
+        JobFunc func;
+        void* data = nullptr;
+    };
+
+    // Process items in the range [begin, end)
+    using RangeFunc = void(*)(void* data, U32 begin, U32 end);
 
     struct JobHandle
     {
         ~JobHandle() 
         {
-            ASSERT(waitor == nullptr);
-            ASSERT(counter == 0);
+            ASSERT(((U64)state & ~TAG_MASK) == 0);
         }
 
         explicit operator bool()const {
-            return counter > 0;
+            return GetCounter() > 0;
+        }
+
+        U32 GetCounter()const {
+            return (U32)((U64)state & COUNTER_MASK);
         }
 
-        volatile I32 counter = 0;
-        struct JobWaitor* waitor = nullptr;
+        // Packed state: | tag 16bits | head of waiting fibers 16bits | counter 32bits |
+        // The counter and the waiting list are updated together by one CAS
+        static constexpr U64 COUNTER_MASK = 0x00000000ffffffffull;
+        static constexpr U64 WAITOR_MASK  = 0x0000ffff00000000ull;
+        static constexpr U64 TAG_MASK     = 0xffff000000000000ull;
+
+        volatile I64 state = 0;
         I32 generation = 0;
     };
 
     bool Initialize(U32 numWorkers);
     void Uninitialize();
 
-    void Run(void*data, JobFunc func, JobHandle* handle, U8 workerIndex = ANY_WORKER);
+    // Count of workers executing frame jobs, long-running workers are not included
+    U32 GetWorkersCount();
+
+    void Run(void*data, JobFunc func, JobHandle* handle, U8 workerIndex = ANY_WORKER, JobPriority priority = JobPriority::Normal);
+    void RunBatch(Span<JobDecl> jobs, JobHandle* handle, U8 workerIndex = ANY_WORKER, JobPriority priority = JobPriority::Normal);
     void Wait(JobHandle* handle);
+
+    // Get the latency stats of the priority since the last call
+    JobLatencyStats PopLatencyStats(JobPriority priority);
+
+    // Parallel-for over [0, count), the range is split on demand until it is not larger than grainSize.
+    // The calling thread takes part in the work and returns after all items are processed.
+    // grainSize 0 means choosing automatically according to the count of workers.
+    // Split jobs inherit the priority of the calling job.
+    void ForEach(U32 count, U32 grainSize, void* data, RangeFunc func);
+
+    template<typename F>
+    void ForEach(U32 count, U32 grainSize, const F& func)
+    {
+        ForEach(count, grainSize, (void*)&func, [](void* data, U32 begin, U32 end) {
+            (*static_cast<const F*>(data))(begin, end);
+        });
+    }
 }
 }
\ No newline at end of file
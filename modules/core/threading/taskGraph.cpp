@@ -1,71 +1,190 @@
 #include "taskGraph.h"
 #include "core\profiler\profiler.h"
+#include "core\platform\atomic.h"
+#include "core\utils\log.h"
 
 namespace VulkanTest
 {
+	TaskGraphSystem::~TaskGraphSystem()
+	{
+		if (graph != nullptr)
+			graph->RemoveSystem(this);
+	}
+
 	void TaskGraphSystem::AddDependency(TaskGraphSystem* system)
 	{
 		dependencies.push_back(system);
+		if (graph != nullptr)
+			graph->isDirty = true;
 	}
 
 	TaskGraph::TaskGraph() = default;
-	TaskGraph::~TaskGraph() = default;
+
+	TaskGraph::~TaskGraph()
+	{
+		for (auto system : systems)
+			system->graph = nullptr;
+	}
 
 	void TaskGraph::AddSystem(TaskGraphSystem* system)
 	{
 		ASSERT(system != nullptr);
+		ASSERT(system->graph == nullptr);
+		ASSERT(system->GetName() != nullptr && system->GetName()[0] != 0);
 		systems.push_back(system);
+		system->graph = this;
+		isDirty = true;
 	}
 
 	void TaskGraph::RemoveSystem(TaskGraphSystem* system)
 	{
 		ASSERT(system != nullptr);
 		systems.erase(system);
+		system->graph = nullptr;
+		system->nodeIndex = -1;
+		isDirty = true;
 	}
 
-	void TaskGraph::Execute()
+	void TaskGraph::Compile()
 	{
 		PROFILE_FUNCTION();
 
-		queue.clear();
-		remaining.clear();
-		
+		nodes.resize(systems.size());
+		for (U32 i = 0; i < systems.size(); i++)
+		{
+			systems[i]->nodeIndex = (I32)i;
+			Node& node = nodes[i];
+			node.system = systems[i];
+			node.dependencyCount = 0;
+			node.successorOffset = 0;
+			node.successorCount = 0;
+			node.pendingCount = 0;
+		}
+
+		// Count edges, dependencies outside the graph are ignored
 		for (auto system : systems)
-			remaining.push_back(system);
+		{
+			for (auto d : system->dependencies)
+			{
+				if (d->graph != this)
+					continue;
+
+				nodes[system->nodeIndex].dependencyCount++;
+				nodes[d->nodeIndex].successorCount++;
+			}
+		}
 
-		while (!remaining.empty())
+		U32 offset = 0;
+		for (auto& node : nodes)
 		{
-			for (I32 i = (I32)remaining.size() - 1; i >= 0; i--)
+			node.successorOffset = offset;
+			offset += node.successorCount;
+			node.successorCount = 0;
+		}
+
+		successors.resize(offset);
+		for (auto system : systems)
+		{
+			for (auto d : system->dependencies)
 			{
-				auto system = remaining[i];
-				bool hasDepReady = true;
-				for (auto d : system->dependencies)
-				{
-					if (remaining.indexOf(d) >= 0)
-					{
-						hasDepReady = false;
-						break;
-					}
-				}
-
-				// All dependencies are ready
-				if (hasDepReady)
-				{
-					queue.push_back(system);
-					remaining.eraseAt(i);
-				}
+				if (d->graph != this)
+					continue;
+
+				Node& node = nodes[d->nodeIndex];
+				successors[node.successorOffset + node.successorCount++] = system->nodeIndex;
 			}
+		}
 
-			if (queue.empty())
-				break;
+		roots.clear();
+		for (U32 i = 0; i < nodes.size(); i++)
+		{
+			if (nodes[i].dependencyCount == 0)
+				roots.push_back((I32)i);
+		}
 
-			Jobsystem::JobHandle jobHandle;
-			for (auto system : queue)
-				system->Execute(&jobHandle);
-			queue.clear();
+		// Check cycles, the nodes in a cycle would never be executed
+		Array<I32> pending;
+		Array<I32> stack;
+		pending.resize(nodes.size());
+		for (U32 i = 0; i < nodes.size(); i++)
+			pending[i] = nodes[i].dependencyCount;
+		for (auto root : roots)
+			stack.push_back(root);
 
-			// Wait all jobs
-			Jobsystem::Wait(&jobHandle);
+		U32 visited = 0;
+		while (!stack.empty())
+		{
+			const I32 index = stack.back();
+			stack.pop_back();
+			visited++;
+
+			const Node& node = nodes[index];
+			for (U32 i = 0; i < node.successorCount; i++)
+			{
+				const I32 successor = successors[node.successorOffset + i];
+				if (--pending[successor] == 0)
+					stack.push_back(successor);
+			}
 		}
+
+		if (visited != nodes.size())
+		{
+			Logger::Error("TaskGraph has cyclic dependencies, %d systems are never executed", nodes.size() - visited);
+			for (U32 i = 0; i < nodes.size(); i++)
+			{
+				if (pending[i] > 0)
+					Logger::Error("  System %s is in or behind a cycle", nodes[i].system->GetName());
+			}
+		}
+
+		isDirty = false;
+	}
+
+	void TaskGraph::RunNode(I32 index)
+	{
+		Jobsystem::Run(this, [index](void* data) {
+			static_cast<TaskGraph*>(data)->ExecuteNode(index);
+		}, &executeHandle);
+	}
+
+	void TaskGraph::ExecuteNode(I32 index)
+	{
+		Node& node = nodes[index];
+		{
+			// The block covers the jobs of system, so the critical path could be seen in profiler
+			PROFILE_BLOCK(node.system->GetName());
+			Jobsystem::JobHandle handle;
+			node.system->Execute(&handle);
+			Jobsystem::Wait(&handle);
+		}
+
+		// Start the successors whose dependencies are all finished
+		for (U32 i = 0; i < node.successorCount; i++)
+		{
+			const I32 successor = successors[node.successorOffset + i];
+			if (AtomicDecrement(&nodes[successor].pendingCount) == 0)
+				RunNode(successor);
+		}
+	}
+
+	void TaskGraph::Execute()
+	{
+		PROFILE_FUNCTION();
+
+		if (isDirty)
+			Compile();
+
+		if (roots.empty())
+			return;
+
+		for (auto& node : nodes)
+			AtomicStore(&node.pendingCount, node.dependencyCount);
+
+		// Successors are submitted before their predecessor job finishes,
+		// so the handle is not signaled until all nodes are executed
+		for (auto root : roots)
+			RunNode(root);
+
+		Jobsystem::Wait(&executeHandle);
 	}
 }
\ No newline at end of file
@@ -13,15 +13,24 @@ namespace VulkanTest
 	class VULKAN_TEST_API TaskGraphSystem : public Object
 	{
 	public:
+		virtual ~TaskGraphSystem();
+
 		void AddDependency(TaskGraphSystem* system);
 		virtual void Execute(Jobsystem::JobHandle* handle) = 0;
 
+		// Every system is named, the name is used by profiler blocks and diagnostics of the graph
+		virtual const char* GetName()const = 0;
+
 	private:
 		friend class TaskGraph;
 
 		Array<TaskGraphSystem*> dependencies;
+		TaskGraph* graph = nullptr;
+		I32 nodeIndex = -1;
 	};
 
+	// Systems are compiled into a graph once they are changed.
+	// Each system starts as soon as all of its dependencies are finished.
 	class VULKAN_TEST_API TaskGraph : public Object
 	{
 	public:
@@ -33,8 +42,26 @@ namespace VulkanTest
 		void Execute();
 
 	private:
+		friend class TaskGraphSystem;
+
+		struct Node
+		{
+			TaskGraphSystem* system;
+			I32 dependencyCount;
+			U32 successorOffset;
+			U32 successorCount;
+			volatile I32 pendingCount;
+		};
+
+		void Compile();
+		void RunNode(I32 index);
+		void ExecuteNode(I32 index);
+
 		Array<TaskGraphSystem*> systems;
-		Array<TaskGraphSystem*> remaining;
-		Array<TaskGraphSystem*> queue;
+		Array<Node> nodes;
+		Array<I32> successors;
+		Array<I32> roots;
+		Jobsystem::JobHandle executeHandle;
+		bool isDirty = true;
 	};
 }
\ No newline at end of file
@@ -0,0 +1,100 @@
+#pragma once
+
+#include "core\common.h"
+
+#include <atomic>
+
+namespace VulkanTest
+{
+	// Lock-free single-owner work-stealing deque.
+	// Based on: Chase & Lev, "Dynamic Circular Work-Stealing Deque" and
+	// Le et al., "Correct and Efficient Work-Stealing for Weak Memory Models"
+	//
+	// The owner thread pushes and pops at the bottom (LIFO), other threads steal from the top (FIFO).
+	// The capacity is fixed, Push returns false when the queue is full so the caller can spill elsewhere.
+	template<typename T, U32 Capacity>
+	class WorkStealingQueue
+	{
+	public:
+		static_assert((Capacity & (Capacity - 1)) == 0, "Capacity must be power of two");
+		static_assert(std::is_trivially_copyable<T>::value, "WorkStealingQueue only supports trivially copyable items");
+
+		WorkStealingQueue() = default;
+		WorkStealingQueue(const WorkStealingQueue&) = delete;
+		WorkStealingQueue& operator=(const WorkStealingQueue&) = delete;
+
+		// Only called by owner thread
+		bool Push(const T& item)
+		{
+			const I64 b = bottom.load(std::memory_order_relaxed);
+			const I64 t = top.load(std::memory_order_acquire);
+			if (b - t >= (I64)Capacity)
+				return false;
+
+			items[b & MASK].store(item, std::memory_order_relaxed);
+			std::atomic_thread_fence(std::memory_order_release);
+			bottom.store(b + 1, std::memory_order_relaxed);
+			return true;
+		}
+
+		// Only called by owner thread
+		bool Pop(T& item)
+		{
+			const I64 b = bottom.load(std::memory_order_relaxed) - 1;
+			bottom.store(b, std::memory_order_relaxed);
+			std::atomic_thread_fence(std::memory_order_seq_cst);
+			I64 t = top.load(std::memory_order_relaxed);
+
+			if (t > b)
+			{
+				// Empty queue
+				bottom.store(b + 1, std::memory_order_relaxed);
+				return false;
+			}
+
+			item = items[b & MASK].load(std::memory_order_relaxed);
+			if (t != b)
+				return true;
+
+			// Last item, race against thieves
+			const bool ret = top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed);
+			bottom.store(b + 1, std::memory_order_relaxed);
+			return ret;
+		}
+
+		// Could be called by any thread
+		bool Steal(T& item)
+		{
+			I64 t = top.load(std::memory_order_acquire);
+			std::atomic_thread_fence(std::memory_order_seq_cst);
+			const I64 b = bottom.load(std::memory_order_acquire);
+			if (t >= b)
+				return false;
+
+			item = items[t & MASK].load(std::memory_order_relaxed);
+			return top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed);
+		}
+
+		bool Empty()const
+		{
+			const I64 b = bottom.load(std::memory_order_relaxed);
+			const I64 t = top.load(std::memory_order_relaxed);
+			return b <= t;
+		}
+
+		I32 Count()const
+		{
+			const I64 b = bottom.load(std::memory_order_relaxed);
+			const I64 t = top.load(std::memory_order_relaxed);
+			return b > t ? (I32)(b - t) : 0;
+		}
+
+	private:
+		static constexpr I64 MASK = Capacity - 1;
+
+		// Keep the owner and thieves cursors on different cache lines
+		alignas(64) std::atomic<I64> top{ 0 };
+		alignas(64) std::atomic<I64> bottom{ 0 };
+		alignas(64) std::atomic<T> items[Capacity];
+	};
+}
\ No newline at end of file
@@ -76,6 +76,15 @@ namespace VulkanTest {
             return ((left.A ^ right.A) | (left.B ^ right.B) | (left.C ^ right.C) | (left.D ^ right.D)) != 0;
         }
 
+        // Ordering used by sorted tables of contents
+        friend bool operator<(const Guid& left, const Guid& right)
+        {
+            if (left.A != right.A) return left.A < right.A;
+            if (left.B != right.B) return left.B < right.B;
+            if (left.C != right.C) return left.C < right.C;
+            return left.D < right.D;
+        }
+
         inline U64 GetHash()const {
             return A ^ B ^ C ^ D;
         }
@@ -4,6 +4,16 @@
 
 namespace VulkanTest
 {
+	// Codec of the chunk data in the storage file
+	enum class ChunkCodec : U8
+	{
+		None = 0,
+		LZ4,
+		LZ4Dict,	// LZ4 with the dictionary of the storage file, for small chunks sharing similar content
+		LZ4Blocks,	// Independent LZ4 blocks with a block table, for large chunks decompressed in parallel
+		Count
+	};
+
 	struct VULKAN_TEST_API DataChunk
 	{
 	public:
@@ -15,7 +25,9 @@ namespace VulkanTest
 		Location location;
 		U64 LastAccessTime = 0;
 		OutputMemoryStream mem;
-		bool compressed = false;
+		ChunkCodec codec = ChunkCodec::None;
+		// The memory is a view into the mapped storage file
+		bool mapped = false;
 
 	public:
 		U8* Data() {
@@ -36,6 +48,21 @@ namespace VulkanTest
 
 		void Unload() {
 			mem.Free();
+			mapped = false;
+		}
+
+		// Link the chunk to the memory owned by others, the memory must outlive the chunk data
+		void LinkMapped(const U8* data, U64 size) {
+			mem.Link(data, size);
+			mapped = true;
+		}
+
+		bool IsMapped()const {
+			return mapped && mem.Size() > 0;
+		}
+
+		bool IsCompressed()const {
+			return codec != ChunkCodec::None;
 		}
 
 		bool IsMissing() const {
@@ -1,11 +1,14 @@
 #include "log.h"
 #include "platform\platform.h"
+#include "core\platform\sync.h"
 
 #include <mutex>
+#include <atomic>
+#include <thread>
 #include <stdarg.h>
 #include <iostream>
 #include <vector>
-#include <array>
+#include <algorithm>
 
 namespace VulkanTest
 {
@@ -47,38 +50,398 @@ namespace Logger
 		}
 #endif
 
+		static const U32 RING_SIZE = 64 * 1024;
+		static const U32 MAX_RECORD_SIZE = RING_SIZE / 4;	// Larger records are dispatched synchronously
+		static const U32 FORMAT_BUFFER_SIZE = 4 * 1024;
+
+		enum class RecordType : U8
+		{
+			TEXT,
+			DEFERRED,
+			PADDING
+		};
+
+		struct RecordHeader
+		{
+			U64 sequence;
+			U32 size;	// Including header, aligned to 8 bytes
+			LogLevel level;
+			RecordType type;
+			DeferredFormatFunc func;
+			const char* fmt;
+		};
+		static_assert(sizeof(RecordHeader) % 8 == 0);
+
+		// Single-producer single-consumer ring of records, the owner thread pushes and the consumer pops
+		struct LogRing
+		{
+			alignas(64) std::atomic<U64> head = 0;
+			alignas(64) std::atomic<U64> tail = 0;
+			std::atomic<U64> dropped = 0;
+			std::atomic<bool> isOrphaned = false;
+			alignas(64) U8 data[RING_SIZE];
+		};
+
 		struct LogContext
 		{
-			static const int BUFFER_SIZE = 64 * 1024;
-			std::array<char, BUFFER_SIZE> buffer_ = {};
+			LogRing* ring = nullptr;
+			char buffer[FORMAT_BUFFER_SIZE];
+		};
+		thread_local LogContext mLogContext;
 
-			LogContext() {
-				buffer_.fill('\0');
+		// Rings of exited threads are released by the consumer after drained
+		struct LogRingGuard
+		{
+			~LogRingGuard()
+			{
+				if (mLogContext.ring != nullptr)
+					mLogContext.ring->isOrphaned.store(true, std::memory_order_release);
+				mLogContext.ring = nullptr;
 			}
 		};
-		thread_local LogContext mLogContext;
+		thread_local LogRingGuard mLogRingGuard;
+
+		class LogWriter : public Thread
+		{
+		public:
+			int Task() override;
+
+			std::atomic<bool> isRunning = true;
+		};
 
 		struct LoggerImpl
 		{
-			std::mutex mMutex;
+			std::mutex mMutex;		// Sinks
 			bool mDisplayTime = false;
 			std::vector<LoggerSink*> mSinks; // DynamicArray<LoggerSink*>
+
+			std::mutex mRingsMutex;
+			std::vector<LogRing*> mRings;
+			std::mutex mDrainMutex;	// Only one consumer drains rings at a time
+			std::atomic<U64> mSequence = 0;
+			std::atomic<bool> mIsAsync = false;
+			LogWriter* mWriter = nullptr;
 		};
 		static LoggerImpl mImpl;
 
-		void LogImpl(LogLevel level, const char* msg, va_list args)
+		struct PendingRecord
+		{
+			U64 sequence;
+			const RecordHeader* header;
+		};
+		std::vector<PendingRecord> mPendingRecords;	// Guarded by mDrainMutex
+		std::vector<LogRing*> mDrainRings;			// Guarded by mDrainMutex
+		std::vector<U64> mDrainedTails;				// Guarded by mDrainMutex
+		std::vector<bool> mOrphanedRings;			// Guarded by mDrainMutex
+		char mDrainBuffer[FORMAT_BUFFER_SIZE];		// Guarded by mDrainMutex
+
+		// Current thread is calling sinks, logs of sinks must not dispatch again
+		thread_local bool mIsDispatching = false;
+
+		void DispatchSync(LogLevel level, const char* msg)
 		{
-			vsprintf_s(mLogContext.buffer_.data(), mLogContext.buffer_.size(), msg, args);
+			std::lock_guard lock(mImpl.mMutex);
+			mIsDispatching = true;
+			for (auto sink : mImpl.mSinks) {
+				sink->Log(level, msg);
+			}
+			mIsDispatching = false;
+		}
+
+		LogRing* GetThreadRing()
+		{
+			LogRing* ring = mLogContext.ring;
+			if (ring == nullptr)
+			{
+				(void)&mLogRingGuard;
+				ring = new LogRing();
+				std::lock_guard lock(mImpl.mRingsMutex);
+				mImpl.mRings.push_back(ring);
+				mLogContext.ring = ring;
+			}
+			return ring;
+		}
+
+		bool PushRecord(LogRing& ring, LogLevel level, RecordType type, DeferredFormatFunc func, const char* fmt, const void* payload, U32 payloadSize)
+		{
+			const U32 size = (U32)(sizeof(RecordHeader) + payloadSize + 7) & ~7u;
+			const U64 head = ring.head.load(std::memory_order_relaxed);
+			const U64 tail = ring.tail.load(std::memory_order_acquire);
+
+			// Records are contiguous, skip the end of ring if the record doesn't fit
+			U32 offset = (U32)(head % RING_SIZE);
+			const U32 contiguous = RING_SIZE - offset;
+			const U32 skipped = contiguous < size ? contiguous : 0;
+			if (head - tail + skipped + size > RING_SIZE)
+				return false;
+
+			if (skipped > 0)
+			{
+				// Consumer skips the tail implicitly if there is no space for a header
+				if (skipped >= sizeof(RecordHeader))
+				{
+					RecordHeader* padding = (RecordHeader*)&ring.data[offset];
+					padding->size = skipped;
+					padding->type = RecordType::PADDING;
+				}
+				offset = 0;
+			}
+
+			RecordHeader* header = (RecordHeader*)&ring.data[offset];
+			header->sequence = mImpl.mSequence.fetch_add(1, std::memory_order_relaxed);
+			header->size = size;
+			header->level = level;
+			header->type = type;
+			header->func = func;
+			header->fmt = fmt;
+			memcpy(header + 1, payload, payloadSize);
+
+			ring.head.store(head + skipped + size, std::memory_order_release);
+			return true;
+		}
+
+		void Push(LogLevel level, RecordType type, DeferredFormatFunc func, const char* fmt, const void* payload, U32 payloadSize)
+		{
+			LogRing& ring = *GetThreadRing();
+			while (!PushRecord(ring, level, type, func, fmt, payload, payloadSize))
+			{
+				// Bounded-drop policy, only keep warnings and errors when the ring is full.
+				// Logs of sinks never wait, the current thread may be the one draining the ring.
+				if (level < LogLevel::LVL_WARNING || mIsDispatching || !mImpl.mIsAsync.load(std::memory_order_acquire))
+				{
+					ring.dropped.fetch_add(1, std::memory_order_relaxed);
+					return;
+				}
+				std::this_thread::yield();
+			}
+		}
+
+		void DispatchRecord(const RecordHeader& header)
+		{
+			const char* msg = (const char*)(&header + 1);
+			if (header.type == RecordType::DEFERRED)
+			{
+				header.func(mDrainBuffer, sizeof(mDrainBuffer), header.fmt, &header + 1);
+				msg = mDrainBuffer;
+			}
+
+			for (auto sink : mImpl.mSinks) {
+				sink->Log(header.level, msg);
+			}
+		}
+
+		// Dispatch the records of all rings in the order they were pushed
+		void Drain()
+		{
+			// Logs of sinks are dispatched by the next drain
+			if (mIsDispatching)
+				return;
+
+			std::lock_guard drainLock(mImpl.mDrainMutex);
+
+			// Rings are only released by the drain, so the list is copied and sinks are called without the lock,
+			// sinks can log and new threads can register their rings while dispatching
+			{
+				std::lock_guard ringsLock(mImpl.mRingsMutex);
+				mDrainRings = mImpl.mRings;
+			}
+
+			U64 dropped = 0;
+			mPendingRecords.clear();
+			mDrainedTails.clear();
+			mOrphanedRings.clear();
+			for (auto ring : mDrainRings)
+			{
+				// Orphaned rings never get new records, check before reading the head
+				mOrphanedRings.push_back(ring->isOrphaned.load(std::memory_order_acquire));
+				dropped += ring->dropped.exchange(0, std::memory_order_relaxed);
+
+				const U64 head = ring->head.load(std::memory_order_acquire);
+				U64 tail = ring->tail.load(std::memory_order_relaxed);
+				while (tail < head)
+				{
+					const U32 offset = (U32)(tail % RING_SIZE);
+					const U32 contiguous = RING_SIZE - offset;
+					if (contiguous < sizeof(RecordHeader))
+					{
+						tail += contiguous;
+						continue;
+					}
+
+					const RecordHeader* header = (const RecordHeader*)&ring->data[offset];
+					if (header->type != RecordType::PADDING)
+						mPendingRecords.push_back({ header->sequence, header });
+					tail += header->size;
+				}
+				mDrainedTails.push_back(tail);
+			}
+
+			std::sort(mPendingRecords.begin(), mPendingRecords.end(), [](const PendingRecord& a, const PendingRecord& b) {
+				return a.sequence < b.sequence;
+			});
+
 			{
 				std::lock_guard lock(mImpl.mMutex);
-				for (auto sink : mImpl.mSinks) {
-					sink->Log(level, mLogContext.buffer_.data());
+				mIsDispatching = true;
+				for (const auto& record : mPendingRecords)
+					DispatchRecord(*record.header);
+
+				if (dropped > 0)
+				{
+					snprintf(mDrainBuffer, sizeof(mDrainBuffer), "%llu log messages were dropped", (unsigned long long)dropped);
+					for (auto sink : mImpl.mSinks) {
+						sink->Log(LogLevel::LVL_WARNING, mDrainBuffer);
+					}
+				}
+				mIsDispatching = false;
+			}
+
+			// Release the dispatched records
+			bool hasOrphanedRings = false;
+			for (size_t i = 0; i < mDrainRings.size(); i++)
+			{
+				mDrainRings[i]->tail.store(mDrainedTails[i], std::memory_order_release);
+				hasOrphanedRings |= mOrphanedRings[i];
+			}
+
+			// Release the drained rings of exited threads
+			if (hasOrphanedRings)
+			{
+				std::lock_guard ringsLock(mImpl.mRingsMutex);
+				for (size_t i = 0; i < mDrainRings.size(); i++)
+				{
+					if (!mOrphanedRings[i])
+						continue;
+
+					auto it = std::find(mImpl.mRings.begin(), mImpl.mRings.end(), mDrainRings[i]);
+					*it = mImpl.mRings.back();
+					mImpl.mRings.pop_back();
+					delete mDrainRings[i];
 				}
 			}
-			mLogContext.buffer_.fill('\0');
 		}
+
+		int LogWriter::Task()
+		{
+			while (isRunning.load(std::memory_order_acquire))
+			{
+				Drain();
+				Platform::Sleep(0.002f);
+			}
+			Drain();
+			return 0;
+		}
+
+		void LogImpl(LogLevel level, const char* msg, va_list args)
+		{
+			char* buffer = mLogContext.buffer;
+			va_list argsCopy;
+			va_copy(argsCopy, args);
+			const int length = vsnprintf(buffer, FORMAT_BUFFER_SIZE, msg, argsCopy);
+			va_end(argsCopy);
+			if (length < 0)
+				return;
+
+			// Format large message again into a temporary buffer
+			std::vector<char> largeBuffer;
+			if (length >= (int)FORMAT_BUFFER_SIZE)
+			{
+				largeBuffer.resize((size_t)length + 1);
+				vsnprintf(largeBuffer.data(), largeBuffer.size(), msg, args);
+				buffer = largeBuffer.data();
+			}
+
+			const U32 payloadSize = (U32)length + 1;
+			const bool fitsRecord = sizeof(RecordHeader) + payloadSize <= MAX_RECORD_SIZE;
+
+			// Logs of sinks are queued, dispatching them here would call sinks recursively
+			if (mIsDispatching)
+			{
+				if (fitsRecord)
+					Push(level, RecordType::TEXT, nullptr, nullptr, buffer, payloadSize);
+				return;
+			}
+
+			// Errors are dispatched before returning, so the message is not lost if the process aborts right after
+			const bool isAsync = mImpl.mIsAsync.load(std::memory_order_acquire);
+			if (isAsync && level < LogLevel::LVL_ERROR && fitsRecord)
+			{
+				Push(level, RecordType::TEXT, nullptr, nullptr, buffer, payloadSize);
+				return;
+			}
+
+			// Keep the order with the pending records
+			if (isAsync)
+				Drain();
+			DispatchSync(level, buffer);
+		}
+	}
+
+	void LogDeferredImpl(LogLevel level, const char* fmt, DeferredFormatFunc func, const void* args, size_t argsSize)
+	{
+		const bool fitsRecord = sizeof(RecordHeader) + argsSize <= MAX_RECORD_SIZE;
+		if (mIsDispatching)
+		{
+			if (fitsRecord)
+				Push(level, RecordType::DEFERRED, func, fmt, args, (U32)argsSize);
+			return;
+		}
+
+		const bool isAsync = mImpl.mIsAsync.load(std::memory_order_acquire);
+		if (isAsync && level < LogLevel::LVL_ERROR && fitsRecord)
+		{
+			Push(level, RecordType::DEFERRED, func, fmt, args, (U32)argsSize);
+			return;
+		}
+
+		if (isAsync)
+			Drain();
+		func(mLogContext.buffer, FORMAT_BUFFER_SIZE, fmt, args);
+		DispatchSync(level, mLogContext.buffer);
+	}
+
+	void StartAsync()
+	{
+		if (mImpl.mWriter != nullptr)
+			return;
+
+		LogWriter* writer = new LogWriter();
+		if (!writer->Create("Logger"))
+		{
+			delete writer;
+			return;
+		}
+
+		mImpl.mWriter = writer;
+		mImpl.mIsAsync.store(true, std::memory_order_release);
+	}
+
+	void StopAsync()
+	{
+		if (mImpl.mWriter == nullptr)
+			return;
+
+		mImpl.mIsAsync.store(false, std::memory_order_release);
+		mImpl.mWriter->isRunning.store(false, std::memory_order_release);
+		mImpl.mWriter->Join();
+		mImpl.mWriter->Destroy();
+		delete mImpl.mWriter;
+		mImpl.mWriter = nullptr;
+
+		// Records pushed while stopping
+		Drain();
+	}
+
+	bool IsAsync()
+	{
+		return mImpl.mIsAsync.load(std::memory_order_acquire);
 	}
-	
+
+	void Flush()
+	{
+		Drain();
+	}
+
 	void SetIsDisplayTime(bool displayTime)
 	{
 		mImpl.mDisplayTime = displayTime;
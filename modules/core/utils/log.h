@@ -1,5 +1,9 @@
 #pragma once
 
+#include <cstdio>
+#include <tuple>
+#include <type_traits>
+
 namespace VulkanTest
 {
 enum class LogLevel
@@ -31,6 +35,37 @@ namespace Logger
 	void Warning(const char* msg, ...);
 	void Error(const char* msg, ...);
 	const char* GetPrefix(LogLevel level);
+
+	// Records are pushed into a ring of the calling thread and dispatched to sinks by a background thread.
+	// When a ring is full, dev and info records are dropped, warnings wait for space.
+	// Errors are dispatched synchronously after the pending records, so they are not lost by a following abort.
+	// Logs of sinks are queued and dispatched by the next drain.
+	void StartAsync();
+	void StopAsync();
+	bool IsAsync();
+	// Dispatch all pending records on the calling thread, used before the process exits abnormally
+	void Flush();
+
+	using DeferredFormatFunc = int(*)(char* buffer, size_t size, const char* fmt, const void* args);
+	void LogDeferredImpl(LogLevel level, const char* fmt, DeferredFormatFunc func, const void* args, size_t argsSize);
+
+	// Only the format pointer and arguments are captured, formatting is done by the background thread.
+	// Only arithmetic and pointer arguments are supported, the format and string arguments must be static.
+	template<typename... Args>
+	void LogDeferred(LogLevel level, const char* fmt, const Args&... args)
+	{
+		static_assert(((std::is_arithmetic_v<Args> || std::is_pointer_v<Args>) && ...), "Unsupported argument type of deferred log");
+
+		using Tuple = std::tuple<Args...>;
+		static_assert(alignof(Tuple) <= 8, "Unsupported argument alignment of deferred log");
+
+		const Tuple tuple(args...);
+		LogDeferredImpl(level, fmt, [](char* buffer, size_t size, const char* fmt, const void* data) {
+			return std::apply([&](const Args&... args) {
+				return snprintf(buffer, size, fmt, args...);
+			}, *static_cast<const Tuple*>(data));
+		}, &tuple, sizeof(Tuple));
+	}
 }
 
 class StdoutLoggerSink : public LoggerSink
@@ -0,0 +1,124 @@
+#include "allocatorBenchmark.h"
+#include "core\memory\allocators.h"
+#include "core\platform\atomic.h"
+#include "core\platform\timer.h"
+
+namespace VulkanTest
+{
+namespace Editor
+{
+	// Alloc/free pairs of each thread
+	static const U32 OPERATION_COUNT = 1024 * 1024;
+	// Count of live allocations of each thread, the oldest is freed before a new allocation
+	static const U32 LIVE_COUNT = 64;
+	// Sizes cover the small size classes (8 to 512 bytes)
+	static const U32 MAX_ALLOCATION_SIZE = 512;
+
+	class StressThread final : public Thread
+	{
+	public:
+		IAllocator* allocator = nullptr;
+		U32 seed = 1;
+		volatile I32* start = nullptr;
+
+		int Task() override
+		{
+			void* allocations[LIVE_COUNT] = {};
+			while (AtomicRead(start) == 0) {}
+
+			// Xorshift, so that the sizes are not the same among threads
+			U32 state = seed;
+			for (U32 i = 0; i < OPERATION_COUNT; i++)
+			{
+				state ^= state << 13;
+				state ^= state >> 17;
+				state ^= state << 5;
+				const size_t size = 8 + state % (MAX_ALLOCATION_SIZE - 7);
+
+				void*& allocation = allocations[i % LIVE_COUNT];
+				if (allocator != nullptr)
+				{
+					allocator->Free(allocation);
+					allocation = allocator->Allocate(size);
+				}
+				else
+				{
+					free(allocation);
+					allocation = malloc(size);
+				}
+				// Touch the memory like a real object
+				*static_cast<U8*>(allocation) = (U8)i;
+			}
+
+			for (void* allocation : allocations)
+			{
+				if (allocator != nullptr)
+					allocator->Free(allocation);
+				else
+					free(allocation);
+			}
+			return 0;
+		}
+	};
+
+	// Return the operations per second of all threads
+	static F32 RunStress(IAllocator* allocator, U32 threadCount)
+	{
+		volatile I32 start = 0;
+		Array<StressThread*> threads;
+		for (U32 i = 0; i < threadCount; i++)
+		{
+			StressThread* thread = CJING_NEW(StressThread);
+			thread->allocator = allocator;
+			thread->seed = 0x9E3779B9u * (i + 1);
+			thread->start = &start;
+			if (!thread->Create("AllocatorStress"))
+			{
+				CJING_SAFE_DELETE(thread);
+				break;
+			}
+			threads.push_back(thread);
+		}
+
+		Timer timer;
+		AtomicStore(&start, 1);
+		for (auto thread : threads)
+			thread->Join();
+		const F32 time = timer.GetTimeSinceStart();
+
+		for (auto thread : threads)
+		{
+			thread->Destroy();
+			CJING_SAFE_DELETE(thread);
+		}
+		return (F32)threads.size() * OPERATION_COUNT / time;
+	}
+
+	bool AllocatorBenchmark::Run()
+	{
+		PROFILE_FUNCTION();
+		const U32 cpuCount = (U32)Platform::GetCPUsCount();
+		Logger::Info("Allocator stress: %d alloc/free pairs per thread, sizes 8-%d bytes, %d live allocations",
+			OPERATION_COUNT,
+			MAX_ALLOCATION_SIZE,
+			LIVE_COUNT);
+
+		for (U32 threadCount = 1; threadCount <= cpuCount; threadCount *= 2)
+		{
+			// A new allocator for each run, so the thread caches start empty
+			DefaultAllocator* allocator = CJING_NEW(DefaultAllocator);
+			const F32 allocatorOps = RunStress(allocator, threadCount);
+			CJING_SAFE_DELETE(allocator);
+			const F32 mallocOps = RunStress(nullptr, threadCount);
+
+			Logger::Info("%2d threads: DefaultAllocator %.2f Mops/s (%.2f per thread), malloc %.2f Mops/s (%.2f per thread)",
+				threadCount,
+				allocatorOps / 1000000.0f,
+				allocatorOps / threadCount / 1000000.0f,
+				mallocOps / 1000000.0f,
+				mallocOps / threadCount / 1000000.0f);
+		}
+		return true;
+	}
+}
+}
\ No newline at end of file
@@ -0,0 +1,17 @@
+#pragma once
+
+#include "editor\common.h"
+
+namespace VulkanTest
+{
+namespace Editor
+{
+	// Multi-threaded alloc/free stress of DefaultAllocator against malloc
+	class VULKAN_EDITOR_API AllocatorBenchmark
+	{
+	public:
+		// Alloc/free operations per second for 1 to N threads, where N is the count of CPUs
+		static bool Run();
+	};
+}
+}
\ No newline at end of file
@@ -0,0 +1,73 @@
+#include "benchmarks.h"
+#include "jobsystemBenchmark.h"
+#include "allocatorBenchmark.h"
+#include "profilerBenchmark.h"
+#include "logBenchmark.h"
+#include "bvhBenchmark.h"
+#include "cullBenchmark.h"
+#include "renderQueueBenchmark.h"
+#include "sceneUpdateBenchmark.h"
+#include "blockCompressionBenchmark.h"
+#include "codecBenchmark.h"
+#include "storageBenchmark.h"
+
+namespace VulkanTest
+{
+namespace Editor
+{
+	struct BenchmarkEntry
+	{
+		const char* name;
+		const char* description;
+		bool (*run)();
+	};
+
+	static const BenchmarkEntry BENCHMARKS[] = {
+		{ "jobs", "Throughput of empty jobs on the work-stealing scheduler", JobsystemBenchmark::RunThroughput },
+		{ "jobhandle", "Contention of empty jobs finishing on one shared handle", JobsystemBenchmark::RunHandleContention },
+		{ "alloc", "Multi-threaded alloc/free stress of DefaultAllocator", AllocatorBenchmark::Run },
+		{ "profiler", "Overhead of profiler blocks", ProfilerBenchmark::Run },
+		{ "log", "Throughput of formatted and deferred log lines", LogBenchmark::Run },
+		{ "bvh", "Frustum and ray queries of the scene BVH against a linear scan", BVHBenchmark::Run },
+		{ "cull", "Frustum culling of 1M packed boxes against the scalar box test", CullBenchmark::Run },
+		{ "renderqueue", "Parallel build and radix sort of render queues against std::sort", RenderQueueBenchmark::Run },
+		{ "sceneupdate", "Records written by render scene updates of mostly static objects", SceneUpdateBenchmark::Run },
+		{ "bc", "Speed and PSNR of the block compression encoders", BlockCompressionBenchmark::Run },
+		{ "codec", "Ratio and speed of chunk codecs over the content", CodecBenchmark::Run },
+		{ "storageio", "MB/s of loading all chunks with each storage read mode", StorageBenchmark::RunIO },
+		{ "storagecopy", "Copied bytes and working set of loading a large model, file stream and mapped", StorageBenchmark::RunChunkCopies },
+		{ "packages", "File opens and load time of the content from the per-file layout and from a package", StorageBenchmark::RunPackages },
+		{ "codectest", "Round trips of every LZ4 and LZ4HC level over generated data", CodecBenchmark::RunRoundTrips },
+	};
+
+	bool Benchmarks::Run(const char* name)
+	{
+		PROFILE_FUNCTION();
+		const bool runAll = EqualString(name, "all");
+		bool found = false;
+		bool ret = true;
+		for (const auto& benchmark : BENCHMARKS)
+		{
+			if (!runAll && !EqualString(benchmark.name, name))
+				continue;
+
+			found = true;
+			Logger::Info("Benchmark %s: %s", benchmark.name, benchmark.description);
+			if (!benchmark.run())
+			{
+				Logger::Error("Benchmark %s failed", benchmark.name);
+				ret = false;
+			}
+		}
+
+		if (!found)
+		{
+			Logger::Error("Unknown benchmark %s, available benchmarks:", name);
+			for (const auto& benchmark : BENCHMARKS)
+				Logger::Info("  %s: %s", benchmark.name, benchmark.description);
+			return false;
+		}
+		return ret;
+	}
+}
+}
\ No newline at end of file
@@ -0,0 +1,17 @@
+#pragma once
+
+#include "editor\common.h"
+
+namespace VulkanTest
+{
+namespace Editor
+{
+	// Command line benchmarks (-bench <name>), the results are written into the log
+	class VULKAN_EDITOR_API Benchmarks
+	{
+	public:
+		// Run the benchmark of the name, "all" runs every benchmark
+		static bool Run(const char* name);
+	};
+}
+}
\ No newline at end of file
@@ -0,0 +1,144 @@
+#include "blockCompressionBenchmark.h"
+#include "contentImporters\texture\blockCompression.h"
+#include "core\threading\jobsystem.h"
+#include "core\platform\timer.h"
+
+namespace VulkanTest
+{
+namespace Editor
+{
+	static const U32 IMAGE_SIZE = 1024;
+	static const U32 RUN_COUNT = 3;
+
+	struct FormatInfo
+	{
+		BlockCompression::Format format;
+		const char* name;
+		U32 channelCount;	// Channels compared by PSNR
+		bool isNormalMap;
+	};
+
+	static const FormatInfo FORMATS[] = {
+		{ BlockCompression::Format::BC1, "BC1", 3, false },
+		{ BlockCompression::Format::BC3, "BC3", 4, false },
+		{ BlockCompression::Format::BC4, "BC4", 1, false },
+		{ BlockCompression::Format::BC5, "BC5", 2, true },
+		{ BlockCompression::Format::BC7, "BC7", 4, false },
+	};
+
+	static const char* QUALITY_NAMES[] = { "Fast", "Normal", "High" };
+
+	// Smooth gradients, hard edges and noise, so every kind of block is covered
+	static void GenerateColorImage(Array<U8>& image)
+	{
+		U32 state = 0x9E3779B9u;
+		image.resize(IMAGE_SIZE * IMAGE_SIZE * 4);
+		for (U32 y = 0; y < IMAGE_SIZE; y++)
+		{
+			for (U32 x = 0; x < IMAGE_SIZE; x++)
+			{
+				state ^= state << 13;
+				state ^= state >> 17;
+				state ^= state << 5;
+				const I32 noise = (I32)(state & 15) - 8;
+				U8* pixel = image.data() + (y * IMAGE_SIZE + x) * 4;
+				pixel[0] = (U8)std::clamp(128 + (I32)(127.0f * sinf(x * 0.02f)) + noise, 0, 255);
+				pixel[1] = (U8)std::clamp(128 + (I32)(127.0f * cosf(y * 0.03f)) + noise, 0, 255);
+				pixel[2] = (U8)(((x / 32) ^ (y / 32)) & 1 ? 224 : 32);
+				pixel[3] = (U8)((x + y) / 8);
+			}
+		}
+	}
+
+	// Tangent space normals of a height field
+	static void GenerateNormalMap(Array<U8>& image)
+	{
+		image.resize(IMAGE_SIZE * IMAGE_SIZE * 4);
+		for (U32 y = 0; y < IMAGE_SIZE; y++)
+		{
+			for (U32 x = 0; x < IMAGE_SIZE; x++)
+			{
+				const F32 dx = 0.4f * cosf(x * 0.05f) * cosf(y * 0.03f);
+				const F32 dy = -0.24f * sinf(x * 0.05f) * sinf(y * 0.03f);
+				const F32 invLen = 1.0f / sqrtf(dx * dx + dy * dy + 1.0f);
+				U8* pixel = image.data() + (y * IMAGE_SIZE + x) * 4;
+				pixel[0] = (U8)((-dx * invLen * 0.5f + 0.5f) * 255.0f + 0.5f);
+				pixel[1] = (U8)((-dy * invLen * 0.5f + 0.5f) * 255.0f + 0.5f);
+				pixel[2] = (U8)((invLen * 0.5f + 0.5f) * 255.0f + 0.5f);
+				pixel[3] = 255;
+			}
+		}
+	}
+
+	static F32 ComputePSNR(const Array<U8>& image, const U8* compressed, const FormatInfo& info)
+	{
+		const U32 blocksX = IMAGE_SIZE / 4;
+		const U32 blockSize = BlockCompression::GetBlockSize(info.format);
+		F64 error = 0.0;
+		U8 pixels[16 * 4];
+		for (U32 blockY = 0; blockY < IMAGE_SIZE / 4; blockY++)
+		{
+			for (U32 blockX = 0; blockX < blocksX; blockX++)
+			{
+				BlockCompression::DecompressBlock(info.format, compressed + (blockY * blocksX + blockX) * blockSize, pixels);
+				for (U32 i = 0; i < 16; i++)
+				{
+					const U8* src = image.data() + ((blockY * 4 + i / 4) * IMAGE_SIZE + blockX * 4 + i % 4) * 4;
+					for (U32 c = 0; c < info.channelCount; c++)
+					{
+						const F64 diff = (F64)src[c] - pixels[i * 4 + c];
+						error += diff * diff;
+					}
+				}
+			}
+		}
+
+		const F64 mse = error / ((F64)IMAGE_SIZE * IMAGE_SIZE * info.channelCount);
+		return mse > 0.0 ? (F32)(10.0 * log10(255.0 * 255.0 / mse)) : 99.0f;
+	}
+
+	bool BlockCompressionBenchmark::Run()
+	{
+		PROFILE_FUNCTION();
+		Array<U8> colorImage;
+		Array<U8> normalMap;
+		GenerateColorImage(colorImage);
+		GenerateNormalMap(normalMap);
+
+		Logger::Info("Block compression: %dx%d images, %d workers, BC5 uses a normal map", IMAGE_SIZE, IMAGE_SIZE, Jobsystem::GetWorkersCount());
+		const U32 blockRows = IMAGE_SIZE / 4;
+		Array<U8> compressed;
+		for (const FormatInfo& info : FORMATS)
+		{
+			const Array<U8>& image = info.isNormalMap ? normalMap : colorImage;
+			const U64 rowSize = (U64)(IMAGE_SIZE / 4) * BlockCompression::GetBlockSize(info.format);
+			compressed.resize((U32)(rowSize * blockRows));
+
+			for (U32 quality = 0; quality < LengthOf(QUALITY_NAMES); quality++)
+			{
+				// Rows of blocks are compressed in parallel like the texture importer
+				F32 bestTime = FLT_MAX;
+				for (U32 run = 0; run < RUN_COUNT; run++)
+				{
+					Timer timer;
+					Jobsystem::ForEach(blockRows, 1, [&](U32 beginRow, U32 endRow) {
+						for (U32 row = beginRow; row < endRow; row++)
+						{
+							BlockCompression::CompressBlockRow(info.format, (BlockCompression::Quality)quality,
+								image.data(), IMAGE_SIZE, IMAGE_SIZE, row, compressed.data() + row * rowSize);
+						}
+					});
+					bestTime = std::min(bestTime, timer.GetTimeSinceStart());
+				}
+
+				Logger::Info("%s %-6s: %7.1f MPix/s, PSNR %.2f dB",
+					info.name,
+					QUALITY_NAMES[quality],
+					(F32)IMAGE_SIZE * IMAGE_SIZE / bestTime / 1000000.0f,
+					ComputePSNR(image, compressed.data(), info));
+			}
+		}
+		return true;
+	}
+}
+}
\ No newline at end of file
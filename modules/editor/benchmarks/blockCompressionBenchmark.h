@@ -0,0 +1,17 @@
+#pragma once
+
+#include "editor\common.h"
+
+namespace VulkanTest
+{
+namespace Editor
+{
+	// Speed and quality of the block compression encoders
+	class VULKAN_EDITOR_API BlockCompressionBenchmark
+	{
+	public:
+		// MPix/s and PSNR of each format and quality on synthetic images
+		static bool Run();
+	};
+}
+}
\ No newline at end of file
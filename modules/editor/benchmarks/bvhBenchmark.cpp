@@ -0,0 +1,131 @@
+#include "bvhBenchmark.h"
+#include "renderer\sceneBVH.h"
+#include "core\platform\timer.h"
+
+namespace VulkanTest
+{
+namespace Editor
+{
+	static const U32 SCENE_SIZES[] = { 10 * 1000, 100 * 1000, 500 * 1000 };
+	static const U32 RAY_COUNT = 256;
+	static const U32 RUN_COUNT = 5;
+	// The density of boxes is the same in all scenes, so the visible count does not grow with the scene
+	static const F32 SPACE_PER_BOX = 1000.0f;
+	static const F32 FAR_DISTANCE = 200.0f;
+	static const F32 RAY_LENGTH = 100.0f;
+
+	static F32 Random(U32& state)
+	{
+		state ^= state << 13;
+		state ^= state >> 17;
+		state ^= state << 5;
+		return (F32)(state & 0xFFFFFF) / (F32)0xFFFFFF;
+	}
+
+	static void RunScene(U32 boxCount)
+	{
+		// Boxes of 1 to 4 meters in a cube around the origin
+		const F32 extent = std::cbrt(SPACE_PER_BOX * boxCount) * 0.5f;
+		U32 state = 0x9E3779B9u;
+		Array<AABB> boxes;
+		boxes.resize(boxCount);
+		for (auto& box : boxes)
+		{
+			const F32x3 center(
+				(Random(state) * 2.0f - 1.0f) * extent,
+				(Random(state) * 2.0f - 1.0f) * extent,
+				(Random(state) * 2.0f - 1.0f) * extent);
+			const F32 halfWidth = 0.5f + Random(state) * 1.5f;
+			box = AABB::CreateFromHalfWidth(center, F32x3(halfWidth));
+		}
+
+		Timer timer;
+		SceneBVH bvh;
+		for (const auto& box : boxes)
+			bvh.CreateProxy(box, ECS::INVALID_ENTITY);
+		const F32 buildTime = timer.GetTimeSinceStart();
+
+		Frustum frustum;
+		const MATRIX view = MatrixLookToLH(VectorSet(0, 0, 0, 1), VectorSet(0, 0, 1, 0), VectorSet(0, 1, 0, 0));
+		const MATRIX projection = MatrixPerspectiveFovLH(MATH_PIDIV4, 16.0f / 9.0f, FAR_DISTANCE, 0.1f);
+		frustum.Compute(MatrixMultiply(view, projection));
+
+		// Frustum queries, boxes of intersecting subtrees are tested like the culling does
+		F32 bvhFrustumTime = FLT_MAX;
+		F32 linearFrustumTime = FLT_MAX;
+		U32 bvhVisible = 0;
+		U32 linearVisible = 0;
+		for (U32 run = 0; run < RUN_COUNT; run++)
+		{
+			bvhVisible = 0;
+			timer.Tick();
+			bvh.QueryFrustum(frustum, [&](I32 proxy, bool fullyInside) {
+				if (fullyInside || frustum.CheckBoxFast(bvh.GetAABB(proxy)))
+					bvhVisible++;
+			});
+			bvhFrustumTime = std::min(bvhFrustumTime, timer.GetTimeSinceTick());
+
+			linearVisible = 0;
+			timer.Tick();
+			for (const auto& box : boxes)
+			{
+				if (frustum.CheckBoxFast(box))
+					linearVisible++;
+			}
+			linearFrustumTime = std::min(linearFrustumTime, timer.GetTimeSinceTick());
+		}
+
+		// Ray queries from the origin in random directions, like picking
+		Array<Ray> rays;
+		for (U32 i = 0; i < RAY_COUNT; i++)
+		{
+			const VECTOR dir = Vector3Normalize(VectorSet(Random(state) - 0.5f, Random(state) - 0.5f, Random(state) - 0.5f, 0.0f));
+			rays.push_back(Ray(F32x3(0.0f), StoreF32x3(dir), 0.0f, RAY_LENGTH));
+		}
+
+		U32 bvhHits = 0;
+		U32 linearHits = 0;
+		timer.Tick();
+		for (const auto& ray : rays)
+		{
+			bvh.QueryRay(ray, [&](I32 proxy, F32 tMax) {
+				bvhHits++;
+				return tMax;
+			});
+		}
+		const F32 bvhRayTime = timer.GetTimeSinceTick();
+
+		timer.Tick();
+		for (const auto& ray : rays)
+		{
+			for (const auto& box : boxes)
+			{
+				if (box.Intersects(ray))
+					linearHits++;
+			}
+		}
+		const F32 linearRayTime = timer.GetTimeSinceTick();
+
+		Logger::Info("%7d boxes: build %.2f ms, height %d", boxCount, buildTime * 1000.0f, bvh.GetHeight());
+		Logger::Info("  frustum: BVH %.3f ms (%d visible), linear %.3f ms (%d visible)",
+			bvhFrustumTime * 1000.0f,
+			bvhVisible,
+			linearFrustumTime * 1000.0f,
+			linearVisible);
+		Logger::Info("  ray: BVH %.2f us per ray (%d hits), linear %.2f us per ray (%d hits)",
+			bvhRayTime * 1e6f / RAY_COUNT,
+			bvhHits,
+			linearRayTime * 1e6f / RAY_COUNT,
+			linearHits);
+	}
+
+	bool BVHBenchmark::Run()
+	{
+		PROFILE_FUNCTION();
+		Logger::Info("Scene BVH: frustum far plane %.0f m, %d rays of %.0f m", FAR_DISTANCE, RAY_COUNT, RAY_LENGTH);
+		for (U32 boxCount : SCENE_SIZES)
+			RunScene(boxCount);
+		return true;
+	}
+}
+}
\ No newline at end of file
@@ -0,0 +1,17 @@
+#pragma once
+
+#include "editor\common.h"
+
+namespace VulkanTest
+{
+namespace Editor
+{
+	// Queries of SceneBVH against a linear scan of all boxes
+	class VULKAN_EDITOR_API BVHBenchmark
+	{
+	public:
+		// Build, frustum and ray query times for 10k, 100k and 500k boxes
+		static bool Run();
+	};
+}
+}
\ No newline at end of file
@@ -0,0 +1,309 @@
+#include "codecBenchmark.h"
+#include "core\globals.h"
+#include "core\filesystem\filesystem.h"
+#include "core\platform\timer.h"
+#include "content\compress\compressor.h"
+#include "content\storage\storageManager.h"
+
+namespace VulkanTest
+{
+namespace Editor
+{
+	// Chunks not larger than it are compressed with the dictionary, same as the storage
+	static const U32 SMALL_CHUNK_SIZE = 4096;
+
+	struct CodecConfig
+	{
+		const char* name;
+		I32 acceleration;
+		// LZ4HC level, 0 to use the fast compressor
+		I32 hcLevel;
+		bool useDictionary;
+		// Chunks larger than two blocks are compressed as blocks decompressed in parallel, 0 to disable
+		U32 blockSize;
+	};
+
+	static const CodecConfig CODEC_CONFIGS[] = {
+		{ "LZ4", 1, 0, false, 0 },
+		{ "LZ4 acceleration 4", 4, 0, false, 0 },
+		{ "LZ4 acceleration 16", 16, 0, false, 0 },
+		{ "LZ4 dictionary", 1, 0, true, 0 },
+		{ "LZ4 blocks", 1, 0, false, CompressionOptions().blockSize },
+		{ "LZ4HC level 4", 1, 4, false, 0 },
+		{ "LZ4HC level 9", 1, Compressor::HC_LEVEL_DEFAULT, false, 0 },
+		{ "LZ4HC level 12", 1, Compressor::HC_LEVEL_MAX, false, 0 },
+		{ "LZ4HC dictionary", 1, Compressor::HC_LEVEL_DEFAULT, true, 0 },
+	};
+
+	static void EnumerateStorages(const Path& dir, Array<Path>& outPaths)
+	{
+		auto fileList = FileSystem::Enumerate(dir.c_str());
+		for (const auto& fileInfo : fileList)
+		{
+			if (fileInfo.filename[0] == '.')
+				continue;
+
+			if (fileInfo.type == PathType::Directory)
+				EnumerateStorages(dir / fileInfo.filename, outPaths);
+			else if (EndsWith(fileInfo.filename, RESOURCE_FILES_EXTENSION_WITH_DOT))
+				outPaths.push_back(dir / fileInfo.filename);
+		}
+	}
+
+	// Copy the uncompressed data of all chunks
+	static void CollectChunks(const Path& path, Array<OutputMemoryStream>& outChunks)
+	{
+		auto storage = StorageManager::GetStorage(path, true);
+		if (!storage)
+			return;
+
+		auto lock = storage->Lock();
+		for (I32 i = 0; i < storage->GetEntriesCount(); i++)
+		{
+			ResourceInitData initData;
+			if (!storage->LoadResourceHeader(storage->GetEntry(i).guid, initData))
+				continue;
+
+			for (auto chunk : initData.header.chunks)
+			{
+				if (chunk == nullptr || !storage->LoadChunk(chunk))
+					continue;
+
+				OutputMemoryStream& mem = outChunks.emplace();
+				mem.Write(chunk->Data(), chunk->Size());
+			}
+		}
+	}
+
+	static bool RunCodec(const CodecConfig& config, const Array<OutputMemoryStream>& chunks, Span<const U8> dictionary)
+	{
+		U64 rawSize = 0;
+		U64 compressedSize = 0;
+		F32 compressTime = 0.0f;
+		F32 decompressTime = 0.0f;
+		OutputMemoryStream compressed;
+		OutputMemoryStream decompressed;
+		Timer timer;
+		for (const auto& chunk : chunks)
+		{
+			const bool useDictionary = config.useDictionary && chunk.Size() <= SMALL_CHUNK_SIZE;
+			const bool useBlocks = config.blockSize > 0 && chunk.Size() > (U64)config.blockSize * 2;
+			Span<const U8> chunkDictionary = useDictionary ? dictionary : Span<const U8>();
+			decompressed.Resize(chunk.Size());
+
+			timer.Tick();
+			U64 size = 0;
+			bool ret = useBlocks ?
+				Compressor::CompressBlocks(compressed, size, chunk, config.blockSize, config.acceleration, config.hcLevel) :
+				Compressor::Compress(compressed, size, chunk, config.acceleration, config.hcLevel, chunkDictionary);
+			if (!ret)
+			{
+				Logger::Error("Codec %s failed to compress", config.name);
+				return false;
+			}
+			compressTime += timer.Tick();
+
+			if (useBlocks)
+			{
+				ret = Compressor::DecompressBlocks(Span<const U8>(compressed.Data(), size), decompressed.Data(), chunk.Size());
+			}
+			else
+			{
+				I32 decompressedSize = Compressor::Decompress(
+					(const char*)compressed.Data(),
+					(char*)decompressed.Data(),
+					(I32)size,
+					(I32)chunk.Size(),
+					chunkDictionary);
+				ret = decompressedSize == (I32)chunk.Size();
+			}
+			decompressTime += timer.Tick();
+
+			if (!ret || memcmp(decompressed.Data(), chunk.Data(), chunk.Size()) != 0)
+			{
+				Logger::Error("Codec %s failed to round trip", config.name);
+				return false;
+			}
+
+			rawSize += chunk.Size();
+			compressedSize += size + sizeof(I32);
+		}
+
+		const F32 rawMB = rawSize / (1024.0f * 1024.0f);
+		Logger::Info("%-20s ratio %.3f, compress %.1f MB/s, decompress %.1f MB/s",
+			config.name,
+			compressedSize > 0 ? (F32)rawSize / compressedSize : 0.0f,
+			compressTime > 0.0f ? rawMB / compressTime : 0.0f,
+			decompressTime > 0.0f ? rawMB / decompressTime : 0.0f);
+		return true;
+	}
+
+	static U32 RandomU32(U32& state)
+	{
+		state ^= state << 13;
+		state ^= state >> 17;
+		state ^= state << 5;
+		return state;
+	}
+
+	enum class RoundTripData
+	{
+		Random,
+		Runs,
+		Words,
+		Count
+	};
+
+	// Random bytes don't compress, runs give long matches and words give short matches at any distance
+	static void GenerateData(OutputMemoryStream& data, RoundTripData type, U32 size, U32& state)
+	{
+		static const char* WORDS[] = { "mesh", "texture", "material", "shader", "model", "chunk", "storage", "the", "of", " ", "\n" };
+		data.Clear();
+		data.Reserve(size);
+		while (data.Size() < size)
+		{
+			const U32 remaining = size - (U32)data.Size();
+			if (type == RoundTripData::Random)
+			{
+				data.Write((U8)RandomU32(state));
+			}
+			else if (type == RoundTripData::Runs)
+			{
+				const U8 value = (U8)(RandomU32(state) % 4);
+				const U32 length = std::min(remaining, 1 + RandomU32(state) % 300);
+				for (U32 i = 0; i < length; i++)
+					data.Write(value);
+			}
+			else
+			{
+				const char* word = WORDS[RandomU32(state) % LengthOf(WORDS)];
+				data.Write(word, std::min(remaining, (U32)strlen(word)));
+			}
+		}
+	}
+
+	static bool CheckRoundTrip(Span<const U8> data, I32 acceleration, I32 hcLevel, Span<const U8> dictionary, U32 blockSize)
+	{
+		OutputMemoryStream compressed;
+		OutputMemoryStream decompressed;
+		decompressed.Resize(data.length());
+		U64 size = 0;
+		if (blockSize > 0)
+		{
+			return Compressor::CompressBlocks(compressed, size, data, blockSize, acceleration, hcLevel) &&
+				Compressor::DecompressBlocks(Span<const U8>(compressed.Data(), size), decompressed.Data(), data.length()) &&
+				memcmp(decompressed.Data(), data.begin(), data.length()) == 0;
+		}
+
+		if (!Compressor::Compress(compressed, size, data, acceleration, hcLevel, dictionary))
+			return false;
+
+		const I32 decompressedSize = Compressor::Decompress(
+			(const char*)compressed.Data(),
+			(char*)decompressed.Data(),
+			(I32)size,
+			(I32)data.length(),
+			dictionary);
+		return decompressedSize == (I32)data.length() && memcmp(decompressed.Data(), data.begin(), data.length()) == 0;
+	}
+
+	bool CodecBenchmark::RunRoundTrips()
+	{
+		PROFILE_FUNCTION();
+		// Every size up to the minimum compressed input, sizes around the 64KB window and larger than a block
+		Array<U32> sizes;
+		for (U32 size = 0; size <= 32; size++)
+			sizes.push_back(size);
+		for (U32 size : { 100, 1000, 4096, 65535, 65536, 65537, 300000 })
+			sizes.push_back(size);
+
+		// The fast compressor and all LZ4HC levels
+		struct Level
+		{
+			I32 acceleration;
+			I32 hcLevel;
+		};
+		Array<Level> levels;
+		levels.push_back({ 1, 0 });
+		levels.push_back({ 16, 0 });
+		for (I32 hcLevel = Compressor::HC_LEVEL_MIN; hcLevel <= Compressor::HC_LEVEL_MAX; hcLevel++)
+			levels.push_back({ 1, hcLevel });
+
+		U32 state = 0x9E3779B9u;
+		OutputMemoryStream dictionary;
+		GenerateData(dictionary, RoundTripData::Words, CompressionOptions().maxDictionarySize, state);
+
+		U32 count = 0;
+		OutputMemoryStream data;
+		for (U32 type = 0; type < (U32)RoundTripData::Count; type++)
+		{
+			for (U32 size : sizes)
+			{
+				GenerateData(data, (RoundTripData)type, size, state);
+				const Span<const U8> span(data.Data(), data.Size());
+				for (const Level& level : levels)
+				{
+					const bool ret =
+						CheckRoundTrip(span, level.acceleration, level.hcLevel, Span<const U8>(), 0) &&
+						CheckRoundTrip(span, level.acceleration, level.hcLevel, Span<const U8>(dictionary.Data(), dictionary.Size()), 0) &&
+						(size == 0 || CheckRoundTrip(span, level.acceleration, level.hcLevel, Span<const U8>(), 64 * 1024));
+					if (!ret)
+					{
+						Logger::Error("Round trip failed: data %d, size %d, acceleration %d, LZ4HC level %d", type, size, level.acceleration, level.hcLevel);
+						return false;
+					}
+					count += 3;
+				}
+			}
+		}
+
+		Logger::Info("%d round trips passed", count);
+		return true;
+	}
+
+	bool CodecBenchmark::Run()
+	{
+		PROFILE_FUNCTION();
+		Array<Path> paths;
+		EnumerateStorages(Globals::EngineContentFolder, paths);
+		EnumerateStorages(Globals::ProjectContentFolder, paths);
+
+		Array<OutputMemoryStream> chunks;
+		for (const auto& path : paths)
+			CollectChunks(path, chunks);
+
+		if (chunks.empty())
+		{
+			Logger::Warning("No chunks to benchmark");
+			return false;
+		}
+
+		U64 totalSize = 0;
+		Array<Span<const U8>> samples;
+		for (const auto& chunk : chunks)
+		{
+			totalSize += chunk.Size();
+			if (chunk.Size() <= SMALL_CHUNK_SIZE)
+				samples.push_back(Span<const U8>(chunk.Data(), chunk.Size()));
+		}
+		Logger::Info("Codec benchmark: %d storages, %d chunks (%d small), %.2f MB",
+			paths.size(),
+			chunks.size(),
+			samples.size(),
+			totalSize / (1024.0f * 1024.0f));
+
+		// The content set is treated as one package sharing one dictionary
+		Timer timer;
+		OutputMemoryStream dictionary;
+		Compressor::TrainDictionary(dictionary, Span<const Span<const U8>>(samples.data(), samples.size()), CompressionOptions().maxDictionarySize);
+		Logger::Info("Dictionary trained in %.2fms, %d bytes", timer.GetTimeSinceStart() * 1000.0f, (I32)dictionary.Size());
+
+		for (const auto& config : CODEC_CONFIGS)
+		{
+			if (!RunCodec(config, chunks, Span<const U8>(dictionary.Data(), dictionary.Size())))
+				return false;
+		}
+		return true;
+	}
+}
+}
\ No newline at end of file
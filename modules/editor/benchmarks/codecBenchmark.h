@@ -0,0 +1,18 @@
+#pragma once
+
+#include "editor\common.h"
+
+namespace VulkanTest
+{
+namespace Editor
+{
+	// Measures the ratio and the speed of chunk codecs over the resources of the engine and project content
+	class VULKAN_EDITOR_API CodecBenchmark
+	{
+	public:
+		static bool Run();
+		// Round trips of the fast compressor and every LZ4HC level over generated data, with a dictionary and as blocks
+		static bool RunRoundTrips();
+	};
+}
+}
\ No newline at end of file
@@ -0,0 +1,125 @@
+#include "cullBenchmark.h"
+#include "math\geometry.h"
+#include "core\threading\jobsystem.h"
+#include "core\platform\timer.h"
+
+namespace VulkanTest
+{
+namespace Editor
+{
+	static const U32 BOX_COUNT = 1024 * 1024;
+	static const U32 RUN_COUNT = 5;
+	// Same block size as the culling system
+	static const U32 BLOCK_SIZE = 1024;
+	static const F32 SCENE_EXTENT = 500.0f;
+	static const F32 FAR_DISTANCE = 300.0f;
+
+	static F32 Random(U32& state)
+	{
+		state ^= state << 13;
+		state ^= state >> 17;
+		state ^= state << 5;
+		return (F32)(state & 0xFFFFFF) / (F32)0xFFFFFF;
+	}
+
+	bool CullBenchmark::Run()
+	{
+		PROFILE_FUNCTION();
+		Logger::Info("Frustum culling: %d boxes, %d workers", BOX_COUNT, Jobsystem::GetWorkersCount());
+
+		// Boxes of 1 to 4 meters around the origin, in AABBs and in the packed layout of the culling
+		U32 state = 0x9E3779B9u;
+		Array<AABB> boxes;
+		boxes.resize(BOX_COUNT);
+		F32* mem = static_cast<F32*>(CJING_MALLOC_ALIGN(sizeof(F32) * BOX_COUNT * 6, 16));
+		F32* bounds[6];
+		for (U32 i = 0; i < 6; i++)
+			bounds[i] = mem + BOX_COUNT * i;
+		for (U32 i = 0; i < BOX_COUNT; i++)
+		{
+			const F32x3 center(
+				(Random(state) * 2.0f - 1.0f) * SCENE_EXTENT,
+				(Random(state) * 2.0f - 1.0f) * SCENE_EXTENT,
+				(Random(state) * 2.0f - 1.0f) * SCENE_EXTENT);
+			const F32 halfWidth = 0.5f + Random(state) * 1.5f;
+			const AABB box = AABB::CreateFromHalfWidth(center, F32x3(halfWidth));
+			boxes[i] = box;
+			bounds[0][i] = box.min.x;
+			bounds[1][i] = box.min.y;
+			bounds[2][i] = box.min.z;
+			bounds[3][i] = box.max.x;
+			bounds[4][i] = box.max.y;
+			bounds[5][i] = box.max.z;
+		}
+
+		AABBArray boxArray;
+		boxArray.minX = bounds[0];
+		boxArray.minY = bounds[1];
+		boxArray.minZ = bounds[2];
+		boxArray.maxX = bounds[3];
+		boxArray.maxY = bounds[4];
+		boxArray.maxZ = bounds[5];
+		boxArray.count = BOX_COUNT;
+
+		Frustum frustum;
+		const MATRIX view = MatrixLookToLH(VectorSet(0, 0, 0, 1), VectorSet(0, 0, 1, 0), VectorSet(0, 1, 0, 0));
+		const MATRIX projection = MatrixPerspectiveFovLH(MATH_PIDIV4, 16.0f / 9.0f, FAR_DISTANCE, 0.1f);
+		frustum.Compute(MatrixMultiply(view, projection));
+
+		Array<U32> indices;
+		indices.resize(BOX_COUNT);
+		const U32 blockCount = BOX_COUNT / BLOCK_SIZE;
+		Array<U32> blockVisibleCounts;
+		blockVisibleCounts.resize(blockCount);
+
+		F32 scalarTime = FLT_MAX;
+		F32 packedTime = FLT_MAX;
+		F32 parallelTime = FLT_MAX;
+		U32 scalarVisible = 0;
+		U32 packedVisible = 0;
+		U32 parallelVisible = 0;
+		Timer timer;
+		for (U32 run = 0; run < RUN_COUNT; run++)
+		{
+			scalarVisible = 0;
+			timer.Tick();
+			for (U32 i = 0; i < BOX_COUNT; i++)
+			{
+				if (frustum.CheckBoxFast(boxes[i]))
+					indices[scalarVisible++] = i;
+			}
+			scalarTime = std::min(scalarTime, timer.GetTimeSinceTick());
+
+			timer.Tick();
+			packedVisible = frustum.CheckBoxes(boxArray, 0, BOX_COUNT, indices.data());
+			packedTime = std::min(packedTime, timer.GetTimeSinceTick());
+
+			// Blocks write into their own buckets like CullBuffer, the merge is not timed
+			timer.Tick();
+			Jobsystem::ForEach(blockCount, 1, [&](U32 beginBlock, U32 endBlock) {
+				for (U32 block = beginBlock; block < endBlock; block++)
+				{
+					const U32 begin = block * BLOCK_SIZE;
+					blockVisibleCounts[block] = frustum.CheckBoxes(boxArray, begin, begin + BLOCK_SIZE, indices.data() + begin);
+				}
+			});
+			parallelTime = std::min(parallelTime, timer.GetTimeSinceTick());
+
+			parallelVisible = 0;
+			for (U32 count : blockVisibleCounts)
+				parallelVisible += count;
+		}
+		CJING_FREE_ALIGN(mem);
+
+		Logger::Info("  CheckBoxFast: %.3f ms, %.1f Mboxes/s (%d visible)", scalarTime * 1000.0f, BOX_COUNT / scalarTime / 1000000.0f, scalarVisible);
+		Logger::Info("  CheckBoxes: %.3f ms, %.1f Mboxes/s (%d visible)", packedTime * 1000.0f, BOX_COUNT / packedTime / 1000000.0f, packedVisible);
+		Logger::Info("  CheckBoxes in parallel blocks: %.3f ms, %.1f Mboxes/s (%d visible)", parallelTime * 1000.0f, BOX_COUNT / parallelTime / 1000000.0f, parallelVisible);
+		if (scalarVisible != packedVisible || scalarVisible != parallelVisible)
+		{
+			Logger::Error("Culling results differ");
+			return false;
+		}
+		return true;
+	}
+}
+}
\ No newline at end of file
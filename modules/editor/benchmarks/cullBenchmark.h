@@ -0,0 +1,17 @@
+#pragma once
+
+#include "editor\common.h"
+
+namespace VulkanTest
+{
+namespace Editor
+{
+	// Frustum culling of packed bounds against the scalar test of each box
+	class VULKAN_EDITOR_API CullBenchmark
+	{
+	public:
+		// CheckBoxes single threaded and in parallel blocks, and CheckBoxFast over 1M boxes
+		static bool Run();
+	};
+}
+}
\ No newline at end of file
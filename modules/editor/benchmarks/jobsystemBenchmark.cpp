@@ -0,0 +1,134 @@
+#include "jobsystemBenchmark.h"
+#include "core\threading\jobsystem.h"
+#include "core\platform\timer.h"
+
+namespace VulkanTest
+{
+namespace Editor
+{
+	// Count of empty jobs of each run
+	static const U32 JOB_COUNT = 256 * 1024;
+	// The best run is reported
+	static const U32 RUN_COUNT = 4;
+
+	// Submitters are jobs too, so the spawned jobs are pushed into the local deques and stolen by idle workers
+	static F32 RunSubmitters(U32 submitterCount, bool useBatch)
+	{
+		struct SubmitterData
+		{
+			U32 jobCount;
+			bool useBatch;
+		};
+		SubmitterData data;
+		data.jobCount = JOB_COUNT / submitterCount;
+		data.useBatch = useBatch;
+
+		Timer timer;
+		Jobsystem::JobHandle handle;
+		for (U32 i = 0; i < submitterCount; i++)
+		{
+			Jobsystem::Run(&data, [](void* ptr) {
+				const SubmitterData* data = static_cast<const SubmitterData*>(ptr);
+				Jobsystem::JobHandle children;
+				if (data->useBatch)
+				{
+					// Job functions are moved out by RunBatch, so they are set for each batch
+					Jobsystem::JobDecl decls[256];
+					for (U32 j = 0; j < data->jobCount; j += LengthOf(decls))
+					{
+						const U32 count = std::min(data->jobCount - j, (U32)LengthOf(decls));
+						for (U32 k = 0; k < count; k++)
+							decls[k].func = [](void*) {};
+						Jobsystem::RunBatch(Span<Jobsystem::JobDecl>(decls, count), &children);
+					}
+				}
+				else
+				{
+					for (U32 j = 0; j < data->jobCount; j++)
+						Jobsystem::Run(nullptr, [](void*) {}, &children);
+				}
+				Jobsystem::Wait(&children);
+			}, &handle);
+		}
+		Jobsystem::Wait(&handle);
+		return timer.GetTimeSinceStart();
+	}
+
+	bool JobsystemBenchmark::RunThroughput()
+	{
+		PROFILE_FUNCTION();
+		const U32 workerCount = Jobsystem::GetWorkersCount();
+		Logger::Info("Job throughput: %d workers, %d empty jobs per run", workerCount, JOB_COUNT);
+
+		for (U32 submitterCount = 1; submitterCount <= workerCount; submitterCount *= 2)
+		{
+			F32 runTime = FLT_MAX;
+			F32 batchTime = FLT_MAX;
+			for (U32 i = 0; i < RUN_COUNT; i++)
+			{
+				runTime = std::min(runTime, RunSubmitters(submitterCount, false));
+				batchTime = std::min(batchTime, RunSubmitters(submitterCount, true));
+			}
+
+			Logger::Info("%2d submitters: Run %.2f Mjobs/s, RunBatch %.2f Mjobs/s",
+				submitterCount,
+				JOB_COUNT / runTime / 1000000.0f,
+				JOB_COUNT / batchTime / 1000000.0f);
+		}
+		return true;
+	}
+
+	// The submitter is a job, so its wait is a fiber switch instead of the sleeping poll of the main thread
+	static F32 RunContention(U32 jobCount)
+	{
+		struct ContentionData
+		{
+			U32 jobCount;
+			F32 time;
+		};
+		ContentionData data;
+		data.jobCount = jobCount;
+		data.time = 0.0f;
+
+		Jobsystem::JobHandle submitter;
+		Jobsystem::Run(&data, [](void* ptr) {
+			ContentionData* data = static_cast<ContentionData*>(ptr);
+			Timer timer;
+			Jobsystem::JobHandle handle;
+			Jobsystem::JobDecl decls[256];
+			for (U32 i = 0; i < data->jobCount; i += LengthOf(decls))
+			{
+				const U32 count = std::min(data->jobCount - i, (U32)LengthOf(decls));
+				for (U32 k = 0; k < count; k++)
+					decls[k].func = [](void*) {};
+				Jobsystem::RunBatch(Span<Jobsystem::JobDecl>(decls, count), &handle);
+			}
+			Jobsystem::Wait(&handle);
+			data->time = timer.GetTimeSinceStart();
+		}, &submitter);
+		Jobsystem::Wait(&submitter);
+		return data.time;
+	}
+
+	bool JobsystemBenchmark::RunHandleContention()
+	{
+		PROFILE_FUNCTION();
+		const U32 workerCount = Jobsystem::GetWorkersCount();
+		Logger::Info("JobHandle contention: %d workers", workerCount);
+
+		const U32 jobCounts[] = { workerCount * 16, 64 * 1024, 1024 * 1024 };
+		for (U32 jobCount : jobCounts)
+		{
+			F32 bestTime = FLT_MAX;
+			for (U32 run = 0; run < RUN_COUNT; run++)
+				bestTime = std::min(bestTime, RunContention(jobCount));
+
+			Logger::Info("%8d jobs on one handle: %.2f Mjobs/s, %.1f ns per completion",
+				jobCount,
+				jobCount / bestTime / 1000000.0f,
+				bestTime * 1000000000.0f / jobCount);
+		}
+		return true;
+	}
+}
+}
\ No newline at end of file
@@ -0,0 +1,19 @@
+#pragma once
+
+#include "editor\common.h"
+
+namespace VulkanTest
+{
+namespace Editor
+{
+	// Measures the scheduler with empty jobs, run with -workers <n> to get the scaling over worker counts
+	class VULKAN_EDITOR_API JobsystemBenchmark
+	{
+	public:
+		// Jobs per second submitted by 1 to N submitters, where N is the count of workers
+		static bool RunThroughput();
+		// Completions per second of empty jobs sharing one handle, all workers trigger the same counter
+		static bool RunHandleContention();
+	};
+}
+}
\ No newline at end of file
@@ -0,0 +1,116 @@
+#include "logBenchmark.h"
+#include "core\platform\atomic.h"
+#include "core\platform\sync.h"
+#include "core\platform\timer.h"
+
+namespace VulkanTest
+{
+namespace Editor
+{
+	// Lines of each thread, dev lines so that the dropped lines are not a problem
+	static const U32 LINE_COUNT = 16 * 1024;
+	static const U32 MAX_THREAD_COUNT = 8;
+
+	class CountingLoggerSink final : public LoggerSink
+	{
+	public:
+		volatile I32 count = 0;
+
+		void Log(LogLevel level, const char* msg)override
+		{
+			AtomicIncrement(&count);
+		}
+	};
+
+	class LogThread final : public Thread
+	{
+	public:
+		bool deferred = false;
+		volatile I32* start = nullptr;
+		F32 time = 0.0f;
+
+		int Task() override
+		{
+			while (AtomicRead(start) == 0) {}
+
+			Timer timer;
+			for (U32 i = 0; i < LINE_COUNT; i++)
+			{
+				if (deferred)
+					Logger::LogDeferred(LogLevel::LVL_DEV, "Benchmark line %d of %d, value %f", i, LINE_COUNT, (F32)i * 0.5f);
+				else
+					Logger::Log(LogLevel::LVL_DEV, "Benchmark line %d of %d, value %f", i, LINE_COUNT, (F32)i * 0.5f);
+			}
+			time = timer.GetTimeSinceStart();
+			return 0;
+		}
+	};
+
+	static void RunLogThreads(U32 threadCount, bool deferred, CountingLoggerSink& sink)
+	{
+		volatile I32 start = 0;
+		Array<LogThread*> threads;
+		for (U32 i = 0; i < threadCount; i++)
+		{
+			LogThread* thread = CJING_NEW(LogThread);
+			thread->deferred = deferred;
+			thread->start = &start;
+			if (!thread->Create("LogBenchmark"))
+			{
+				CJING_SAFE_DELETE(thread);
+				break;
+			}
+			threads.push_back(thread);
+		}
+
+		Logger::Flush();
+		AtomicStore(&sink.count, 0);
+
+		Timer timer;
+		AtomicStore(&start, 1);
+		F32 threadTime = 0.0f;
+		for (auto thread : threads)
+		{
+			thread->Join();
+			threadTime = std::max(threadTime, thread->time);
+		}
+		Logger::Flush();
+		const F32 totalTime = timer.GetTimeSinceStart();
+		const I32 dispatched = AtomicRead(&sink.count);
+
+		for (auto thread : threads)
+		{
+			thread->Destroy();
+			CJING_SAFE_DELETE(thread);
+		}
+
+		const U32 lineCount = (U32)threads.size() * LINE_COUNT;
+		Logger::Info("%2d threads, %s: logging %.2f Mlines/s (%.1f ns per line), dispatched %d of %d lines, %.2f Mlines/s",
+			threadCount,
+			deferred ? "deferred" : "formatted",
+			lineCount / threadTime / 1000000.0f,
+			threadTime * 1e9f / LINE_COUNT,
+			dispatched,
+			lineCount,
+			dispatched / totalTime / 1000000.0f);
+	}
+
+	bool LogBenchmark::Run()
+	{
+		PROFILE_FUNCTION();
+		Logger::Info("Log throughput: %d lines per thread, %s mode", LINE_COUNT, Logger::IsAsync() ? "async" : "sync");
+
+		CountingLoggerSink sink;
+		Logger::RegisterSink(sink);
+		const U32 maxThreadCount = std::min((U32)Platform::GetCPUsCount(), MAX_THREAD_COUNT);
+		for (U32 threadCount = 1; threadCount <= maxThreadCount; threadCount *= 2)
+		{
+			RunLogThreads(threadCount, false, sink);
+			RunLogThreads(threadCount, true, sink);
+		}
+		Logger::Flush();
+		Logger::UnregisterSink(sink);
+		return true;
+	}
+}
+}
\ No newline at end of file
@@ -0,0 +1,17 @@
+#pragma once
+
+#include "editor\common.h"
+
+namespace VulkanTest
+{
+namespace Editor
+{
+	// Throughput of the logger with formatted and deferred records
+	class VULKAN_EDITOR_API LogBenchmark
+	{
+	public:
+		// Lines per second of the logging threads and of the sinks, for 1 to N threads
+		static bool Run();
+	};
+}
+}
\ No newline at end of file
@@ -0,0 +1,55 @@
+#include "profilerBenchmark.h"
+#include "core\platform\timer.h"
+
+namespace VulkanTest
+{
+namespace Editor
+{
+	static const U32 PAIR_COUNT = 1024 * 1024;
+	// The best run is reported
+	static const U32 RUN_COUNT = 5;
+
+	template<typename F>
+	static F32 MeasureNanoseconds(U32 count, const F& func)
+	{
+		F32 bestTime = FLT_MAX;
+		for (U32 run = 0; run < RUN_COUNT; run++)
+		{
+			Timer timer;
+			for (U32 i = 0; i < count; i++)
+				func();
+			bestTime = std::min(bestTime, timer.GetTimeSinceStart());
+		}
+		return bestTime * 1000000000.0f / count;
+	}
+
+	bool ProfilerBenchmark::Run()
+	{
+		PROFILE_FUNCTION();
+		const bool wasEnabled = Profiler::IsEnable();
+		Profiler::Enable(true);
+
+		volatile U64 ticksSum = 0;
+		const F32 ticksTime = MeasureNanoseconds(PAIR_COUNT, [&]() {
+			ticksSum += Profiler::GetTicks();
+		});
+		const F32 pairTime = MeasureNanoseconds(PAIR_COUNT, []() {
+			Profiler::BeginBlock("ProfilerBenchmark");
+			Profiler::EndBlock();
+		});
+		const F32 nestedTime = MeasureNanoseconds(PAIR_COUNT, []() {
+			Profiler::BeginBlock("ProfilerBenchmark");
+			Profiler::BeginBlock("ProfilerBenchmarkNested");
+			Profiler::EndBlock();
+			Profiler::EndBlock();
+		}) * 0.5f;
+
+		Profiler::Enable(wasEnabled);
+
+		Logger::Info("Timestamp: %.1f ns", ticksTime);
+		Logger::Info("Begin/end pair: %.1f ns, %.1f ns without timestamps", pairTime, pairTime - ticksTime * 2.0f);
+		Logger::Info("Nested begin/end pair: %.1f ns, %.1f ns without timestamps", nestedTime, nestedTime - ticksTime * 2.0f);
+		return true;
+	}
+}
+}
\ No newline at end of file
@@ -0,0 +1,17 @@
+#pragma once
+
+#include "editor\common.h"
+
+namespace VulkanTest
+{
+namespace Editor
+{
+	// Measures the overhead of profiler blocks on the calling thread
+	class VULKAN_EDITOR_API ProfilerBenchmark
+	{
+	public:
+		// Nanoseconds per begin/end pair, split into the timestamps and the bookkeeping
+		static bool Run();
+	};
+}
+}
\ No newline at end of file
@@ -0,0 +1,106 @@
+#include "renderQueueBenchmark.h"
+#include "renderer\renderQueue.h"
+#include "core\threading\jobsystem.h"
+#include "core\platform\timer.h"
+
+namespace VulkanTest
+{
+namespace Editor
+{
+	using Renderer::RenderBatch;
+	using Renderer::RenderQueue;
+
+	static const U32 OBJECT_COUNTS[] = { 1000, 10 * 1000, 50 * 1000, 100 * 1000 };
+	static const U32 MESH_COUNT = 256;
+	static const U32 RUN_COUNT = 5;
+
+	// Batches like DrawScene builds them, one per object, mesh hashes and distances are random and instance indices are unique
+	static void CreateBatches(Array<RenderBatch>& batches, U32 objectCount)
+	{
+		batches.resize(objectCount);
+		U32 state = 0x9E3779B9u;
+		for (U32 i = 0; i < objectCount; i++)
+		{
+			state ^= state << 13;
+			state ^= state >> 17;
+			state ^= state << 5;
+			RenderBatch& batch = batches[i];
+			batch.sortingKey = 0;
+			batch.sortingKey |= U64(((state % MESH_COUNT) * 2654435761u) & 0x00FFFFFF) << 40ull;
+			batch.sortingKey |= U64(ConvertFloatToHalf((F32)(state >> 16) * 0.01f) & 0xFFFF) << 24ull;
+			batch.sortingKey |= U64(i & 0x00FFFFFF) << 0ull;
+			batch.meshInfo = nullptr;
+			batch.objCmp = nullptr;
+		}
+	}
+
+	// Build and sort the queue, the objects are gathered from the prepared batches instead of the components
+	static void SetupQueue(RenderQueue& queue, const Array<RenderBatch>& objects, F32& buildTime, F32& sortTime)
+	{
+		Timer timer;
+		queue.Clear();
+		queue.BuildBlocks(objects.size(), [&](U32 index, Array<RenderBatch>& output) {
+			output.push_back(objects[index]);
+		});
+		buildTime = timer.Tick();
+		queue.SortOpaque();
+		sortTime = timer.Tick();
+	}
+
+	bool RenderQueueBenchmark::Run()
+	{
+		PROFILE_FUNCTION();
+		Logger::Info("Render queue: %d meshes, %d workers", MESH_COUNT, Jobsystem::GetWorkersCount());
+		for (U32 objectCount : OBJECT_COUNTS)
+		{
+			Array<RenderBatch> objects;
+			CreateBatches(objects, objectCount);
+
+			// A new queue allocates its storage, queues of the pool reuse it
+			F32 firstBuildTime, firstSortTime;
+			RenderQueue queue;
+			SetupQueue(queue, objects, firstBuildTime, firstSortTime);
+
+			F32 bestBuildTime = FLT_MAX;
+			F32 bestSortTime = FLT_MAX;
+			for (U32 run = 0; run < RUN_COUNT; run++)
+			{
+				F32 buildTime, sortTime;
+				SetupQueue(queue, objects, buildTime, sortTime);
+				bestBuildTime = std::min(bestBuildTime, buildTime);
+				bestSortTime = std::min(bestSortTime, sortTime);
+			}
+
+			F32 bestStdSortTime = FLT_MAX;
+			Array<RenderBatch> expected;
+			expected.resize(objectCount);
+			Timer timer;
+			for (U32 run = 0; run < RUN_COUNT; run++)
+			{
+				memcpy(expected.data(), objects.data(), objectCount * sizeof(RenderBatch));
+				timer.Tick();
+				std::sort(expected.begin(), expected.end());
+				bestStdSortTime = std::min(bestStdSortTime, timer.GetTimeSinceTick());
+			}
+
+			for (U32 i = 0; i < objectCount; i++)
+			{
+				if (queue.batches[i].sortingKey != expected[i].sortingKey)
+				{
+					Logger::Error("Render queue of %d objects is different from std::sort", objectCount);
+					return false;
+				}
+			}
+
+			Logger::Info("%6d objects: new queue %.3f ms, pooled queue %.3f ms (build %.3f ms, radix sort %.3f ms), std::sort %.3f ms",
+				objectCount,
+				(firstBuildTime + firstSortTime) * 1000.0f,
+				(bestBuildTime + bestSortTime) * 1000.0f,
+				bestBuildTime * 1000.0f,
+				bestSortTime * 1000.0f,
+				bestStdSortTime * 1000.0f);
+		}
+		return true;
+	}
+}
+}
\ No newline at end of file
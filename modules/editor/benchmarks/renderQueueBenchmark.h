@@ -0,0 +1,17 @@
+#pragma once
+
+#include "editor\common.h"
+
+namespace VulkanTest
+{
+namespace Editor
+{
+	// Build and sort of render queues against std::sort
+	class VULKAN_EDITOR_API RenderQueueBenchmark
+	{
+	public:
+		// Queue setup, parallel build and radix sort times for 1k to 100k objects
+		static bool Run();
+	};
+}
+}
\ No newline at end of file
@@ -0,0 +1,74 @@
+#include "sceneUpdateBenchmark.h"
+#include "core\engine.h"
+#include "core\scene\world.h"
+#include "core\platform\timer.h"
+#include "renderer\renderScene.h"
+
+namespace VulkanTest
+{
+namespace Editor
+{
+	static const U32 OBJECT_COUNTS[] = { 10 * 1000, 100 * 1000 };
+	static const U32 MOVING_PERCENTS[] = { 0, 1, 100 };
+	static const U32 FRAME_COUNT = 16;
+
+	static void RunScene(U32 objectCount)
+	{
+		World& world = Engine::Instance->CreateWorld();
+		RenderScene* scene = dynamic_cast<RenderScene*>(world.GetScene("Renderer"));
+
+		// Objects of a mesh whose model is not loaded, so they have instance records without any content
+		ECS::Entity mesh = scene->CreateMesh(ECS::INVALID_ENTITY);
+		mesh.GetMut<MeshComponent>()->meshCount = 1;
+
+		Array<ECS::Entity> objects;
+		for (U32 i = 0; i < objectCount; i++)
+		{
+			ECS::Entity entity = scene->CreateObject(ECS::INVALID_ENTITY);
+			entity.GetMut<ObjectComponent>()->mesh = mesh;
+			entity.GetMut<TransformComponent>()->transform.Translate(F32x3((F32)(i % 256), 0.0f, (F32)(i / 256)));
+			objects.push_back(entity);
+		}
+
+		// The first update allocates and writes all records
+		Timer timer;
+		scene->Update(0.0f, false);
+		Logger::Info("%6d objects: first update %.2f ms, %d instances written",
+			objectCount,
+			timer.GetTimeSinceStart() * 1000.0f,
+			scene->GetStatistics().instancesWritten);
+
+		for (U32 movingPercent : MOVING_PERCENTS)
+		{
+			const U32 movingCount = objectCount * movingPercent / 100;
+			F32 totalTime = 0.0f;
+			U32 instancesWritten = 0;
+			for (U32 frame = 0; frame < FRAME_COUNT; frame++)
+			{
+				for (U32 i = 0; i < movingCount; i++)
+					objects[i].GetMut<TransformComponent>()->transform.Translate(F32x3(0.0f, 0.01f, 0.0f));
+
+				timer.Tick();
+				scene->Update(0.0f, false);
+				totalTime += timer.GetTimeSinceTick();
+				instancesWritten += scene->GetStatistics().instancesWritten;
+			}
+
+			Logger::Info("  %3d%% moving: update %.3f ms per frame, %d instances written per frame",
+				movingPercent,
+				totalTime * 1000.0f / FRAME_COUNT,
+				instancesWritten / FRAME_COUNT);
+		}
+
+		Engine::Instance->DestroyWorld(&world);
+	}
+
+	bool SceneUpdateBenchmark::Run()
+	{
+		PROFILE_FUNCTION();
+		for (U32 objectCount : OBJECT_COUNTS)
+			RunScene(objectCount);
+		return true;
+	}
+}
+}
\ No newline at end of file
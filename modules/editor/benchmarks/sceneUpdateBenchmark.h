@@ -0,0 +1,17 @@
+#pragma once
+
+#include "editor\common.h"
+
+namespace VulkanTest
+{
+namespace Editor
+{
+	// Update of render scenes with mostly static objects
+	class VULKAN_EDITOR_API SceneUpdateBenchmark
+	{
+	public:
+		// Update time and records written per frame when none, 1% or all of the objects move
+		static bool Run();
+	};
+}
+}
\ No newline at end of file
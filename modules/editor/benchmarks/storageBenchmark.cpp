@@ -0,0 +1,496 @@
+#include "storageBenchmark.h"
+#include "core\globals.h"
+#include "core\filesystem\filesystem.h"
+#include "core\platform\atomic.h"
+#include "core\platform\platform.h"
+#include "core\platform\timer.h"
+#include "core\threading\jobsystem.h"
+#include "content\storage\storageManager.h"
+#include "content\resources\model.h"
+#include "editor\cooker\cooker.h"
+
+namespace VulkanTest
+{
+namespace Editor
+{
+	static const U32 RUN_COUNT = 3;
+
+	struct StorageChunks
+	{
+		ResourceStorageRef storage = nullptr;
+		Array<DataChunk*> chunks;
+	};
+
+	struct ReadModeConfig
+	{
+		const char* name;
+		ResourceStorage::ReadMode mode;
+		// Chunks are loaded one by one by the workers instead of a batch
+		bool useWorkers;
+	};
+
+	static const ReadModeConfig READ_MODES[] = {
+		{ "Blocking", ResourceStorage::ReadMode::Blocking, false },
+		{ "Blocking workers", ResourceStorage::ReadMode::Blocking, true },
+		{ "Mapped", ResourceStorage::ReadMode::Mapped, false },
+		{ "AsyncIO", ResourceStorage::ReadMode::Async, false },
+		{ "Auto", ResourceStorage::ReadMode::Auto, false },
+	};
+
+	static void EnumerateStorages(const Path& dir, Array<Path>& outPaths)
+	{
+		auto fileList = FileSystem::Enumerate(dir.c_str());
+		for (const auto& fileInfo : fileList)
+		{
+			if (fileInfo.filename[0] == '.')
+				continue;
+
+			if (fileInfo.type == PathType::Directory)
+				EnumerateStorages(dir / fileInfo.filename, outPaths);
+			else if (EndsWith(fileInfo.filename, RESOURCE_FILES_EXTENSION_WITH_DOT))
+				outPaths.push_back(dir / fileInfo.filename);
+		}
+	}
+
+	// Chunks already loaded are used by loaded resources, they are not touched
+	static void CollectStorages(Array<StorageChunks>& outStorages, U64& outFileSize)
+	{
+		Array<Path> paths;
+		EnumerateStorages(Globals::EngineContentFolder, paths);
+		EnumerateStorages(Globals::ProjectContentFolder, paths);
+
+		outFileSize = 0;
+		for (const auto& path : paths)
+		{
+			auto storage = StorageManager::GetStorage(path, true);
+			if (!storage)
+				continue;
+
+			StorageChunks& storageChunks = outStorages.emplace();
+			storageChunks.storage = storage;
+			for (I32 i = 0; i < storage->GetEntriesCount(); i++)
+			{
+				ResourceInitData initData;
+				if (!storage->LoadResourceHeader(storage->GetEntry(i).guid, initData))
+					continue;
+
+				for (auto chunk : initData.header.chunks)
+				{
+					if (chunk == nullptr || chunk->IsLoaded() || !chunk->ExistsInFile())
+						continue;
+
+					storageChunks.chunks.push_back(chunk);
+					outFileSize += chunk->location.Size;
+				}
+			}
+		}
+	}
+
+	struct LoadPass
+	{
+		Array<StorageChunks>* storages;
+		const ReadModeConfig* config;
+		volatile I32 failedCount;
+		F32 time;
+	};
+
+	// Waits of the loading take the fiber path in a job, like the loading of resources
+	static void LoadPassJob(void* data)
+	{
+		LoadPass* pass = static_cast<LoadPass*>(data);
+		Timer timer;
+		for (auto& storageChunks : *pass->storages)
+		{
+			ResourceStorage* storage = storageChunks.storage;
+			auto lock = storage->Lock();
+			if (pass->config->useWorkers)
+			{
+				Jobsystem::ForEach(storageChunks.chunks.size(), 1, [&](U32 begin, U32 end) {
+					for (U32 i = begin; i < end; i++)
+					{
+						if (!storage->LoadChunk(storageChunks.chunks[i]))
+							AtomicIncrement(&pass->failedCount);
+					}
+				});
+			}
+			else if (!storage->LoadChunks(Span<DataChunk* const>(storageChunks.chunks.data(), storageChunks.chunks.size())))
+			{
+				AtomicIncrement(&pass->failedCount);
+			}
+		}
+		pass->time = timer.GetTimeSinceStart();
+	}
+
+	static bool LoadAll(Array<StorageChunks>& storages, const ReadModeConfig& config, F32& time)
+	{
+		// Drop the chunks, the mappings and the file handles of the previous pass
+		for (auto& storageChunks : storages)
+		{
+			for (auto chunk : storageChunks.chunks)
+				chunk->Unload();
+			storageChunks.storage->CloseContent();
+		}
+
+		ResourceStorage::CurrentReadMode = config.mode;
+		LoadPass pass;
+		pass.storages = &storages;
+		pass.config = &config;
+		pass.failedCount = 0;
+		pass.time = 0.0f;
+
+		Jobsystem::JobHandle handle;
+		Jobsystem::Run(&pass, LoadPassJob, &handle);
+		Jobsystem::Wait(&handle);
+		time = pass.time;
+		return pass.failedCount == 0;
+	}
+
+	bool StorageBenchmark::RunIO()
+	{
+		PROFILE_FUNCTION();
+		Array<StorageChunks> storages;
+		U64 fileSize = 0;
+		CollectStorages(storages, fileSize);
+		if (fileSize == 0)
+		{
+			Logger::Warning("No chunks to benchmark");
+			return false;
+		}
+
+		const F32 fileMB = fileSize / (1024.0f * 1024.0f);
+		Logger::Info("Storage io: %d storages, %.2f MB of chunks, async read batch size %d KB",
+			storages.size(),
+			fileMB,
+			(I32)(ResourceStorage::AsyncReadBatchSize / 1024));
+
+		const ResourceStorage::ReadMode readMode = ResourceStorage::CurrentReadMode;
+		bool ret = true;
+		for (const auto& config : READ_MODES)
+		{
+			F32 firstTime = 0.0f;
+			F32 bestTime = FLT_MAX;
+			for (U32 run = 0; run < RUN_COUNT && ret; run++)
+			{
+				F32 time;
+				ret = LoadAll(storages, config, time);
+				if (run == 0)
+					firstTime = time;
+				bestTime = std::min(bestTime, time);
+			}
+
+			if (!ret)
+			{
+				Logger::Error("Read mode %s failed to load chunks", config.name);
+				break;
+			}
+
+			Logger::Info("%-16s first pass %.1f MB/s, best %.1f MB/s (%.2f ms)",
+				config.name,
+				fileMB / firstTime,
+				fileMB / bestTime,
+				bestTime * 1000.0f);
+		}
+
+		// Leave the chunks to the storages, they are released by the storage tick
+		ResourceStorage::CurrentReadMode = readMode;
+		return ret;
+	}
+
+	// Model storages hold a single model, the largest by the size of its chunks is picked
+	static bool FindLargestModel(StorageChunks& outModel, U64& outFileSize)
+	{
+		Array<Path> paths;
+		EnumerateStorages(Globals::EngineContentFolder, paths);
+		EnumerateStorages(Globals::ProjectContentFolder, paths);
+
+		outFileSize = 0;
+		for (const auto& path : paths)
+		{
+			auto storage = StorageManager::GetStorage(path, true);
+			if (!storage || storage->GetEntriesCount() != 1 || storage->GetEntry(0).type != Model::ResType)
+				continue;
+
+			ResourceInitData initData;
+			if (!storage->LoadResourceHeader(storage->GetEntry(0).guid, initData))
+				continue;
+
+			Array<DataChunk*> chunks;
+			U64 fileSize = 0;
+			for (auto chunk : initData.header.chunks)
+			{
+				if (chunk == nullptr || chunk->IsLoaded() || !chunk->ExistsInFile())
+					continue;
+
+				chunks.push_back(chunk);
+				fileSize += chunk->location.Size;
+			}
+
+			if (fileSize > outFileSize)
+			{
+				outModel.storage = storage;
+				outModel.chunks = std::move(chunks);
+				outFileSize = fileSize;
+			}
+		}
+		return outFileSize > 0;
+	}
+
+	static const ReadModeConfig COPY_MODES[] = {
+		{ "Mapped", ResourceStorage::ReadMode::Mapped, false },
+		{ "File stream", ResourceStorage::ReadMode::Blocking, false },
+	};
+
+	bool StorageBenchmark::RunChunkCopies()
+	{
+		PROFILE_FUNCTION();
+		Array<StorageChunks> storages;
+		U64 fileSize = 0;
+		if (!FindLargestModel(storages.emplace(), fileSize))
+		{
+			Logger::Warning("No model chunks to benchmark");
+			return false;
+		}
+
+		const F32 toMB = 1.0f / (1024.0f * 1024.0f);
+		Logger::Info("Storage copies: %s, %d chunks, %.2f MB",
+			storages[0].storage->GetPath().c_str(),
+			storages[0].chunks.size(),
+			fileSize * toMB);
+
+		const ResourceStorage::ReadMode readMode = ResourceStorage::CurrentReadMode;
+		bool ret = true;
+		for (const auto& config : COPY_MODES)
+		{
+			// Release the chunks of the previous pass before sampling the memory
+			for (auto chunk : storages[0].chunks)
+				chunk->Unload();
+			storages[0].storage->CloseContent();
+
+			const Platform::ProcessMemoryStats memBefore = Platform::GetProcessMemoryStats();
+			const I64 copiedBefore = ResourceStorage::Stats.copiedBytes;
+			F32 time;
+			ret = LoadAll(storages, config, time);
+			if (!ret)
+			{
+				Logger::Error("Read mode %s failed to load chunks", config.name);
+				break;
+			}
+
+			// Mapped chunks are paged in when the model reads them, touch them like the model loading does
+			U64 checksum = 0;
+			for (auto chunk : storages[0].chunks)
+			{
+				const U8* data = chunk->Data();
+				for (U64 i = 0; i < chunk->Size(); i += 4096)
+					checksum += data[i];
+			}
+
+			const Platform::ProcessMemoryStats memAfter = Platform::GetProcessMemoryStats();
+			const I64 copiedBytes = ResourceStorage::Stats.copiedBytes - copiedBefore;
+			Logger::Info("%-12s copied %.2f MB (%.2fx), working set +%.2f MB, private +%.2f MB, peak working set %.2f MB (+%.2f MB), %.2f ms (checksum %d)",
+				config.name,
+				copiedBytes * toMB,
+				(F32)copiedBytes / fileSize,
+				((I64)memAfter.usedPhysicalMemory - (I64)memBefore.usedPhysicalMemory) * toMB,
+				((I64)memAfter.usedVirtualMemory - (I64)memBefore.usedVirtualMemory) * toMB,
+				memAfter.peakPhysicalMemory * toMB,
+				(memAfter.peakPhysicalMemory - memBefore.peakPhysicalMemory) * toMB,
+				time * 1000.0f,
+				(I32)checksum);
+		}
+
+		ResourceStorage::CurrentReadMode = readMode;
+		return ret;
+	}
+
+	// Resources of the per-file storages are copied to a package, like the cooker does
+	static bool CreateContentPackage(const Array<Path>& paths, const Path& packagePath)
+	{
+		Array<ResourceInitData*> initDatas;
+		bool ret = true;
+		for (const auto& path : paths)
+		{
+			auto storage = StorageManager::GetStorage(path, true);
+			if (!storage)
+				continue;
+
+			auto lock = storage->Lock();
+			for (I32 i = 0; i < storage->GetEntriesCount() && ret; i++)
+			{
+				ResourceInitData srcData;
+				if (!storage->LoadResourceHeader(storage->GetEntry(i).guid, srcData))
+					continue;
+
+				ResourceInitData* initData = CJING_NEW(ResourceInitData);
+				initDatas.push_back(initData);
+				initData->header.guid = srcData.header.guid;
+				initData->header.type = srcData.header.type;
+				initData->customData = srcData.customData;
+
+				// Chunks are copied, saving the package changes the locations of the written chunks
+				for (I32 chunkIndex = 0; chunkIndex < MAX_RESOURCE_DATA_CHUNKS; chunkIndex++)
+				{
+					DataChunk* srcChunk = srcData.header.chunks[chunkIndex];
+					if (srcChunk == nullptr)
+						continue;
+
+					if (!storage->LoadChunk(srcChunk))
+					{
+						ret = false;
+						break;
+					}
+
+					DataChunk* chunk = CJING_NEW(DataChunk);
+					chunk->mem.Write(srcChunk->Data(), srcChunk->Size());
+					chunk->codec = srcChunk->codec;
+					initData->header.chunks[chunkIndex] = chunk;
+				}
+			}
+
+			if (!ret)
+			{
+				Logger::Error("Failed to load resources of %s", path.c_str());
+				break;
+			}
+		}
+
+		if (ret)
+			ret = ResourceStorage::CreatePackage(packagePath, Span<const ResourceInitData* const>(initDatas.data(), initDatas.size()), CookOptions().compression);
+
+		for (auto initData : initDatas)
+		{
+			for (auto chunk : initData->header.chunks)
+				CJING_SAFE_DELETE(chunk);
+			CJING_SAFE_DELETE(initData);
+		}
+		return ret && !initDatas.empty();
+	}
+
+	struct LayoutLoad
+	{
+		const Array<Path>* paths;
+		volatile I32 failedCount;
+		I32 startupFileOpens;
+		I32 loadFileOpens;
+		F32 startupTime;
+		F32 loadTime;
+	};
+
+	// Storages are created out of the storage manager, every pass opens the files again
+	static void LayoutLoadJob(void* data)
+	{
+		LayoutLoad* layout = static_cast<LayoutLoad*>(data);
+		Array<ResourceStorage*> storages;
+		Array<Array<DataChunk*>> storageChunks;
+
+		// Startup, open the storages and read the headers of the resources
+		Timer timer;
+		I32 fileOpens = ResourceStorage::Stats.fileOpens;
+		for (const auto& path : *layout->paths)
+		{
+			ResourceStorage* storage = CJING_NEW(ResourceStorage)(path);
+			storages.push_back(storage);
+			Array<DataChunk*>& chunks = storageChunks.emplace();
+			if (!storage->Load())
+			{
+				AtomicIncrement(&layout->failedCount);
+				continue;
+			}
+
+			for (I32 i = 0; i < storage->GetEntriesCount(); i++)
+			{
+				ResourceInitData initData;
+				if (!storage->LoadResourceHeader(storage->GetEntry(i).guid, initData))
+				{
+					AtomicIncrement(&layout->failedCount);
+					continue;
+				}
+
+				for (auto chunk : initData.header.chunks)
+				{
+					if (chunk != nullptr && chunk->ExistsInFile())
+						chunks.push_back(chunk);
+				}
+			}
+		}
+		layout->startupTime = timer.Tick();
+		layout->startupFileOpens = ResourceStorage::Stats.fileOpens - fileOpens;
+
+		// Level load, load all chunks
+		fileOpens = ResourceStorage::Stats.fileOpens;
+		for (U32 i = 0; i < storages.size(); i++)
+		{
+			if (storages[i]->IsLoaded() && !storages[i]->LoadChunks(Span<DataChunk* const>(storageChunks[i].data(), storageChunks[i].size())))
+				AtomicIncrement(&layout->failedCount);
+		}
+		layout->loadTime = timer.Tick();
+		layout->loadFileOpens = ResourceStorage::Stats.fileOpens - fileOpens;
+
+		for (auto storage : storages)
+		{
+			storage->Unload();
+			CJING_DELETE(storage);
+		}
+	}
+
+	static bool LoadLayout(const char* name, const Array<Path>& paths)
+	{
+		F32 bestStartupTime = FLT_MAX;
+		F32 bestLoadTime = FLT_MAX;
+		LayoutLoad layout;
+		for (U32 run = 0; run < RUN_COUNT; run++)
+		{
+			layout.paths = &paths;
+			layout.failedCount = 0;
+			Jobsystem::JobHandle handle;
+			Jobsystem::Run(&layout, LayoutLoadJob, &handle);
+			Jobsystem::Wait(&handle);
+			if (layout.failedCount > 0)
+			{
+				Logger::Error("Failed to load the %s layout", name);
+				return false;
+			}
+
+			bestStartupTime = std::min(bestStartupTime, layout.startupTime);
+			bestLoadTime = std::min(bestLoadTime, layout.loadTime);
+		}
+
+		Logger::Info("%-9s %5d files, startup %5d opens %.2f ms, level load %5d opens %.2f ms",
+			name,
+			paths.size(),
+			layout.startupFileOpens,
+			bestStartupTime * 1000.0f,
+			layout.loadFileOpens,
+			bestLoadTime * 1000.0f);
+		return true;
+	}
+
+	bool StorageBenchmark::RunPackages()
+	{
+		PROFILE_FUNCTION();
+		Array<Path> paths;
+		EnumerateStorages(Globals::EngineContentFolder, paths);
+		EnumerateStorages(Globals::ProjectContentFolder, paths);
+		if (paths.empty())
+		{
+			Logger::Warning("No storages to benchmark");
+			return false;
+		}
+
+		const Path packagePath = Globals::TemporaryFolder / "storage_benchmark" + PACKAGE_FILES_EXTENSION_WITH_DOT;
+		if (!CreateContentPackage(paths, packagePath))
+		{
+			Logger::Error("Failed to create the package %s", packagePath.c_str());
+			FileSystem::DeleteFile(packagePath.c_str());
+			return false;
+		}
+
+		// The package is compressed with the default options of the cooker, the per-file storages are as imported
+		Array<Path> packagePaths;
+		packagePaths.push_back(packagePath);
+		const bool ret = LoadLayout("Per-file", paths) && LoadLayout("Package", packagePaths);
+		FileSystem::DeleteFile(packagePath.c_str());
+		return ret;
+	}
+}
+}
\ No newline at end of file
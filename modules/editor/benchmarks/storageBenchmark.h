@@ -0,0 +1,25 @@
+#pragma once
+
+#include "editor\common.h"
+
+namespace VulkanTest
+{
+namespace Editor
+{
+	// Chunk loading of the resource storages of the engine and project content
+	class VULKAN_EDITOR_API StorageBenchmark
+	{
+	public:
+		// MB/s of each read mode loading all chunks: blocking reads (the path before batched loading),
+		// blocking reads on a pool of workers, decompression from the mapping, AsyncIO and the auto mode.
+		// Only the first pass reads cold files, clear the OS file cache (standby list) before running for cold numbers
+		static bool RunIO();
+		// Bytes copied and memory of loading the chunks of the largest model, by the file stream (the path before
+		// the mapping) and from the mapping. The mapped pass runs first, the peak working set only grows in a process
+		static bool RunChunkCopies();
+		// File opens and wall time of the startup (opening the storages and reading the resource headers) and
+		// the level load (loading all chunks) of the content, from the per-file layout and from a package of it
+		static bool RunPackages();
+	};
+}
+}
\ No newline at end of file
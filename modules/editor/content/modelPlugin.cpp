@@ -30,6 +30,7 @@ namespace Editor
 			ImGuiTreeNodeFlags flags = ImGuiTreeNodeFlags_DefaultOpen;
 			if (ImGui::CollapsingHeader("Geometry", flags))
 			{
+				ATTRIBUTE_EDITOR(optimizeMeshes);
 			}
 
 			if (ImGui::CollapsingHeader("Transform", flags))
@@ -40,6 +41,8 @@ namespace Editor
 			if (ImGui::CollapsingHeader("Level of details", flags))
 			{
 				ATTRIBUTE_EDITOR(autoLODs);
+				ATTRIBUTE_EDITOR(autoLodCount);
+				ATTRIBUTE_EDITOR(autoLodRatio);
 			}
 		}
 
@@ -31,6 +31,21 @@ namespace Editor
 		{
 			ATTRIBUTE_EDITOR(generateMipmaps);
 			ATTRIBUTE_EDITOR(compress);
+
+			if (settings.compress)
+			{
+				const char* formats[] = { "Auto", "BC1", "BC3", "BC4", "BC5", "BC7" };
+				I32 format = (I32)settings.format;
+				ImGuiEx::Label("format");
+				if (ImGui::Combo("##format", &format, formats, LengthOf(formats)))
+					settings.format = (TextureImporter::CompressionFormat)format;
+
+				const char* qualities[] = { "Fast", "Normal", "High" };
+				I32 quality = (I32)settings.quality;
+				ImGuiEx::Label("quality");
+				if (ImGui::Combo("##quality", &quality, qualities, LengthOf(qualities)))
+					settings.quality = (BlockCompression::Quality)quality;
+			}
 		}
 
 		bool HasSetting() const override
@@ -0,0 +1,214 @@
+#include "cooker.h"
+#include "steps\collectResourcesStep.h"
+#include "steps\cookResourcesStep.h"
+#include "core\filesystem\filesystem.h"
+#include "core\platform\atomic.h"
+#include "core\platform\timer.h"
+#include "core\serialization\json.h"
+#include "core\serialization\jsonWriter.h"
+#include "core\serialization\jsonUtils.h"
+
+namespace VulkanTest
+{
+namespace Editor
+{
+	const U32 Cooker::VERSION = 0x03;
+
+	static volatile I32 gIsRunning = 0;
+
+	static Path GetManifestPath(const CookingData& data)
+	{
+		return data.options.outputPath / "cook_manifest.json";
+	}
+
+	static U64 GetUint64(const rapidjson_flax::Value& node, const char* name)
+	{
+		auto member = node.FindMember(name);
+		return member != node.MemberEnd() && member->value.IsUint64() ? member->value.GetUint64() : 0;
+	}
+
+	// The manifest of the last cooking is used as the build cache.
+	// A forced cooking only loads the package names, so stale packages are still deleted
+	static void LoadManifest(CookingData& data)
+	{
+		const Path path = GetManifestPath(data);
+		if (!FileSystem::FileExists(path))
+			return;
+
+		OutputMemoryStream mem;
+		if (!FileSystem::LoadContext(path, mem))
+			return;
+
+		rapidjson_flax::Document document;
+		document.Parse((const char*)mem.Data(), mem.Size());
+		if (document.HasParseError() || !document.IsObject())
+		{
+			Logger::Warning("Invalid cook manifest %s", path.c_str());
+			return;
+		}
+
+		auto packagesIt = document.FindMember("Packages");
+		if (packagesIt != document.MemberEnd() && packagesIt->value.IsArray())
+		{
+			for (auto& packageValue : packagesIt->value.GetArray())
+			{
+				const String name = JsonUtils::GetString(packageValue, "Name");
+				if (name.empty())
+					continue;
+				data.lastPackageNames.push_back(name);
+
+				// Packages cooked by another version are cooked again
+				if (!data.options.force && JsonUtils::GetUint(document, "Version", 0) == Cooker::VERSION)
+					data.lastPackages.insert(StringID(name.c_str()).GetHashValue(), GetUint64(packageValue, "Hash"));
+			}
+		}
+
+		if (data.options.force)
+			return;
+
+		auto filesIt = document.FindMember("Files");
+		if (filesIt != document.MemberEnd() && filesIt->value.IsArray())
+		{
+			for (auto& fileValue : filesIt->value.GetArray())
+			{
+				const String filePath = JsonUtils::GetString(fileValue, "Path");
+				CookManifestEntry entry;
+				entry.modifiedTime = GetUint64(fileValue, "ModifiedTime");
+				entry.fileSize = GetUint64(fileValue, "Size");
+				entry.hash = GetUint64(fileValue, "Hash");
+				data.lastFiles.insert(Path(filePath.c_str()).GetHashValue(), entry);
+			}
+		}
+	}
+
+	static bool SaveManifest(const CookingData& data)
+	{
+		rapidjson_flax::StringBuffer buffer;
+		JsonWriter stream(buffer);
+		stream.StartObject();
+		{
+			stream.JKEY("Version");
+			stream.Uint(Cooker::VERSION);
+
+			stream.JKEY("Packages");
+			stream.StartArray();
+			for (const auto& package : data.packages)
+			{
+				stream.StartObject();
+				stream.JKEY("Name");
+				stream.String(package.name);
+				stream.JKEY("Hash");
+				stream.Uint64(package.hash);
+				stream.JKEY("Resources");
+				stream.StartArray();
+				for (I32 resIndex : package.resources)
+				{
+					const auto& res = data.resources[resIndex];
+					stream.StartObject();
+					stream.JKEY("ID");
+					stream.Guid(res.info.guid);
+					stream.JKEY("Path");
+					stream.String(res.cookedPath.c_str());
+					stream.EndObject();
+				}
+				stream.EndArray();
+				stream.EndObject();
+			}
+			stream.EndArray();
+
+			stream.JKEY("Files");
+			stream.StartArray();
+			for (const auto& file : data.files)
+			{
+				stream.StartObject();
+				stream.JKEY("Path");
+				stream.String(file.path.c_str());
+				stream.JKEY("ModifiedTime");
+				stream.Uint64(file.modifiedTime);
+				stream.JKEY("Size");
+				stream.Uint64(file.fileSize);
+				stream.JKEY("Hash");
+				stream.Uint64(file.hash);
+				stream.EndObject();
+			}
+			stream.EndArray();
+		}
+		stream.EndObject();
+
+		const Path path = GetManifestPath(data);
+		auto file = FileSystem::OpenFile(path.c_str(), FileFlags::DEFAULT_WRITE);
+		if (!file || !file->Write(buffer.GetString(), buffer.GetSize()))
+		{
+			Logger::Error("Failed to save cook manifest %s", path.c_str());
+			return false;
+		}
+		file->Close();
+		return true;
+	}
+
+	bool Cooker::Cook(const CookOptions& options)
+	{
+		PROFILE_FUNCTION();
+		if (options.outputPath.IsEmpty())
+		{
+			Logger::Error("Missing cooking output path");
+			return false;
+		}
+
+		if (AtomicCmpExchange(&gIsRunning, 1, 0) != 0)
+		{
+			Logger::Warning("Cooker is already running");
+			return false;
+		}
+
+		Logger::Info("Cooking to %s", options.outputPath.c_str());
+		Timer timer;
+
+		CookingData data;
+		data.options.outputPath = options.outputPath;
+		data.options.scenes = options.scenes.copy();
+		data.options.force = options.force;
+		data.options.compression = options.compression;
+		LoadManifest(data);
+
+		CollectResourcesStep collectStep;
+		CookResourcesStep cookStep;
+		CookingStep* steps[] = { &collectStep, &cookStep };
+
+		bool ret = true;
+		for (auto step : steps)
+		{
+			if (!step->Perform(data))
+			{
+				ret = false;
+				break;
+			}
+		}
+
+		if (ret)
+			ret = SaveManifest(data);
+
+		if (ret)
+		{
+			Logger::Info("Cooking finished in %.2fs: %d resources, %d packages cooked, %d packages up to date, %d files hashed",
+				timer.GetTimeSinceStart(),
+				data.resources.size(),
+				data.cookedPackages,
+				data.skippedPackages,
+				data.hashedFiles);
+		}
+		else
+		{
+			Logger::Error("Cooking failed");
+		}
+
+		AtomicStore(&gIsRunning, 0);
+		return ret;
+	}
+
+	bool Cooker::IsRunning()
+	{
+		return AtomicRead(&gIsRunning) != 0;
+	}
+}
+}
\ No newline at end of file
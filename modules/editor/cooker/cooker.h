@@ -0,0 +1,101 @@
+#pragma once
+
+#include "editor\common.h"
+#include "content\resourceInfo.h"
+#include "content\compress\compressor.h"
+
+namespace VulkanTest
+{
+namespace Editor
+{
+	struct CookOptions
+	{
+		// Output folder, cooked packages are written into its content folder
+		Path outputPath;
+		// Scenes to cook, all scenes of the project content are cooked if empty
+		Array<Path> scenes;
+		// Ignore the build cache and cook all packages
+		bool force = false;
+		// Small chunks of a package share a trained dictionary
+		CompressionOptions compression = { 1, Compressor::HC_LEVEL_DEFAULT, true };
+	};
+
+	// Source file of collected resources
+	struct CookFile
+	{
+		Path path;
+		U64 modifiedTime = 0;
+		U64 fileSize = 0;
+		U64 hash = 0;
+	};
+
+	struct CookResource
+	{
+		ResourceInfo info;
+		// Path used to load the resource in the shipping build, relative to the output folder
+		Path cookedPath;
+		bool isJson = false;
+		I32 file = -1;
+		I32 package = -1;
+	};
+
+	struct CookPackage
+	{
+		String name;
+		Array<I32> resources;
+		U64 hash = 0;
+		bool changed = true;
+	};
+
+	struct CookManifestEntry
+	{
+		U64 modifiedTime = 0;
+		U64 fileSize = 0;
+		U64 hash = 0;
+	};
+
+	struct CookingData
+	{
+		CookOptions options;
+
+		Array<CookFile> files;
+		HashMap<U64, I32> fileMap;
+		Array<CookResource> resources;
+		HashMap<Guid, I32> resourceMap;
+		Array<CookPackage> packages;
+
+		// Build manifest of the last cooking, keyed by path hash and package name hash
+		HashMap<U64, CookManifestEntry> lastFiles;
+		HashMap<U64, U64> lastPackages;
+		Array<String> lastPackageNames;
+
+		// Stats
+		U32 hashedFiles = 0;
+		U32 cookedPackages = 0;
+		U32 skippedPackages = 0;
+
+		Path GetContentOutputPath()const {
+			return options.outputPath / "content";
+		}
+	};
+
+	class CookingStep
+	{
+	public:
+		virtual ~CookingStep() = default;
+		virtual bool Perform(CookingData& data) = 0;
+	};
+
+	// Bakes the resources referenced by scenes into packages for the shipping build.
+	// Cooking is incremental, a package is rewritten only if the hash of its sources is changed.
+	class VULKAN_EDITOR_API Cooker
+	{
+	public:
+		// Bump it to invalidate all cooked packages
+		static const U32 VERSION;
+
+		static bool Cook(const CookOptions& options);
+		static bool IsRunning();
+	};
+}
+}
\ No newline at end of file
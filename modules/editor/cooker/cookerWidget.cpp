@@ -0,0 +1,113 @@
+#include "cookerWidget.h"
+#include "cooker.h"
+#include "editor\editor.h"
+#include "core\globals.h"
+#include "core\threading\jobsystem.h"
+#include "imgui-docking\imgui.h"
+
+namespace VulkanTest
+{
+namespace Editor
+{
+	class CookerWidgetImpl : public CookerWidget
+	{
+	private:
+		EditorApp& editor;
+		char outputPath[MAX_PATH_LENGTH];
+		bool force = false;
+		CompressionOptions compression = CookOptions().compression;
+		bool lastResult = true;
+		bool hasCooked = false;
+		Jobsystem::JobHandle jobHandle;
+
+	public:
+		CookerWidgetImpl(EditorApp& editor_) :
+			editor(editor_)
+		{
+			isOpen = false;
+			CopyString(outputPath, (Globals::ProjectFolder / "cooked").c_str());
+		}
+
+		~CookerWidgetImpl()
+		{
+			Jobsystem::Wait(&jobHandle);
+		}
+
+		void OnGUI()override
+		{
+			if (!isOpen) return;
+
+			if (ImGui::Begin(ICON_FA_BOXES "Cooker##cooker", &isOpen))
+			{
+				const bool isRunning = Cooker::IsRunning() || jobHandle.GetCounter() > 0;
+				if (isRunning)
+					ImGui::BeginDisabled();
+
+				ImGui::InputText("Output", outputPath, sizeof(outputPath));
+				ImGui::Checkbox("Force", &force);
+				if (ImGui::IsItemHovered())
+					ImGui::SetTooltip("Ignore the build cache and cook all packages");
+
+				bool useHC = compression.hcLevel > 0;
+				if (ImGui::Checkbox("High compression", &useHC))
+					compression.hcLevel = useHC ? Compressor::HC_LEVEL_DEFAULT : 0;
+				if (ImGui::IsItemHovered())
+					ImGui::SetTooltip("Compress with LZ4HC, slower to cook with a better ratio and the same decompression speed");
+				if (useHC)
+				{
+					ImGui::SliderInt("Level", &compression.hcLevel, Compressor::HC_LEVEL_MIN, Compressor::HC_LEVEL_MAX);
+					if (ImGui::IsItemHovered())
+						ImGui::SetTooltip("Higher is slower to compress with a better ratio");
+				}
+				else
+				{
+					ImGui::SliderInt("Acceleration", &compression.acceleration, 1, 64);
+					if (ImGui::IsItemHovered())
+						ImGui::SetTooltip("Higher is faster to compress with a lower ratio");
+				}
+				ImGui::Checkbox("Dictionary", &compression.useDictionary);
+				if (ImGui::IsItemHovered())
+					ImGui::SetTooltip("Compress small chunks with a dictionary trained over each package");
+
+				if (ImGui::Button("Cook"))
+					Cook();
+
+				if (isRunning)
+					ImGui::EndDisabled();
+
+				if (isRunning)
+					ImGui::TextUnformatted("Cooking...");
+				else if (hasCooked)
+					ImGui::TextUnformatted(lastResult ? "Cooking finished" : "Cooking failed, see the log for details");
+			}
+			ImGui::End();
+		}
+
+		const char* GetName()override
+		{
+			return "CookerWidget";
+		}
+
+	private:
+		void Cook()
+		{
+			// Cooking blocks on file IO, run it on long-running workers so that frame workers are never starved,
+			// the parallel cooking steps inherit the priority
+			Jobsystem::Run(this, [](void* data) {
+				CookerWidgetImpl* widget = static_cast<CookerWidgetImpl*>(data);
+				CookOptions options;
+				options.outputPath = Path(widget->outputPath);
+				options.force = widget->force;
+				options.compression = widget->compression;
+				widget->lastResult = Cooker::Cook(options);
+				widget->hasCooked = true;
+			}, &jobHandle, Jobsystem::ANY_WORKER, Jobsystem::JobPriority::LongRunning);
+		}
+	};
+
+	UniquePtr<CookerWidget> CookerWidget::Create(EditorApp& app)
+	{
+		return CJING_MAKE_UNIQUE<CookerWidgetImpl>(app);
+	}
+}
+}
\ No newline at end of file
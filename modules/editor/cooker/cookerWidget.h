@@ -0,0 +1,19 @@
+#pragma once
+
+#include "editor\common.h"
+#include "editor\editorPlugin.h"
+
+namespace VulkanTest
+{
+namespace Editor
+{
+	class EditorApp;
+
+	class VULKAN_EDITOR_API CookerWidget : public EditorWidget
+	{
+	public:
+		static UniquePtr<CookerWidget> Create(EditorApp& app);
+		virtual ~CookerWidget() {};
+	};
+}
+}
\ No newline at end of file
@@ -0,0 +1,504 @@
+#include "collectResourcesStep.h"
+#include "core\globals.h"
+#include "core\filesystem\filesystem.h"
+#include "core\platform\atomic.h"
+#include "core\serialization\json.h"
+#include "core\serialization\jsonUtils.h"
+#include "core\serialization\serialization.h"
+#include "core\threading\jobsystem.h"
+#include "content\resourceManager.h"
+#include "content\storage\storageManager.h"
+#include "content\resources\model.h"
+#include "content\resources\material.h"
+
+namespace VulkanTest
+{
+namespace Editor
+{
+	static const I32 NO_OWNER = -1;
+	static const I32 SHARED_OWNER = -2;
+	static const I32 ENGINE_OWNER = -3;
+
+	// Source files are hashed in blocks, so large files are never loaded at once
+	static const U64 HASH_BLOCK_SIZE = 1024 * 1024;
+
+	struct ResourceReferences
+	{
+		Array<Guid> guids;
+		Array<Path> paths;
+	};
+
+	static bool IsBinaryResource(const Path& path)
+	{
+		auto extension = Path::GetExtension(path.ToSpan());
+		return EqualString(extension, RESOURCE_FILES_EXTENSION) || EqualString(extension, PACKAGE_FILES_EXTENSION);
+	}
+
+	static void EnumerateFiles(const Path& dir, const char* extension, Array<Path>& outPaths)
+	{
+		auto fileList = FileSystem::Enumerate(dir.c_str());
+		for (const auto& fileInfo : fileList)
+		{
+			if (fileInfo.filename[0] == '.')
+				continue;
+
+			if (fileInfo.type == PathType::Directory)
+				EnumerateFiles(dir / fileInfo.filename, extension, outPaths);
+			else if (EndsWith(fileInfo.filename, extension))
+				outPaths.push_back(dir / fileInfo.filename);
+		}
+	}
+
+	static bool LoadJson(const Path& path, rapidjson_flax::Document& document)
+	{
+		OutputMemoryStream mem;
+		if (!FileSystem::LoadContext(path.c_str(), mem))
+			return false;
+
+		document.Parse((const char*)mem.Data(), mem.Size());
+		if (document.HasParseError() || !document.IsObject())
+		{
+			Logger::Warning("Failed to parse json resource %s", path.c_str());
+			return false;
+		}
+		return true;
+	}
+
+	static bool GetResourceInfo(const Path& path, ResourceInfo& info)
+	{
+		if (IsBinaryResource(path))
+			return ResourceManager::GetResourceInfo(path, info);
+
+		// Json resources store their guid and typename in the file
+		rapidjson_flax::Document document;
+		if (!LoadJson(path, document))
+			return false;
+
+		info.guid = JsonUtils::GetGuid(document, "ID");
+		info.type = ResourceType(JsonUtils::GetString(document, "Typename").c_str());
+		info.path = path;
+		return info.guid.IsValid();
+	}
+
+	// Guids of json resources are stored as strings
+	static void CollectJsonReferences(rapidjson_flax::Value& value, Array<Guid>& guids)
+	{
+		if (value.IsString())
+		{
+			if (value.GetStringLength() == 32)
+			{
+				const Guid guid = DeserializeGuid(value);
+				if (guid.IsValid())
+					guids.push_back(guid);
+			}
+		}
+		else if (value.IsObject())
+		{
+			for (auto it = value.MemberBegin(); it != value.MemberEnd(); ++it)
+				CollectJsonReferences(it->value, guids);
+		}
+		else if (value.IsArray())
+		{
+			for (auto& element : value.GetArray())
+				CollectJsonReferences(element, guids);
+		}
+	}
+
+	static void CollectModelReferences(InputMemoryStream& input, ResourceReferences& refs)
+	{
+		// Material slots
+		I32 materialCount = 0;
+		input.Read(materialCount);
+		for (I32 i = 0; i < materialCount; i++)
+		{
+			Guid matGuid;
+			input.Read(matGuid);
+			refs.guids.push_back(matGuid);
+
+			I32 nameLength;
+			input.Read(nameLength);
+			input.SetPos(input.GetPos() + nameLength);
+		}
+	}
+
+	static void CollectMaterialReferences(InputMemoryStream& input, ResourceReferences& refs)
+	{
+		// Same layout as MaterialParams::Load, textures are referenced by path
+		I32 paramsCount = 0;
+		input.Read(paramsCount);
+		for (I32 i = 0; i < paramsCount; i++)
+		{
+			auto type = static_cast<MaterialParameterType>(input.Read<U8>());
+			input.ReadStringWithLength();
+			input.Read<U8>();
+			input.Read<U16>();
+
+			switch (type)
+			{
+			case MaterialParameterType::Bool:
+				input.Read<bool>();
+				break;
+			case MaterialParameterType::Integer:
+				input.Read<I32>();
+				break;
+			case MaterialParameterType::Float:
+				input.Read<F32>();
+				break;
+			case MaterialParameterType::Vector2:
+				input.Read<F32x2>();
+				break;
+			case MaterialParameterType::Vector3:
+				input.Read<F32x3>();
+				break;
+			case MaterialParameterType::Color:
+				input.Read<U32>();
+				break;
+			case MaterialParameterType::Texture:
+			{
+				String path = input.ReadStringWithLength();
+				if (!path.empty())
+					refs.paths.push_back(Path(path.c_str()));
+			}
+				break;
+			default:
+				break;
+			}
+		}
+	}
+
+	static bool CollectBinaryReferences(const ResourceInfo& info, ResourceReferences& refs)
+	{
+		I32 chunkIndex = INVALID_CHUNK_INDEX;
+		if (info.type == Model::ResType)
+			chunkIndex = 0;
+		else if (info.type == Material::ResType)
+			chunkIndex = MATERIAL_CHUNK_PARAMS;
+		else
+			return true;
+
+		auto storage = StorageManager::GetStorage(info.path, true);
+		if (!storage)
+			return false;
+
+		auto lock = storage->Lock();
+		ResourceInitData initData;
+		if (!storage->LoadResourceHeader(info.guid, initData))
+			return false;
+
+		DataChunk* chunk = initData.header.chunks[chunkIndex];
+		if (chunk == nullptr)
+			return true;
+		if (!storage->LoadChunk(chunk))
+			return false;
+
+		InputMemoryStream input(chunk->Data(), chunk->Size());
+		if (info.type == Model::ResType)
+			CollectModelReferences(input, refs);
+		else
+			CollectMaterialReferences(input, refs);
+		return true;
+	}
+
+	static void CollectReferences(const CookResource& res, ResourceReferences& refs)
+	{
+		if (res.isJson)
+		{
+			rapidjson_flax::Document document;
+			if (LoadJson(res.info.path, document))
+				CollectJsonReferences(document, refs.guids);
+		}
+		else if (!CollectBinaryReferences(res.info, refs))
+		{
+			Logger::Warning("Failed to collect references of %s", res.info.path.c_str());
+		}
+	}
+
+	static void HashFile(const CookingData& data, CookFile& file, volatile I32& hashedFiles)
+	{
+		FileInfo fileInfo;
+		if (!FileSystem::StatFile(file.path.c_str(), fileInfo))
+		{
+			Logger::Warning("Failed to stat %s", file.path.c_str());
+			return;
+		}
+		file.modifiedTime = fileInfo.modifiedTime;
+		file.fileSize = fileInfo.fileSize;
+
+		// Unchanged files reuse the hash in the build manifest
+		auto it = data.lastFiles.find(file.path.GetHashValue());
+		if (it.isValid() &&
+			it.value().modifiedTime == file.modifiedTime &&
+			it.value().fileSize == file.fileSize)
+		{
+			file.hash = it.value().hash;
+			return;
+		}
+
+		auto stream = FileSystem::OpenFile(file.path.c_str(), FileFlags::DEFAULT_READ);
+		if (!stream || !stream->IsValid())
+		{
+			Logger::Warning("Failed to read %s", file.path.c_str());
+			return;
+		}
+
+		HashCombiner hasher;
+		hasher.HashCombine((U64)file.fileSize);
+
+		OutputMemoryStream buffer;
+		buffer.Resize(std::min(HASH_BLOCK_SIZE, (U64)file.fileSize));
+		U64 remaining = file.fileSize;
+		while (remaining > 0)
+		{
+			const U64 size = std::min(remaining, HASH_BLOCK_SIZE);
+			if (!stream->Read(buffer.Data(), size))
+			{
+				Logger::Warning("Failed to read %s", file.path.c_str());
+				return;
+			}
+			hasher.HashCombine((U64)XXHash64(buffer.Data(), size));
+			remaining -= size;
+		}
+		stream->Close();
+
+		file.hash = hasher.Get();
+		AtomicIncrement(&hashedFiles);
+	}
+
+	class ResourceCollector
+	{
+	public:
+		ResourceCollector(CookingData& data_) :
+			data(data_)
+		{
+		}
+
+		~ResourceCollector()
+		{
+			for (auto refs : references)
+				CJING_SAFE_DELETE(refs);
+		}
+
+		I32 AddResource(const ResourceInfo& info)
+		{
+			auto it = data.resourceMap.find(info.guid);
+			if (it.isValid())
+				return it.value();
+
+			const I32 index = (I32)data.resources.size();
+			auto& res = data.resources.emplace();
+			res.info = info;
+			res.isJson = !IsBinaryResource(info.path);
+			res.cookedPath = GetCookedPath(info.path);
+			res.file = AddFile(info.path);
+			data.resourceMap.insert(info.guid, index);
+
+			owners.push_back(NO_OWNER);
+			lastVisitors.push_back(NO_OWNER);
+			references.push_back(nullptr);
+			return index;
+		}
+
+		// Collect the dependency closure of the scene, references are scanned in parallel per level
+		void CollectScene(I32 sceneIndex, I32 root)
+		{
+			Array<I32> level;
+			Visit(root, sceneIndex, level);
+			while (!level.empty())
+			{
+				Array<I32> toScan;
+				for (I32 index : level)
+				{
+					if (references[index] == nullptr)
+					{
+						references[index] = CJING_NEW(ResourceReferences);
+						toScan.push_back(index);
+					}
+				}
+
+				Jobsystem::ForEach(toScan.size(), 1, [&](U32 begin, U32 end) {
+					for (U32 i = begin; i < end; i++)
+						CollectReferences(data.resources[toScan[i]], *references[toScan[i]]);
+				});
+
+				Array<I32> nextLevel;
+				for (I32 index : level)
+				{
+					const ResourceReferences& refs = *references[index];
+					for (const auto& guid : refs.guids)
+					{
+						ResourceInfo info;
+						if (ResourceManager::GetResourceInfo(guid, info))
+							Visit(AddResource(info), sceneIndex, nextLevel);
+					}
+					for (const auto& path : refs.paths)
+					{
+						ResourceInfo info;
+						if (GetResourceInfo(path, info))
+							Visit(AddResource(info), sceneIndex, nextLevel);
+						else
+							Logger::Warning("Missing resource %s referenced by %s", path.c_str(), data.resources[index].info.path.c_str());
+					}
+				}
+				level = std::move(nextLevel);
+			}
+		}
+
+		void CollectEngineContent()
+		{
+			Array<Path> paths;
+			EnumerateFiles(Globals::EngineContentFolder, RESOURCE_FILES_EXTENSION_WITH_DOT, paths);
+			for (const auto& path : paths)
+			{
+				ResourceInfo info;
+				if (ResourceManager::GetResourceInfo(path, info))
+					owners[AddResource(info)] = ENGINE_OWNER;
+			}
+		}
+
+		void AssignPackages(Span<const Path> scenes)
+		{
+			HashMap<I32, I32> ownerPackages;
+			for (I32 i = 0; i < (I32)data.resources.size(); i++)
+			{
+				const I32 owner = owners[i];
+				auto it = ownerPackages.find(owner);
+				if (!it.isValid())
+				{
+					ownerPackages.insert(owner, (I32)data.packages.size());
+					auto& package = data.packages.emplace();
+					if (owner == ENGINE_OWNER)
+						package.name = "engine";
+					else if (owner == SHARED_OWNER)
+						package.name = "shared";
+					else
+						package.name = GetScenePackageName(scenes[owner]);
+					it = ownerPackages.find(owner);
+				}
+
+				data.resources[i].package = it.value();
+				data.packages[it.value()].resources.push_back(i);
+			}
+
+			// Keep the order of package entries stable, so the package hash only depends on the contents
+			for (auto& package : data.packages)
+			{
+				std::sort(package.resources.begin(), package.resources.end(), [&](I32 a, I32 b) {
+					return data.resources[a].info.guid < data.resources[b].info.guid;
+				});
+			}
+		}
+
+	private:
+		void Visit(I32 index, I32 sceneIndex, Array<I32>& level)
+		{
+			if (lastVisitors[index] == sceneIndex)
+				return;
+
+			lastVisitors[index] = sceneIndex;
+			if (owners[index] == NO_OWNER)
+				owners[index] = sceneIndex;
+			else
+				owners[index] = SHARED_OWNER;
+
+			level.push_back(index);
+		}
+
+		I32 AddFile(const Path& path)
+		{
+			auto it = data.fileMap.find(path.GetHashValue());
+			if (it.isValid())
+				return it.value();
+
+			const I32 index = (I32)data.files.size();
+			data.files.emplace().path = path;
+			data.fileMap.insert(path.GetHashValue(), index);
+			return index;
+		}
+
+		// Paths are relative to the output folder, which is the working folder of the shipping build
+		static Path GetCookedPath(const Path& path)
+		{
+			if (StartsWith(path.c_str(), Globals::EngineContentFolder.c_str()))
+				return Path("content") / Path::ConvertAbsolutePathToRelative(Globals::EngineContentFolder, path);
+			return Path::ConvertAbsolutePathToRelative(Globals::ProjectFolder, path);
+		}
+
+		String GetScenePackageName(const Path& scenePath)
+		{
+			String name = String(Path::GetBaseName(scenePath.c_str()));
+			String ret = name;
+			for (I32 i = 1; IsPackageNameUsed(ret); i++)
+			{
+				ret = name;
+				ret += "_";
+				ret += std::to_string(i).c_str();
+			}
+			return ret;
+		}
+
+		bool IsPackageNameUsed(const String& name)const
+		{
+			if (name == "engine" || name == "shared")
+				return true;
+
+			for (const auto& package : data.packages)
+			{
+				if (package.name == name)
+					return true;
+			}
+			return false;
+		}
+
+	private:
+		CookingData& data;
+		Array<I32> owners;
+		Array<I32> lastVisitors;
+		Array<ResourceReferences*> references;
+	};
+
+	bool CollectResourcesStep::Perform(CookingData& data)
+	{
+		PROFILE_FUNCTION();
+		Logger::Info("Collecting resources");
+
+		Array<Path> scenes;
+		if (data.options.scenes.empty())
+			EnumerateFiles(Globals::ProjectContentFolder, ".scene", scenes);
+		else
+			scenes = data.options.scenes.copy();
+
+		if (scenes.empty())
+		{
+			Logger::Error("No scene to cook");
+			return false;
+		}
+
+		ResourceCollector collector(data);
+		for (I32 i = 0; i < (I32)scenes.size(); i++)
+		{
+			ResourceInfo info;
+			if (!GetResourceInfo(scenes[i], info))
+			{
+				Logger::Error("Failed to load scene %s", scenes[i].c_str());
+				return false;
+			}
+			collector.CollectScene(i, collector.AddResource(info));
+		}
+
+		// Internal resources are loaded by path at runtime, so engine content is always cooked
+		collector.CollectEngineContent();
+		collector.AssignPackages(Span(scenes.data(), scenes.size()));
+
+		// Hash source files
+		volatile I32 hashedFiles = 0;
+		Jobsystem::ForEach(data.files.size(), 1, [&](U32 begin, U32 end) {
+			for (U32 i = begin; i < end; i++)
+				HashFile(data, data.files[i], hashedFiles);
+		});
+		data.hashedFiles = (U32)hashedFiles;
+
+		Logger::Info("Collected %d resources from %d scenes", data.resources.size(), scenes.size());
+		return true;
+	}
+}
+}
\ No newline at end of file
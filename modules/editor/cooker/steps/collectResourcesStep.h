@@ -0,0 +1,17 @@
+#pragma once
+
+#include "editor\cooker\cooker.h"
+
+namespace VulkanTest
+{
+namespace Editor
+{
+	// Collects the dependency closure of the cooked scenes and engine content,
+	// assigns resources to packages and hashes their source files.
+	class CollectResourcesStep : public CookingStep
+	{
+	public:
+		bool Perform(CookingData& data) override;
+	};
+}
+}
\ No newline at end of file
@@ -0,0 +1,209 @@
+#include "cookResourcesStep.h"
+#include "core\filesystem\filesystem.h"
+#include "core\platform\atomic.h"
+#include "core\threading\jobsystem.h"
+#include "content\resourcesCache.h"
+#include "content\storage\storageManager.h"
+
+namespace VulkanTest
+{
+namespace Editor
+{
+	static Path GetPackagePath(const CookingData& data, const CookPackage& package)
+	{
+		return data.GetContentOutputPath() / package.name + PACKAGE_FILES_EXTENSION_WITH_DOT;
+	}
+
+	static U64 ComputePackageHash(const CookingData& data, const CookPackage& package)
+	{
+		HashCombiner hasher;
+		hasher.HashCombine(Cooker::VERSION);
+		hasher.HashCombine(data.options.compression.acceleration);
+		hasher.HashCombine(data.options.compression.hcLevel);
+		hasher.HashCombine((U32)data.options.compression.useDictionary);
+		hasher.HashCombine(data.options.compression.maxDictionarySize);
+		hasher.HashCombine(data.options.compression.blockSize);
+		for (I32 index : package.resources)
+		{
+			const auto& res = data.resources[index];
+			hasher.HashCombine(res.info.guid.A);
+			hasher.HashCombine(res.info.guid.B);
+			hasher.HashCombine(res.info.guid.C);
+			hasher.HashCombine(res.info.guid.D);
+			hasher.HashCombine(res.info.type.GetHashValue());
+			hasher.HashCombine(res.cookedPath.GetHashValue());
+			hasher.HashCombine(data.files[res.file].hash);
+		}
+		return hasher.Get();
+	}
+
+	static bool LoadResourceData(const CookResource& res, ResourceInitData& initData)
+	{
+		initData.header.guid = res.info.guid;
+		initData.header.type = res.info.type;
+
+		// Json resources are stored as the text in the first chunk
+		if (res.isJson)
+		{
+			DataChunk* chunk = CJING_NEW(DataChunk);
+			initData.header.chunks[0] = chunk;
+			return FileSystem::LoadContext(res.info.path.c_str(), chunk->mem);
+		}
+
+		auto storage = StorageManager::GetStorage(res.info.path, true);
+		if (!storage)
+			return false;
+
+		auto lock = storage->Lock();
+		ResourceInitData srcData;
+		if (!storage->LoadResourceHeader(res.info.guid, srcData))
+			return false;
+
+		// Chunks are copied, saving the package changes the locations of the written chunks
+		initData.customData = srcData.customData;
+		for (I32 i = 0; i < MAX_RESOURCE_DATA_CHUNKS; i++)
+		{
+			DataChunk* srcChunk = srcData.header.chunks[i];
+			if (srcChunk == nullptr)
+				continue;
+
+			if (!storage->LoadChunk(srcChunk))
+				return false;
+
+			DataChunk* chunk = CJING_NEW(DataChunk);
+			chunk->mem.Write(srcChunk->Data(), srcChunk->Size());
+			chunk->codec = srcChunk->codec;
+			initData.header.chunks[i] = chunk;
+		}
+		return true;
+	}
+
+	static bool WritePackage(const CookingData& data, const CookPackage& package)
+	{
+		PROFILE_FUNCTION();
+		Array<ResourceInitData*> initDatas;
+		bool ret = true;
+		for (I32 index : package.resources)
+		{
+			const auto& res = data.resources[index];
+			ResourceInitData* initData = CJING_NEW(ResourceInitData);
+			initDatas.push_back(initData);
+			if (!LoadResourceData(res, *initData))
+			{
+				Logger::Error("Failed to load resource %s", res.info.path.c_str());
+				ret = false;
+				break;
+			}
+		}
+
+		const Path path = GetPackagePath(data, package);
+		if (ret)
+		{
+			ret = ResourceStorage::CreatePackage(path, Span<const ResourceInitData* const>(initDatas.data(), initDatas.size()), data.options.compression);
+			if (!ret)
+				Logger::Error("Failed to write package %s", path.c_str());
+		}
+
+		for (auto initData : initDatas)
+		{
+			for (auto chunk : initData->header.chunks)
+				CJING_SAFE_DELETE(chunk);
+			CJING_SAFE_DELETE(initData);
+		}
+		return ret;
+	}
+
+	static bool WriteResourceCache(const CookingData& data)
+	{
+		HashMap<Guid, ResourcesCache::Entry> registry;
+		HashMap<Path, Guid> pathMapping;
+		for (const auto& res : data.resources)
+		{
+			const auto& package = data.packages[res.package];
+			ResourcesCache::Entry entry;
+			entry.info = ResourceInfo(res.info.guid, res.info.type, Path("content") / package.name + PACKAGE_FILES_EXTENSION_WITH_DOT);
+			registry.insert(res.info.guid, entry);
+			pathMapping.insert(res.cookedPath, res.info.guid);
+		}
+
+		const Path path = data.GetContentOutputPath() / "resource_cache.bin";
+		return ResourcesCache::Save(path, registry, pathMapping, ResorucesCacheFlags::RelativePaths);
+	}
+
+	// Remove packages of the last cooking which are not cooked anymore
+	static void DeleteStalePackages(const CookingData& data)
+	{
+		for (const auto& name : data.lastPackageNames)
+		{
+			bool isStale = true;
+			for (const auto& package : data.packages)
+			{
+				if (package.name == name)
+				{
+					isStale = false;
+					break;
+				}
+			}
+
+			const Path path = data.GetContentOutputPath() / name + PACKAGE_FILES_EXTENSION_WITH_DOT;
+			if (isStale && FileSystem::FileExists(path.c_str()))
+			{
+				Logger::Info("Delete stale package %s", path.c_str());
+				FileSystem::DeleteFile(path.c_str());
+			}
+		}
+	}
+
+	bool CookResourcesStep::Perform(CookingData& data)
+	{
+		PROFILE_FUNCTION();
+		Logger::Info("Cooking resources");
+
+		const Path contentPath = data.GetContentOutputPath();
+		if (!Platform::DirExists(data.options.outputPath.c_str()))
+			Platform::MakeDir(data.options.outputPath.c_str());
+		if (!Platform::DirExists(contentPath.c_str()))
+			Platform::MakeDir(contentPath.c_str());
+
+		// Only the packages whose sources are changed are cooked again
+		Array<I32> toCook;
+		for (I32 i = 0; i < (I32)data.packages.size(); i++)
+		{
+			auto& package = data.packages[i];
+			package.hash = ComputePackageHash(data, package);
+
+			auto it = data.lastPackages.find(StringID(package.name.c_str()).GetHashValue());
+			package.changed = !it.isValid() ||
+				it.value() != package.hash ||
+				!FileSystem::FileExists(GetPackagePath(data, package).c_str());
+			if (package.changed)
+				toCook.push_back(i);
+		}
+
+		volatile I32 failedCount = 0;
+		Jobsystem::ForEach(toCook.size(), 1, [&](U32 begin, U32 end) {
+			for (U32 i = begin; i < end; i++)
+			{
+				const auto& package = data.packages[toCook[i]];
+				Logger::Info("Cook package %s (%d resources)", package.name.c_str(), package.resources.size());
+				if (!WritePackage(data, package))
+					AtomicIncrement(&failedCount);
+			}
+		});
+
+		data.cookedPackages = toCook.size();
+		data.skippedPackages = data.packages.size() - toCook.size();
+		if (failedCount > 0)
+			return false;
+
+		DeleteStalePackages(data);
+
+		if (!WriteResourceCache(data))
+		{
+			Logger::Error("Failed to write resource cache");
+			return false;
+		}
+		return true;
+	}
+}
+}
\ No newline at end of file
@@ -0,0 +1,16 @@
+#pragma once
+
+#include "editor\cooker\cooker.h"
+
+namespace VulkanTest
+{
+namespace Editor
+{
+	// Writes the changed packages in parallel and the resource cache of the shipping build
+	class CookResourcesStep : public CookingStep
+	{
+	public:
+		bool Perform(CookingData& data) override;
+	};
+}
+}
\ No newline at end of file
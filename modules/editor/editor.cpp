@@ -30,6 +30,9 @@
 #include "widgets\renderGraph.h"
 #include "widgets\gizmo.h"
 #include "widgets\profiler.h"
+#include "cooker\cooker.h"
+#include "cooker\cookerWidget.h"
+#include "benchmarks\benchmarks.h"
 
 #include "imgui-docking\imgui.h"
 
@@ -252,6 +255,7 @@ namespace Editor
             entityListWidget = CJING_MAKE_UNIQUE<EntityListWidget>(*this);
             propertyWidget = CJING_MAKE_UNIQUE<PropertyWidget>(*this);
             profilerWidget = ProfilerWidget::Create(*this);
+            cookerWidget = CookerWidget::Create(*this);
             logWidget = CJING_MAKE_UNIQUE<LogWidget>();
 
             // Load modules
@@ -289,6 +293,7 @@ namespace Editor
             AddWidget(*assetBrowser);
             AddWidget(*entityListWidget);
             AddWidget(*profilerWidget);
+            AddWidget(*cookerWidget);
             AddWidget(*renderGraphWidget);
             AddWidget(*propertyWidget);
             AddWidget(*logWidget);
@@ -345,6 +350,7 @@ namespace Editor
             assetImporter.Reset();
             entityListWidget.Reset();
             profilerWidget.Reset();
+            cookerWidget.Reset();
             renderGraphWidget.Reset();
             propertyWidget.Reset();
             logWidget.Reset();
@@ -674,6 +680,19 @@ namespace Editor
 
             // Loading scene if necessary
             // TODO
+
+            // Cook the project and exit if requested by the command line
+            if (!CommandLine::options.cookPath.empty())
+            {
+                CookOptions options;
+                options.outputPath = Path(CommandLine::options.cookPath.c_str());
+                options.force = CommandLine::options.cookForce;
+                Engine::RequestExit(Cooker::Cook(options) ? 0 : 1);
+            }
+            else if (!CommandLine::options.benchmark.empty())
+            {
+                Engine::RequestExit(Benchmarks::Run(CommandLine::options.benchmark.c_str()) ? 0 : 1);
+            }
         }
 
         void AddPlugin(EditorPlugin& plugin) override
@@ -956,6 +975,7 @@ namespace Editor
             ImGui::MenuItem(ICON_FA_COMMENT_ALT "Log", nullptr, &logWidget->isOpen);
             ImGui::MenuItem(ICON_FA_STREAM "EntityList", nullptr, &entityListWidget->isOpen);
             ImGui::MenuItem(ICON_FA_CHART_AREA "Profiler", nullptr, &profilerWidget->isOpen);
+            ImGui::MenuItem(ICON_FA_BOXES "Cooker", nullptr, &cookerWidget->isOpen);
             ImGui::MenuItem(ICON_FA_STREAM "EditorSetting", nullptr, &settings.isOpen);
             ImGui::EndMenu();
         }
@@ -1408,6 +1428,7 @@ namespace Editor
         UniquePtr<EntityListWidget> entityListWidget;
         UniquePtr<RenderGraphWidget> renderGraphWidget;
         UniquePtr<ProfilerWidget> profilerWidget;
+        UniquePtr<CookerWidget> cookerWidget;
 
         // Reflection
         HashMap<I32, String> componentLabels;
@@ -27,8 +27,12 @@ namespace Editor
 		mainStats.memoryCPU = Platform::GetProcessMemoryStats().usedPhysicalMemory;
 		mainStats.memoryGPU = GPU::GPUDevice::Instance->GetMemoryUsage().usage;
 		ProfilerGPU::GetLastFrameData(mainStats.drawTimesGPU);
+		for (U32 i = 0; i < (U32)Jobsystem::JobPriority::Count; i++)
+			mainStats.jobLatency[i] = Jobsystem::PopLatencyStats((Jobsystem::JobPriority)i);
 
-		// Get cpu profiler blocks
+		// Get cpu profiler blocks and counters
+		counters.clear();
+		std::vector<Profiler::Counter> threadCounters;
 		auto & threads = Profiler::GetThreads();
 		for (auto& thread : threads)
 		{
@@ -52,6 +56,27 @@ namespace Editor
 			}
 
 			thread->GetBlocks(stats->blocks);
+
+			thread->GetCounters(threadCounters);
+			for (const auto& counter : threadCounters)
+			{
+				const F64 value = counter.type == Profiler::CounterType::FLOAT ?
+					counter.value.floatValue : (F64)counter.value.intValue;
+
+				CounterStats* counterStats = nullptr;
+				for (auto& c : counters)
+				{
+					if (EqualString(c.name, counter.name))
+					{
+						counterStats = &c;
+						break;
+					}
+				}
+				if (counterStats == nullptr)
+					counters.push_back({ counter.name, counter.type, value });
+				else
+					counterStats->value = std::max(counterStats->value, value);
+			}
 		}
 
 		// Get the last resolved GPU frame blocks
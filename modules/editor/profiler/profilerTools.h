@@ -6,6 +6,7 @@
 #include "core\collections\array.h"
 #include "core\utils\string.h"
 #include "core\profiler\profiler.h"
+#include "core\threading\jobsystem.h"
 #include "renderer\profiler\profilerGPU.h"
 
 namespace VulkanTest
@@ -26,6 +27,7 @@ namespace Editor
 			F32 drawTimesGPU;
 			U64 memoryCPU;
 			U64 memoryGPU;
+			Jobsystem::JobLatencyStats jobLatency[(U32)Jobsystem::JobPriority::Count];
 		};
 
 		struct ThreadStats
@@ -34,6 +36,14 @@ namespace Editor
 			std::vector<Profiler::Block> blocks;
 		};
 
+		// Peak value of a counter in the current frame over all threads
+		struct CounterStats
+		{
+			const char* name;
+			Profiler::CounterType type;
+			F64 value;
+		};
+
 		ProfilerTools(EditorApp& editor_);
 		~ProfilerTools();
 
@@ -51,9 +61,14 @@ namespace Editor
 			return gpuBlocks;
 		}
 
+		const std::vector<CounterStats>& GetCounters()const {
+			return counters;
+		}
+
 	private:
 		MainStats mainStats;
 		std::vector<ThreadStats> cpuThreads;
+		std::vector<CounterStats> counters;
 		std::vector<ProfilerGPU::Block> gpuBlocks;
 		EditorApp& editor;
 	};
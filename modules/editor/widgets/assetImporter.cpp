@@ -2,6 +2,7 @@
 #include "content\importFileEntry.h"
 #include "editor\editor.h"
 #include "core\platform\platform.h"
+#include "core\threading\jobsystem.h"
 #include "imgui-docking\imgui.h"
 
 namespace VulkanTest
@@ -277,7 +278,16 @@ namespace Editor
                 }
 
                 PROFILE_BLOCK("Compile asset");
-                bool ret = entry->Import();
+
+                // Importing is long and blocks on file IO, run it on long-running workers,
+                // so that the parallel import stages (texture encoding, mesh optimization...) never starve frame jobs
+                bool ret = false;
+                Jobsystem::JobHandle jobHandle;
+                Jobsystem::Run(nullptr, [&](void*) {
+                    ret = entry->Import();
+                }, &jobHandle, Jobsystem::ANY_WORKER, Jobsystem::JobPriority::LongRunning);
+                Jobsystem::Wait(&jobHandle);
+
                 if (ret == false) {
                     Logger::Error("Failed to import resource %s", entry->inputPath.c_str());
                 }
@@ -2,6 +2,7 @@
 #include "editor\editor.h"
 #include "editor\profiler\profilerTools.h"
 #include "editor\profiler\samplesBuffer.h"
+#include "core\globals.h"
 #include "imgui-docking\imgui.h"
 
 namespace VulkanTest
@@ -13,6 +14,7 @@ namespace Editor
 		ProfilerTools::MainStats mainStats;
 		std::vector<ProfilerTools::ThreadStats> cpuThreads;
 		std::vector<ProfilerGPU::Block> gpuBlocks;
+		std::vector<ProfilerTools::CounterStats> counters;
 	};
 
 	// Base profiler mode
@@ -150,6 +152,20 @@ namespace Editor
 		SingleChart drawTimesChart;
 		SingleChart cpuMemoryChart;
 		SingleChart gpuMemoryChart;
+		SingleChart jobLatencyCharts[(U32)Jobsystem::JobPriority::Count] = {
+			"JobLatency(High)",
+			"JobLatency(Normal)",
+			"JobLatency(Background)",
+			"JobLatency(LongRunning)"
+		};
+
+		// Charts of the profiler counters, created when a counter first shows up
+		struct CounterChart
+		{
+			const char* name;
+			SingleChart* chart;
+		};
+		std::vector<CounterChart> counterCharts;
 
 		OverallProfiler() :
 			fpsChart("FPS"),
@@ -170,6 +186,50 @@ namespace Editor
 			gpuMemoryChart.formatSample = [](F32 value)->String {
 				return StaticString<32>().Sprintf("%d MB", (I32)value).c_str();
 			};
+			for (auto& chart : jobLatencyCharts)
+			{
+				chart.formatSample = [](F32 value)->String {
+					return StaticString<32>().Sprintf("%.3f ms", value * 1000.0f).c_str();
+				};
+			}
+		}
+
+		~OverallProfiler()
+		{
+			for (auto& counterChart : counterCharts)
+				CJING_SAFE_DELETE(counterChart.chart);
+			counterCharts.clear();
+		}
+
+		SingleChart* GetCounterChart(const ProfilerTools::CounterStats& counter)
+		{
+			for (auto& counterChart : counterCharts)
+			{
+				if (EqualString(counterChart.name, counter.name))
+					return counterChart.chart;
+			}
+
+			SingleChart* chart = CJING_NEW(SingleChart)(counter.name);
+			switch (counter.type)
+			{
+			case Profiler::CounterType::BYTES:
+				chart->formatSample = [](F32 value)->String {
+					return StaticString<32>().Sprintf("%.2f MB", value).c_str();
+				};
+				break;
+			case Profiler::CounterType::FLOAT:
+				chart->formatSample = [](F32 value)->String {
+					return StaticString<32>().Sprintf("%.3f", value).c_str();
+				};
+				break;
+			default:
+				chart->formatSample = [](F32 value)->String {
+					return StaticString<32>().Sprintf("%d", (I32)value).c_str();
+				};
+				break;
+			}
+			counterCharts.push_back({ counter.name, chart });
+			return chart;
 		}
 
 		void Update(ProfilerData& data) override
@@ -179,6 +239,19 @@ namespace Editor
 			drawTimesChart.AddSample(data.mainStats.drawTimes);
 			cpuMemoryChart.AddSample((F32)(data.mainStats.memoryCPU / 1024 / 1024));	// Bytes -> MB)
 			gpuMemoryChart.AddSample((F32)(data.mainStats.memoryGPU / 1024 / 1024));	// Bytes -> MB
+
+			// Average latency from submission to start of execution
+			for (U32 i = 0; i < LengthOf(jobLatencyCharts); i++)
+				jobLatencyCharts[i].AddSample((F32)data.mainStats.jobLatency[i].averageLatency);
+
+			for (const auto& counter : data.counters)
+			{
+				SingleChart* chart = GetCounterChart(counter);
+				if (counter.type == Profiler::CounterType::BYTES)
+					chart->AddSample((F32)(counter.value / 1024.0 / 1024.0));	// Bytes -> MB
+				else
+					chart->AddSample((F32)counter.value);
+			}
 		}
 
 		void OnGUI(bool isPaused) override
@@ -191,6 +264,10 @@ namespace Editor
 			drawTimesChart.OnGUI();
 			cpuMemoryChart.OnGUI();
 			gpuMemoryChart.OnGUI();
+			for (auto& chart : jobLatencyCharts)
+				chart.OnGUI();
+			for (auto& counterChart : counterCharts)
+				counterChart.chart->OnGUI();
 
 			ImGui::EndTabItem();
 		}
@@ -202,6 +279,10 @@ namespace Editor
 			drawTimesChart.Clear();
 			cpuMemoryChart.Clear();
 			gpuMemoryChart.Clear();
+			for (auto& chart : jobLatencyCharts)
+				chart.Clear();
+			for (auto& counterChart : counterCharts)
+				counterChart.chart->Clear();
 		}
 	};
 
@@ -1010,6 +1091,7 @@ namespace Editor
 			profilerData.cpuThreads = profilerTools.GetCPUThreads();
 			profilerData.mainStats = profilerTools.GetMainStats();
 			profilerData.gpuBlocks = profilerTools.GetGPUBlocks();
+			profilerData.counters = profilerTools.GetCounters();
 
 			for (auto mode : profilerModes)
 				mode->Update(profilerData);
@@ -1086,6 +1168,25 @@ namespace Editor
 						mode->showLastUpdateBlocks = lastUpdateOnly;
 				}
 
+				ImGui::SameLine();
+				ImGuiEx::Rect(1.0f, ImGui::GetItemRectSize().y, 0xff3A3A3E);
+				ImGui::SameLine();
+
+				// Stream profiler events into the capture file
+				const bool isCapturing = Profiler::IsCapturing();
+				if (ImGui::Button(isCapturing ? ICON_FA_STOP "StopCapture" : ICON_FA_CIRCLE "Capture"))
+				{
+					if (isCapturing)
+					{
+						Profiler::StopCapture();
+					}
+					else
+					{
+						const Path capturePath = Globals::ProjectCacheFolder / "profiler.capture";
+						Profiler::StartCapture(capturePath.c_str());
+					}
+				}
+
 				// Show profiler tabs
 				if (ImGui::BeginTabBar("tabs"))
 				{
@@ -33,6 +33,13 @@ namespace Editor
 			});
 		}
 
+		static void OnAttribute(const char* name, U32& value, bool isReadonly = false)
+		{
+			OnAttributeImpl(name, isReadonly, [&]() {
+				ImGui::InputScalar("##v", ImGuiDataType_U32, &value);
+			});
+		}
+
 		static void OnAttribute(const char* name, bool& value, bool isReadonly = false)
 		{
 			OnAttributeImpl(name, isReadonly, [&]() {
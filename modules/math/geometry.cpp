@@ -1,5 +1,6 @@
 #include "geometry.h"
 #include "vMath_impl.hpp"
+#include "simd.h"
 
 namespace VulkanTest
 {
@@ -176,4 +177,70 @@ namespace VulkanTest
 		}
 		return true;
 	}
+
+	U32 Frustum::CheckBoxes(const AABBArray& boxes, U32 begin, U32 end, U32* outIndices) const
+	{
+		U32 visibleCount = 0;
+#ifdef __SSE__
+		// The farthest corner along the plane normal is selected per plane instead of per box
+		struct PlaneSIMD
+		{
+			const F32* x;
+			const F32* y;
+			const F32* z;
+			__m128 a, b, c, d;
+		};
+		PlaneSIMD simdPlanes[(U32)Planes::Count];
+		for (U32 p = 0; p < (U32)Planes::Count; p++)
+		{
+			const F32x4& plane = planes[p];
+			simdPlanes[p].x = plane.x >= 0.0f ? boxes.maxX : boxes.minX;
+			simdPlanes[p].y = plane.y >= 0.0f ? boxes.maxY : boxes.minY;
+			simdPlanes[p].z = plane.z >= 0.0f ? boxes.maxZ : boxes.minZ;
+			simdPlanes[p].a = _mm_set1_ps(plane.x);
+			simdPlanes[p].b = _mm_set1_ps(plane.y);
+			simdPlanes[p].c = _mm_set1_ps(plane.z);
+			simdPlanes[p].d = _mm_set1_ps(plane.w);
+		}
+
+		const __m128 zero = _mm_setzero_ps();
+		for (U32 i = begin; i < end; i += 4)
+		{
+			__m128 outside = zero;
+			for (const PlaneSIMD& plane : simdPlanes)
+			{
+				__m128 dist = _mm_add_ps(_mm_mul_ps(plane.a, _mm_load_ps(plane.x + i)), plane.d);
+				dist = _mm_add_ps(dist, _mm_mul_ps(plane.b, _mm_load_ps(plane.y + i)));
+				dist = _mm_add_ps(dist, _mm_mul_ps(plane.c, _mm_load_ps(plane.z + i)));
+				outside = _mm_or_ps(outside, _mm_cmplt_ps(dist, zero));
+			}
+
+			U32 visibleMask = ~(U32)_mm_movemask_ps(outside) & 0xF;
+			if (end - i < 4)
+				visibleMask &= (1u << (end - i)) - 1;
+
+			for (U32 lane = 0; visibleMask != 0; lane++, visibleMask >>= 1)
+			{
+				if (visibleMask & 1)
+					outIndices[visibleCount++] = i + lane;
+			}
+		}
+#else
+		for (U32 i = begin; i < end; i++)
+		{
+			bool visible = true;
+			for (U32 p = 0; p < (U32)Planes::Count && visible; p++)
+			{
+				const F32x4& plane = planes[p];
+				const F32 x = plane.x >= 0.0f ? boxes.maxX[i] : boxes.minX[i];
+				const F32 y = plane.y >= 0.0f ? boxes.maxY[i] : boxes.minY[i];
+				const F32 z = plane.z >= 0.0f ? boxes.maxZ[i] : boxes.minZ[i];
+				visible = plane.x * x + plane.y * y + plane.z * z + plane.w >= 0.0f;
+			}
+			if (visible)
+				outIndices[visibleCount++] = i;
+		}
+#endif
+		return visibleCount;
+	}
 }
\ No newline at end of file
@@ -160,6 +160,18 @@ namespace VulkanTest
 		bool Intersects(const Ray& ray) const;
 	};
 
+	// Boxes stored in structure of arrays, the arrays are padded to a multiple of 4 and 16 bytes aligned
+	struct AABBArray
+	{
+		const F32* minX = nullptr;
+		const F32* minY = nullptr;
+		const F32* minZ = nullptr;
+		const F32* maxX = nullptr;
+		const F32* maxY = nullptr;
+		const F32* maxZ = nullptr;
+		U32 count = 0;
+	};
+
 	struct Frustum
 	{
 		enum class Planes
@@ -188,6 +200,10 @@ namespace VulkanTest
 		BoxFrustumIntersect CheckBox(const AABB& box) const;
 		bool CheckBoxFast(const AABB& box) const;
 
+		// Test the boxes in [begin, end) four at a time, begin must be a multiple of 4.
+		// Indices of visible boxes are written into outIndices in order, returns the count of visible boxes.
+		U32 CheckBoxes(const AABBArray& boxes, U32 begin, U32 end, U32* outIndices) const;
+
 		const F32x4& GetPlane(Planes plane) const
 		{
 			return planes[(U32)plane];
@@ -2,18 +2,122 @@
 #include "renderer.h"
 #include "renderScene.h"
 #include "core\profiler\profiler.h"
+#include "core\threading\jobsystem.h"
 
 namespace VulkanTest
 {   
-    struct CullingTag {};
+    // Bounds of the culled entities in structure of arrays, rebuilt every frame
+    struct CullingBuffer
+    {
+        F32* bounds[6] = {};
+        ECS::Entity* entities = nullptr;
+        U32 count = 0;
+        U32 capacity = 0;
+
+        void Reset(U32 maxCount)
+        {
+            count = 0;
+            capacity = AlignTo(maxCount, 4u);
+            if (capacity == 0)
+                return;
+
+            F32* mem = static_cast<F32*>(FrameAllocator::Allocate(sizeof(F32) * capacity * 6, 16));
+            for (U32 i = 0; i < 6; i++)
+                bounds[i] = mem + capacity * i;
+            entities = static_cast<ECS::Entity*>(FrameAllocator::Allocate(sizeof(ECS::Entity) * capacity, alignof(ECS::Entity)));
+        }
+
+        void Add(ECS::Entity entity, const AABB& aabb)
+        {
+            ASSERT(count < capacity);
+            bounds[0][count] = aabb.min.x;
+            bounds[1][count] = aabb.min.y;
+            bounds[2][count] = aabb.min.z;
+            bounds[3][count] = aabb.max.x;
+            bounds[4][count] = aabb.max.y;
+            bounds[5][count] = aabb.max.z;
+            entities[count] = entity;
+            count++;
+        }
+
+        AABBArray GetArray()const
+        {
+            // Padding lanes are masked by the culling, but keep them initialized
+            for (U32 i = count; i < AlignTo(count, 4u); i++)
+            {
+                for (U32 j = 0; j < 6; j++)
+                    bounds[j][i] = 0.0f;
+            }
+
+            AABBArray ret;
+            ret.minX = bounds[0];
+            ret.minY = bounds[1];
+            ret.minZ = bounds[2];
+            ret.maxX = bounds[3];
+            ret.maxY = bounds[4];
+            ret.maxZ = bounds[5];
+            ret.count = count;
+            return ret;
+        }
+    };
+
+    // Boxes are culled in parallel blocks, each block writes visible indices into its own bucket.
+    // Buckets are merged once in order and appended to the output, so the result is deterministic.
+    static void CullBuffer(const Frustum& frustum, const CullingBuffer& buffer, FrameArray<ECS::Entity>& output)
+    {
+        static const U32 BLOCK_SIZE = 1024;
+        const U32 count = buffer.count;
+        if (count == 0)
+            return;
+
+        const AABBArray boxes = buffer.GetArray();
+        const U32 blockCount = (count + BLOCK_SIZE - 1) / BLOCK_SIZE;
+        U32* indices = static_cast<U32*>(FrameAllocator::Allocate(sizeof(U32) * count, alignof(U32)));
+        U32* blockVisibleCounts = static_cast<U32*>(FrameAllocator::Allocate(sizeof(U32) * blockCount, alignof(U32)));
+        Jobsystem::ForEach(blockCount, 1, [&](U32 beginBlock, U32 endBlock) {
+            for (U32 block = beginBlock; block < endBlock; block++)
+            {
+                const U32 begin = block * BLOCK_SIZE;
+                const U32 end = std::min(begin + BLOCK_SIZE, count);
+                blockVisibleCounts[block] = frustum.CheckBoxes(boxes, begin, end, indices + begin);
+            }
+        });
+
+        U32 visibleCount = 0;
+        for (U32 block = 0; block < blockCount; block++)
+            visibleCount += blockVisibleCounts[block];
+
+        U32 offset = output.size();
+        output.resize(offset + visibleCount);
+        for (U32 block = 0; block < blockCount; block++)
+        {
+            const U32* blockIndices = indices + block * BLOCK_SIZE;
+            for (U32 i = 0; i < blockVisibleCounts[block]; i++)
+                output[offset++] = buffer.entities[blockIndices[i]];
+        }
+    }
+
+    // Subtrees of the BVH fully inside the frustum are accepted directly,
+    // the leaves of the intersecting subtrees are tested in batches.
+    static void CullBVH(const Frustum& frustum, const SceneBVH& bvh, CullingBuffer& buffer, FrameArray<ECS::Entity>& output)
+    {
+        buffer.Reset(bvh.GetProxyCount());
+        output.clear();
+        output.reserve(bvh.GetProxyCount());
+        bvh.QueryFrustum(frustum, [&](I32 proxy, bool fullyInside) {
+            if (fullyInside)
+                output.push_back(bvh.GetEntity(proxy));
+            else
+                buffer.Add(bvh.GetEntity(proxy), bvh.GetAABB(proxy));
+        });
+        CullBuffer(frustum, buffer, output);
+    }
 
     class CullingSystemImpl : public CullingSystem
     {
     private:
-        ECS::Pipeline pipeline;
-        ECS::System cullingObjects;
-        ECS::System cullingLights;
-        Visibility* visibility = nullptr;
+        CullingBuffer objectBuffer;
+        CullingBuffer lightBuffer;
 
     public:
         CullingSystemImpl()
@@ -26,73 +130,20 @@ namespace VulkanTest
 
         bool Initialize(RenderScene& scene) override
         {
-            auto& world = scene.GetWorld();
-            // Culling objects
-            cullingObjects = world.CreateSystem<const ObjectComponent>()
-                .Kind<CullingTag>()
-                .MultiThread(true)
-                .ForEach([&](ECS::Entity entity, const ObjectComponent& obj) {
-
-                ASSERT(visibility != nullptr);
-
-                if (obj.mesh != ECS::INVALID_ENTITY)
-                {
-                    if (visibility->frustum.CheckBoxFast(obj.aabb))
-                    {
-                        I32 index = AtomicIncrement(&visibility->objectCount);
-                        visibility->objects[index - 1] = entity;
-                    }
-                }
-            });
-
-            // Culling lights
-            cullingLights = world.CreateSystem<const LightComponent>()
-                .Kind<CullingTag>()
-                .MultiThread(true)
-                .ForEach([&](ECS::Entity entity, const LightComponent& light) {
-
-                ASSERT(visibility != nullptr);
-
-                if (visibility->frustum.CheckBoxFast(light.aabb))
-                {
-                    I32 index = AtomicIncrement(&visibility->lightCount);
-                    visibility->lights[index - 1] = entity;
-                }
-            });
-
-            pipeline = world.CreatePipeline()
-                .Term(ECS::EcsCompSystem)
-                .Term<CullingTag>()
-                .Build();
             return true;
         }
 
         void Uninitialize() override
         {
-            cullingObjects.Destroy();
-            cullingLights.Destroy();
-            pipeline.Destroy();
         }
 
         void Cull(Visibility& vis, RenderScene& scene) override
         {
             PROFILE_BLOCK("Culling");
-            visibility = &vis;
-            visibility->frustum = vis.camera->frustum;
-
-            auto& world = scene.GetWorld();
-            I32 objCount = world.Count<ObjectComponent>();
-            visibility->objects.resize(objCount);
-
-            I32 lightCount = world.Count<LightComponent>();
-            visibility->lights.resize(lightCount);
-
-            if (pipeline != ECS::INVALID_ENTITY)
-                scene.GetWorld().RunPipeline(pipeline);
+            vis.frustum = vis.camera->frustum;
 
-            // Finalize visibility
-            vis.objects.resize(AtomicRead(&vis.objectCount));
-            vis.lights.resize(AtomicRead(&vis.lightCount));
+            CullBVH(vis.frustum, scene.GetObjectBVH(), objectBuffer, vis.objects);
+            CullBVH(vis.frustum, scene.GetLightBVH(), lightBuffer, vis.lights);
         }
     };
 
@@ -2,8 +2,8 @@
 
 #include "core\common.h"
 #include "core\memory\memory.h"
+#include "core\memory\frameAllocator.h"
 #include "core\scene\world.h"
-#include "core\platform\atomic.h"
 #include "math\geometry.h"
 #include "renderScene.h"
 
@@ -26,19 +26,15 @@ namespace VulkanTest
         struct CameraComponent* camera = nullptr;
         Frustum frustum;
 
-        Array<ECS::Entity> objects;
-        Array<ECS::Entity> lights;
-
-        volatile I32 objectCount;
-        volatile I32 lightCount;
+        // Rebuilt every frame
+        FrameArray<ECS::Entity> objects;
+        FrameArray<ECS::Entity> lights;
 
         void Clear()
         {
-            objects.clear();
-            lights.clear();
-
-            AtomicExchange(&objectCount, 0);
-            AtomicExchange(&lightCount, 0);
+            // Drop the storage of the previous frames
+            objects = FrameArray<ECS::Entity>();
+            lights = FrameArray<ECS::Entity>();
         }
     };
 
@@ -2,6 +2,7 @@
 #include "renderGraph.h"
 #include "gpu\vulkan\typeToString.h"
 #include "core\memory\memory.h"
+#include "core\memory\frameAllocator.h"
 #include "core\threading\jobsystem.h"
 
 #include <stdexcept>
@@ -1756,7 +1757,7 @@ namespace VulkanTest
 
     void RenderGraphImpl::HandleTimelineGPU(GPU::DeviceVulkan& device, const PhysicalPass& physicalPass, GPUPassSubmissionState* state, U8 index)
     {
-        ASSERT(state->renderingDependency.counter == 0);
+        ASSERT(state->renderingDependency.GetCounter() == 0);
         Jobsystem::Run(state, [this, &device, &physicalPass](void* data)->void {
             GPUPassSubmissionState* state = (GPUPassSubmissionState*)data;
             if (state == nullptr)
@@ -1955,7 +1956,7 @@ namespace VulkanTest
         }
 
         // Sequential submit all states
-        ASSERT(submitHandle.counter == 0);
+        ASSERT(submitHandle.GetCounter() == 0);
         Jobsystem::Run(nullptr, [this](void* data)->void {
             PROFILE_BLOCK("Submit states");
             for (auto& state : submissionStates)
@@ -2240,16 +2241,19 @@ namespace VulkanTest
             !imageBarriers.empty() ||
             !bufferBarriers.empty())
         {
-            std::vector<VkImageMemoryBarrier> combinedBarriers;
-            combinedBarriers.reserve(
+            FrameArray<VkImageMemoryBarrier> combinedBarriers;
+            combinedBarriers.reserve(U32(
                 handoverBarriers.size() + 
                 immediateImageBarriers.size() +
                 imageBarriers.size()
-            );
-
-            combinedBarriers.insert(combinedBarriers.end(), handoverBarriers.begin(), handoverBarriers.end());
-            combinedBarriers.insert(combinedBarriers.end(), immediateImageBarriers.begin(), immediateImageBarriers.end());
-            combinedBarriers.insert(combinedBarriers.end(), imageBarriers.begin(), imageBarriers.end());
+            ));
+
+            for (const auto& barrier : handoverBarriers)
+                combinedBarriers.push_back(barrier);
+            for (const auto& barrier : immediateImageBarriers)
+                combinedBarriers.push_back(barrier);
+            for (const auto& barrier : imageBarriers)
+                combinedBarriers.push_back(barrier);
 
             VkPipelineStageFlags src = handoverStages | preSrcStages;
             VkPipelineStageFlags dst = handoverStages | immediateDstStages | preDstStages;
@@ -0,0 +1,218 @@
+#pragma once
+
+#include "culling.h"
+#include "renderScene.h"
+#include "core\threading\jobsystem.h"
+#include "content\resources\model.h"
+
+// Internal to the renderer, only included by the renderer and the benchmarks
+namespace VulkanTest
+{
+namespace Renderer
+{
+	struct RenderBatch
+	{
+		U64 sortingKey;
+		const MeshComponent::MeshInfo* meshInfo;
+		const ObjectComponent* objCmp;
+
+		RenderBatch() = default;
+		RenderBatch(const MeshComponent::MeshInfo* meshInfo_, const ObjectComponent* objCmp_, U32 instanceIndex, F32 distance) :
+			meshInfo(meshInfo_),
+			objCmp(objCmp_)
+		{
+			ASSERT(instanceIndex < 0x00FFFFFF);
+			sortingKey = 0;
+			sortingKey |= U64((U32)meshInfo->mesh->GetGUID().GetHash() & 0x00FFFFFF) << 40ull;
+			sortingKey |= U64(ConvertFloatToHalf(distance) & 0xFFFF) << 24ull;
+			sortingKey |= U64((U32)instanceIndex & 0x00FFFFFF) << 0ull;
+		}
+
+		inline float GetDistance() const
+		{
+			return ConvertHalfToFloat(HALF((sortingKey >> 24ull) & 0xFFFF));
+		}
+
+		inline const MeshComponent::MeshInfo* GetMeshInfo() const
+		{
+			return meshInfo;
+		}
+		
+		inline const ObjectComponent* GetObjectComponent()const {
+			return objCmp;
+		}
+
+		inline U32 GetInstanceIndex() const
+		{
+			return (sortingKey >> 0ull) & 0x00FFFFFF;
+		}
+
+		bool operator<(const RenderBatch& other) const
+		{
+			return sortingKey < other.sortingKey;
+		}
+	};
+
+	// Render queue keeps its storage across frames, queues are reused by the queue pool
+	struct RenderQueue
+	{
+		static const U32 BUILD_BLOCK_SIZE = 256;	// Objects
+		static const U32 SORT_BLOCK_SIZE = 8192;	// Batches
+		static const U32 RADIX_BITS = 8;
+		static const U32 RADIX_SIZE = 1 << RADIX_BITS;
+
+		void Build(const Visibility& vis)
+		{
+			const F32x3 eye = vis.camera->eye;
+			BuildBlocks(vis.objects.size(), [&](U32 index, Array<RenderBatch>& output) {
+				const ObjectComponent* obj = vis.objects[index].Get<ObjectComponent>();
+				if (obj == nullptr || obj->mesh == ECS::INVALID_ENTITY)
+					return;
+
+				const MeshComponent* mesh = obj->mesh.Get<MeshComponent>();
+				if (mesh == nullptr || obj->lodIndex >= mesh->lodsCount || !mesh->model->IsReady())
+					return;
+
+				const F32 distance = Distance(eye, obj->center);
+				auto& lodMeshes = mesh->meshes[obj->lodIndex];
+				for (U32 i = 0; i < lodMeshes.size(); i++)
+					output.emplace(&lodMeshes[i], obj, obj->instanceOffset + i, distance);
+			});
+		}
+
+		// Every block of objects writes its batches into its own array, gather(index, output) appends the batches of an object
+		template<typename Gather>
+		void BuildBlocks(U32 objectCount, Gather gather)
+		{
+			const U32 blockCount = (objectCount + BUILD_BLOCK_SIZE - 1) / BUILD_BLOCK_SIZE;
+			if (blockBatches.size() < blockCount)
+				blockBatches.resize(blockCount);
+
+			Jobsystem::ForEach(blockCount, 1, [&](U32 beginBlock, U32 endBlock) {
+				for (U32 block = beginBlock; block < endBlock; block++)
+				{
+					auto& output = blockBatches[block];
+					output.clear();
+
+					const U32 end = std::min(objectCount, (block + 1) * BUILD_BLOCK_SIZE);
+					for (U32 index = block * BUILD_BLOCK_SIZE; index < end; index++)
+						gather(index, output);
+				}
+			});
+
+			// Merge the arrays of blocks in order
+			U32 batchCount = 0;
+			for (U32 block = 0; block < blockCount; block++)
+				batchCount += blockBatches[block].size();
+
+			batches.resize(batchCount);
+			U32 offset = 0;
+			for (U32 block = 0; block < blockCount; block++)
+			{
+				const auto& blockBatch = blockBatches[block];
+				if (!blockBatch.empty())
+					memcpy(batches.data() + offset, blockBatch.data(), blockBatch.size() * sizeof(RenderBatch));
+				offset += blockBatch.size();
+			}
+		}
+
+		// Parallel LSD radix sort on the sorting keys, each pass is stable.
+		// Blocks count digits into their own histograms, then scatter into the offsets given by the prefix sums.
+		void SortOpaque()
+		{
+			const U32 count = batches.size();
+			if (count <= 1)
+				return;
+
+			const U32 blockCount = (count + SORT_BLOCK_SIZE - 1) / SORT_BLOCK_SIZE;
+			sortBuffer.resize(count);
+			histograms.resize(blockCount * RADIX_SIZE);
+			blockDiffBits.resize(blockCount);
+
+			// Skip the digits which are the same in all keys
+			const U64 firstKey = batches[0].sortingKey;
+			Jobsystem::ForEach(blockCount, 1, [&](U32 beginBlock, U32 endBlock) {
+				for (U32 block = beginBlock; block < endBlock; block++)
+				{
+					U64 diffBits = 0;
+					const U32 end = std::min(count, (block + 1) * SORT_BLOCK_SIZE);
+					for (U32 i = block * SORT_BLOCK_SIZE; i < end; i++)
+						diffBits |= batches[i].sortingKey ^ firstKey;
+					blockDiffBits[block] = diffBits;
+				}
+			});
+
+			U64 diffBits = 0;
+			for (U32 block = 0; block < blockCount; block++)
+				diffBits |= blockDiffBits[block];
+
+			RenderBatch* src = batches.data();
+			RenderBatch* dst = sortBuffer.data();
+			for (U32 shift = 0; shift < 64; shift += RADIX_BITS)
+			{
+				if (((diffBits >> shift) & (RADIX_SIZE - 1)) == 0)
+					continue;
+
+				Jobsystem::ForEach(blockCount, 1, [&](U32 beginBlock, U32 endBlock) {
+					for (U32 block = beginBlock; block < endBlock; block++)
+					{
+						U32* histogram = histograms.data() + block * RADIX_SIZE;
+						memset(histogram, 0, sizeof(U32) * RADIX_SIZE);
+						const U32 end = std::min(count, (block + 1) * SORT_BLOCK_SIZE);
+						for (U32 i = block * SORT_BLOCK_SIZE; i < end; i++)
+							histogram[(src[i].sortingKey >> shift) & (RADIX_SIZE - 1)]++;
+					}
+				});
+
+				// Exclusive prefix sums ordered by digit then block, so the scatter is stable
+				U32 offset = 0;
+				for (U32 digit = 0; digit < RADIX_SIZE; digit++)
+				{
+					for (U32 block = 0; block < blockCount; block++)
+					{
+						U32& value = histograms[block * RADIX_SIZE + digit];
+						const U32 digitCount = value;
+						value = offset;
+						offset += digitCount;
+					}
+				}
+
+				Jobsystem::ForEach(blockCount, 1, [&](U32 beginBlock, U32 endBlock) {
+					for (U32 block = beginBlock; block < endBlock; block++)
+					{
+						U32* offsets = histograms.data() + block * RADIX_SIZE;
+						const U32 end = std::min(count, (block + 1) * SORT_BLOCK_SIZE);
+						for (U32 i = block * SORT_BLOCK_SIZE; i < end; i++)
+							dst[offsets[(src[i].sortingKey >> shift) & (RADIX_SIZE - 1)]++] = src[i];
+					}
+				});
+				std::swap(src, dst);
+			}
+
+			if (src != batches.data())
+				memcpy(batches.data(), src, count * sizeof(RenderBatch));
+		}
+
+		void Clear()
+		{
+			batches.clear();
+		}
+
+		bool Empty()const
+		{
+			return batches.empty();
+		}
+
+		size_t Size()const
+		{
+			return batches.size();
+		}
+
+		Array<RenderBatch> batches;
+		Array<RenderBatch> sortBuffer;
+		Array<Array<RenderBatch>> blockBatches;
+		Array<U32> histograms;
+		Array<U64> blockDiffBits;
+	};
+}
+}
\ No newline at end of file
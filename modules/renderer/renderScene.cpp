@@ -1,9 +1,11 @@
 #include "RenderScene.h"
 #include "renderer.h"
 #include "culling.h"
+#include "transformHierarchy.h"
 #include "gpu\vulkan\wsi.h"
 #include "core\scene\reflection.h"
 #include "core\profiler\profiler.h"
+#include "core\platform\sync.h"
 
 namespace VulkanTest
 {
@@ -30,12 +32,21 @@ namespace VulkanTest
             return buffer && arraySize > 0;
         }
 
-        void UpdateBuffer(GPU::DeviceVulkan& device, U32 arraySize_)
+        // Returns true if the buffer is recreated, all records must be written again
+        bool UpdateBuffer(GPU::DeviceVulkan& device, U32 arraySize_)
         {
             if (arraySize_ == arraySize)
-                return;
+                return false;
 
             arraySize = arraySize_;
+            const U32 oldWordCount = dirtyMask.size();
+            const U32 wordCount = (arraySize + 63) / 64;
+            if (wordCount > oldWordCount)
+            {
+                dirtyMask.resize(wordCount);
+                memset(dirtyMask.data() + oldWordCount, 0, (wordCount - oldWordCount) * sizeof(I64));
+            }
+
             U32 bufferSize = arraySize * sizeof(T);
             if (arraySize > 0 && (!buffer || buffer->GetCreateInfo().size < bufferSize))
             {
@@ -60,30 +71,99 @@ namespace VulkanTest
                 }
 
                 bindless = device.CreateBindlessStroageBuffer(*buffer, 0, buffer->GetCreateInfo().size);
+                return true;
             }
+            return false;
         }
 
-        void UploadBuffer(GPU::DeviceVulkan& device, GPU::CommandList& cmd)
+        // Mark the records written into the upload buffer of current frame, could be called concurrently
+        void MarkDirty(U32 index, U32 count = 1)
         {
-            if (buffer && arraySize > 0)
+            ASSERT(index + count <= arraySize);
+            while (count > 0)
             {
-                auto uploadBuffer = uploadBuffers[device.GetFrameIndex()];
-                if (uploadBuffer)
+                const U32 bit = index & 63;
+                const U32 bits = std::min(count, 64 - bit);
+                const I64 mask = (I64)((bits == 64 ? ~0ull : ((1ull << bits) - 1)) << bit);
+                volatile I64* word = &dirtyMask[index >> 6];
+                I64 oldValue = AtomicRead(word);
+                while ((oldValue & mask) != mask)
+                {
+                    const I64 prevValue = AtomicCmpExchange(word, oldValue | mask, oldValue);
+                    if (prevValue == oldValue)
+                        break;
+                    oldValue = prevValue;
+                }
+                index += bits;
+                count -= bits;
+            }
+        }
+
+        // Only the dirty ranges are copied, the other records in the device buffer are still valid
+        U32 UploadBuffer(GPU::DeviceVulkan& device, GPU::CommandList& cmd)
+        {
+            if (!buffer || arraySize == 0)
+                return 0;
+
+            auto uploadBuffer = uploadBuffers[device.GetFrameIndex()];
+            if (!uploadBuffer)
+                return 0;
+
+            U32 rangeCount = 0;
+            U32 rangeBegin = 0;
+            U32 rangeEnd = 0;
+            auto FlushRange = [&]() {
+                if (rangeEnd > rangeBegin)
+                {
+                    cmd.CopyBuffer(*buffer, rangeBegin * sizeof(T), *uploadBuffer, rangeBegin * sizeof(T), (rangeEnd - rangeBegin) * sizeof(T));
+                    rangeCount++;
+                }
+            };
+
+            const U32 wordCount = (arraySize + 63) / 64;
+            for (U32 wordIndex = 0; wordIndex < wordCount; wordIndex++)
+            {
+                U64 word = (U64)dirtyMask[wordIndex];
+                if (word == 0)
+                    continue;
+
+                dirtyMask[wordIndex] = 0;
+                while (word != 0)
                 {
-                    cmd.CopyBuffer(
-                        *buffer,
-                        0,
-                        *uploadBuffer,
-                        0,
-                        arraySize * sizeof(T)
-                    );
-                    cmd.BufferBarrier(*buffer,
-                        VK_PIPELINE_STAGE_ALL_COMMANDS_BIT,
-                        VK_ACCESS_TRANSFER_WRITE_BIT,
-                        VK_PIPELINE_STAGE_ALL_COMMANDS_BIT,
-                        VK_ACCESS_SHADER_READ_BIT);
+                    // Find the next run of ones
+                    U32 bit = 0;
+                    while (((word >> bit) & 1) == 0)
+                        bit++;
+                    U32 bitEnd = bit;
+                    while (bitEnd < 64 && ((word >> bitEnd) & 1) != 0)
+                        bitEnd++;
+                    word &= bitEnd == 64 ? 0 : ~0ull << bitEnd;
+
+                    const U32 begin = wordIndex * 64 + bit;
+                    const U32 end = std::min(wordIndex * 64 + bitEnd, arraySize);
+                    if (begin == rangeEnd)
+                    {
+                        rangeEnd = end;
+                    }
+                    else
+                    {
+                        FlushRange();
+                        rangeBegin = begin;
+                        rangeEnd = end;
+                    }
                 }
             }
+            FlushRange();
+
+            if (rangeCount > 0)
+            {
+                cmd.BufferBarrier(*buffer,
+                    VK_PIPELINE_STAGE_ALL_COMMANDS_BIT,
+                    VK_ACCESS_TRANSFER_WRITE_BIT,
+                    VK_PIPELINE_STAGE_ALL_COMMANDS_BIT,
+                    VK_ACCESS_SHADER_READ_BIT);
+            }
+            return rangeCount;
         }
 
         T* Mapping(GPU::DeviceVulkan& device)
@@ -104,9 +184,198 @@ namespace VulkanTest
             uploadBuffers[0].reset();
             uploadBuffers[1].reset();
             bindless.reset();
+            dirtyMask.clear();
+            arraySize = 0;
         }
+
+    private:
+        Array<I64> dirtyMask;
     };
 
+    // Allocates stable ranges of records, so records are only written again when they are changed.
+    // Freed ranges are reused by the requests of the same size.
+    struct RecordAllocator
+    {
+        struct Range
+        {
+            U32 offset = 0;
+            U32 count = 0;
+        };
+
+        U32 size = 0;
+        HashMap<U32, Array<U32>> freeRanges;
+        Array<Range> freedRanges;   // Freed in the current frame
+
+        // Returns true if the range is changed
+        bool Reallocate(Range& range, U32 count)
+        {
+            if (range.count == count)
+                return false;
+
+            Free(range);
+            range.count = count;
+            if (count > 0)
+            {
+                auto it = freeRanges.find(count);
+                if (it.isValid() && !it.value().empty())
+                {
+                    range.offset = it.value().back();
+                    it.value().pop_back();
+                }
+                else
+                {
+                    range.offset = size;
+                    size += count;
+                }
+            }
+            return true;
+        }
+
+        void Free(Range& range)
+        {
+            if (range.count > 0)
+            {
+                auto it = freeRanges.find(range.count);
+                if (!it.isValid())
+                    it = freeRanges.insert(range.count, Array<U32>());
+                it.value().push_back(range.offset);
+                freedRanges.push_back(range);
+            }
+            range = Range();
+        }
+
+        void Clear()
+        {
+            size = 0;
+            freeRanges.clear();
+            freedRanges.clear();
+        }
+    };
+
+    // Bounds of entities which moved out of their enlarged boxes in the BVH
+    struct SceneBVHUpdater
+    {
+        struct MovedBounds
+        {
+            ECS::Entity entity;
+            AABB aabb;
+        };
+
+        SceneBVH bvh;
+        HashMap<ECS::Entity, I32> proxies;
+        SpinLock movedLock;
+        Array<MovedBounds> moved;
+
+        // Called by the multi-threaded systems, the tree is only modified in Apply
+        void Update(ECS::Entity entity, const AABB& aabb)
+        {
+            auto it = proxies.find(entity);
+            if (it.isValid())
+            {
+                if (aabb.IsValid() && bvh.TryUpdateProxy(it.value(), aabb))
+                    return;
+            }
+            else if (!aabb.IsValid())
+            {
+                return;
+            }
+
+            movedLock.Lock();
+            moved.push_back({ entity, aabb });
+            movedLock.Unlock();
+        }
+
+        void Apply()
+        {
+            for (const auto& bounds : moved)
+            {
+                auto it = proxies.find(bounds.entity);
+                if (!bounds.aabb.IsValid())
+                {
+                    if (it.isValid())
+                    {
+                        bvh.DestroyProxy(it.value());
+                        proxies.erase(it);
+                    }
+                }
+                else if (it.isValid())
+                {
+                    bvh.MoveProxy(it.value(), bounds.aabb);
+                }
+                else
+                {
+                    proxies.insert(bounds.entity, bvh.CreateProxy(bounds.aabb, bounds.entity));
+                }
+            }
+            moved.clear();
+        }
+
+        void Remove(ECS::Entity entity)
+        {
+            auto it = proxies.find(entity);
+            if (it.isValid())
+            {
+                bvh.DestroyProxy(it.value());
+                proxies.erase(it);
+            }
+        }
+
+        void Clear()
+        {
+            bvh.Clear();
+            proxies.clear();
+            moved.clear();
+        }
+    };
+
+    // Records of an object, the instances of all meshes and their meshlets
+    struct InstanceRecords
+    {
+        RecordAllocator::Range instances;
+        RecordAllocator::Range meshlets;
+        U32 geometryVersion = 0;
+        bool isDirty = true;
+    };
+
+    // Geometries of all subsets of a mesh component
+    struct GeometryRecords
+    {
+        RecordAllocator::Range geometries;
+        const Model* model = nullptr;
+        U32 meshletCount = 0;
+        U32 version = 0;
+        bool isDirty = true;
+    };
+
+    // Materials have no change notification, params can be edited and textures are loaded or reloaded at any time,
+    // so records are generated every frame and only written when they are different from the last written ones
+    struct MaterialRecords
+    {
+        RecordAllocator::Range materials;
+        Array<ShaderMaterial> written;
+        bool isDirty = true;
+    };
+
+    template<typename T>
+    static T& GetRecords(HashMap<ECS::Entity, T>& records, ECS::Entity entity)
+    {
+        auto it = records.find(entity);
+        if (!it.isValid())
+            it = records.insert(entity, T());
+        return it.value();
+    }
+
+    template<typename T>
+    static void FreeRecords(HashMap<ECS::Entity, T>& records, ECS::Entity entity, RecordAllocator& allocator, RecordAllocator::Range T::* range)
+    {
+        auto it = records.find(entity);
+        if (it.isValid())
+        {
+            allocator.Free(it.value().*range);
+            records.erase(it);
+        }
+    }
+
     class RenderSceneImpl : public RenderScene
     {
     public:
@@ -124,20 +393,42 @@ namespace VulkanTest
         U32 instanceArraySize = 0;
 
         // Component query
+        ECS::Query<TransformComponent> transformQuery;
         ECS::Query<ObjectComponent> objectQuery;
         ECS::Query<MeshComponent> meshQuery;
         ECS::Query<MaterialComponent> materialQuery;
         ECS::Query<LightComponent> lightQuery;
 
+        TransformHierarchy transformHierarchy;
+
+        // Bounding volume hierarchies
+        SceneBVHUpdater objectBVH;
+        SceneBVHUpdater lightBVH;
+
         // Runtime rendering infos
         RenderSceneBuffer<ShaderMeshInstance> instanceBuffer;
         RenderSceneBuffer<ShaderGeometry> geometryBuffer;
         RenderSceneBuffer<ShaderMaterial> materialBuffer;
 
+        // Stable records of the scene buffers, only the changed records are written and uploaded
+        RecordAllocator instanceAllocator;
+        RecordAllocator meshletAllocator;
+        RecordAllocator geometryAllocator;
+        RecordAllocator materialAllocator;
+        HashMap<ECS::Entity, InstanceRecords> instanceRecords;
+        HashMap<ECS::Entity, GeometryRecords> geometryRecords;
+        HashMap<ECS::Entity, MaterialRecords> materialRecords;
+        U32 geometryVersion = 0;
+
+        // The count of records written in current frame
+        volatile I32 instancesWritten = 0;
+        volatile I32 geometriesWritten = 0;
+        volatile I32 materialsWritten = 0;
+        RenderSceneStatistics statistics;
+
         // Meshlets:
         GPU::BufferPtr meshletBuffer;
         GPU::BindlessDescriptorPtr meshletBufferBindless;
-        volatile I32 meshletAllocator = 0;
 
         ShaderMeshInstance* instanceMapped = nullptr;
         ShaderMaterial* materialMapped = nullptr;
@@ -158,6 +449,7 @@ namespace VulkanTest
         {
             cullingSystem = CullingSystem::Create();
 
+            transformQuery = world.CreateQuery<TransformComponent>().Build();
             objectQuery = world.CreateQuery<ObjectComponent>().Build();
             meshQuery = world.CreateQuery<MeshComponent>().Build();
             materialQuery = world.CreateQuery<MaterialComponent>().Build();
@@ -167,6 +459,30 @@ namespace VulkanTest
                 if (model.model)
                     modelEntityMap.erase(model.model.get());
             });
+
+            world.SetComponenetOnRemoved<ObjectComponent>([&](ECS::Entity entity, ObjectComponent& obj) {
+                objectBVH.Remove(entity);
+
+                auto it = instanceRecords.find(entity);
+                if (it.isValid())
+                {
+                    instanceAllocator.Free(it.value().instances);
+                    meshletAllocator.Free(it.value().meshlets);
+                    instanceRecords.erase(it);
+                }
+            });
+
+            world.SetComponenetOnRemoved<MeshComponent>([&](ECS::Entity entity, MeshComponent& mesh) {
+                FreeRecords(geometryRecords, entity, geometryAllocator, &GeometryRecords::geometries);
+            });
+
+            world.SetComponenetOnRemoved<MaterialComponent>([&](ECS::Entity entity, MaterialComponent& material) {
+                FreeRecords(materialRecords, entity, materialAllocator, &MaterialRecords::materials);
+            });
+
+            world.SetComponenetOnRemoved<LightComponent>([&](ECS::Entity entity, LightComponent& light) {
+                lightBVH.Remove(entity);
+            });
         }
 
         virtual ~RenderSceneImpl()
@@ -207,6 +523,18 @@ namespace VulkanTest
             }
             modelEntityMap.clear();
 
+            transformHierarchy.Clear();
+            objectBVH.Clear();
+            lightBVH.Clear();
+
+            instanceRecords.clear();
+            geometryRecords.clear();
+            materialRecords.clear();
+            instanceAllocator.Clear();
+            meshletAllocator.Clear();
+            geometryAllocator.Clear();
+            materialAllocator.Clear();
+
             cullingSystem->Uninitialize();
         }
 
@@ -245,21 +573,23 @@ namespace VulkanTest
         PickResult CastRayPick(const Ray& ray, U32 mask = ~0)override
         {
             PickResult ret;
-            ForEachObjects([&](ECS::Entity entity, ObjectComponent& comp) 
-            {
-                const AABB& aabb = comp.aabb;
-                if (!ray.Intersects(aabb))
-                    return;
+            if (!IsSceneValid())
+                return ret;
 
-                if (comp.mesh == ECS::INVALID_ENTITY)
-                    return;
+            // Objects are visited near to far, farther subtrees are skipped after a hit
+            objectBVH.bvh.QueryRay(ray, [&](I32 proxy, F32 tMax)
+            {
+                ECS::Entity entity = objectBVH.bvh.GetEntity(proxy);
+                const ObjectComponent* comp = entity.Get<ObjectComponent>();
+                if (comp == nullptr || comp->mesh == ECS::INVALID_ENTITY)
+                    return tMax;
 
-                auto meshComp = comp.mesh.Get<MeshComponent>();
+                auto meshComp = comp->mesh.Get<MeshComponent>();
                 if (meshComp == nullptr || !meshComp->model || !meshComp->model->IsReady())
-                    return;
+                    return tMax;
 
                 // Transform ray to local object space
-                const MATRIX objectMat = LoadFMat4x4(comp.worldMat);
+                const MATRIX objectMat = LoadFMat4x4(comp->worldMat);
                 const MATRIX objectMatInverse = MatrixInverse(objectMat);
                 const VECTOR rayOriginLocal = Vector3Transform(LoadF32x3(ray.origin), objectMatInverse);
                 const XMVECTOR rayDirectionLocal = XMVector3Normalize(XMVector3TransformNormal(LoadF32x3(ray.direction), objectMatInverse));
@@ -285,10 +615,28 @@ namespace VulkanTest
                         }
                     }
                 }
+
+                // The pick ray is normalized, so the distance is the ray parameter
+                return ret.isHit ? std::min(tMax, ret.distance) : tMax;
             });
             return ret;
         }
 
+        const SceneBVH& GetObjectBVH()const override
+        {
+            return objectBVH.bvh;
+        }
+
+        const SceneBVH& GetLightBVH()const override
+        {
+            return lightBVH.bvh;
+        }
+
+        const RenderSceneStatistics& GetStatistics()const override
+        {
+            return statistics;
+        }
+
         void CreateComponent(ECS::Entity entity, ComponentType compType) override
         {
             auto compMeta = Reflection::GetComponent(compType);
@@ -533,9 +881,11 @@ namespace VulkanTest
             auto& device = cmd.GetDevice();
 
             // Update scene common buffers
-            instanceBuffer.UploadBuffer(device, cmd);
-            geometryBuffer.UploadBuffer(device, cmd);
-            materialBuffer.UploadBuffer(device, cmd);
+            U32 uploadRanges = 0;
+            uploadRanges += instanceBuffer.UploadBuffer(device, cmd);
+            uploadRanges += geometryBuffer.UploadBuffer(device, cmd);
+            uploadRanges += materialBuffer.UploadBuffer(device, cmd);
+            PROFILE_COUNTER("SceneUploadRanges", uploadRanges);
 
             // Update meshlet buffer
             if (instanceArraySize > 0 && meshletBuffer)
@@ -551,6 +901,19 @@ namespace VulkanTest
             }
         }
 
+        void ClearInstances(U32 offset, U32 count)
+        {
+            ShaderMeshInstance inst;
+            inst.init();
+            inst.uid = 0;
+            inst.geometryOffset = 0;
+            inst.geometryCount = 0;
+            for (U32 i = offset; i < offset + count && i < instanceArraySize; i++)
+                memcpy(instanceMapped + i, &inst, sizeof(ShaderMeshInstance));
+            if (offset < instanceArraySize)
+                instanceBuffer.MarkDirty(offset, std::min(count, instanceArraySize - offset));
+        }
+
         const ShaderSceneCB& GetShaderScene()const override
         {
             return sceneCB;
@@ -570,66 +933,170 @@ namespace VulkanTest
             }
             toLoadModels.clear();
 
-            // Update instance buffer
-            instanceArraySize = 0;
-            if (objectQuery.Valid())
+            // Update world matrices, parents are always updated before their children
+            transformHierarchy.Begin();
+            if (transformQuery.Valid())
             {
-                objectQuery.ForEach([&](ECS::Entity entity, ObjectComponent& obj) {
-                    obj.instanceOffset = instanceArraySize;
-                    auto meshComp = obj.mesh.Get<MeshComponent>();
-                    if (meshComp != nullptr)
-                        instanceArraySize += meshComp->meshCount;
-                    
-                });
-            }
-            instanceBuffer.UpdateBuffer(device, instanceArraySize);
-            instanceMapped = instanceBuffer.Mapping(device);
-            
-            // Update material buffer
-            U32 materialArraySize = 0;
-            if (materialQuery.Valid())
-            {
-                materialQuery.ForEach([&](ECS::Entity entity, MaterialComponent& mat) {
-                    mat.materialOffset = materialArraySize;
-                    materialArraySize += mat.materials.size();
+                transformQuery.ForEach([&](ECS::Entity entity, TransformComponent& transComp) {
+                    transformHierarchy.Add(entity, transComp.transform);
                 });
             }
-            materialBuffer.UpdateBuffer(device, materialArraySize);
-            materialMapped = materialBuffer.Mapping(device);
+            PROFILE_COUNTER("TransformsUpdated", transformHierarchy.Update());
 
-            // Update geometry buffer
-            U32 geometryArraySize = 0;
+            // Allocate geometry records, geometries are only written again when the model is changed
             if (meshQuery.Valid())
             {
                 meshQuery.ForEach([&](ECS::Entity entity, MeshComponent& meshComp) 
                 {
-                    if (!meshComp.model || !meshComp.model->IsReady())
+                    const Model* model = meshComp.model && meshComp.model->IsReady() ? meshComp.model.get() : nullptr;
+                    U32 geometryCount = 0;
+                    if (model != nullptr)
+                    {
+                        for (I32 lodIndex = 0; lodIndex < meshComp.lodsCount; lodIndex++)
+                        {
+                            for (auto& meshInfo : meshComp.meshes[lodIndex])
+                            {
+                                if (meshInfo.mesh == nullptr && meshInfo.meshIndex >= 0)
+                                    meshInfo.mesh = meshComp.model->GetMesh(lodIndex, meshInfo.meshIndex);
+                                if (meshInfo.mesh != nullptr)
+                                    geometryCount += meshInfo.mesh->subsets.size();
+                            }
+                        }
+                    }
+
+                    GeometryRecords& records = GetRecords(geometryRecords, entity);
+                    const bool isChanged = geometryAllocator.Reallocate(records.geometries, geometryCount);
+                    if (!isChanged && records.model == model)
                         return;
 
+                    U32 geometryOffset = records.geometries.offset;
+                    U32 meshletCount = 0;
                     for (I32 lodIndex = 0; lodIndex < meshComp.lodsCount; lodIndex++)
                     {
                         for (auto& meshInfo : meshComp.meshes[lodIndex])
                         {
-                            meshInfo.geometryOffset = geometryArraySize;
-                            if (meshInfo.mesh != nullptr)
-                                geometryArraySize += meshInfo.mesh->subsets.size();
+                            meshInfo.geometryOffset = geometryOffset;
+                            meshInfo.meshletCount = 0;
+                            if (model == nullptr || meshInfo.mesh == nullptr)
+                                continue;
+
+                            for (auto& subset : meshInfo.mesh->subsets)
+                                meshInfo.meshletCount += TriangleCountToMeshletCount(subset.indexCount);
+                            geometryOffset += meshInfo.mesh->subsets.size();
+                            meshletCount += meshInfo.meshletCount;
                         }
                     }
+                    records.model = model;
+                    records.meshletCount = meshletCount;
+                    records.version = ++geometryVersion;
+                    records.isDirty = true;
                 });
             }
-            geometryBuffer.UpdateBuffer(device, geometryArraySize);
-            geometryMapped = geometryBuffer.Mapping(device);
 
-            // Reset meshlet count
-            AtomicStore(&meshletAllocator, 0);
+            // Allocate instance records
+            if (objectQuery.Valid())
+            {
+                objectQuery.ForEach([&](ECS::Entity entity, ObjectComponent& obj) {
+                    U32 instanceCount = 0;
+                    U32 meshletCount = 0;
+                    U32 version = 0;
+                    auto meshComp = obj.mesh.Get<MeshComponent>();
+                    if (meshComp != nullptr)
+                    {
+                        instanceCount = meshComp->meshCount;
+                        auto it = geometryRecords.find(obj.mesh);
+                        if (it.isValid())
+                        {
+                            meshletCount = it.value().meshletCount;
+                            version = it.value().version;
+                        }
+                    }
+
+                    InstanceRecords& records = GetRecords(instanceRecords, entity);
+                    if (instanceAllocator.Reallocate(records.instances, instanceCount))
+                        records.isDirty = true;
+                    if (meshletAllocator.Reallocate(records.meshlets, meshletCount))
+                        records.isDirty = true;
+                    if (records.geometryVersion != version)
+                    {
+                        records.geometryVersion = version;
+                        records.isDirty = true;
+                    }
+                    obj.instanceOffset = records.instances.offset;
+                });
+            }
+
+            // Allocate material records
+            if (materialQuery.Valid())
+            {
+                materialQuery.ForEach([&](ECS::Entity entity, MaterialComponent& mat) {
+                    MaterialRecords& records = GetRecords(materialRecords, entity);
+                    if (materialAllocator.Reallocate(records.materials, mat.materials.size()))
+                    {
+                        records.written.resize(mat.materials.size());
+                        records.isDirty = true;
+                    }
+                    mat.materialOffset = records.materials.offset;
+                });
+            }
+
+            // Update instance buffer, all records are written again if the buffer is recreated
+            instanceArraySize = instanceAllocator.size;
+            const bool instanceBufferChanged = instanceBuffer.UpdateBuffer(device, instanceArraySize);
+            instanceMapped = instanceBuffer.Mapping(device);
+            if (instanceMapped != nullptr)
+            {
+                if (instanceBufferChanged)
+                {
+                    for (auto& records : instanceRecords)
+                        records.isDirty = true;
+                    ClearInstances(0, instanceArraySize);
+                }
+                else
+                {
+                    // Meshlet preparing should skip the freed instances
+                    for (const auto& range : instanceAllocator.freedRanges)
+                        ClearInstances(range.offset, range.count);
+                }
+            }
+            instanceAllocator.freedRanges.clear();
+            meshletAllocator.freedRanges.clear();
+
+            // Update material buffer
+            if (materialBuffer.UpdateBuffer(device, materialAllocator.size))
+            {
+                for (auto& records : materialRecords)
+                    records.isDirty = true;
+            }
+            materialMapped = materialBuffer.Mapping(device);
+            materialAllocator.freedRanges.clear();
+
+            // Update geometry buffer
+            if (geometryBuffer.UpdateBuffer(device, geometryAllocator.size))
+            {
+                for (auto& records : geometryRecords)
+                    records.isDirty = true;
+            }
+            geometryMapped = geometryBuffer.Mapping(device);
+            geometryAllocator.freedRanges.clear();
 
             // Run systems
             if (pipeline)
                 world.RunPipeline(pipeline);
 
+            // Update bounding volume hierarchies
+            objectBVH.Apply();
+            lightBVH.Apply();
+
+            statistics.instancesWritten = AtomicExchange(&instancesWritten, 0);
+            statistics.geometriesWritten = AtomicExchange(&geometriesWritten, 0);
+            statistics.materialsWritten = AtomicExchange(&materialsWritten, 0);
+            PROFILE_COUNTER("InstancesWritten", statistics.instancesWritten);
+            PROFILE_COUNTER("GeometriesWritten", statistics.geometriesWritten);
+            PROFILE_COUNTER("MaterialsWritten", statistics.materialsWritten);
+
             // Create meshlet buffer
-            I32 meshletCount = AtomicRead(&meshletAllocator);
-            U32 bufferSize = meshletCount * sizeof(ShaderMeshlet);
+            U32 bufferSize = meshletAllocator.size * sizeof(ShaderMeshlet);
             if (bufferSize > 0 && (!meshletBuffer || meshletBuffer->GetCreateInfo().size < bufferSize))
             {
                 GPU::BufferCreateInfo info = {};
@@ -653,43 +1120,6 @@ namespace VulkanTest
 
     struct RenderingSystem {};
 
-    ECS::System TransformUpdateSystem(RenderSceneImpl& scene)
-    {
-        return scene.GetWorld().CreateSystem<TransformComponent>()
-            .Kind<RenderingSystem>()
-            .MultiThread(true)
-            .ForEach([&](ECS::Entity entity, TransformComponent& transComp) {
-            transComp.transform.UpdateTransform();
-        });
-    }
-
-    ECS::System HierarchyUpdateSystem(RenderSceneImpl& scene)
-    {
-        return scene.GetWorld().CreateSystem<TransformComponent>()
-            .Kind<RenderingSystem>()
-            .MultiThread(true)
-            .Arg(0).Parent().Cascade()
-            .ForEach([&](ECS::Entity entity, TransformComponent& transComp) {
-
-            auto parent = entity.GetParent();
-            if (parent == ECS::INVALID_ENTITY)
-                return;
-
-            MATRIX worldmatrix = transComp.transform.GetLocalMatrix();
-            while (parent != ECS::INVALID_ENTITYID)
-            {
-                const TransformComponent* parentTransform = parent.Get<TransformComponent>();
-                if (parentTransform != nullptr)
-                    worldmatrix *= parentTransform->transform.GetLocalMatrix();
-              
-                parent = parent.GetParent();
-            }
-
-            transComp.transform.world = StoreFMat4x4(worldmatrix);
-        });
-    }
-
-
     ECS::System MeshUpdateSystem(RenderSceneImpl& scene)
     {
         return scene.GetWorld().CreateSystem<MeshComponent>()
@@ -697,20 +1127,20 @@ namespace VulkanTest
             .MultiThread(true)
             .ForEach([&](ECS::Entity entity, MeshComponent& meshComp) {
 
-            if (!meshComp.model || !meshComp.model->IsReady())
+            auto geometryMapped = scene.geometryMapped;
+            if (!geometryMapped || !meshComp.model || !meshComp.model->IsReady())
                 return;
 
-            auto lodsCount = meshComp.model->GetLODsCount();
-            for (int lodIndex = 0; lodIndex < lodsCount; lodIndex++)
+            // Geometries are only written when the records are changed
+            auto it = scene.geometryRecords.find(entity);
+            if (!it.isValid() || !it.value().isDirty)
+                return;
+
+            GeometryRecords& records = it.value();
+            for (int lodIndex = 0; lodIndex < meshComp.lodsCount; lodIndex++)
             {
                 for (auto& meshInfo : meshComp.meshes[lodIndex])
                 {
-                    // Reset meshlet count
-                    meshInfo.meshletCount = 0;
-
-                    if (meshInfo.mesh == nullptr && meshInfo.meshIndex >= 0)
-                        meshInfo.mesh = meshComp.model->GetMesh(lodIndex, meshInfo.meshIndex);
-
                     auto mesh = meshInfo.mesh;
                     if (mesh == nullptr)
                         continue;
@@ -722,21 +1152,23 @@ namespace VulkanTest
                     geometry.ib = mesh->ib.srv->GetIndex();
 
                     U32 subsetIndex = 0;
+                    U32 meshletOffset = 0;
                     for (auto& subset : mesh->subsets)
                     {
                         geometry.indexOffset = subset.indexOffset;
-                        geometry.meshletOffset = meshInfo.meshletCount;
+                        geometry.meshletOffset = meshletOffset;
                         geometry.meshletCount = TriangleCountToMeshletCount(subset.indexCount);
-                        meshInfo.meshletCount += geometry.meshletCount;
+                        meshletOffset += geometry.meshletCount;
 
-                        auto geometryMapped = scene.geometryMapped;
-                        if (geometryMapped)
-                            memcpy(geometryMapped + meshInfo.geometryOffset + subsetIndex, &geometry, sizeof(ShaderGeometry));
-                        
+                        memcpy(geometryMapped + meshInfo.geometryOffset + subsetIndex, &geometry, sizeof(ShaderGeometry));
                         subsetIndex++;
                     }
                 }
             }   
+
+            scene.geometryBuffer.MarkDirty(records.geometries.offset, records.geometries.count);
+            AtomicAdd(&scene.geometriesWritten, (I32)records.geometries.count);
+            records.isDirty = false;
         });
     }
 
@@ -751,12 +1183,30 @@ namespace VulkanTest
             if (!materialMapped || materialComp.materials.empty())
                 return;
 
+            auto it = scene.materialRecords.find(entity);
+            if (!it.isValid())
+                return;
+
+            // Records are written when they are reallocated, or the params or textures of materials are changed
+            MaterialRecords& records = it.value();
+            ASSERT(records.written.size() == materialComp.materials.size());
             for (int i = 0; i < materialComp.materials.size(); i++)
             {
                 auto& material = materialComp.materials[i];
-                if (material && material->IsReady())
-                    material->WriteShaderMaterial(materialMapped + materialComp.materialOffset + i);
+                if (!material || !material->IsReady())
+                    continue;
+
+                ShaderMaterial shaderMaterial;
+                material->WriteShaderMaterial(&shaderMaterial);
+                if (!records.isDirty && memcmp(&records.written[i], &shaderMaterial, sizeof(ShaderMaterial)) == 0)
+                    continue;
+
+                records.written[i] = shaderMaterial;
+                memcpy(materialMapped + materialComp.materialOffset + i, &shaderMaterial, sizeof(ShaderMaterial));
+                scene.materialBuffer.MarkDirty(materialComp.materialOffset + i);
+                AtomicIncrement(&scene.materialsWritten);
             }
+            records.isDirty = false;
          });
     }
 
@@ -771,55 +1221,69 @@ namespace VulkanTest
             if (!instanceMapped)
                 return;
 
-            const MeshComponent* meshComp = nullptr;
-            AABB& aabb = objComp.aabb;
-            aabb = AABB();
-            if (objComp.mesh != ECS::INVALID_ENTITY)
-            {
-                meshComp = objComp.mesh.Get<MeshComponent>();
-                if (meshComp == nullptr)
-                    return;
+            auto it = scene.instanceRecords.find(entity);
+            if (!it.isValid())
+                return;
 
-                I32 instOffset = objComp.instanceOffset;
-                MATRIX mat = LoadFMat4x4(transform.transform.world);
-                for (int lodIndex = 0; lodIndex < meshComp->lodsCount; lodIndex++)
+            // Instances are only written when the records or the world transform are changed
+            InstanceRecords& records = it.value();
+            const bool isMoved = memcmp(&objComp.worldMat, &transform.transform.world, sizeof(FMat4x4)) != 0;
+            const MeshComponent* meshComp = objComp.mesh != ECS::INVALID_ENTITY ? objComp.mesh.Get<MeshComponent>() : nullptr;
+            if (records.isDirty || isMoved)
+            {
+                AABB& aabb = objComp.aabb;
+                aabb = AABB();
+                if (meshComp != nullptr)
                 {
-                    for (auto& meshInfo : meshComp->meshes[lodIndex])
+                    I32 instOffset = objComp.instanceOffset;
+                    U32 meshletOffset = records.meshlets.offset;
+                    MATRIX mat = LoadFMat4x4(transform.transform.world);
+
+                    // Inverse transpose world mat
+                    MATRIX worldMatInvTranspose = MatrixTranspose(MatrixInverse(mat));
+                    for (int lodIndex = 0; lodIndex < meshComp->lodsCount; lodIndex++)
                     {
-                        auto mesh = meshInfo.mesh;
-                        if (mesh == nullptr)
-                            continue;
-
-                        if (lodIndex == 0)
-                            aabb.Merge(meshInfo.aabb.Transform(mat));
-
-                        // Setup shader mesh instance
-                        ShaderMeshInstance inst;
-                        inst.init();
-                        inst.uid = uint((ECS::EntityID)objComp.mesh);   // Need use u64?
-                        inst.geometryOffset = meshInfo.geometryOffset;
-                        inst.geometryCount = mesh->subsets.size();   // TODO select the subset for target lod
-                        inst.meshletOffset = AtomicAdd(&scene.meshletAllocator, meshInfo.meshletCount) - meshInfo.meshletCount;
-
-                        // Set world transform
-                        inst.transform.Create(transform.transform.world);
-
-                        // Inverse transpose world mat
-                        MATRIX worldMatInvTranspose = MatrixTranspose(MatrixInverse(mat));
-                        inst.transformInvTranspose.Create(StoreFMat4x4(worldMatInvTranspose));
-                        memcpy(instanceMapped + instOffset, &inst, sizeof(ShaderMeshInstance));
-
-                        instOffset++;
+                        for (auto& meshInfo : meshComp->meshes[lodIndex])
+                        {
+                            auto mesh = meshInfo.mesh;
+                            if (mesh == nullptr)
+                                continue;
+
+                            if (lodIndex == 0)
+                                aabb.Merge(meshInfo.aabb.Transform(mat));
+
+                            // Setup shader mesh instance
+                            ShaderMeshInstance inst;
+                            inst.init();
+                            inst.uid = uint((ECS::EntityID)objComp.mesh);   // Need use u64?
+                            inst.geometryOffset = meshInfo.geometryOffset;
+                            inst.geometryCount = mesh->subsets.size();   // TODO select the subset for target lod
+                            inst.meshletOffset = meshletOffset;
+                            meshletOffset += meshInfo.meshletCount;
+
+                            // Set world transform
+                            inst.transform.Create(transform.transform.world);
+                            inst.transformInvTranspose.Create(StoreFMat4x4(worldMatInvTranspose));
+                            memcpy(instanceMapped + instOffset, &inst, sizeof(ShaderMeshInstance));
+
+                            instOffset++;
+                        }
                     }
+
+                    FMat4x4 meshMatrix = StoreFMat4x4(aabb.GetAsMatrix() * mat);
+                    objComp.center = meshMatrix.vec[3].xyz();
+
+                    // Instances of unloaded meshes are kept empty
+                    scene.instanceBuffer.MarkDirty(records.instances.offset, records.instances.count);
+                    AtomicAdd(&scene.instancesWritten, (I32)records.instances.count);
                 }
-      
-                FMat4x4 meshMatrix = StoreFMat4x4(aabb.GetAsMatrix() * mat);
-                objComp.center = meshMatrix.vec[3].xyz();
-            }
 
-            // objComp.center = aabb.GetCenter();
-            objComp.radius = aabb.GetRadius();
-            objComp.worldMat = transform.transform.world;
+                // objComp.center = aabb.GetCenter();
+                objComp.radius = aabb.GetRadius();
+                objComp.worldMat = transform.transform.world;
+                scene.objectBVH.Update(entity, aabb);
+                records.isDirty = false;
+            }
 
             // Calculate LOD
             if (meshComp != nullptr && meshComp->model)
@@ -864,13 +1328,12 @@ namespace VulkanTest
             default:
                 break;
             }
+            scene.lightBVH.Update(entity, light.aabb);
         });
     }
 
     void RenderSceneImpl::InitSystems()
     {
-        AddSystem(TransformUpdateSystem(*this));
-        AddSystem(HierarchyUpdateSystem(*this));
         AddSystem(MeshUpdateSystem(*this));
         AddSystem(MaterialUpdateSystem(*this));
         AddSystem(ObjectUpdateSystem(*this));
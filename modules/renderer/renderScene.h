@@ -2,9 +2,18 @@
 
 #include "rendererCommon.h"
 #include "renderScene_comps.h"
+#include "sceneBVH.h"
 
 namespace VulkanTest
 {
+	// The count of records written into the scene buffers by the last update
+	struct RenderSceneStatistics
+	{
+		U32 instancesWritten = 0;
+		U32 geometriesWritten = 0;
+		U32 materialsWritten = 0;
+	};
+
 	class VULKAN_TEST_API RenderScene : public IScene
 	{
 	public:
@@ -20,6 +29,12 @@ namespace VulkanTest
 
 		virtual PickResult CastRayPick(const Ray& ray, U32 mask = ~0) = 0;
 
+		// Bounding volume hierarchies of objects and lights, updated after running the rendering systems
+		virtual const SceneBVH& GetObjectBVH()const = 0;
+		virtual const SceneBVH& GetLightBVH()const = 0;
+
+		virtual const RenderSceneStatistics& GetStatistics()const = 0;
+
 		virtual void CreateComponent(ECS::Entity entity, ComponentType compType) = 0;
 
 		// Entity
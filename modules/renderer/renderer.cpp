@@ -1,9 +1,11 @@
 #include "renderer.h"
+#include "renderQueue.h"
 #include "shaderInterop.h"
 #include "shaderInterop_renderer.h"
 #include "shaderInterop_postprocess.h"
 #include "gpu\vulkan\wsi.h"
 #include "core\profiler\profiler.h"
+#include "core\threading\jobsystem.h"
 #include "renderScene.h"
 #include "renderPath3D.h"
 #include "textureHelper.h"
@@ -144,77 +146,28 @@ private:
 
 namespace Renderer
 {
-	struct RenderBatch
-	{
-		U64 sortingKey;
-		const MeshComponent::MeshInfo* meshInfo;
-		const ObjectComponent* objCmp;
-
-		RenderBatch(const MeshComponent::MeshInfo* meshInfo_, const ObjectComponent* objCmp_, U32 instanceIndex, F32 distance) :
-			meshInfo(meshInfo_),
-			objCmp(objCmp_)
-		{
-			ASSERT(instanceIndex < 0x00FFFFFF);
-			sortingKey = 0;
-			sortingKey |= U64((U32)meshInfo->mesh->GetGUID().GetHash() & 0x00FFFFFF) << 40ull;
-			sortingKey |= U64(ConvertFloatToHalf(distance) & 0xFFFF) << 24ull;
-			sortingKey |= U64((U32)instanceIndex & 0x00FFFFFF) << 0ull;
-		}
-
-		inline float GetDistance() const
-		{
-			return ConvertHalfToFloat(HALF((sortingKey >> 24ull) & 0xFFFF));
-		}
-
-		inline const MeshComponent::MeshInfo* GetMeshInfo() const
-		{
-			return meshInfo;
-		}
-		
-		inline const ObjectComponent* GetObjectComponent()const {
-			return objCmp;
-		}
+	// DrawScene could be recorded by several passes at the same time, each takes a queue from the pool.
+	// Thread local queues are not used because the jobs could be resumed on another thread.
+	Mutex renderQueuePoolMutex;
+	Array<RenderQueue*> renderQueuePool;
 
-		inline U32 GetInstanceIndex() const
-		{
-			return (sortingKey >> 0ull) & 0x00FFFFFF;
-		}
-
-		bool operator<(const RenderBatch& other) const
-		{
-			return sortingKey < other.sortingKey;
-		}
-	};
-
-	struct RenderQueue
+	RenderQueue* AcquireRenderQueue()
 	{
-		void SortOpaque()
-		{
-			std::sort(batches.begin(), batches.end(), std::less<RenderBatch>());
-		}
-
-		void Clear()
-		{
-			batches.clear();
-		}
+		ScopedMutex lock(renderQueuePoolMutex);
+		if (renderQueuePool.empty())
+			return CJING_NEW(RenderQueue)();
 
-		void Add(const MeshComponent::MeshInfo* meshInfo, const ObjectComponent* objCmp, U32 instanceIndex, F32 distance)
-		{
-			batches.emplace(meshInfo, objCmp, instanceIndex, distance);
-		}
-
-		bool Empty()const
-		{
-			return batches.empty();
-		}
-
-		size_t Size()const
-		{
-			return batches.size();
-		}
+		RenderQueue* queue = renderQueuePool.back();
+		renderQueuePool.pop_back();
+		return queue;
+	}
 
-		Array<RenderBatch> batches;
-	};
+	void ReleaseRenderQueue(RenderQueue* queue)
+	{
+		queue->Clear();
+		ScopedMutex lock(renderQueuePoolMutex);
+		renderQueuePool.push_back(queue);
+	}
 
 	GPU::BlendState stockBlendStates[BSTYPE_COUNT] = {};
 	GPU::RasterizerState stockRasterizerState[RSTYPE_COUNT] = {};
@@ -420,6 +373,11 @@ namespace Renderer
 		for (int i = 0; i < ARRAYSIZE(samplers); i++)
 			samplers[i].reset();
 
+		// Release render queues
+		for (RenderQueue* queue : renderQueuePool)
+			CJING_SAFE_DELETE(queue);
+		renderQueuePool.clear();
+
 		rendererPlugin = nullptr;
 		Logger::Info("Render uninitialized");
 	}
@@ -681,35 +639,14 @@ namespace Renderer
 
 		BindFrameCB(cmd);
 
-#if 0
-		static thread_local RenderQueue queue;
-#else
-		RenderQueue queue;
-#endif
-		queue.Clear();
-		for (auto objectID : vis.objects)
-		{
-			const ObjectComponent* obj = objectID.Get<ObjectComponent>();
-			if (obj == nullptr || obj->mesh == ECS::INVALID_ENTITY)
-				continue;
-
-			const MeshComponent* mesh = obj->mesh.Get<MeshComponent>();
-			if (mesh == nullptr || obj->lodIndex >= mesh->lodsCount || !mesh->model->IsReady())
-				continue;
-
-			auto& lodMeshes = mesh->meshes[obj->lodIndex];
-			for (U32 i = 0; i < lodMeshes.size(); i++)
-			{
-				const F32 distance = Distance(vis.camera->eye, obj->center);
-				queue.Add(&lodMeshes[i], obj, obj->instanceOffset + i, distance);
-			}
-		}
-
-		if (!queue.Empty())
+		RenderQueue* queue = AcquireRenderQueue();
+		queue->Build(vis);
+		if (!queue->Empty())
 		{
-			queue.SortOpaque();
-			DrawMeshes(cmd, queue, vis, pass, 0);
+			queue->SortOpaque();
+			DrawMeshes(cmd, *queue, vis, pass, 0);
 		}
+		ReleaseRenderQueue(queue);
 
 		cmd.EndEvent();
 	}
@@ -739,10 +676,12 @@ namespace Renderer
 		if (model->GetLODsCount() <= 1)
 			return 0;
 
-		for (int i = model->GetLODsCount() - 1; i >= 0; i--)
+		// Pick the coarsest lod allowed at the projected size
+		const F32 screenSize = radius / std::sqrt(distSq);
+		for (int i = model->GetLODsCount() - 1; i > 0; i--)
 		{
 			const auto& lod = model->GetModelLOD(i);
-			if (lod->screenSize >= distSq)
+			if (lod->screenSize >= screenSize)
 				return i;
 		}
 		return 0;
@@ -0,0 +1,377 @@
+#include "sceneBVH.h"
+
+namespace VulkanTest
+{
+	static constexpr F32 AABB_MARGIN = 0.1f;
+	static constexpr F32 AABB_MARGIN_RATIO = 0.1f;
+	static constexpr F32 UNBOUNDED_EXTENT = 1e18f;
+
+	static AABB GetEnlargedAABB(const AABB& aabb)
+	{
+		const F32 marginX = std::max(AABB_MARGIN, (aabb.max.x - aabb.min.x) * AABB_MARGIN_RATIO);
+		const F32 marginY = std::max(AABB_MARGIN, (aabb.max.y - aabb.min.y) * AABB_MARGIN_RATIO);
+		const F32 marginZ = std::max(AABB_MARGIN, (aabb.max.z - aabb.min.z) * AABB_MARGIN_RATIO);
+		return AABB(
+			F32x3(aabb.min.x - marginX, aabb.min.y - marginY, aabb.min.z - marginZ),
+			F32x3(aabb.max.x + marginX, aabb.max.y + marginY, aabb.max.z + marginZ));
+	}
+
+	static bool Contains(const AABB& outer, const AABB& inner)
+	{
+		return
+			outer.min.x <= inner.min.x && outer.min.y <= inner.min.y && outer.min.z <= inner.min.z &&
+			outer.max.x >= inner.max.x && outer.max.y >= inner.max.y && outer.max.z >= inner.max.z;
+	}
+
+	SceneBVH::SceneBVH()
+	{
+	}
+
+	I32 SceneBVH::CreateProxy(const AABB& aabb, ECS::Entity entity)
+	{
+		const I32 proxy = AllocateNode();
+		Node& node = nodes[proxy];
+		node.box = aabb;
+		node.entity = entity;
+		proxyCount++;
+
+		if (IsUnbounded(aabb))
+		{
+			node.aabb = aabb;
+			node.height = -1;
+			unboundedProxies.push_back(proxy);
+			return proxy;
+		}
+
+		node.aabb = GetEnlargedAABB(aabb);
+		node.height = 0;
+		InsertLeaf(proxy);
+		return proxy;
+	}
+
+	void SceneBVH::DestroyProxy(I32 proxy)
+	{
+		ASSERT(proxy >= 0 && proxy < (I32)nodes.size());
+		ASSERT(nodes[proxy].IsLeaf());
+		if (nodes[proxy].height < 0)
+			unboundedProxies.erase(proxy);
+		else
+			RemoveLeaf(proxy);
+
+		FreeNode(proxy);
+		proxyCount--;
+	}
+
+	bool SceneBVH::MoveProxy(I32 proxy, const AABB& aabb)
+	{
+		ASSERT(proxy >= 0 && proxy < (I32)nodes.size());
+		Node& node = nodes[proxy];
+		ASSERT(node.IsLeaf());
+
+		const bool wasUnbounded = node.height < 0;
+		const bool isUnbounded = IsUnbounded(aabb);
+		node.box = aabb;
+		if (!wasUnbounded && !isUnbounded && Contains(node.aabb, aabb))
+			return false;
+
+		if (wasUnbounded)
+			unboundedProxies.erase(proxy);
+		else
+			RemoveLeaf(proxy);
+
+		if (isUnbounded)
+		{
+			nodes[proxy].aabb = aabb;
+			nodes[proxy].height = -1;
+			unboundedProxies.push_back(proxy);
+		}
+		else
+		{
+			nodes[proxy].aabb = GetEnlargedAABB(aabb);
+			nodes[proxy].height = 0;
+			InsertLeaf(proxy);
+		}
+		return true;
+	}
+
+	void SceneBVH::Clear()
+	{
+		nodes.clear();
+		unboundedProxies.clear();
+		root = INVALID_PROXY;
+		freeList = INVALID_PROXY;
+		proxyCount = 0;
+	}
+
+	bool SceneBVH::TryUpdateProxy(I32 proxy, const AABB& aabb)
+	{
+		ASSERT(proxy >= 0 && proxy < (I32)nodes.size());
+		Node& node = nodes[proxy];
+		const bool isContained = node.height < 0 ?
+			IsUnbounded(aabb) :
+			!IsUnbounded(aabb) && Contains(node.aabb, aabb);
+		if (!isContained)
+			return false;
+
+		node.box = aabb;
+		return true;
+	}
+
+	I32 SceneBVH::AllocateNode()
+	{
+		if (freeList == INVALID_PROXY)
+		{
+			nodes.emplace();
+			return (I32)nodes.size() - 1;
+		}
+
+		const I32 ret = freeList;
+		freeList = nodes[ret].parent;
+		nodes[ret] = Node();
+		return ret;
+	}
+
+	void SceneBVH::FreeNode(I32 node)
+	{
+		nodes[node].parent = freeList;
+		nodes[node].entity = ECS::INVALID_ENTITY;
+		nodes[node].height = -2;
+		freeList = node;
+	}
+
+	void SceneBVH::InsertLeaf(I32 leaf)
+	{
+		if (root == INVALID_PROXY)
+		{
+			root = leaf;
+			nodes[root].parent = INVALID_PROXY;
+			return;
+		}
+
+		// Find the best sibling by the surface area heuristic
+		const AABB leafAABB = nodes[leaf].aabb;
+		I32 index = root;
+		while (!nodes[index].IsLeaf())
+		{
+			const Node& node = nodes[index];
+			const F32 area = GetArea(node.aabb);
+			const F32 combinedArea = GetArea(AABB::Merge(node.aabb, leafAABB));
+
+			// Cost of creating a new parent for this node and the new leaf
+			const F32 cost = 2.0f * combinedArea;
+			// Minimum cost of pushing the leaf further down the tree
+			const F32 inheritanceCost = 2.0f * (combinedArea - area);
+
+			auto GetChildCost = [&](I32 child) {
+				const AABB merged = AABB::Merge(leafAABB, nodes[child].aabb);
+				if (nodes[child].IsLeaf())
+					return GetArea(merged) + inheritanceCost;
+				return GetArea(merged) - GetArea(nodes[child].aabb) + inheritanceCost;
+			};
+			const F32 cost1 = GetChildCost(node.child1);
+			const F32 cost2 = GetChildCost(node.child2);
+			if (cost < cost1 && cost < cost2)
+				break;
+
+			index = cost1 < cost2 ? node.child1 : node.child2;
+		}
+
+		// Create a new parent
+		const I32 sibling = index;
+		const I32 oldParent = nodes[sibling].parent;
+		const I32 newParent = AllocateNode();
+		nodes[newParent].parent = oldParent;
+		nodes[newParent].aabb = AABB::Merge(leafAABB, nodes[sibling].aabb);
+		nodes[newParent].height = nodes[sibling].height + 1;
+		nodes[newParent].child1 = sibling;
+		nodes[newParent].child2 = leaf;
+		nodes[sibling].parent = newParent;
+		nodes[leaf].parent = newParent;
+
+		if (oldParent != INVALID_PROXY)
+		{
+			if (nodes[oldParent].child1 == sibling)
+				nodes[oldParent].child1 = newParent;
+			else
+				nodes[oldParent].child2 = newParent;
+		}
+		else
+		{
+			root = newParent;
+		}
+
+		// Refit the ancestors
+		index = nodes[leaf].parent;
+		while (index != INVALID_PROXY)
+		{
+			index = Balance(index);
+
+			Node& node = nodes[index];
+			node.height = 1 + std::max(nodes[node.child1].height, nodes[node.child2].height);
+			node.aabb = AABB::Merge(nodes[node.child1].aabb, nodes[node.child2].aabb);
+			index = node.parent;
+		}
+	}
+
+	void SceneBVH::RemoveLeaf(I32 leaf)
+	{
+		if (leaf == root)
+		{
+			root = INVALID_PROXY;
+			return;
+		}
+
+		const I32 parent = nodes[leaf].parent;
+		const I32 grandParent = nodes[parent].parent;
+		const I32 sibling = nodes[parent].child1 == leaf ? nodes[parent].child2 : nodes[parent].child1;
+		if (grandParent != INVALID_PROXY)
+		{
+			// Replace the parent with the sibling
+			if (nodes[grandParent].child1 == parent)
+				nodes[grandParent].child1 = sibling;
+			else
+				nodes[grandParent].child2 = sibling;
+			nodes[sibling].parent = grandParent;
+			FreeNode(parent);
+
+			I32 index = grandParent;
+			while (index != INVALID_PROXY)
+			{
+				index = Balance(index);
+
+				Node& node = nodes[index];
+				node.aabb = AABB::Merge(nodes[node.child1].aabb, nodes[node.child2].aabb);
+				node.height = 1 + std::max(nodes[node.child1].height, nodes[node.child2].height);
+				index = node.parent;
+			}
+		}
+		else
+		{
+			root = sibling;
+			nodes[sibling].parent = INVALID_PROXY;
+			FreeNode(parent);
+		}
+		nodes[leaf].parent = INVALID_PROXY;
+	}
+
+	// Rotate the subtree if it is imbalanced, returns the new root of the subtree
+	I32 SceneBVH::Balance(I32 index)
+	{
+		const Node& node = nodes[index];
+		if (node.IsLeaf() || node.height < 2)
+			return index;
+
+		const I32 child1 = node.child1;
+		const I32 child2 = node.child2;
+		const I32 balance = nodes[child2].height - nodes[child1].height;
+		if (balance > 1)
+		{
+			Rotate(index, child1, child2, true);
+			return child2;
+		}
+		if (balance < -1)
+		{
+			Rotate(index, child2, child1, false);
+			return child1;
+		}
+		return index;
+	}
+
+	// Promote the higher child to the place of the parent, the parent takes the lower grandchild
+	void SceneBVH::Rotate(I32 parent, I32 sibling, I32 promoted, bool isChild2)
+	{
+		Node& parentNode = nodes[parent];
+		Node& promotedNode = nodes[promoted];
+		I32 keep = promotedNode.child1;
+		I32 move = promotedNode.child2;
+		if (nodes[keep].height < nodes[move].height)
+			std::swap(keep, move);
+
+		promotedNode.child1 = parent;
+		promotedNode.child2 = keep;
+		promotedNode.parent = parentNode.parent;
+		parentNode.parent = promoted;
+		if (promotedNode.parent != INVALID_PROXY)
+		{
+			Node& grandParentNode = nodes[promotedNode.parent];
+			if (grandParentNode.child1 == parent)
+				grandParentNode.child1 = promoted;
+			else
+				grandParentNode.child2 = promoted;
+		}
+		else
+		{
+			root = promoted;
+		}
+
+		if (isChild2)
+			parentNode.child2 = move;
+		else
+			parentNode.child1 = move;
+		nodes[move].parent = parent;
+
+		const Node& siblingNode = nodes[sibling];
+		parentNode.aabb = AABB::Merge(siblingNode.aabb, nodes[move].aabb);
+		parentNode.height = 1 + std::max(siblingNode.height, nodes[move].height);
+		promotedNode.aabb = AABB::Merge(parentNode.aabb, nodes[keep].aabb);
+		promotedNode.height = 1 + std::max(parentNode.height, nodes[keep].height);
+	}
+
+	bool SceneBVH::IsUnbounded(const AABB& aabb)
+	{
+		return !(
+			aabb.max.x - aabb.min.x < UNBOUNDED_EXTENT &&
+			aabb.max.y - aabb.min.y < UNBOUNDED_EXTENT &&
+			aabb.max.z - aabb.min.z < UNBOUNDED_EXTENT);
+	}
+
+	F32 SceneBVH::GetArea(const AABB& aabb)
+	{
+		const F32 dx = aabb.max.x - aabb.min.x;
+		const F32 dy = aabb.max.y - aabb.min.y;
+		const F32 dz = aabb.max.z - aabb.min.z;
+		return dx * dy + dy * dz + dz * dx;
+	}
+
+	SceneBVH::FrustumTest SceneBVH::TestFrustum(const Frustum& frustum, const AABB& aabb)
+	{
+		FrustumTest ret = FrustumTest::INSIDE;
+		for (const F32x4& plane : frustum.planes)
+		{
+			// The corner farthest along the plane normal, and the nearest one
+			const F32 px = plane.x >= 0.0f ? aabb.max.x : aabb.min.x;
+			const F32 py = plane.y >= 0.0f ? aabb.max.y : aabb.min.y;
+			const F32 pz = plane.z >= 0.0f ? aabb.max.z : aabb.min.z;
+			if (plane.x * px + plane.y * py + plane.z * pz + plane.w < 0.0f)
+				return FrustumTest::OUTSIDE;
+
+			const F32 nx = plane.x >= 0.0f ? aabb.min.x : aabb.max.x;
+			const F32 ny = plane.y >= 0.0f ? aabb.min.y : aabb.max.y;
+			const F32 nz = plane.z >= 0.0f ? aabb.min.z : aabb.max.z;
+			if (plane.x * nx + plane.y * ny + plane.z * nz + plane.w < 0.0f)
+				ret = FrustumTest::INTERSECTS;
+		}
+		return ret;
+	}
+
+	bool SceneBVH::IntersectRay(const Ray& ray, const AABB& aabb, F32 tMax, F32& tEntry)
+	{
+		F32 tx1 = (aabb.min.x - ray.origin.x) * ray.directionInv.x;
+		F32 tx2 = (aabb.max.x - ray.origin.x) * ray.directionInv.x;
+		F32 tmin = std::min(tx1, tx2);
+		F32 tmax = std::max(tx1, tx2);
+
+		F32 ty1 = (aabb.min.y - ray.origin.y) * ray.directionInv.y;
+		F32 ty2 = (aabb.max.y - ray.origin.y) * ray.directionInv.y;
+		tmin = std::max(tmin, std::min(ty1, ty2));
+		tmax = std::min(tmax, std::max(ty1, ty2));
+
+		F32 tz1 = (aabb.min.z - ray.origin.z) * ray.directionInv.z;
+		F32 tz2 = (aabb.max.z - ray.origin.z) * ray.directionInv.z;
+		tmin = std::max(tmin, std::min(tz1, tz2));
+		tmax = std::min(tmax, std::max(tz1, tz2));
+
+		tEntry = std::max(tmin, ray.tMin);
+		return tmax >= tEntry && tEntry <= tMax;
+	}
+}
\ No newline at end of file
@@ -0,0 +1,191 @@
+#pragma once
+
+#include "core\common.h"
+#include "core\collections\array.h"
+#include "core\scene\world.h"
+#include "math\geometry.h"
+
+namespace VulkanTest
+{
+	// Dynamic bounding volume hierarchy of scene entities.
+	// Leaves store enlarged boxes, so the tree is only changed when an entity moves out of its enlarged box.
+	// The tree is balanced by rotations on insertion, queries cost O(log n) plus the count of results.
+	// Entities with unbounded boxes (directional lights) are kept out of the tree and reported by every query.
+	class VULKAN_TEST_API SceneBVH
+	{
+	public:
+		static constexpr I32 INVALID_PROXY = -1;
+
+		SceneBVH();
+
+		I32 CreateProxy(const AABB& aabb, ECS::Entity entity);
+		void DestroyProxy(I32 proxy);
+		// Update the box of the proxy, returns true if the proxy is reinserted
+		bool MoveProxy(I32 proxy, const AABB& aabb);
+		void Clear();
+
+		// Update the box of the proxy only if it is still inside the enlarged box, otherwise returns false and MoveProxy is required.
+		// It never changes the tree, so it could be called concurrently for different proxies.
+		bool TryUpdateProxy(I32 proxy, const AABB& aabb);
+
+		const AABB& GetAABB(I32 proxy)const {
+			return nodes[proxy].box;
+		}
+
+		ECS::Entity GetEntity(I32 proxy)const {
+			return nodes[proxy].entity;
+		}
+
+		U32 GetProxyCount()const {
+			return proxyCount;
+		}
+
+		I32 GetHeight()const {
+			return root != INVALID_PROXY ? nodes[root].height : 0;
+		}
+
+		// func(proxy, bool fullyInside), proxies fully inside the frustum are reported without testing their own boxes
+		template<typename F>
+		void QueryFrustum(const Frustum& frustum, const F& func)const;
+
+		// func(proxy, F32 tMax) returns the new tMax, subtrees farther than tMax are skipped
+		template<typename F>
+		void QueryRay(const Ray& ray, const F& func)const;
+
+	private:
+		static constexpr U32 STACK_SIZE = 256;
+
+		enum class FrustumTest
+		{
+			OUTSIDE,
+			INTERSECTS,
+			INSIDE
+		};
+
+		struct Node
+		{
+			AABB aabb;			// Enlarged box of leaf, or the union of children
+			AABB box;			// Actual box of leaf
+			ECS::Entity entity = ECS::INVALID_ENTITY;
+			I32 parent = INVALID_PROXY;	// Next free node when freed
+			I32 child1 = INVALID_PROXY;
+			I32 child2 = INVALID_PROXY;
+			I32 height = 0;			// -1 means unbounded proxy, -2 means freed
+
+			bool IsLeaf()const {
+				return child1 == INVALID_PROXY;
+			}
+		};
+
+		I32 AllocateNode();
+		void FreeNode(I32 node);
+		void InsertLeaf(I32 leaf);
+		void RemoveLeaf(I32 leaf);
+		I32 Balance(I32 index);
+		void Rotate(I32 parent, I32 sibling, I32 promoted, bool isChild2);
+
+		static bool IsUnbounded(const AABB& aabb);
+		static F32 GetArea(const AABB& aabb);
+		static FrustumTest TestFrustum(const Frustum& frustum, const AABB& aabb);
+		static bool IntersectRay(const Ray& ray, const AABB& aabb, F32 tMax, F32& tEntry);
+
+		Array<Node> nodes;
+		Array<I32> unboundedProxies;
+		I32 root = INVALID_PROXY;
+		I32 freeList = INVALID_PROXY;
+		U32 proxyCount = 0;
+	};
+
+	template<typename F>
+	void SceneBVH::QueryFrustum(const Frustum& frustum, const F& func)const
+	{
+		for (I32 proxy : unboundedProxies)
+			func(proxy, true);
+
+		if (root == INVALID_PROXY)
+			return;
+
+		// Subtrees fully inside the frustum are reported without more tests
+		I32 stack[STACK_SIZE];
+		bool insideStack[STACK_SIZE];
+		U32 stackSize = 0;
+		stack[stackSize] = root;
+		insideStack[stackSize++] = false;
+		while (stackSize > 0)
+		{
+			stackSize--;
+			const I32 index = stack[stackSize];
+			bool inside = insideStack[stackSize];
+			const Node& node = nodes[index];
+			if (!inside)
+			{
+				const FrustumTest result = TestFrustum(frustum, node.aabb);
+				if (result == FrustumTest::OUTSIDE)
+					continue;
+				inside = result == FrustumTest::INSIDE;
+			}
+
+			if (node.IsLeaf())
+			{
+				func(index, inside);
+				continue;
+			}
+
+			ASSERT(stackSize + 2 <= STACK_SIZE);
+			stack[stackSize] = node.child1;
+			insideStack[stackSize++] = inside;
+			stack[stackSize] = node.child2;
+			insideStack[stackSize++] = inside;
+		}
+	}
+
+	template<typename F>
+	void SceneBVH::QueryRay(const Ray& ray, const F& func)const
+	{
+		F32 tMax = ray.tMax;
+		for (I32 proxy : unboundedProxies)
+			tMax = func(proxy, tMax);
+
+		if (root == INVALID_PROXY)
+			return;
+
+		I32 stack[STACK_SIZE];
+		U32 stackSize = 0;
+		stack[stackSize++] = root;
+		while (stackSize > 0)
+		{
+			const I32 index = stack[--stackSize];
+			const Node& node = nodes[index];
+			F32 tEntry;
+			if (!IntersectRay(ray, node.aabb, tMax, tEntry))
+				continue;
+
+			if (node.IsLeaf())
+			{
+				if (IntersectRay(ray, node.box, tMax, tEntry))
+					tMax = func(index, tMax);
+				continue;
+			}
+
+			// Visit the nearer child first, so more subtrees are skipped by the closer hits
+			I32 first = node.child1;
+			I32 second = node.child2;
+			F32 t1, t2;
+			const bool hit1 = IntersectRay(ray, nodes[first].aabb, tMax, t1);
+			const bool hit2 = IntersectRay(ray, nodes[second].aabb, tMax, t2);
+			if (hit1 && hit2 && t2 < t1)
+				std::swap(first, second);
+
+			ASSERT(stackSize + 2 <= STACK_SIZE);
+			if (hit1 && hit2)
+			{
+				stack[stackSize++] = second;
+				stack[stackSize++] = first;
+			}
+			else if (hit1 || hit2)
+			{
+				stack[stackSize++] = hit1 ? node.child1 : node.child2;
+			}
+		}
+	}
+}
\ No newline at end of file
@@ -0,0 +1,153 @@
+#include "transformHierarchy.h"
+
+namespace VulkanTest
+{
+	void TransformHierarchy::Begin()
+	{
+		gatherCount = 0;
+		isChanged = false;
+	}
+
+	void TransformHierarchy::Add(ECS::Entity entity, Transform& transform)
+	{
+		const U32 index = gatherCount++;
+		const ECS::Entity parent = entity.GetParent();
+		if (index >= nodes.size())
+		{
+			nodes.resize(index + 1);
+			gathered.resize(index + 1);
+			isChanged = true;
+		}
+
+		Node& node = nodes[index];
+		if (node.entity != entity || node.parent != parent)
+		{
+			node.entity = entity;
+			node.parent = parent;
+			isChanged = true;
+		}
+		gathered[index] = &transform;
+	}
+
+	void TransformHierarchy::Sort()
+	{
+		const U32 count = gatherCount;
+		HashMap<ECS::Entity, I32> nodeIndices;
+		for (U32 i = 0; i < count; i++)
+			nodeIndices.insert(nodes[i].entity, (I32)i);
+
+		// Find the nearest ancestor with transform of each node
+		Array<I32> parentIndices;
+		parentIndices.resize(count);
+		for (U32 i = 0; i < count; i++)
+		{
+			parentIndices[i] = -1;
+			ECS::Entity parent = nodes[i].parent;
+			while (parent != ECS::INVALID_ENTITY)
+			{
+				auto it = nodeIndices.find(parent);
+				if (it.isValid())
+				{
+					parentIndices[i] = it.value();
+					break;
+				}
+				parent = parent.GetParent();
+			}
+		}
+
+		// Calculate depths, each chain is only walked until a node with known depth
+		Array<I32> depths;
+		Array<I32> chain;
+		depths.resize(count);
+		for (U32 i = 0; i < count; i++)
+			depths[i] = -1;
+
+		I32 maxDepth = 0;
+		for (U32 i = 0; i < count; i++)
+		{
+			I32 index = (I32)i;
+			while (index >= 0 && depths[index] < 0)
+			{
+				chain.push_back(index);
+				index = parentIndices[index];
+			}
+
+			I32 depth = index >= 0 ? depths[index] : -1;
+			for (I32 k = (I32)chain.size() - 1; k >= 0; k--)
+				depths[chain[k]] = ++depth;
+			chain.clear();
+			maxDepth = std::max(maxDepth, depths[i]);
+		}
+
+		// Counting sort by depth
+		sortedIndices.resize(count);
+		Array<U32> offsets;
+		offsets.resize(maxDepth + 2);
+		memset(offsets.data(), 0, offsets.size() * sizeof(U32));
+		for (U32 i = 0; i < count; i++)
+			offsets[depths[i] + 1]++;
+		for (I32 depth = 1; depth <= maxDepth + 1; depth++)
+			offsets[depth] += offsets[depth - 1];
+		for (U32 i = 0; i < count; i++)
+			sortedIndices[i] = offsets[depths[i]]++;
+
+		parents.resize(count);
+		for (U32 i = 0; i < count; i++)
+			parents[sortedIndices[i]] = parentIndices[i] >= 0 ? sortedIndices[parentIndices[i]] : -1;
+	}
+
+	U32 TransformHierarchy::Update()
+	{
+		// Removed entities
+		if (gatherCount != nodes.size())
+		{
+			nodes.resize(gatherCount);
+			gathered.resize(gatherCount);
+			isChanged = true;
+		}
+
+		// All world matrices are computed again after the hierarchy is changed
+		const bool forceUpdate = isChanged;
+		if (isChanged)
+			Sort();
+
+		transforms.resize(gatherCount);
+		for (U32 i = 0; i < gatherCount; i++)
+			transforms[sortedIndices[i]] = gathered[i];
+
+		const U32 count = (U32)transforms.size();
+		dirtyFlags.resize(count);
+
+		U32 updated = 0;
+		for (U32 i = 0; i < count; i++)
+		{
+			Transform& transform = *transforms[i];
+			const I32 parent = parents[i];
+			const bool isDirty = forceUpdate || transform.isDirty || (parent >= 0 && dirtyFlags[parent]);
+			dirtyFlags[i] = isDirty;
+			if (!isDirty)
+				continue;
+
+			MATRIX world = transform.GetLocalMatrix();
+			if (parent >= 0)
+				world = world * LoadFMat4x4(transforms[parent]->world);
+
+			transform.world = StoreFMat4x4(world);
+			transform.isDirty = false;
+			updated++;
+		}
+		return updated;
+	}
+
+	void TransformHierarchy::Clear()
+	{
+		nodes.clear();
+		gathered.clear();
+		sortedIndices.clear();
+		transforms.clear();
+		parents.clear();
+		dirtyFlags.clear();
+		gatherCount = 0;
+		isChanged = false;
+	}
+}
\ No newline at end of file
@@ -0,0 +1,52 @@
+#pragma once
+
+#include "core\common.h"
+#include "core\collections\array.h"
+#include "core\collections\hashMap.h"
+#include "core\scene\world.h"
+#include "math\math.hpp"
+
+namespace VulkanTest
+{
+	// Flat transform hierarchy of scene entities.
+	// Nodes are sorted by depth, so a parent is always before its children and all world matrices
+	// are computed in one linear pass, each node multiplies its local matrix with the world matrix of its parent.
+	// Dirty flags are propagated from parents to children, subtrees without changed transforms are skipped.
+	class VULKAN_TEST_API TransformHierarchy
+	{
+	public:
+		// Gather the transforms of current frame, Add is called for each entity with transform.
+		// The nodes are only sorted again if the entities or their parents are changed since the last frame.
+		void Begin();
+		void Add(ECS::Entity entity, Transform& transform);
+
+		// Update world matrices of the dirty nodes, returns the count of updated nodes
+		U32 Update();
+		void Clear();
+
+		U32 GetNodeCount()const {
+			return (U32)transforms.size();
+		}
+
+	private:
+		void Sort();
+
+		struct Node
+		{
+			ECS::Entity entity = ECS::INVALID_ENTITY;
+			ECS::Entity parent = ECS::INVALID_ENTITY;
+		};
+
+		// Nodes in gathering order
+		Array<Node> nodes;
+		Array<Transform*> gathered;
+		Array<I32> sortedIndices;
+		U32 gatherCount = 0;
+		bool isChanged = false;
+
+		// Nodes in depth order
+		Array<Transform*> transforms;
+		Array<I32> parents;
+		Array<U8> dirtyFlags;
+	};
+}
\ No newline at end of file